@@ -102,7 +102,7 @@ class BlockchainTest(BitcoinTestFramework):
 
     def _test_gettxoutsetinfo(self):
         node = self.nodes[0]
-        res = node.gettxoutsetinfo()
+        res = node.gettxoutsetinfo(True)
 
         assert_equal(res['total_amount'], Decimal('60000000.00000000'))
         assert_equal(res['transactions'], 120)
@@ -111,6 +111,13 @@ class BlockchainTest(BitcoinTestFramework):
         assert_equal(res['bytes_serialized'], 8520),
         assert_equal(len(res['bestblock']), 64)
         assert_equal(len(res['hash_serialized']), 64)
+        assert_equal(len(res['muhash']), 64)
+
+        # Without a full scan, the rolling statistics are returned
+        rolling = node.gettxoutsetinfo()
+        assert('hash_serialized' not in rolling)
+        for key in ['height', 'bestblock', 'txouts', 'total_amount', 'muhash']:
+            assert_equal(rolling[key], res[key])
 
     def _test_getblockheader(self):
         node = self.nodes[0]
@@ -0,0 +1,213 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "addressindex.h"
+
+#include "chain.h"
+#include "chainparams.h"
+#include "hash.h"
+#include "primitives/block.h"
+#include "txdb.h"
+#include "undo.h"
+#include "util.h"
+#include "validation.h"
+
+#include <boost/thread.hpp>
+
+bool fAddressIndexSynced = false;
+
+/** Number of changes collected while building the index before they are written */
+static const size_t ADDRESS_INDEX_SYNC_BATCH_SIZE = 100000;
+
+uint160 GetAddressIndexScriptHash(const CScript& scriptPubKey)
+{
+    return Hash160(scriptPubKey.begin(), scriptPubKey.end());
+}
+
+void CAddressIndexBatch::AddHistory(const CAddressIndexKey& key, CAmount nValue)
+{
+    setHistoryErased.erase(key);
+    mapHistory[key] = nValue;
+}
+
+void CAddressIndexBatch::EraseHistory(const CAddressIndexKey& key)
+{
+    mapHistory.erase(key);
+    setHistoryErased.insert(key);
+}
+
+void CAddressIndexBatch::AddUnspent(const CAddressUnspentKey& key, const CAddressUnspentValue& value)
+{
+    setUnspentErased.erase(key);
+    mapUnspent[key] = value;
+}
+
+void CAddressIndexBatch::EraseUnspent(const CAddressUnspentKey& key)
+{
+    mapUnspent.erase(key);
+    setUnspentErased.insert(key);
+}
+
+void CAddressIndexBatch::ConnectBlock(const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    hashBlock = pindex->GetBlockHash();
+    // The outputs of the genesis block are not spendable, so they are not indexed
+    if (pindex->pprev == NULL)
+        return;
+
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        const uint256& txhash = tx.GetHash();
+        if (i > 0) {
+            const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+            for (size_t j = 0; j < tx.vin.size(); j++) {
+                const Coin& coin = txundo.vprevout[j];
+                uint160 hashScript = GetAddressIndexScriptHash(coin.out.scriptPubKey);
+                AddHistory(CAddressIndexKey(hashScript, pindex->nHeight, txhash, j, true), -coin.out.nValue);
+                EraseUnspent(CAddressUnspentKey(hashScript, tx.vin[j].prevout.hash, tx.vin[j].prevout.n));
+            }
+        }
+        for (size_t o = 0; o < tx.vout.size(); o++) {
+            const CTxOut& out = tx.vout[o];
+            if (out.scriptPubKey.IsUnspendable())
+                continue;
+            uint160 hashScript = GetAddressIndexScriptHash(out.scriptPubKey);
+            AddHistory(CAddressIndexKey(hashScript, pindex->nHeight, txhash, o, false), out.nValue);
+            AddUnspent(CAddressUnspentKey(hashScript, txhash, o), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight));
+        }
+    }
+}
+
+void CAddressIndexBatch::DisconnectBlock(const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    assert(pindex->pprev);
+    hashBlock = pindex->pprev->GetBlockHash();
+
+    for (size_t i = block.vtx.size(); i-- > 0;) {
+        const CTransaction& tx = *block.vtx[i];
+        const uint256& txhash = tx.GetHash();
+        for (size_t o = 0; o < tx.vout.size(); o++) {
+            const CTxOut& out = tx.vout[o];
+            if (out.scriptPubKey.IsUnspendable())
+                continue;
+            uint160 hashScript = GetAddressIndexScriptHash(out.scriptPubKey);
+            EraseHistory(CAddressIndexKey(hashScript, pindex->nHeight, txhash, o, false));
+            EraseUnspent(CAddressUnspentKey(hashScript, txhash, o));
+        }
+        if (i > 0) {
+            const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+            for (size_t j = 0; j < tx.vin.size(); j++) {
+                const Coin& coin = txundo.vprevout[j];
+                uint160 hashScript = GetAddressIndexScriptHash(coin.out.scriptPubKey);
+                EraseHistory(CAddressIndexKey(hashScript, pindex->nHeight, txhash, j, true));
+                AddUnspent(CAddressUnspentKey(hashScript, tx.vin[j].prevout.hash, tx.vin[j].prevout.n),
+                           CAddressUnspentValue(coin.out.nValue, coin.out.scriptPubKey, coin.nHeight));
+            }
+        }
+    }
+}
+
+void CAddressIndexBatch::Clear()
+{
+    hashBlock.SetNull();
+    mapHistory.clear();
+    setHistoryErased.clear();
+    mapUnspent.clear();
+    setUnspentErased.clear();
+}
+
+static bool ReadBlockAndUndo(CBlock& block, CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus(pindex->nHeight)))
+        return false;
+    return UndoReadFromDisk(blockundo, pindex);
+}
+
+void ThreadSyncAddressIndex()
+{
+    RenameThread("dogecoin-addrindex");
+
+    // Pick up where the index was left, which may be a block that is no
+    // longer part of the active chain
+    const CBlockIndex* pindex = NULL;
+    uint256 hashBest;
+    if (pblocktree->ReadAddressIndexBestBlock(hashBest)) {
+        LOCK(cs_main);
+        BlockMap::const_iterator mi = mapBlockIndex.find(hashBest);
+        if (mi != mapBlockIndex.end())
+            pindex = mi->second;
+    }
+    if (pindex == NULL) {
+        LogPrintf("%s: building the address index from scratch\n", __func__);
+        if (!pblocktree->EraseAddressIndex()) {
+            LogPrintf("%s: failed to erase the address index\n", __func__);
+            return;
+        }
+    } else {
+        LogPrintf("%s: address index at block %s (height %d)\n", __func__, pindex->GetBlockHash().ToString(), pindex->nHeight);
+    }
+
+    CAddressIndexBatch batch;
+    int64_t nLastProgress = GetTime();
+    while (true) {
+        boost::this_thread::interruption_point();
+
+        const CBlockIndex* pindexStep = NULL;
+        bool fConnect = true;
+        {
+            LOCK(cs_main);
+            if (pindex == chainActive.Tip()) {
+                if (batch.IsNull()) {
+                    // Everything up to the tip is written, so further blocks
+                    // are indexed as they are connected
+                    fAddressIndexSynced = true;
+                    LogPrintf("%s: address index synced at height %d\n", __func__, chainActive.Height());
+                    return;
+                }
+            } else if (pindex != NULL && !chainActive.Contains(pindex)) {
+                // Rewind blocks that were reorganized away while the index was behind
+                pindexStep = pindex;
+                fConnect = false;
+            } else {
+                pindexStep = pindex == NULL ? chainActive.Genesis() : chainActive.Next(pindex);
+            }
+        }
+
+        if (pindexStep != NULL) {
+            CBlock block;
+            CBlockUndo blockundo;
+            if (fConnect) {
+                if (pindexStep->pprev != NULL && !ReadBlockAndUndo(block, blockundo, pindexStep)) {
+                    LogPrintf("%s: failed to read block %s, the address index is not available\n", __func__, pindexStep->GetBlockHash().ToString());
+                    return;
+                }
+                batch.ConnectBlock(block, blockundo, pindexStep);
+                pindex = pindexStep;
+            } else {
+                if (!ReadBlockAndUndo(block, blockundo, pindexStep)) {
+                    LogPrintf("%s: failed to read block %s, rebuilding the address index\n", __func__, pindexStep->GetBlockHash().ToString());
+                    batch.Clear();
+                    pindex = NULL;
+                    if (!pblocktree->EraseAddressIndex())
+                        return;
+                    continue;
+                }
+                batch.DisconnectBlock(block, blockundo, pindexStep);
+                pindex = pindexStep->pprev;
+            }
+        }
+
+        if (!batch.IsNull() && (pindexStep == NULL || batch.GetCount() >= ADDRESS_INDEX_SYNC_BATCH_SIZE)) {
+            if (!pblocktree->WriteAddressIndex(batch)) {
+                LogPrintf("%s: failed to write the address index\n", __func__);
+                return;
+            }
+            batch.Clear();
+            if (GetTime() - nLastProgress >= 60) {
+                LogPrintf("%s: address index at height %d\n", __func__, pindex->nHeight);
+                nLastProgress = GetTime();
+            }
+        }
+    }
+}
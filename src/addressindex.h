@@ -0,0 +1,164 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_ADDRESSINDEX_H
+#define BITCOIN_ADDRESSINDEX_H
+
+#include "amount.h"
+#include "script/script.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <map>
+#include <set>
+#include <stdint.h>
+
+class CBlock;
+class CBlockIndex;
+class CBlockUndo;
+
+/** Default for -addressindex */
+static const bool DEFAULT_ADDRESSINDEX = false;
+
+/** The key under which outputs to a script are indexed: the Hash160 of the scriptPubKey */
+uint160 GetAddressIndexScriptHash(const CScript& scriptPubKey);
+
+/**
+ * An output paying to a script, or an input spending such an output. Heights
+ * are serialized big endian, so that the history of a script is ordered by
+ * height in the database and a height range is a single range of keys.
+ */
+struct CAddressIndexKey
+{
+    uint160 hashScript;
+    int nHeight;
+    uint256 txhash;
+    uint32_t nIndex;
+    bool fSpending;
+
+    CAddressIndexKey() : nHeight(0), nIndex(0), fSpending(false) {}
+    CAddressIndexKey(const uint160& hashScriptIn, int nHeightIn, const uint256& txhashIn, uint32_t nIndexIn, bool fSpendingIn) :
+        hashScript(hashScriptIn), nHeight(nHeightIn), txhash(txhashIn), nIndex(nIndexIn), fSpending(fSpendingIn) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        s << hashScript;
+        ser_writedata32be(s, nHeight);
+        s << txhash;
+        ser_writedata32be(s, nIndex);
+        s << fSpending;
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        s >> hashScript;
+        nHeight = ser_readdata32be(s);
+        s >> txhash;
+        nIndex = ser_readdata32be(s);
+        s >> fSpending;
+    }
+
+    friend bool operator<(const CAddressIndexKey& a, const CAddressIndexKey& b) {
+        if (a.hashScript != b.hashScript)
+            return a.hashScript < b.hashScript;
+        if (a.nHeight != b.nHeight)
+            return a.nHeight < b.nHeight;
+        if (a.txhash != b.txhash)
+            return a.txhash < b.txhash;
+        if (a.nIndex != b.nIndex)
+            return a.nIndex < b.nIndex;
+        return a.fSpending < b.fSpending;
+    }
+};
+
+/** An unspent output paying to a script */
+struct CAddressUnspentKey
+{
+    uint160 hashScript;
+    uint256 txhash;
+    uint32_t nIndex;
+
+    CAddressUnspentKey() : nIndex(0) {}
+    CAddressUnspentKey(const uint160& hashScriptIn, const uint256& txhashIn, uint32_t nIndexIn) :
+        hashScript(hashScriptIn), txhash(txhashIn), nIndex(nIndexIn) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        s << hashScript << txhash;
+        ser_writedata32be(s, nIndex);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        s >> hashScript >> txhash;
+        nIndex = ser_readdata32be(s);
+    }
+
+    friend bool operator<(const CAddressUnspentKey& a, const CAddressUnspentKey& b) {
+        if (a.hashScript != b.hashScript)
+            return a.hashScript < b.hashScript;
+        if (a.txhash != b.txhash)
+            return a.txhash < b.txhash;
+        return a.nIndex < b.nIndex;
+    }
+};
+
+struct CAddressUnspentValue
+{
+    CAmount nValue;
+    CScript script;
+    int nHeight;
+
+    CAddressUnspentValue() : nValue(0), nHeight(0) {}
+    CAddressUnspentValue(CAmount nValueIn, const CScript& scriptIn, int nHeightIn) :
+        nValue(nValueIn), script(scriptIn), nHeight(nHeightIn) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nValue);
+        READWRITE(*(CScriptBase*)(&script));
+        READWRITE(nHeight);
+    }
+};
+
+/**
+ * Changes to the address index made by connecting or disconnecting blocks,
+ * which are written to the block tree database in one batch together with
+ * the block the index is at afterwards. Spends are stored with a negative
+ * amount.
+ */
+class CAddressIndexBatch
+{
+public:
+    //! The block the index is at once the batch is written, null if there are no changes
+    uint256 hashBlock;
+    std::map<CAddressIndexKey, CAmount> mapHistory;
+    std::set<CAddressIndexKey> setHistoryErased;
+    std::map<CAddressUnspentKey, CAddressUnspentValue> mapUnspent;
+    std::set<CAddressUnspentKey> setUnspentErased;
+
+    void ConnectBlock(const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex);
+    void DisconnectBlock(const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex);
+
+    bool IsNull() const { return hashBlock.IsNull(); }
+    size_t GetCount() const { return mapHistory.size() + setHistoryErased.size() + mapUnspent.size() + setUnspentErased.size(); }
+    void Clear();
+
+private:
+    void AddHistory(const CAddressIndexKey& key, CAmount nValue);
+    void EraseHistory(const CAddressIndexKey& key);
+    void AddUnspent(const CAddressUnspentKey& key, const CAddressUnspentValue& value);
+    void EraseUnspent(const CAddressUnspentKey& key);
+};
+
+/** Whether ConnectTip() and DisconnectTip() keep the address index up to date.
+ *  Set once the index caught up with the active chain. Protected by cs_main. */
+extern bool fAddressIndexSynced;
+
+/** Run the thread that builds the address index up to the active chain in the background */
+void ThreadSyncAddressIndex();
+
+#endif // BITCOIN_ADDRESSINDEX_H
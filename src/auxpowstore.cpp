@@ -0,0 +1,105 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "auxpowstore.h"
+
+#include "auxpow.h"
+#include "txdb.h"
+
+#include <vector>
+
+CAuxPowStore auxpowstore;
+
+void CAuxPowStore::Touch(const uint256& hash, const boost::shared_ptr<CAuxPow>& auxpow)
+{
+    AssertLockHeld(cs);
+    auto it = mapLRU.find(hash);
+    if (it != mapLRU.end()) {
+        lru.splice(lru.begin(), lru, it->second);
+        return;
+    }
+    lru.push_front(std::make_pair(hash, auxpow));
+    mapLRU[hash] = lru.begin();
+    while (lru.size() > nMaxEntries) {
+        mapLRU.erase(lru.back().first);
+        lru.pop_back();
+    }
+}
+
+void CAuxPowStore::Add(const uint256& hash, const boost::shared_ptr<CAuxPow>& auxpow)
+{
+    LOCK(cs);
+    mapUnwritten[hash] = auxpow;
+    Touch(hash, auxpow);
+}
+
+boost::shared_ptr<CAuxPow> CAuxPowStore::Get(const uint256& hash, CBlockTreeDB* db)
+{
+    {
+        LOCK(cs);
+        auto it = mapLRU.find(hash);
+        if (it != mapLRU.end()) {
+            lru.splice(lru.begin(), lru, it->second);
+            return it->second->second;
+        }
+        auto itUnwritten = mapUnwritten.find(hash);
+        if (itUnwritten != mapUnwritten.end()) {
+            Touch(hash, itUnwritten->second);
+            return itUnwritten->second;
+        }
+    }
+
+    // Read without holding cs, so that lookups of cached entries do not
+    // wait on disk I/O.
+    boost::shared_ptr<CAuxPow> auxpow(new CAuxPow());
+    if (!db || !db->ReadAuxPow(hash, *auxpow))
+        return boost::shared_ptr<CAuxPow>();
+
+    LOCK(cs);
+    Touch(hash, auxpow);
+    return auxpow;
+}
+
+bool CAuxPowStore::Flush(CBlockTreeDB& db)
+{
+    std::map<uint256, boost::shared_ptr<CAuxPow> > mapWrite;
+    {
+        LOCK(cs);
+        mapWrite.swap(mapUnwritten);
+    }
+    if (mapWrite.empty())
+        return true;
+
+    std::vector<std::pair<uint256, const CAuxPow*> > vAuxPow;
+    vAuxPow.reserve(mapWrite.size());
+    for (const auto& entry : mapWrite)
+        vAuxPow.push_back(std::make_pair(entry.first, entry.second.get()));
+    if (!db.WriteAuxPow(vAuxPow)) {
+        // Keep the entries so that the next flush retries them.
+        LOCK(cs);
+        mapUnwritten.insert(mapWrite.begin(), mapWrite.end());
+        return false;
+    }
+    return true;
+}
+
+void CAuxPowStore::Clear()
+{
+    LOCK(cs);
+    lru.clear();
+    mapLRU.clear();
+    mapUnwritten.clear();
+}
+
+size_t CAuxPowStore::CachedEntries() const
+{
+    LOCK(cs);
+    return lru.size();
+}
+
+size_t CAuxPowStore::UnwrittenEntries() const
+{
+    LOCK(cs);
+    return mapUnwritten.size();
+}
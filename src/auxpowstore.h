@@ -0,0 +1,74 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_AUXPOWSTORE_H
+#define BITCOIN_AUXPOWSTORE_H
+
+#include "sync.h"
+#include "uint256.h"
+
+#include <list>
+#include <map>
+#include <utility>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+class CAuxPow;
+class CBlockTreeDB;
+
+/** Default number of auxpows kept in memory by the auxpow store */
+static const size_t DEFAULT_AUXPOW_CACHE_ENTRIES = 4096;
+
+/**
+ * Store of the auxpow of merge-mined block headers, keyed by block hash.
+ *
+ * CDiskBlockIndex does not keep the auxpow, so without this store every
+ * auxpow header has to be read back from the block files. Entries are
+ * persisted in the block tree database, and a bounded LRU keeps recently
+ * used ones in memory. Entries that have not been written yet are pinned
+ * in memory until the next Flush().
+ */
+class CAuxPowStore
+{
+private:
+    struct CheapHasher
+    {
+        size_t operator()(const uint256& hash) const { return hash.GetCheapHash(); }
+    };
+
+    typedef std::list<std::pair<uint256, boost::shared_ptr<CAuxPow> > > LRUList;
+
+    mutable CCriticalSection cs;
+    //! Most recently used entries at the front
+    LRUList lru;
+    boost::unordered_map<uint256, LRUList::iterator, CheapHasher> mapLRU;
+    //! Entries that still have to be written to the database
+    std::map<uint256, boost::shared_ptr<CAuxPow> > mapUnwritten;
+    size_t nMaxEntries;
+
+    void Touch(const uint256& hash, const boost::shared_ptr<CAuxPow>& auxpow);
+
+public:
+    explicit CAuxPowStore(size_t nMaxEntriesIn = DEFAULT_AUXPOW_CACHE_ENTRIES) : nMaxEntries(nMaxEntriesIn) {}
+
+    /** Add the auxpow of a block header; it is written on the next Flush(). */
+    void Add(const uint256& hash, const boost::shared_ptr<CAuxPow>& auxpow);
+
+    /** Look up an auxpow in memory, then in db. Returns NULL if not found. */
+    boost::shared_ptr<CAuxPow> Get(const uint256& hash, CBlockTreeDB* db);
+
+    /** Write all unwritten entries to db. */
+    bool Flush(CBlockTreeDB& db);
+
+    /** Forget everything kept in memory, including unwritten entries. */
+    void Clear();
+
+    size_t CachedEntries() const;
+    size_t UnwrittenEntries() const;
+};
+
+extern CAuxPowStore auxpowstore;
+
+#endif // BITCOIN_AUXPOWSTORE_H
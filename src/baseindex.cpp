@@ -0,0 +1,207 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "baseindex.h"
+
+#include "chain.h"
+#include "chainparams.h"
+#include "util.h"
+#include "utiltime.h"
+#include "validation.h"
+
+#include <boost/bind/bind.hpp>
+#include <boost/thread.hpp>
+
+static const char DB_BEST_BLOCK = 'B';
+
+/** How often the index commits while it is catching up, in seconds */
+static const int64_t SYNC_COMMIT_INTERVAL = 30;
+/** How often the progress of catching up is logged, in seconds */
+static const int64_t SYNC_LOG_INTERVAL = 30;
+/** How long BlockUntilSyncedToCurrentChain() waits for the index, in milliseconds */
+static const int64_t SYNC_WAIT_TIMEOUT = 5000;
+
+CBaseIndex::DB::DB(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool fObfuscate) :
+    CDBWrapper(path, nCacheSize, fMemory, fWipe, fObfuscate)
+{}
+
+bool CBaseIndex::DB::ReadBestBlock(CBlockLocator& locator) const
+{
+    bool fSuccess = Read(DB_BEST_BLOCK, locator);
+    if (!fSuccess)
+        locator.SetNull();
+    return fSuccess;
+}
+
+void CBaseIndex::DB::WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator)
+{
+    batch.Write(DB_BEST_BLOCK, locator);
+}
+
+CBaseIndex::CBaseIndex() :
+    fSynced(false), pbestBlockIndex(NULL), fTipChanged(false), nLastCommit(0), fCommitted(true)
+{}
+
+CBaseIndex::~CBaseIndex()
+{
+}
+
+bool CBaseIndex::Init()
+{
+    CBlockLocator locator;
+    GetDB().ReadBestBlock(locator);
+
+    LOCK(cs_main);
+    if (locator.IsNull()) {
+        pbestBlockIndex = NULL;
+    } else {
+        // Blocks after the fork with the active chain are indexed again
+        pbestBlockIndex = FindForkInGlobalIndex(chainActive, locator);
+    }
+    return true;
+}
+
+void CBaseIndex::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload)
+{
+    boost::unique_lock<boost::mutex> lock(csSync);
+    fTipChanged = true;
+    cvSync.notify_all();
+}
+
+bool CBaseIndex::Commit()
+{
+    const CBlockIndex* pindex = pbestBlockIndex;
+    if (pindex == NULL)
+        return true;
+
+    CDBBatch batch(GetDB());
+    if (!CommitInternal(batch))
+        return error("%s: failed to commit the %s", __func__, GetName());
+    {
+        LOCK(cs_main);
+        GetDB().WriteBestBlock(batch, chainActive.GetLocator(pindex));
+    }
+    if (!GetDB().WriteBatch(batch))
+        return error("%s: failed to commit the %s", __func__, GetName());
+    nLastCommit = GetTime();
+    fCommitted = true;
+    return true;
+}
+
+void CBaseIndex::ThreadSync()
+{
+    RenameThread("dogecoin-index");
+    const CChainParams& chainparams = Params();
+
+    const CBlockIndex* pindex = pbestBlockIndex;
+    int64_t nLastLog = 0;
+    nLastCommit = GetTime();
+    while (true) {
+        boost::this_thread::interruption_point();
+        {
+            boost::unique_lock<boost::mutex> lock(csSync);
+            fTipChanged = false;
+        }
+
+        const CBlockIndex* pindexFork = NULL;
+        const CBlockIndex* pindexNext = NULL;
+        {
+            LOCK(cs_main);
+            if (pindex != NULL && !chainActive.Contains(pindex))
+                pindexFork = chainActive.FindFork(pindex);
+            else
+                pindexNext = pindex == NULL ? chainActive.Genesis() : chainActive.Next(pindex);
+        }
+
+        if (pindexFork != NULL) {
+            if (!Rewind(pindex, pindexFork)) {
+                LogPrintf("%s: failed to rewind the %s to %s, it is not updated anymore\n", __func__, GetName(), pindexFork->GetBlockHash().ToString());
+                return;
+            }
+            pindex = pindexFork;
+            pbestBlockIndex = pindex;
+            fCommitted = false;
+            continue;
+        }
+
+        if (pindexNext == NULL) {
+            // Caught up; commit and wait for the tip to change. Before the
+            // genesis block is connected there is nothing to catch up with.
+            if (!fSynced && pindex != NULL) {
+                LogPrintf("%s: %s is enabled at height %d\n", __func__, GetName(), pindex ? pindex->nHeight : -1);
+                fSynced = true;
+            }
+            if (!fCommitted)
+                Commit();
+            boost::unique_lock<boost::mutex> lock(csSync);
+            cvSync.notify_all();
+            while (!fTipChanged)
+                cvSync.wait(lock);
+            continue;
+        }
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindexNext, chainparams.GetConsensus(pindexNext->nHeight))) {
+            LogPrintf("%s: failed to read block %s from disk, the %s is not updated anymore\n", __func__, pindexNext->GetBlockHash().ToString(), GetName());
+            return;
+        }
+        if (!WriteBlock(block, pindexNext)) {
+            LogPrintf("%s: failed to write block %s to the %s, it is not updated anymore\n", __func__, pindexNext->GetBlockHash().ToString(), GetName());
+            return;
+        }
+        pindex = pindexNext;
+        {
+            boost::unique_lock<boost::mutex> lock(csSync);
+            pbestBlockIndex = pindex;
+            cvSync.notify_all();
+        }
+        fCommitted = false;
+
+        int64_t nNow = GetTime();
+        if (!fSynced && nNow - nLastLog >= SYNC_LOG_INTERVAL) {
+            LogPrintf("Syncing %s with block chain from height %d\n", GetName(), pindex->nHeight);
+            nLastLog = nNow;
+        }
+        if (nNow - nLastCommit >= SYNC_COMMIT_INTERVAL)
+            Commit();
+    }
+}
+
+bool CBaseIndex::Start(boost::thread_group& threadGroup)
+{
+    if (!Init())
+        return error("%s: failed to initialize the %s", __func__, GetName());
+    RegisterValidationInterface(this);
+    threadGroup.create_thread(boost::bind(&CBaseIndex::ThreadSync, this));
+    return true;
+}
+
+void CBaseIndex::Stop()
+{
+    UnregisterValidationInterface(this);
+    if (!fCommitted)
+        Commit();
+}
+
+bool CBaseIndex::BlockUntilSyncedToCurrentChain()
+{
+    if (!fSynced)
+        return false;
+
+    const CBlockIndex* pindexTip;
+    {
+        LOCK(cs_main);
+        pindexTip = chainActive.Tip();
+    }
+
+    boost::system_time deadline = boost::get_system_time() + boost::posix_time::milliseconds(SYNC_WAIT_TIMEOUT);
+    boost::unique_lock<boost::mutex> lock(csSync);
+    while (true) {
+        const CBlockIndex* pindexBest = pbestBlockIndex;
+        if (pindexBest != NULL && pindexBest->GetAncestor(pindexTip->nHeight) == pindexTip)
+            return true;
+        if (!cvSync.timed_wait(lock, deadline))
+            return false;
+    }
+}
@@ -0,0 +1,110 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BASEINDEX_H
+#define BITCOIN_BASEINDEX_H
+
+#include "dbwrapper.h"
+#include "primitives/block.h"
+#include "validationinterface.h"
+
+#include <atomic>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+class CBlockIndex;
+
+namespace boost {
+class thread_group;
+} // namespace boost
+
+/**
+ * Base class for indexes that live in a database of their own and follow the
+ * active chain on a thread of their own. The thread is woken up by
+ * UpdatedBlockTip notifications and reads the blocks it has not indexed yet
+ * from disk, so an index for an existing chain is built in the background
+ * while the node keeps running. Where the index is at is stored as a block
+ * locator, from which it picks up again after a restart or a reorg.
+ */
+class CBaseIndex : public CValidationInterface
+{
+protected:
+    class DB : public CDBWrapper
+    {
+    public:
+        DB(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool fObfuscate = false);
+
+        bool ReadBestBlock(CBlockLocator& locator) const;
+        void WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator);
+    };
+
+private:
+    //! Whether the index caught up with the active chain at least once
+    std::atomic<bool> fSynced;
+    //! The last block that was indexed
+    std::atomic<const CBlockIndex*> pbestBlockIndex;
+
+    //! Guards fTipChanged and signals progress of the index thread
+    boost::mutex csSync;
+    boost::condition_variable cvSync;
+    bool fTipChanged;
+
+    int64_t nLastCommit;
+    bool fCommitted;
+
+    /** Write the index's own data and the block it is at to disk */
+    bool Commit();
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override;
+
+    /** Initialize internal state from the database and the block index. */
+    virtual bool Init();
+
+    /** Index a block that extends the one the index is at. */
+    virtual bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) = 0;
+
+    /** Make the data written so far durable. Entries can be added to the batch
+     *  that stores the best block. */
+    virtual bool CommitInternal(CDBBatch& batch) { return true; }
+
+    /** Rewind the index from pindexTip to its ancestor pindexNewTip, after the
+     *  blocks in between were disconnected from the active chain. */
+    virtual bool Rewind(const CBlockIndex* pindexTip, const CBlockIndex* pindexNewTip) { return true; }
+
+    virtual DB& GetDB() const = 0;
+
+    /** Name of the index, for logging */
+    virtual const char* GetName() const = 0;
+
+public:
+    CBaseIndex();
+    virtual ~CBaseIndex();
+
+    /** Follow the active chain until interrupted. */
+    void ThreadSync();
+
+    /** Start following the active chain on a new thread of threadGroup. */
+    bool Start(boost::thread_group& threadGroup);
+
+    /** Stop listening to notifications and commit what was indexed. The thread
+     *  has to be interrupted and joined first. */
+    void Stop();
+
+    /** Whether the index caught up with the active chain at least once */
+    bool IsSynced() const { return fSynced; }
+
+    const CBlockIndex* GetBestBlockIndex() const { return pbestBlockIndex; }
+
+    /** The database of the index, for statistics */
+    const CDBWrapper& GetDatabase() const { return GetDB(); }
+
+    /** Wait briefly for the index to catch up with the current tip of the
+     *  active chain. Returns false if it did not, e.g. because it is still
+     *  being built. */
+    bool BlockUntilSyncedToCurrentChain();
+};
+
+#endif // BITCOIN_BASEINDEX_H
@@ -4,15 +4,21 @@
 
 #include "bench.h"
 
+#include "crypto/scrypt.h"
+#include "crypto/sha256.h"
 #include "key.h"
+#include "script/sigcache.h"
 #include "validation.h"
 #include "util.h"
 
 int
 main(int argc, char** argv)
 {
+    SHA256AutoDetect();
+    scrypt_detect_multi();
     ECC_Start();
     SetupEnvironment();
+    InitSignatureCache();
     fPrintToDebugLog = false; // don't want to write to debug.log file
 
     benchmark::BenchRunner::RunAll();
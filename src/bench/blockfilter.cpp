@@ -0,0 +1,82 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "amount.h"
+#include "blockfilter.h"
+#include "pubkey.h"
+#include "random.h"
+#include "script/standard.h"
+#include "uint256.h"
+#include "undo.h"
+
+#include <vector>
+
+// A block of pay-to-pubkey-hash transactions and the undo data of the outputs
+// they spend, about the size of a busy Dogecoin block.
+static const size_t TXS_PER_BLOCK = 1000;
+static const size_t INPUTS_PER_TX = 2;
+static const size_t OUTPUTS_PER_TX = 2;
+
+static CScript RandomP2PKHScript()
+{
+    uint160 hash;
+    GetRandBytes(hash.begin(), hash.size());
+    return GetScriptForDestination(CKeyID(hash));
+}
+
+static void BuildBlockAndUndo(CBlock& block, CBlockUndo& blockundo)
+{
+    block.vtx.clear();
+    blockundo.vtxundo.clear();
+    for (size_t i = 0; i < TXS_PER_BLOCK; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(INPUTS_PER_TX);
+        for (size_t j = 0; j < OUTPUTS_PER_TX; j++)
+            tx.vout.push_back(CTxOut(1 * COIN, RandomP2PKHScript()));
+        block.vtx.push_back(MakeTransactionRef(std::move(tx)));
+
+        CTxUndo txundo;
+        for (size_t j = 0; j < INPUTS_PER_TX; j++)
+            txundo.vprevout.push_back(Coin(CTxOut(1 * COIN, RandomP2PKHScript()), 1, false));
+        blockundo.vtxundo.push_back(txundo);
+    }
+}
+
+// Building the basic filter of a block, as the block filter index does for
+// every block it indexes.
+static void BlockFilterConstruct(benchmark::State& state)
+{
+    CBlock block;
+    CBlockUndo blockundo;
+    BuildBlockAndUndo(block, blockundo);
+
+    while (state.KeepRunning()) {
+        BlockFilter filter(BASIC, block, blockundo);
+        assert(filter.GetFilter().GetN() > 0);
+    }
+}
+
+// Matching a wallet's scripts against a filter, as a light client does.
+static void BlockFilterMatchAny(benchmark::State& state)
+{
+    CBlock block;
+    CBlockUndo blockundo;
+    BuildBlockAndUndo(block, blockundo);
+    BlockFilter filter(BASIC, block, blockundo);
+
+    GCSFilter::ElementSet elements;
+    for (int i = 0; i < 100; i++) {
+        CScript script = RandomP2PKHScript();
+        elements.emplace(script.begin(), script.end());
+    }
+
+    while (state.KeepRunning()) {
+        filter.GetFilter().MatchAny(elements);
+    }
+}
+
+BENCHMARK(BlockFilterConstruct);
+BENCHMARK(BlockFilterMatchAny);
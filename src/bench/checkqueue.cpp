@@ -7,6 +7,7 @@
 #include "validation.h"
 #include "checkqueue.h"
 #include "prevector.h"
+#include "crypto/sha256.h"
 #include <vector>
 #include <boost/thread/thread.hpp>
 #include "random.h"
@@ -99,5 +100,55 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::State& state)
     tg.interrupt_all();
     tg.join_all();
 }
+
+// This Benchmark measures how the CheckQueue scales with the number of
+// worker threads. Every check hashes a few times, which is roughly the cost
+// of a cached signature lookup, so the queue overhead is still visible but
+// there is real work to share out. On machines with fewer cores than
+// threads the extra workers only add scheduling overhead.
+static const size_t SCALING_HASHES = 16;
+static void CCheckQueueScaling(benchmark::State& state, int nThreads)
+{
+    struct HashJob {
+        uint8_t data[CSHA256::OUTPUT_SIZE] = {};
+        bool operator()()
+        {
+            for (size_t i = 0; i < SCALING_HASHES; i++)
+                CSHA256().Write(data, sizeof(data)).Finalize(data);
+            return true;
+        }
+        void swap(HashJob& x){std::swap(data, x.data);};
+    };
+    CCheckQueue<HashJob> queue {QUEUE_BATCH_SIZE};
+    boost::thread_group tg;
+    // The master joins in, so start one fewer worker than threads wanted.
+    for (auto x = 0; x < nThreads - 1; ++x) {
+       tg.create_thread([&]{queue.Thread();});
+    }
+    while (state.KeepRunning()) {
+        CCheckQueueControl<HashJob> control(&queue);
+        std::vector<std::vector<HashJob>> vBatches(BATCHES);
+        for (auto& vChecks : vBatches) {
+            vChecks.resize(BATCH_SIZE);
+            control.Add(vChecks);
+        }
+        control.Wait();
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
+static void CCheckQueueScaling1(benchmark::State& state) { CCheckQueueScaling(state, 1); }
+static void CCheckQueueScaling2(benchmark::State& state) { CCheckQueueScaling(state, 2); }
+static void CCheckQueueScaling4(benchmark::State& state) { CCheckQueueScaling(state, 4); }
+static void CCheckQueueScaling8(benchmark::State& state) { CCheckQueueScaling(state, 8); }
+static void CCheckQueueScaling16(benchmark::State& state) { CCheckQueueScaling(state, 16); }
+static void CCheckQueueScaling32(benchmark::State& state) { CCheckQueueScaling(state, 32); }
+
 BENCHMARK(CCheckQueueSpeed);
 BENCHMARK(CCheckQueueSpeedPrevectorJob);
+BENCHMARK(CCheckQueueScaling1);
+BENCHMARK(CCheckQueueScaling2);
+BENCHMARK(CCheckQueueScaling4);
+BENCHMARK(CCheckQueueScaling8);
+BENCHMARK(CCheckQueueScaling16);
+BENCHMARK(CCheckQueueScaling32);
@@ -0,0 +1,109 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chainparams.h"
+#include "coins.h"
+#include "consensus/merkle.h"
+#include "consensus/validation.h"
+#include "key.h"
+#include "keystore.h"
+#include "primitives/block.h"
+#include "pubkey.h"
+#include "random.h"
+#include "script/sign.h"
+#include "script/standard.h"
+#include "validation.h"
+
+#include <vector>
+
+// ConnectBlock() over a block that only spends pay-to-pubkey-hash outputs,
+// at a height where the address blacklist is enforced. Signatures land in
+// the signature cache during the first run, so later runs are dominated by
+// the per-input UTXO, blacklist and sighash work.
+static const int BLOCK_HEIGHT = 280000;
+static const size_t TXS_PER_BLOCK = 250;
+static const size_t INPUTS_PER_TX = 4;
+
+static void ConnectBlockP2PKH(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    const CChainParams& chainparams = Params();
+    ECCVerifyHandle verifyHandle;
+
+    CBasicKeyStore keystore;
+    CKey key;
+    key.MakeNewKey(true);
+    keystore.AddKey(key);
+
+    // ConnectBlock() looks up ancestors (e.g. at the BIP34 height), so the
+    // block needs a complete chain of index entries below it. Their hashes
+    // are never compared to anything but each other. The spend height is
+    // taken from the parent's entry in mapBlockIndex.
+    uint256 hashPrev = GetRandHash();
+    std::vector<CBlockIndex> vIndex(BLOCK_HEIGHT + 1);
+    for (int i = 0; i <= BLOCK_HEIGHT; i++) {
+        vIndex[i].phashBlock = &hashPrev;
+        vIndex[i].nHeight = i;
+        vIndex[i].pprev = i > 0 ? &vIndex[i - 1] : NULL;
+        vIndex[i].BuildSkip();
+    }
+    CBlockIndex& index = vIndex[BLOCK_HEIGHT];
+    const ChainSigVersion chainSigVersion = GetChainSigVersion(index.pprev, chainparams.GetConsensus(BLOCK_HEIGHT));
+
+    CMutableTransaction txFunding;
+    txFunding.vin.resize(1);
+    txFunding.vin[0].prevout.hash = GetRandHash();
+    txFunding.vout.resize(TXS_PER_BLOCK * INPUTS_PER_TX);
+    for (CTxOut& txout : txFunding.vout) {
+        txout.nValue = COIN;
+        txout.scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+    }
+    const CTransaction txFundingFinal(txFunding);
+
+    CCoinsView coinsDummy;
+    CCoinsViewCache coinsBase(&coinsDummy);
+    AddCoins(coinsBase, txFundingFinal, 1);
+    coinsBase.SetBestBlock(hashPrev);
+
+    CBlock block;
+    CMutableTransaction txCoinbase;
+    txCoinbase.vin.resize(1);
+    txCoinbase.vin[0].prevout.SetNull();
+    txCoinbase.vin[0].scriptSig = CScript() << BLOCK_HEIGHT << OP_0;
+    txCoinbase.vout.resize(1);
+    txCoinbase.vout[0].nValue = 0;
+    block.vtx.push_back(MakeTransactionRef(std::move(txCoinbase)));
+    for (size_t i = 0; i < TXS_PER_BLOCK; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(INPUTS_PER_TX);
+        for (size_t j = 0; j < INPUTS_PER_TX; j++) {
+            tx.vin[j].prevout.hash = txFundingFinal.GetHash();
+            tx.vin[j].prevout.n = i * INPUTS_PER_TX + j;
+        }
+        tx.vout.resize(1);
+        tx.vout[0].nValue = INPUTS_PER_TX * COIN;
+        tx.vout[0].scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+        for (size_t j = 0; j < INPUTS_PER_TX; j++) {
+            bool fSigned = SignSignature(keystore, txFundingFinal, tx, j, SIGHASH_ALL, chainSigVersion);
+            assert(fSigned);
+        }
+        block.vtx.push_back(MakeTransactionRef(std::move(tx)));
+    }
+    block.hashPrevBlock = hashPrev;
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+
+    LOCK(cs_main);
+    mapBlockIndex[hashPrev] = index.pprev;
+    while (state.KeepRunning()) {
+        CCoinsViewCache view(&coinsBase);
+        CValidationState validationState;
+        bool fConnected = ConnectBlock(block, validationState, &index, view, chainparams, true);
+        assert(fConnected);
+    }
+    mapBlockIndex.erase(hashPrev);
+}
+
+BENCHMARK(ConnectBlockP2PKH);
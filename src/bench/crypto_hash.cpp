@@ -51,6 +51,31 @@ static void SHA256_32b(benchmark::State& state)
     }
 }
 
+static void SHA256D64_1024(benchmark::State& state)
+{
+    std::vector<uint8_t> in(64 * 1024, 0);
+    while (state.KeepRunning()) {
+        SHA256D64(in.data(), in.data(), 1024);
+    }
+}
+
+/* Run a benchmark with only the given SHA256 implementations enabled */
+static void WithSHA256(benchmark::State& state, int allowed, void (*bench)(benchmark::State&))
+{
+    std::cout << "Using the '" << SHA256AutoDetect(allowed) << "' SHA256 implementation" << std::endl;
+    bench(state);
+    SHA256AutoDetect();
+}
+
+static void SHA256_standard(benchmark::State& state) { WithSHA256(state, SHA256_STANDARD, SHA256); }
+static void SHA256_shani(benchmark::State& state) { WithSHA256(state, SHA256_SHANI, SHA256); }
+static void SHA256_32b_standard(benchmark::State& state) { WithSHA256(state, SHA256_STANDARD, SHA256_32b); }
+static void SHA256_32b_shani(benchmark::State& state) { WithSHA256(state, SHA256_SHANI, SHA256_32b); }
+static void SHA256D64_1024_standard(benchmark::State& state) { WithSHA256(state, SHA256_STANDARD, SHA256D64_1024); }
+static void SHA256D64_1024_shani(benchmark::State& state) { WithSHA256(state, SHA256_SHANI, SHA256D64_1024); }
+static void SHA256D64_1024_sse41(benchmark::State& state) { WithSHA256(state, SHA256_SSE41, SHA256D64_1024); }
+static void SHA256D64_1024_avx2(benchmark::State& state) { WithSHA256(state, SHA256_AVX2, SHA256D64_1024); }
+
 static void SHA512(benchmark::State& state)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -76,3 +101,13 @@ BENCHMARK(SHA512);
 
 BENCHMARK(SHA256_32b);
 BENCHMARK(SipHash_32b);
+
+BENCHMARK(SHA256_standard);
+BENCHMARK(SHA256_shani);
+BENCHMARK(SHA256_32b_standard);
+BENCHMARK(SHA256_32b_shani);
+BENCHMARK(SHA256D64_1024);
+BENCHMARK(SHA256D64_1024_standard);
+BENCHMARK(SHA256D64_1024_shani);
+BENCHMARK(SHA256D64_1024_sse41);
+BENCHMARK(SHA256D64_1024_avx2);
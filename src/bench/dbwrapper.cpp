@@ -0,0 +1,87 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "crypto/common.h"
+#include "dbwrapper.h"
+#include "random.h"
+#include "uint256.h"
+
+#include <boost/filesystem.hpp>
+
+#include <vector>
+
+// Records shaped like coins of the chain state: a txid and output index as
+// the key, and a value of about the size of a compressed pay-to-pubkey-hash
+// output. Half of each value repeats, as scripts and amounts do.
+static const size_t RECORDS_PER_BATCH = 1000;
+static const size_t VALUE_SIZE = 40;
+static const size_t DB_CACHE_SIZE = 8 << 20;
+
+static std::pair<uint256, uint32_t> RandomKey(FastRandomContext& rng)
+{
+    uint256 hash;
+    for (int i = 0; i < 8; i++)
+        WriteLE32(hash.begin() + 4 * i, rng.rand32());
+    return std::make_pair(hash, rng.rand32() % 4);
+}
+
+static std::vector<unsigned char> RandomValue(FastRandomContext& rng)
+{
+    std::vector<unsigned char> value(VALUE_SIZE, 0x76);
+    for (size_t i = 0; i < VALUE_SIZE / 2; i++)
+        value[i] = rng.rand32();
+    return value;
+}
+
+// Write a batch of new records to a database on disk, and read as many
+// records back at random, with the leveldb options of the profile.
+static void DBWrapperWriteRead(benchmark::State& state, DBProfile profile)
+{
+    FastRandomContext rng(true);
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    {
+        CDBWrapper db(path, DB_CACHE_SIZE, false, true, true, profile);
+        std::vector<std::pair<uint256, uint32_t> > vKeys;
+        while (state.KeepRunning()) {
+            CDBBatch batch(db);
+            for (size_t i = 0; i < RECORDS_PER_BATCH; i++) {
+                vKeys.push_back(RandomKey(rng));
+                batch.Write(vKeys.back(), RandomValue(rng));
+            }
+            db.WriteBatch(batch);
+
+            std::vector<unsigned char> value;
+            for (size_t i = 0; i < RECORDS_PER_BATCH; i++)
+                assert(db.Read(vKeys[rng.rand32() % vKeys.size()], value));
+        }
+    }
+    boost::filesystem::remove_all(path);
+}
+
+static void DBWrapperDefault(benchmark::State& state)
+{
+    DBWrapperWriteRead(state, DBProfile::DEFAULT);
+}
+
+static void DBWrapperBlockIndex(benchmark::State& state)
+{
+    DBWrapperWriteRead(state, DBProfile::BLOCK_INDEX);
+}
+
+static void DBWrapperChainstate(benchmark::State& state)
+{
+    DBWrapperWriteRead(state, DBProfile::CHAINSTATE);
+}
+
+static void DBWrapperChainstateIBD(benchmark::State& state)
+{
+    DBWrapperWriteRead(state, DBProfile::CHAINSTATE_IBD);
+}
+
+BENCHMARK(DBWrapperDefault);
+BENCHMARK(DBWrapperBlockIndex);
+BENCHMARK(DBWrapperChainstate);
+BENCHMARK(DBWrapperChainstateIBD);
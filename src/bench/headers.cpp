@@ -0,0 +1,63 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chainparams.h"
+#include "hash.h"
+#include "primitives/block.h"
+#include "util.h"
+#include "utilstrencodings.h"
+#include "validation.h"
+
+#include <boost/thread/thread.hpp>
+
+// Proof-of-work pre-validation of a full `headers` message. The chain is
+// built deterministically; the PoW does not have to pass for the cost of
+// checking it to be representative.
+static const size_t HEADERS_PER_MESSAGE = 2000;
+
+static std::vector<CBlockHeader> BuildHeaderChain()
+{
+    const CChainParams& chainparams = Params();
+    std::vector<CBlockHeader> headers(HEADERS_PER_MESSAGE);
+    uint256 hashPrev = chainparams.GenesisBlock().GetHash();
+    for (size_t i = 0; i < headers.size(); i++) {
+        CBlockHeader& header = headers[i];
+        header.nVersion = 2;
+        header.hashPrevBlock = hashPrev;
+        header.hashMerkleRoot = Hash(BEGIN(i), END(i));
+        header.nTime = chainparams.GenesisBlock().nTime + 60 * (i + 1);
+        header.nBits = chainparams.GenesisBlock().nBits;
+        header.nNonce = i;
+        hashPrev = header.GetHash();
+    }
+    return headers;
+}
+
+static void HeadersPoW(benchmark::State& state, int nThreads)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    const std::vector<CBlockHeader> headers = BuildHeaderChain();
+    std::vector<char> vfValid;
+
+    boost::thread_group threadGroup;
+    nScriptCheckThreads = nThreads;
+    for (int i = 0; i < nThreads - 1; i++)
+        threadGroup.create_thread(&ThreadHeaderCheck);
+
+    while (state.KeepRunning()) {
+        CheckBlockHeadersPoW(headers, 0, vfValid);
+    }
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+    nScriptCheckThreads = 0;
+}
+
+static void HeadersPoW_2000_serial(benchmark::State& state) { HeadersPoW(state, 0); }
+static void HeadersPoW_2000_parallel(benchmark::State& state) { HeadersPoW(state, std::max(2, GetNumCores())); }
+
+BENCHMARK(HeadersPoW_2000_serial);
+BENCHMARK(HeadersPoW_2000_parallel);
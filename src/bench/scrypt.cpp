@@ -25,4 +25,36 @@ static void Scrypt(benchmark::State& state)
     }
 }
 
+/* Hash 16 headers per iteration through the batch API, with only the given
+ * multi-lane implementations enabled. */
+static void ScryptMulti(benchmark::State& state, int allowed)
+{
+    static const size_t BATCH = 16;
+    std::vector<std::vector<char> > in(BATCH, std::vector<char>(BUFFER_SIZE, 0));
+    std::vector<uint256> out(BATCH);
+    std::vector<const char*> inputs(BATCH);
+    std::vector<char*> outputs(BATCH);
+    for (size_t i = 0; i < BATCH; i++) {
+        in[i][0] = i;
+        inputs[i] = in[i].data();
+        outputs[i] = BEGIN(out[i]);
+    }
+
+    std::cout << "Using the '" << scrypt_detect_multi(allowed) << "' multi-lane scrypt implementation" << std::endl;
+    while (state.KeepRunning())
+    {
+        scrypt_1024_1_1_256_multi(inputs.data(), outputs.data(), BATCH);
+    }
+    scrypt_detect_multi();
+}
+
+static void ScryptMulti_16_standard(benchmark::State& state) { ScryptMulti(state, SCRYPT_STANDARD); }
+static void ScryptMulti_16_sse41(benchmark::State& state) { ScryptMulti(state, SCRYPT_SSE41); }
+static void ScryptMulti_16_avx2(benchmark::State& state) { ScryptMulti(state, SCRYPT_AVX2); }
+static void ScryptMulti_16_avx512(benchmark::State& state) { ScryptMulti(state, SCRYPT_AVX512); }
+
 BENCHMARK(Scrypt);
+BENCHMARK(ScryptMulti_16_standard);
+BENCHMARK(ScryptMulti_16_sse41);
+BENCHMARK(ScryptMulti_16_avx2);
+BENCHMARK(ScryptMulti_16_avx512);
@@ -0,0 +1,109 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "compat.h"
+#include "netbase.h"
+#include "random.h"
+
+#include <assert.h>
+#include <map>
+#include <string.h>
+#include <vector>
+
+// Message throughput of the socket handler's wait loop over many loopback
+// peers. Every round sends one small message on a random subset of the
+// peers and waits until they have all been received on the other end, so
+// the time per round divided by MESSAGES_PER_ROUND is the cost of a message,
+// and the cycle counts show the CPU spent in the waiting backend. PEERS is
+// small enough for all descriptors to fit below FD_SETSIZE, so that select()
+// can be compared as well.
+static const int PEERS = 400;
+static const int MESSAGES_PER_ROUND = 100;
+static const size_t MESSAGE_SIZE = 64;
+
+static SOCKET MakeLoopbackListener(struct sockaddr_in& addr)
+{
+    SOCKET hListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t len = sizeof(addr);
+    bool fOk = bind(hListen, (struct sockaddr*)&addr, sizeof(addr)) != SOCKET_ERROR &&
+               listen(hListen, SOMAXCONN) != SOCKET_ERROR &&
+               getsockname(hListen, (struct sockaddr*)&addr, &len) != SOCKET_ERROR;
+    assert(fOk);
+    return hListen;
+}
+
+static void SocketEvents(benchmark::State& state, CSocketEvents::Backend backend)
+{
+    struct sockaddr_in addr;
+    SOCKET hListen = MakeLoopbackListener(addr);
+    std::vector<SOCKET> vClients, vServers;
+    for (int i = 0; i < PEERS; i++) {
+        SOCKET hClient = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        bool fConnected = connect(hClient, (struct sockaddr*)&addr, sizeof(addr)) != SOCKET_ERROR;
+        assert(fConnected);
+        SOCKET hServer = accept(hListen, NULL, NULL);
+        assert(hServer != INVALID_SOCKET);
+        SetSocketNonBlocking(hServer, true);
+        vClients.push_back(hClient);
+        vServers.push_back(hServer);
+    }
+    CloseSocket(hListen);
+
+    CSocketEvents events(backend);
+    for (SOCKET hServer : vServers)
+        events.Watch(hServer, CSocketEvents::EVENT_RECV);
+
+    FastRandomContext insecure_rand(true);
+    char message[MESSAGE_SIZE] = {};
+    char buf[0x10000];
+    std::map<SOCKET, int> mapReady;
+    while (state.KeepRunning()) {
+        size_t nPending = 0;
+        for (int i = 0; i < MESSAGES_PER_ROUND; i++) {
+            SOCKET hClient = vClients[insecure_rand.rand32() % PEERS];
+            int nSent = send(hClient, message, sizeof(message), MSG_NOSIGNAL);
+            assert(nSent == (int)sizeof(message));
+            nPending += sizeof(message);
+        }
+        while (nPending) {
+            bool fOk = events.Wait(1000, mapReady);
+            assert(fOk);
+            for (const std::pair<const SOCKET, int>& ready : mapReady) {
+                int nBytes = recv(ready.first, buf, sizeof(buf), MSG_DONTWAIT);
+                if (nBytes > 0)
+                    nPending -= nBytes;
+            }
+        }
+    }
+
+    for (SOCKET hSocket : vClients)
+        CloseSocket(hSocket);
+    for (SOCKET hSocket : vServers)
+        CloseSocket(hSocket);
+}
+
+static void SocketEventsSelect(benchmark::State& state)
+{
+    SocketEvents(state, CSocketEvents::BACKEND_SELECT);
+}
+
+static void SocketEventsPoll(benchmark::State& state)
+{
+    SocketEvents(state, CSocketEvents::BACKEND_POLL);
+}
+
+static void SocketEventsEpoll(benchmark::State& state)
+{
+    SocketEvents(state, CSocketEvents::BACKEND_EPOLL);
+}
+
+BENCHMARK(SocketEventsSelect);
+BENCHMARK(SocketEventsPoll);
+BENCHMARK(SocketEventsEpoll);
@@ -0,0 +1,85 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockcache.h"
+
+CBlockPayloadCache blockpayloadcache;
+
+CBlockPayloadCache::CBlockPayloadCache(size_t nMaxSizeIn) : nSize(0), nMaxSize(nMaxSizeIn), nHits(0), nMisses(0)
+{
+}
+
+void CBlockPayloadCache::Trim()
+{
+    AssertLockHeld(cs);
+    while (nSize > nMaxSize) {
+        nSize -= lru.back().second->GetData().size();
+        mapLRU.erase(lru.back().first);
+        lru.pop_back();
+    }
+}
+
+CNetMsgPayloadRef CBlockPayloadCache::Get(const uint256& hash, bool fWitness)
+{
+    LOCK(cs);
+    auto it = mapLRU.find(std::make_pair(hash, fWitness));
+    if (it == mapLRU.end()) {
+        nMisses++;
+        return CNetMsgPayloadRef();
+    }
+    nHits++;
+    lru.splice(lru.begin(), lru, it->second);
+    return it->second->second;
+}
+
+void CBlockPayloadCache::Add(const uint256& hash, bool fWitness, const CNetMsgPayloadRef& payload)
+{
+    const Key key(hash, fWitness);
+    LOCK(cs);
+    if (payload->GetData().size() > nMaxSize || mapLRU.count(key))
+        return;
+    lru.push_front(std::make_pair(key, payload));
+    mapLRU[key] = lru.begin();
+    nSize += payload->GetData().size();
+    Trim();
+}
+
+void CBlockPayloadCache::SetMaxSize(size_t nMaxSizeIn)
+{
+    LOCK(cs);
+    nMaxSize = nMaxSizeIn;
+    Trim();
+}
+
+void CBlockPayloadCache::Clear()
+{
+    LOCK(cs);
+    lru.clear();
+    mapLRU.clear();
+    nSize = 0;
+}
+
+size_t CBlockPayloadCache::CachedEntries() const
+{
+    LOCK(cs);
+    return lru.size();
+}
+
+size_t CBlockPayloadCache::CachedBytes() const
+{
+    LOCK(cs);
+    return nSize;
+}
+
+uint64_t CBlockPayloadCache::Hits() const
+{
+    LOCK(cs);
+    return nHits;
+}
+
+uint64_t CBlockPayloadCache::Misses() const
+{
+    LOCK(cs);
+    return nMisses;
+}
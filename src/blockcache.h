@@ -0,0 +1,76 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKCACHE_H
+#define BITCOIN_BLOCKCACHE_H
+
+#include "net.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <list>
+#include <utility>
+
+#include <boost/unordered_map.hpp>
+
+/** Default for -blockservecache, the size in MiB of the cache of serialized blocks served to peers */
+static const unsigned int DEFAULT_BLOCK_SERVE_CACHE_SIZE = 32;
+
+/**
+ * Bounded cache of blocks in wire format, keyed by block hash, used to
+ * answer getdata requests for blocks. Many peers syncing from us ask for
+ * the same blocks at about the same time, and each of them can be sent
+ * the same payload without reading or serializing the block again.
+ *
+ * Witness and non-witness serializations of a block are kept as separate
+ * entries. Callers that know the two are identical (e.g. before segwit is
+ * active) should always use the witness one. Least recently used entries
+ * are evicted once the total payload size exceeds the limit.
+ */
+class CBlockPayloadCache
+{
+private:
+    typedef std::pair<uint256, bool> Key;
+
+    struct KeyHasher
+    {
+        size_t operator()(const Key& key) const { return key.first.GetCheapHash() ^ key.second; }
+    };
+
+    typedef std::list<std::pair<Key, CNetMsgPayloadRef> > LRUList;
+
+    mutable CCriticalSection cs;
+    //! Most recently used entries at the front
+    LRUList lru;
+    boost::unordered_map<Key, LRUList::iterator, KeyHasher> mapLRU;
+    size_t nSize;
+    size_t nMaxSize;
+    uint64_t nHits;
+    uint64_t nMisses;
+
+    void Trim();
+
+public:
+    explicit CBlockPayloadCache(size_t nMaxSizeIn = (size_t)DEFAULT_BLOCK_SERVE_CACHE_SIZE << 20);
+
+    /** Look up the serialized block. Returns an empty reference if it isn't cached. */
+    CNetMsgPayloadRef Get(const uint256& hash, bool fWitness);
+
+    /** Add a serialized block. Payloads larger than the whole cache are not kept. */
+    void Add(const uint256& hash, bool fWitness, const CNetMsgPayloadRef& payload);
+
+    /** Change the size limit, evicting entries if needed. Zero disables the cache. */
+    void SetMaxSize(size_t nMaxSizeIn);
+
+    void Clear();
+
+    size_t CachedEntries() const;
+    size_t CachedBytes() const;
+    uint64_t Hits() const;
+    uint64_t Misses() const;
+};
+
+extern CBlockPayloadCache blockpayloadcache;
+
+#endif // BITCOIN_BLOCKCACHE_H
@@ -0,0 +1,136 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilemap.h"
+
+#include "chain.h"
+#include "util.h"
+#include "validation.h"
+
+#include <algorithm>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/** Reads starting at most this far after the end of the previous one count as a forward scan */
+static const size_t MAX_SEQUENTIAL_READ_GAP = 64 * 1024;
+/** How far ahead of a forward scan the kernel is asked to read */
+static const size_t READAHEAD_SIZE = 4 * 1024 * 1024;
+
+CBlockFileMapper blockfilemap;
+
+CMappedBlockFile::CMappedBlockFile(const unsigned char* pdataIn, size_t nSizeIn) : pdata(pdataIn), nSize(nSizeIn), nLastReadEnd(0), nReadAheadEnd(0)
+{
+}
+
+CMappedBlockFile::~CMappedBlockFile()
+{
+#ifndef WIN32
+    munmap(const_cast<unsigned char*>(pdata), nSize);
+#endif
+}
+
+void CMappedBlockFile::NoteRead(size_t nOffset, size_t nLength) const
+{
+#ifndef WIN32
+    size_t nEnd = nOffset + nLength;
+    size_t nPrevEnd = nLastReadEnd.exchange(nEnd, std::memory_order_relaxed);
+    if (nOffset < nPrevEnd || nOffset - nPrevEnd > MAX_SEQUENTIAL_READ_GAP)
+        return;
+    // Only renew the hint once the scan got halfway through the last one
+    if (nEnd + READAHEAD_SIZE / 2 < nReadAheadEnd.load(std::memory_order_relaxed))
+        return;
+    static const size_t nPageSize = sysconf(_SC_PAGESIZE);
+    size_t nStart = nEnd - nEnd % nPageSize;
+    size_t nAheadEnd = std::min(nSize, nEnd + READAHEAD_SIZE);
+    if (nAheadEnd > nStart)
+        madvise(const_cast<unsigned char*>(pdata) + nStart, nAheadEnd - nStart, MADV_WILLNEED);
+    nReadAheadEnd.store(nAheadEnd, std::memory_order_relaxed);
+#endif
+}
+
+CMappedBlockFileRef CBlockFileMapper::Map(int nFile, bool fUndo) const
+{
+#ifdef WIN32
+    return CMappedBlockFileRef();
+#else
+    boost::filesystem::path path = GetBlockPosFilename(CDiskBlockPos(nFile, 0), fUndo ? "rev" : "blk");
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1)
+        return CMappedBlockFileRef();
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return CMappedBlockFileRef();
+    }
+    void* p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        LogPrintf("%s: mmap of %s failed: %s\n", __func__, path.string(), strerror(errno));
+        return CMappedBlockFileRef();
+    }
+    // Most reads are of single blocks; forward scans are recognized by NoteRead()
+    madvise(p, st.st_size, MADV_RANDOM);
+    return std::make_shared<const CMappedBlockFile>(static_cast<const unsigned char*>(p), st.st_size);
+#endif
+}
+
+void CBlockFileMapper::SetEnabled(bool fEnabledIn)
+{
+    LOCK(cs);
+    fEnabled = fEnabledIn;
+    if (!fEnabled)
+        mapFiles.clear();
+}
+
+bool CBlockFileMapper::IsEnabled() const
+{
+    LOCK(cs);
+    return fEnabled;
+}
+
+void CBlockFileMapper::SetFinalizedFiles(int nFiles)
+{
+    LOCK(cs);
+    nFinalizedFiles = nFiles;
+    mapFiles.erase(mapFiles.lower_bound(std::make_pair(nFiles, false)), mapFiles.end());
+}
+
+CMappedBlockFileRef CBlockFileMapper::Get(const CDiskBlockPos& pos, bool fUndo, size_t nEnd)
+{
+    LOCK(cs);
+    if (!fEnabled || pos.nFile < 0 || pos.nFile >= nFinalizedFiles)
+        return CMappedBlockFileRef();
+    const Key key(pos.nFile, fUndo);
+    auto it = mapFiles.find(key);
+    if (it != mapFiles.end() && it->second->size() >= nEnd)
+        return it->second;
+    // Not mapped yet, or the file grew since
+    CMappedBlockFileRef file = Map(pos.nFile, fUndo);
+    if (!file) {
+        mapFiles.erase(key);
+        return file;
+    }
+    mapFiles[key] = file;
+    if (file->size() < nEnd)
+        return CMappedBlockFileRef();
+    return file;
+}
+
+void CBlockFileMapper::Forget(int nFile)
+{
+    LOCK(cs);
+    mapFiles.erase(std::make_pair(nFile, false));
+    mapFiles.erase(std::make_pair(nFile, true));
+}
+
+void CBlockFileMapper::Clear()
+{
+    LOCK(cs);
+    mapFiles.clear();
+}
@@ -0,0 +1,93 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKFILEMAP_H
+#define BITCOIN_BLOCKFILEMAP_H
+
+#include "sync.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <utility>
+
+struct CDiskBlockPos;
+
+/** Default for -blockmmap */
+static const bool DEFAULT_BLOCK_MMAP = false;
+
+/** A read-only memory mapping of a whole block or undo file. */
+class CMappedBlockFile
+{
+private:
+    const unsigned char* pdata;
+    size_t nSize;
+    //! End of the last read, to recognize forward scans
+    mutable std::atomic<size_t> nLastReadEnd;
+    //! End of the range the kernel was last asked to read ahead
+    mutable std::atomic<size_t> nReadAheadEnd;
+
+public:
+    CMappedBlockFile(const unsigned char* pdataIn, size_t nSizeIn);
+    ~CMappedBlockFile();
+
+    CMappedBlockFile(const CMappedBlockFile&) = delete;
+    CMappedBlockFile& operator=(const CMappedBlockFile&) = delete;
+
+    const unsigned char* data() const { return pdata; }
+    size_t size() const { return nSize; }
+
+    /** Record a read of [nOffset, nOffset + nLength). Once reads move
+     *  forward through the file, the kernel is asked to read ahead. */
+    void NoteRead(size_t nOffset, size_t nLength) const;
+};
+
+typedef std::shared_ptr<const CMappedBlockFile> CMappedBlockFileRef;
+
+/**
+ * Keeps finalized blk*.dat and rev*.dat files mapped read-only, so that
+ * reading a block or its undo data does not need to open, seek, read and
+ * close the file.
+ *
+ * Only files below the one blocks are currently appended to are mapped.
+ * Undo data can still be appended to older rev files. A read past the
+ * end of an existing mapping therefore maps the file again. Callers fall
+ * back to regular file reads whenever no mapping is returned.
+ */
+class CBlockFileMapper
+{
+private:
+    typedef std::pair<int, bool> Key; // (file number, undo file)
+
+    mutable CCriticalSection cs;
+    std::map<Key, CMappedBlockFileRef> mapFiles;
+    bool fEnabled;
+    //! Files with a lower number are finalized
+    int nFinalizedFiles;
+
+    CMappedBlockFileRef Map(int nFile, bool fUndo) const;
+
+public:
+    CBlockFileMapper() : fEnabled(false), nFinalizedFiles(0) {}
+
+    void SetEnabled(bool fEnabledIn);
+    bool IsEnabled() const;
+
+    /** Files numbered below nFiles will not have blocks appended anymore. */
+    void SetFinalizedFiles(int nFiles);
+
+    /** Return a mapping of the file of pos that covers [0, nEnd), or an
+     *  empty reference if the file cannot be mapped. */
+    CMappedBlockFileRef Get(const CDiskBlockPos& pos, bool fUndo, size_t nEnd);
+
+    /** Drop the mappings of a file, e.g. before it is deleted. Readers
+     *  holding a reference keep it mapped until they are done. */
+    void Forget(int nFile);
+
+    void Clear();
+};
+
+extern CBlockFileMapper blockfilemap;
+
+#endif // BITCOIN_BLOCKFILEMAP_H
@@ -0,0 +1,280 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilterindex.h"
+
+#include "clientversion.h"
+#include "streams.h"
+#include "util.h"
+#include "validation.h"
+
+#include <map>
+
+#include <boost/filesystem.hpp>
+
+/* The database of a block filter index maps
+ *   's' + block hash -> {filter hash, filter header, position of the filter}
+ *   'P'              -> position the next filter is written to
+ * and, through CBaseIndex, 'B' to the locator of the last indexed block.
+ *
+ * Entries are keyed by block hash only, so a reorg leaves the entries of the
+ * disconnected blocks in place; they are still correct for those blocks. The
+ * filters themselves are appended to fltr?????.dat files next to the
+ * database. After an unclean shutdown the index continues from the last
+ * committed position and overwrites what was written after it, which is why
+ * filters read back are checked against the hash in their entry.
+ */
+static const char DB_BLOCK_HASH = 's';
+static const char DB_FILTER_POS = 'P';
+
+/** The maximum size of a fltr?????.dat file */
+static const unsigned int MAX_FLTR_FILE_SIZE = 0x1000000; // 16 MiB
+
+struct CFilterIndexEntry
+{
+    uint256 hashFilter;
+    uint256 header;
+    CDiskBlockPos pos;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(hashFilter);
+        READWRITE(header);
+        READWRITE(pos);
+    }
+};
+
+static std::map<BlockFilterType, std::unique_ptr<BlockFilterIndex> > mapFilterIndexes;
+
+BlockFilterIndex::BlockFilterIndex(BlockFilterType filterTypeIn, size_t nCacheSize, bool fMemory, bool fWipe) :
+    filterType(filterTypeIn)
+{
+    const std::string& strTypeName = BlockFilterTypeName(filterType);
+    if (strTypeName.empty())
+        throw std::invalid_argument("unknown filter_type");
+
+    pathDir = GetDataDir() / "indexes" / "blockfilter" / strTypeName;
+    boost::filesystem::create_directories(pathDir);
+    strName = strTypeName + " block filter index";
+    pdb.reset(new CBaseIndex::DB(pathDir / "db", nCacheSize, fMemory, fWipe));
+}
+
+bool BlockFilterIndex::Init()
+{
+    if (!pdb->Read(DB_FILTER_POS, posNextFilter)) {
+        // Check that the index was not written to before; otherwise the
+        // position was lost and filters would overwrite each other
+        CBlockLocator locator;
+        if (pdb->ReadBestBlock(locator))
+            return error("%s: cannot read the position of the next filter of the %s", __func__, strName);
+        posNextFilter = CDiskBlockPos(0, 0);
+    }
+    return CBaseIndex::Init();
+}
+
+bool BlockFilterIndex::CommitInternal(CDBBatch& batch)
+{
+    // Make the filters durable before the position pointing past them is
+    FILE* file = OpenFilterFile(posNextFilter, false);
+    if (!file)
+        return error("%s: failed to open filter file %d", __func__, posNextFilter.nFile);
+    FileCommit(file);
+    fclose(file);
+
+    batch.Write(DB_FILTER_POS, posNextFilter);
+    return true;
+}
+
+FILE* BlockFilterIndex::OpenFilterFile(const CDiskBlockPos& pos, bool fReadOnly) const
+{
+    if (pos.IsNull())
+        return NULL;
+    boost::filesystem::path path = pathDir / strprintf("fltr%05u.dat", pos.nFile);
+    FILE* file = fopen(path.string().c_str(), "rb+");
+    if (!file && !fReadOnly)
+        file = fopen(path.string().c_str(), "wb+");
+    if (!file) {
+        LogPrintf("Unable to open file %s\n", path.string());
+        return NULL;
+    }
+    if (pos.nPos) {
+        if (fseek(file, pos.nPos, SEEK_SET)) {
+            LogPrintf("Unable to seek to position %u of %s\n", pos.nPos, path.string());
+            fclose(file);
+            return NULL;
+        }
+    }
+    return file;
+}
+
+bool BlockFilterIndex::ReadFilterFromDisk(const CDiskBlockPos& pos, const uint256& hashFilter, const uint256& hashBlock, BlockFilter& filter) const
+{
+    CAutoFile filein(OpenFilterFile(pos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return false;
+
+    uint256 hashBlockRead;
+    std::vector<unsigned char> vEncoded;
+    try {
+        filein >> hashBlockRead >> vEncoded;
+        if (hashBlockRead != hashBlock)
+            return error("%s: filter at %s belongs to another block", __func__, pos.ToString());
+        filter = BlockFilter(filterType, hashBlock, std::move(vEncoded));
+    } catch (const std::exception& e) {
+        return error("%s: failed to read the filter at %s: %s", __func__, pos.ToString(), e.what());
+    }
+
+    if (filter.GetHash() != hashFilter)
+        return error("%s: checksum mismatch of the filter at %s", __func__, pos.ToString());
+    return true;
+}
+
+bool BlockFilterIndex::WriteFilterToDisk(const BlockFilter& filter, CDiskBlockPos& pos)
+{
+    unsigned int nSize = ::GetSerializeSize(filter.GetBlockHash(), SER_DISK, CLIENT_VERSION) +
+                         ::GetSerializeSize(filter.GetEncodedFilter(), SER_DISK, CLIENT_VERSION);
+
+    // Roll over to the next file if the filter does not fit anymore
+    if (posNextFilter.nPos > 0 && posNextFilter.nPos + nSize > MAX_FLTR_FILE_SIZE) {
+        FILE* file = OpenFilterFile(posNextFilter, true);
+        if (!file)
+            return error("%s: failed to open filter file %d", __func__, posNextFilter.nFile);
+        TruncateFile(file, posNextFilter.nPos);
+        FileCommit(file);
+        fclose(file);
+        posNextFilter = CDiskBlockPos(posNextFilter.nFile + 1, 0);
+    }
+
+    CAutoFile fileout(OpenFilterFile(posNextFilter, false), SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull())
+        return error("%s: failed to open filter file %d", __func__, posNextFilter.nFile);
+    fileout << filter.GetBlockHash() << filter.GetEncodedFilter();
+
+    pos = posNextFilter;
+    posNextFilter.nPos += nSize;
+    return true;
+}
+
+bool BlockFilterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CBlockUndo blockundo;
+    uint256 hashPrevHeader;
+
+    if (pindex->pprev != NULL) {
+        if (!UndoReadFromDisk(blockundo, pindex))
+            return error("%s: failed to read undo data of block %s", __func__, pindex->GetBlockHash().ToString());
+
+        const uint256 hashPrev = pindex->pprev->GetBlockHash();
+        if (hashPrev == hashLastBlock) {
+            hashPrevHeader = hashLastHeader;
+        } else {
+            CFilterIndexEntry entryPrev;
+            if (!pdb->Read(std::make_pair(DB_BLOCK_HASH, hashPrev), entryPrev))
+                return error("%s: no filter header of the previous block %s", __func__, hashPrev.ToString());
+            hashPrevHeader = entryPrev.header;
+        }
+    }
+
+    BlockFilter filter(filterType, block, blockundo);
+
+    CFilterIndexEntry entry;
+    if (!WriteFilterToDisk(filter, entry.pos))
+        return false;
+    entry.hashFilter = filter.GetHash();
+    entry.header = filter.ComputeHeader(hashPrevHeader);
+    if (!pdb->Write(std::make_pair(DB_BLOCK_HASH, pindex->GetBlockHash()), entry))
+        return error("%s: failed to write the filter of block %s", __func__, pindex->GetBlockHash().ToString());
+
+    hashLastBlock = pindex->GetBlockHash();
+    hashLastHeader = entry.header;
+    return true;
+}
+
+bool BlockFilterIndex::LookupFilter(const CBlockIndex* pindex, BlockFilter& filter) const
+{
+    CFilterIndexEntry entry;
+    if (!pdb->Read(std::make_pair(DB_BLOCK_HASH, pindex->GetBlockHash()), entry))
+        return false;
+    return ReadFilterFromDisk(entry.pos, entry.hashFilter, pindex->GetBlockHash(), filter);
+}
+
+bool BlockFilterIndex::LookupFilterHeader(const CBlockIndex* pindex, uint256& header) const
+{
+    CFilterIndexEntry entry;
+    if (!pdb->Read(std::make_pair(DB_BLOCK_HASH, pindex->GetBlockHash()), entry))
+        return false;
+    header = entry.header;
+    return true;
+}
+
+/** Collect the entries of the blocks from nStartHeight up to pindexStop, in chain order */
+static bool LookupEntryRange(CDBWrapper& db, int nStartHeight, const CBlockIndex* pindexStop, std::vector<std::pair<uint256, CFilterIndexEntry> >& entries)
+{
+    if (nStartHeight < 0 || pindexStop == NULL || nStartHeight > pindexStop->nHeight)
+        return false;
+
+    entries.resize(pindexStop->nHeight - nStartHeight + 1);
+    const CBlockIndex* pindex = pindexStop;
+    for (size_t i = entries.size(); i > 0; --i, pindex = pindex->pprev) {
+        entries[i - 1].first = pindex->GetBlockHash();
+        if (!db.Read(std::make_pair(DB_BLOCK_HASH, entries[i - 1].first), entries[i - 1].second))
+            return false;
+    }
+    return true;
+}
+
+bool BlockFilterIndex::LookupFilterRange(int nStartHeight, const CBlockIndex* pindexStop, std::vector<BlockFilter>& filters) const
+{
+    std::vector<std::pair<uint256, CFilterIndexEntry> > entries;
+    if (!LookupEntryRange(*pdb, nStartHeight, pindexStop, entries))
+        return false;
+
+    filters.resize(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        const CFilterIndexEntry& entry = entries[i].second;
+        if (!ReadFilterFromDisk(entry.pos, entry.hashFilter, entries[i].first, filters[i]))
+            return false;
+    }
+    return true;
+}
+
+bool BlockFilterIndex::LookupFilterHashRange(int nStartHeight, const CBlockIndex* pindexStop, std::vector<uint256>& hashes) const
+{
+    std::vector<std::pair<uint256, CFilterIndexEntry> > entries;
+    if (!LookupEntryRange(*pdb, nStartHeight, pindexStop, entries))
+        return false;
+
+    hashes.resize(entries.size());
+    for (size_t i = 0; i < entries.size(); i++)
+        hashes[i] = entries[i].second.hashFilter;
+    return true;
+}
+
+BlockFilterIndex* GetBlockFilterIndex(BlockFilterType filterType)
+{
+    auto it = mapFilterIndexes.find(filterType);
+    return it != mapFilterIndexes.end() ? it->second.get() : NULL;
+}
+
+void ForEachBlockFilterIndex(std::function<void (BlockFilterIndex&)> fn)
+{
+    for (auto& entry : mapFilterIndexes)
+        fn(*entry.second);
+}
+
+bool InitBlockFilterIndex(BlockFilterType filterType, size_t nCacheSize, bool fMemory, bool fWipe)
+{
+    if (mapFilterIndexes.count(filterType))
+        return false;
+    mapFilterIndexes[filterType].reset(new BlockFilterIndex(filterType, nCacheSize, fMemory, fWipe));
+    return true;
+}
+
+void DestroyAllBlockFilterIndexes()
+{
+    mapFilterIndexes.clear();
+}
@@ -0,0 +1,93 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKFILTERINDEX_H
+#define BITCOIN_BLOCKFILTERINDEX_H
+
+#include "baseindex.h"
+#include "blockfilter.h"
+#include "chain.h"
+
+#include <functional>
+#include <memory>
+
+#include <boost/filesystem/path.hpp>
+
+/** Default for -blockfilterindex */
+static const char* const DEFAULT_BLOCKFILTERINDEX = "0";
+/** Default for -peerblockfilters */
+static const bool DEFAULT_PEERBLOCKFILTERS = false;
+/** Largest cache of the block filter index database, in MiB */
+static const int64_t nMaxBlockFilterIndexCache = 1024;
+
+/**
+ * An index of the compact block filters (BIP 157) of every block in the
+ * active chain. The filters are appended to flat files; the database maps
+ * each block hash to the position of its filter, the filter hash and the
+ * filter header. Filters of blocks that were reorganized away stay where
+ * they are, since they are still valid for those blocks.
+ */
+class BlockFilterIndex : public CBaseIndex
+{
+private:
+    BlockFilterType filterType;
+    std::string strName;
+    boost::filesystem::path pathDir;
+    std::unique_ptr<CBaseIndex::DB> pdb;
+
+    //! Where the next filter is written to, protected by the index thread
+    CDiskBlockPos posNextFilter;
+    //! Header of the last filter written, to chain the next one onto
+    uint256 hashLastBlock;
+    uint256 hashLastHeader;
+
+    FILE* OpenFilterFile(const CDiskBlockPos& pos, bool fReadOnly) const;
+    bool ReadFilterFromDisk(const CDiskBlockPos& pos, const uint256& hashFilter, const uint256& hashBlock, BlockFilter& filter) const;
+    bool WriteFilterToDisk(const BlockFilter& filter, CDiskBlockPos& pos);
+
+protected:
+    bool Init() override;
+    bool CommitInternal(CDBBatch& batch) override;
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+    CBaseIndex::DB& GetDB() const override { return *pdb; }
+    const char* GetName() const override { return strName.c_str(); }
+
+public:
+    /** Constructs the index, which becomes available to be queried. */
+    BlockFilterIndex(BlockFilterType filterType, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    BlockFilterType GetFilterType() const { return filterType; }
+
+    /** Get a single filter by block. */
+    bool LookupFilter(const CBlockIndex* pindex, BlockFilter& filter) const;
+
+    /** Get a single filter header by block. */
+    bool LookupFilterHeader(const CBlockIndex* pindex, uint256& header) const;
+
+    /** Get a range of filters between two heights on a chain. */
+    bool LookupFilterRange(int nStartHeight, const CBlockIndex* pindexStop, std::vector<BlockFilter>& filters) const;
+
+    /** Get a range of filter hashes between two heights on a chain. */
+    bool LookupFilterHashRange(int nStartHeight, const CBlockIndex* pindexStop, std::vector<uint256>& hashes) const;
+};
+
+/**
+ * Get a block filter index by type. Returns NULL if the index for this type
+ * is not enabled.
+ */
+BlockFilterIndex* GetBlockFilterIndex(BlockFilterType filterType);
+
+/** Iterate over all running block filter indexes, invoking fn on each. */
+void ForEachBlockFilterIndex(std::function<void (BlockFilterIndex&)> fn);
+
+/** Initialize a block filter index for the given type if one does not
+ *  already exist. Returns true if a new index is created and false if one
+ *  has already been initialized. */
+bool InitBlockFilterIndex(BlockFilterType filterType, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+/** Destroy all block filter indexes, which have to be stopped already. */
+void DestroyAllBlockFilterIndexes();
+
+#endif // BITCOIN_BLOCKFILTERINDEX_H
@@ -5,6 +5,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "chain.h"
+#include "auxpowstore.h"
+#include "dogecoin.h"
+#include "txdb.h"
+#include "util.h"
 #include "validation.h"
 
 using namespace std;
@@ -18,12 +22,18 @@ CBlockHeader CBlockIndex::GetBlockHeader(const Consensus::Params& consensusParam
     block.nVersion       = nVersion;
 
     /* The CBlockIndex object's block header is missing the auxpow.
-       So if this is an auxpow block, read it from disk instead.  We only
-       have to read the actual *header*, not the full block.  */
+       So if this is an auxpow block, look it up in the auxpow store, and
+       only read the actual *header* from disk if the store does not have
+       it (e.g. for blocks accepted before the store existed).  */
     if (block.IsAuxpow())
     {
-        ReadBlockHeaderFromDisk(block, this, consensusParams, fCheckPOW);
-        return block;
+        block.auxpow = auxpowstore.Get(GetBlockHash(), pblocktree);
+        if (!block.auxpow) {
+            ReadBlockHeaderFromDisk(block, this, consensusParams, fCheckPOW);
+            if (block.auxpow)
+                auxpowstore.Add(GetBlockHash(), block.auxpow);
+            return block;
+        }
     }
 
     if (pprev)
@@ -32,6 +42,9 @@ CBlockHeader CBlockIndex::GetBlockHeader(const Consensus::Params& consensusParam
     block.nTime          = nTime;
     block.nBits          = nBits;
     block.nNonce         = nNonce;
+
+    if (block.auxpow && fCheckPOW && !CheckAuxPowProofOfWork(block, consensusParams))
+        error("%s: Errors in block header of %s", __func__, GetBlockHash().ToString());
     return block;
 }
 
@@ -6,9 +6,10 @@
 #define BITCOIN_CHECKQUEUE_H
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
 #include <vector>
 
-#include <boost/foreach.hpp>
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/locks.hpp>
 #include <boost/thread/mutex.hpp>
@@ -25,12 +26,41 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Every thread owns a deque of pending checks. Add() spreads new checks
+  * over those deques; a thread takes batches from the back of its own
+  * deque and, when that runs dry, steals from the front of the others.
+  * Only sleeping and waking up go through the shared mutex.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    //! Number of per-thread deques. Slot 0 belongs to the master, workers
+    //! beyond MAX_SLOTS - 1 share slots.
+    static const int MAX_SLOTS = 64;
+
+    struct Slot {
+        //! Protects queue
+        boost::mutex mutex;
+
+        //! Checks waiting to be processed. The owner pops from the back,
+        //! other threads steal from the front.
+        std::deque<T> queue;
+
+        //! queue.size(), readable without taking the mutex so that empty
+        //! slots can be skipped cheaply.
+        std::atomic<unsigned int> nSize;
+
+        //! Keep neighbouring slots off each other's cache lines
+        char padding[64];
+
+        Slot() : nSize(0) {}
+    };
+
+    Slot slots[MAX_SLOTS];
+
+    //! Mutex to protect sleeping and waking up
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -39,90 +69,117 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
+    //! Bumped (under mutex) by every Add(), so that a worker can tell
+    //! whether work arrived after it last looked.
+    std::atomic<uint64_t> nGeneration;
 
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
+    //! The number of worker threads that have been started.
+    std::atomic<int> nWorkers;
 
-    //! The total number of workers (including the master).
-    int nTotal;
+    //! The slot that receives the next chunk of added checks.
+    int nNextSlot;
 
-    //! The temporary evaluation result.
-    bool fAllOk;
+    //! The temporary evaluation result. Once it is false, the remaining
+    //! checks are skipped.
+    std::atomic<bool> fAllOk;
 
     /**
      * Number of verifications that haven't completed yet.
      * This includes elements that are no longer queued, but still in the
      * worker's own batches.
      */
-    unsigned int nTodo;
-
-    //! Whether we're shutting down.
-    bool fQuit;
+    std::atomic<unsigned int> nTodo;
 
     //! The maximum number of elements to be processed in one batch
     unsigned int nBatchSize;
 
+    int ActiveSlots() const
+    {
+        return std::min(MAX_SLOTS, 1 + nWorkers.load());
+    }
+
+    /**
+     * Move a batch of checks into vChecks, preferring the thread's own slot.
+     * Returns false if all slots are empty.
+     */
+    bool TakeWork(int nOwn, std::vector<T>& vChecks)
+    {
+        const int nSlots = ActiveSlots();
+        for (int i = 0; i < nSlots; i++) {
+            const bool fSteal = i > 0;
+            Slot& slot = slots[(nOwn + i) % nSlots];
+            if (slot.nSize.load(std::memory_order_relaxed) == 0)
+                continue;
+            boost::unique_lock<boost::mutex> lock(slot.mutex);
+            const unsigned int nSize = slot.queue.size();
+            if (nSize == 0)
+                continue;
+            // Leave half of our own queue behind for thieves, and steal half
+            // of someone else's, so that batches get smaller towards the end
+            // and all threads finish approximately simultaneously.
+            const unsigned int nNow = std::max(1U, std::min(nBatchSize, fSteal ? (nSize + 1) / 2 : nSize / 2));
+            vChecks.resize(nNow);
+            for (unsigned int j = 0; j < nNow; j++) {
+                // Swap jobs out of the slot rather than copying them.
+                if (fSteal) {
+                    vChecks[j].swap(slot.queue.front());
+                    slot.queue.pop_front();
+                } else {
+                    vChecks[j].swap(slot.queue.back());
+                    slot.queue.pop_back();
+                }
+            }
+            slot.nSize = nSize - nNow;
+            return true;
+        }
+        return false;
+    }
+
     /** Internal function that does bulk of the verification work. */
     bool Loop(bool fMaster = false)
     {
-        boost::condition_variable& cond = fMaster ? condMaster : condWorker;
+        const int nOwn = fMaster ? 0 : 1 + nWorkers++ % (MAX_SLOTS - 1);
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
         do {
-            {
-                boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
+            // Read the generation before looking for work: an Add() that we
+            // miss while scanning will have bumped it by the time we sleep.
+            const uint64_t nGenerationSeen = nGeneration;
+            if (TakeWork(nOwn, vChecks)) {
+                // execute work, skipping it once any check has failed
+                bool fOk = true;
+                for (T& check : vChecks) {
+                    fOk = fOk && fAllOk.load(std::memory_order_relaxed);
+                    if (fOk)
+                        fOk = check();
                 }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if ((fMaster || fQuit) && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        if (fMaster)
-                            fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
+                const unsigned int nNow = vChecks.size();
+                // Destroy the checks before reporting them as done, the
+                // master may not return while they are still alive.
+                vChecks.clear();
+                if (!fOk)
+                    fAllOk = false;
+                if (nTodo.fetch_sub(nNow) == nNow && !fMaster) {
+                    // We processed the last element; inform the master it can exit and return the result
+                    boost::unique_lock<boost::mutex> lock(mutex);
+                    condMaster.notify_one();
                 }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
-                }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+                continue;
+            }
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (fMaster) {
+                // Nothing is queued any more and only the master adds work,
+                // so wait for the batches still being processed.
+                while (nTodo != 0)
+                    condMaster.wait(lock);
+                bool fRet = fAllOk;
+                // reset the status for new work later
+                fAllOk = true;
+                // return the current status
+                return fRet;
             }
-            // execute work
-            BOOST_FOREACH (T& check, vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
+            while (nGeneration == nGenerationSeen)
+                condWorker.wait(lock); // wait
         } while (true);
     }
 
@@ -131,7 +188,7 @@ public:
     boost::mutex ControlMutex;
 
     //! Create a new check queue
-    CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), fQuit(false), nBatchSize(nBatchSizeIn) {}
+    CCheckQueue(unsigned int nBatchSizeIn) : nGeneration(0), nWorkers(0), nNextSlot(0), fAllOk(true), nTodo(0), nBatchSize(nBatchSizeIn) {}
 
     //! Worker thread
     void Thread()
@@ -148,15 +205,28 @@ public:
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        BOOST_FOREACH (T& check, vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
-        }
+        if (vChecks.empty())
+            return;
         nTodo += vChecks.size();
+        // Hand out contiguous chunks, one per slot, continuing round-robin
+        // where the previous call stopped so small batches spread out too.
+        const int nSlots = ActiveSlots();
+        const size_t nChunk = (vChecks.size() + nSlots - 1) / nSlots;
+        for (size_t i = 0; i < vChecks.size(); i += nChunk) {
+            Slot& slot = slots[nNextSlot];
+            nNextSlot = (nNextSlot + 1) % nSlots;
+            boost::unique_lock<boost::mutex> lock(slot.mutex);
+            for (size_t j = i; j < std::min(vChecks.size(), i + nChunk); j++) {
+                slot.queue.push_back(T());
+                vChecks[j].swap(slot.queue.back());
+            }
+            slot.nSize = slot.queue.size();
+        }
+        boost::unique_lock<boost::mutex> lock(mutex);
+        nGeneration++;
         if (vChecks.size() == 1)
             condWorker.notify_one();
-        else if (vChecks.size() > 1)
+        else
             condWorker.notify_all();
     }
 
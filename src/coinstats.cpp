@@ -0,0 +1,115 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "coinstats.h"
+
+#include "chain.h"
+#include "coins.h"
+#include "hash.h"
+#include "streams.h"
+#include "util.h"
+#include "validation.h"
+
+#include <boost/thread.hpp>
+
+/** Add or remove a coin, serialized with its outpoint, in a set hash. */
+static void UpdateMuHash(MuHash3072& muhash, const COutPoint& outpoint, const Coin& coin, bool fAdd)
+{
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << outpoint;
+    ss << (uint32_t)(coin.nHeight * 2 + coin.fCoinBase);
+    ss << coin.out;
+    if (fAdd)
+        muhash.Insert((const unsigned char*)ss.data(), ss.size());
+    else
+        muhash.Remove((const unsigned char*)ss.data(), ss.size());
+}
+
+void CCoinsRollingStats::AddCoin(const COutPoint& outpoint, const Coin& coin)
+{
+    UpdateMuHash(muhash, outpoint, coin, true);
+    nTransactionOutputs++;
+    nTotalAmount += arith_uint256(coin.out.nValue);
+}
+
+void CCoinsRollingStats::RemoveCoin(const COutPoint& outpoint, const Coin& coin)
+{
+    UpdateMuHash(muhash, outpoint, coin, false);
+    nTransactionOutputs--;
+    nTotalAmount -= arith_uint256(coin.out.nValue);
+}
+
+CCoinsRollingStats& CCoinsRollingStats::operator+=(const CCoinsRollingStats& delta)
+{
+    muhash *= delta.muhash;
+    nTransactionOutputs += delta.nTransactionOutputs;
+    nTotalAmount += delta.nTotalAmount;
+    return *this;
+}
+
+uint256 CCoinsRollingStats::GetHash() const
+{
+    MuHash3072 finalized = muhash;
+    uint256 hash;
+    finalized.Finalize(hash.begin());
+    return hash;
+}
+
+void ApplyCoinsStats(CCoinsStats& stats, CHashWriter& ss, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
+{
+    assert(!outputs.empty());
+    ss << hash;
+    ss << VARINT(outputs.begin()->second.nHeight * 2 + outputs.begin()->second.fCoinBase);
+    stats.nTransactions++;
+    for (const auto& output : outputs) {
+        ss << VARINT(output.first + 1);
+        ss << output.second.out;
+        stats.nTransactionOutputs++;
+        stats.nTotalAmount += output.second.out.nValue;
+    }
+    ss << VARINT(0);
+}
+
+bool GetUTXOStats(CCoinsView* view, CCoinsStats& stats, CCoinsRollingStats* prolling)
+{
+    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
+
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    stats.hashBlock = pcursor->GetBestBlock();
+    {
+        LOCK(cs_main);
+        stats.nHeight = mapBlockIndex.find(stats.hashBlock)->second->nHeight;
+    }
+    ss << stats.hashBlock;
+    if (prolling) {
+        *prolling = CCoinsRollingStats();
+        prolling->hashBlock = stats.hashBlock;
+    }
+    uint256 prevkey;
+    std::map<uint32_t, Coin> outputs;
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        COutPoint key;
+        Coin coin;
+        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
+            if (!outputs.empty() && key.hash != prevkey) {
+                ApplyCoinsStats(stats, ss, prevkey, outputs);
+                outputs.clear();
+            }
+            prevkey = key.hash;
+            if (prolling)
+                prolling->AddCoin(key, coin);
+            outputs[key.n] = std::move(coin);
+            stats.nSerializedSize += 32 + 4 + pcursor->GetValueSize();
+        } else {
+            return error("%s: unable to read value", __func__);
+        }
+        pcursor->Next();
+    }
+    if (!outputs.empty()) {
+        ApplyCoinsStats(stats, ss, prevkey, outputs);
+    }
+    stats.hashSerialized = ss.GetHash();
+    return true;
+}
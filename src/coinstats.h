@@ -0,0 +1,87 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_COINSTATS_H
+#define BITCOIN_COINSTATS_H
+
+#include "amount.h"
+#include "arith_uint256.h"
+#include "crypto/muhash.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <map>
+#include <stdint.h>
+
+class CCoinsView;
+class CHashWriter;
+class COutPoint;
+class Coin;
+
+struct CCoinsStats
+{
+    int nHeight;
+    uint256 hashBlock;
+    uint64_t nTransactions;
+    uint64_t nTransactionOutputs;
+    uint64_t nSerializedSize;
+    uint256 hashSerialized;
+    arith_uint256 nTotalAmount;
+
+    CCoinsStats() : nHeight(0), nTransactions(0), nTransactionOutputs(0), nSerializedSize(0), nTotalAmount(0) {}
+};
+
+/**
+ * Running totals and an order-independent hash of the UTXO set at hashBlock,
+ * which are updated as blocks are connected and disconnected instead of
+ * scanning the whole set. The counters are signed so that the changes made
+ * by one block can be collected in an object of the same type.
+ */
+class CCoinsRollingStats
+{
+public:
+    uint256 hashBlock;
+    int64_t nTransactionOutputs;
+    //! Modulo 2^256, so that removals can be collected before additions
+    arith_uint256 nTotalAmount;
+    MuHash3072 muhash;
+
+    CCoinsRollingStats() : nTransactionOutputs(0), nTotalAmount(0) {}
+
+    void AddCoin(const COutPoint& outpoint, const Coin& coin);
+    void RemoveCoin(const COutPoint& outpoint, const Coin& coin);
+    //! Apply changes collected on top of these statistics; hashBlock is left alone.
+    CCoinsRollingStats& operator+=(const CCoinsRollingStats& delta);
+
+    //! The MuHash3072 of the serialized coins
+    uint256 GetHash() const;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        unsigned char data[MuHash3072::SERIALIZED_SIZE];
+        muhash.ToBytes(data);
+        s << hashBlock << nTransactionOutputs << ArithToUint256(nTotalAmount);
+        s.write((const char*)data, sizeof(data));
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        unsigned char data[MuHash3072::SERIALIZED_SIZE];
+        uint256 amount;
+        s >> hashBlock >> nTransactionOutputs >> amount;
+        s.read((char*)data, sizeof(data));
+        nTotalAmount = UintToArith256(amount);
+        muhash.FromBytes(data);
+    }
+};
+
+/** Add the unspent outputs of one transaction to the statistics and to the
+ *  hash of the UTXO set. Transactions have to be passed in txid order. */
+void ApplyCoinsStats(CCoinsStats& stats, CHashWriter& ss, const uint256& hash, const std::map<uint32_t, Coin>& outputs);
+
+/** Calculate statistics about the unspent transaction output set. If
+ *  prolling is given, its rolling statistics are computed from scratch too. */
+bool GetUTXOStats(CCoinsView* view, CCoinsStats& stats, CCoinsRollingStats* prolling = NULL);
+
+#endif // BITCOIN_COINSTATS_H
@@ -83,8 +83,17 @@ typedef u_int SOCKET;
 size_t strnlen( const char *start, size_t max_len);
 #endif // HAVE_DECL_STRNLEN
 
+// select() only handles sockets below FD_SETSIZE. Use poll() instead where
+// it is known to work (WSAPoll and macOS poll() are not), and epoll on Linux.
+#if !defined(WIN32) && !defined(__APPLE__)
+#define USE_POLL
+#endif
+#if defined(__linux__)
+#define USE_EPOLL
+#endif
+
 bool static inline IsSelectableSocket(SOCKET s) {
-#ifdef WIN32
+#if defined(USE_POLL) || defined(WIN32)
     return true;
 #else
     return (s < FD_SETSIZE);
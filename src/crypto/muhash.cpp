@@ -0,0 +1,202 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/muhash.h"
+
+#include "crypto/sha256.h"
+#include "crypto/sha512.h"
+
+#include <string.h>
+
+namespace {
+
+typedef Num3072::limb_t limb_t;
+typedef Num3072::double_limb_t double_limb_t;
+
+/** 2^3072 - MAX_PRIME_DIFF is the largest prime below 2^3072. */
+const limb_t MAX_PRIME_DIFF = 1103717;
+
+/** Add a small value to a number, and return the carry out of its top limb. */
+limb_t AddSmall(limb_t* limbs, double_limb_t v)
+{
+    for (int i = 0; i < Num3072::LIMBS && v; ++i) {
+        v += limbs[i];
+        limbs[i] = (limb_t)v;
+        v >>= Num3072::LIMB_SIZE;
+    }
+    return (limb_t)v;
+}
+
+} // anon namespace
+
+Num3072::Num3072(const unsigned char (&data)[BYTE_SIZE])
+{
+    for (int i = 0; i < LIMBS; ++i) {
+        limbs[i] = 0;
+        for (int j = sizeof(limb_t) - 1; j >= 0; --j) {
+            limbs[i] = (limbs[i] << 8) | data[i * sizeof(limb_t) + j];
+        }
+    }
+}
+
+void Num3072::SetToOne()
+{
+    limbs[0] = 1;
+    for (int i = 1; i < LIMBS; ++i)
+        limbs[i] = 0;
+}
+
+bool Num3072::IsOverflow() const
+{
+    if (limbs[0] <= (limb_t)(-1) - MAX_PRIME_DIFF)
+        return false;
+    for (int i = 1; i < LIMBS; ++i) {
+        if (limbs[i] != (limb_t)(-1))
+            return false;
+    }
+    return true;
+}
+
+void Num3072::FullReduce()
+{
+    // Subtracting the modulus is adding MAX_PRIME_DIFF and dropping 2^3072
+    if (IsOverflow())
+        AddSmall(limbs, MAX_PRIME_DIFF);
+}
+
+void Num3072::Multiply(const Num3072& a)
+{
+    limb_t t[2 * LIMBS];
+    for (int i = 0; i < LIMBS; ++i) {
+        t[i] = 0;
+    }
+    for (int i = 0; i < LIMBS; ++i) {
+        limb_t carry = 0;
+        for (int j = 0; j < LIMBS; ++j) {
+            double_limb_t acc = (double_limb_t)limbs[i] * a.limbs[j] + t[i + j] + carry;
+            t[i + j] = (limb_t)acc;
+            carry = (limb_t)(acc >> LIMB_SIZE);
+        }
+        t[i + LIMBS] = carry;
+    }
+
+    // 2^3072 is MAX_PRIME_DIFF modulo the prime, so fold the upper half onto
+    // the lower one. What carries out of that is folded once more.
+    limb_t carry = 0;
+    for (int i = 0; i < LIMBS; ++i) {
+        double_limb_t acc = (double_limb_t)t[i + LIMBS] * MAX_PRIME_DIFF + t[i] + carry;
+        limbs[i] = (limb_t)acc;
+        carry = (limb_t)(acc >> LIMB_SIZE);
+    }
+    if (AddSmall(limbs, (double_limb_t)carry * MAX_PRIME_DIFF)) {
+        // The number wrapped around, so it is small now and this cannot carry out
+        AddSmall(limbs, MAX_PRIME_DIFF);
+    }
+}
+
+Num3072 Num3072::GetInverse() const
+{
+    // By Fermat's little theorem, a^(p-2) is the inverse of a. The exponent is
+    // processed in windows of 4 bits.
+    Num3072 table[16];
+    table[1] = *this;
+    for (int i = 2; i < 16; ++i) {
+        table[i] = table[i - 1];
+        table[i].Multiply(*this);
+    }
+    limb_t exponent[LIMBS];
+    exponent[0] = (limb_t)(-1) - MAX_PRIME_DIFF - 1;
+    for (int i = 1; i < LIMBS; ++i)
+        exponent[i] = (limb_t)(-1);
+
+    Num3072 out;
+    for (int i = LIMBS * LIMB_SIZE / 4 - 1; i >= 0; --i) {
+        for (int j = 0; j < 4; ++j) {
+            Num3072 square = out;
+            out.Multiply(square);
+        }
+        int window = (exponent[(i * 4) / LIMB_SIZE] >> ((i * 4) % LIMB_SIZE)) & 15;
+        if (window)
+            out.Multiply(table[window]);
+    }
+    return out;
+}
+
+void Num3072::Divide(const Num3072& a)
+{
+    Multiply(a.GetInverse());
+}
+
+void Num3072::ToBytes(unsigned char (&out)[BYTE_SIZE]) const
+{
+    Num3072 reduced = *this;
+    reduced.FullReduce();
+    for (int i = 0; i < LIMBS; ++i) {
+        limb_t limb = reduced.limbs[i];
+        for (size_t j = 0; j < sizeof(limb_t); ++j) {
+            out[i * sizeof(limb_t) + j] = (unsigned char)limb;
+            limb >>= 8;
+        }
+    }
+}
+
+Num3072 MuHash3072::ToNum3072(const unsigned char* data, size_t len)
+{
+    // Expand the SHA-256 of the element to 3072 bits with SHA-512 in counter mode
+    unsigned char key[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(data, len).Finalize(key);
+    unsigned char expanded[Num3072::BYTE_SIZE];
+    for (unsigned char i = 0; i < Num3072::BYTE_SIZE / CSHA512::OUTPUT_SIZE; ++i) {
+        CSHA512().Write(key, sizeof(key)).Write(&i, 1).Finalize(expanded + i * CSHA512::OUTPUT_SIZE);
+    }
+    return Num3072(expanded);
+}
+
+MuHash3072& MuHash3072::Insert(const unsigned char* data, size_t len)
+{
+    numerator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::Remove(const unsigned char* data, size_t len)
+{
+    denominator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator*=(const MuHash3072& mul)
+{
+    numerator.Multiply(mul.numerator);
+    denominator.Multiply(mul.denominator);
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator/=(const MuHash3072& div)
+{
+    numerator.Multiply(div.denominator);
+    denominator.Multiply(div.numerator);
+    return *this;
+}
+
+void MuHash3072::Finalize(unsigned char hash[OUTPUT_SIZE])
+{
+    numerator.Divide(denominator);
+    denominator.SetToOne();
+
+    unsigned char data[Num3072::BYTE_SIZE];
+    numerator.ToBytes(data);
+    CSHA256().Write(data, sizeof(data)).Finalize(hash);
+}
+
+void MuHash3072::ToBytes(unsigned char (&out)[SERIALIZED_SIZE]) const
+{
+    numerator.ToBytes(*(unsigned char (*)[Num3072::BYTE_SIZE])out);
+    denominator.ToBytes(*(unsigned char (*)[Num3072::BYTE_SIZE])(out + Num3072::BYTE_SIZE));
+}
+
+void MuHash3072::FromBytes(const unsigned char (&data)[SERIALIZED_SIZE])
+{
+    numerator = Num3072(*(const unsigned char (*)[Num3072::BYTE_SIZE])data);
+    denominator = Num3072(*(const unsigned char (*)[Num3072::BYTE_SIZE])(data + Num3072::BYTE_SIZE));
+}
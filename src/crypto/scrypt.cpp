@@ -28,12 +28,38 @@
  */
 
 #include "crypto/scrypt.h"
+#include "crypto/common.h"
 #include "crypto/hmac_sha256.h"
+#include "compat/cpuid.h"
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <vector>
 #include <openssl/sha.h>
 
+#if defined(HAVE_GETCPUID) && !defined(BUILD_BITCOIN_INTERNAL)
+#if defined(ENABLE_SSE41)
+namespace scrypt_sse41
+{
+void ROMix_4way(uint32_t* X, void* scratchpad);
+}
+#endif
+
+#if defined(ENABLE_AVX2)
+namespace scrypt_avx2
+{
+void ROMix_8way(uint32_t* X, void* scratchpad);
+}
+#endif
+
+#if defined(ENABLE_AVX512)
+namespace scrypt_avx512
+{
+void ROMix_16way(uint32_t* X, void* scratchpad);
+}
+#endif
+#endif
+
 #if defined(USE_SSE2) && !defined(USE_SSE2_ALWAYS)
 #ifdef _MSC_VER
 // MSVC 64bit is unable to use inline asm
@@ -260,3 +286,119 @@ void scrypt_1024_1_1_256(const char *input, char *output)
     memset(scratchpad, 0, sizeof(scratchpad));
     scrypt_1024_1_1_256_sp(input, output, scratchpad);
 }
+
+namespace {
+
+typedef void (*ROMixType)(uint32_t* X, void* scratchpad);
+
+/** The available ROMix kernels, widest first. Unused slots are NULL. */
+struct ROMixKernel {
+    ROMixType romix;
+    size_t lanes;
+};
+
+ROMixKernel ROMixKernels[3] = {{NULL, 16}, {NULL, 8}, {NULL, 4}};
+
+/** Hash `lanes` inputs with a multi-lane ROMix kernel. */
+void scrypt_1024_1_1_256_lanes(const ROMixKernel& kernel, const char* const* inputs, char* const* outputs)
+{
+    const size_t lanes = kernel.lanes;
+    // Interleaved X and V; V is 64-byte aligned for the widest kernel.
+    thread_local std::vector<uint32_t> X;
+    thread_local std::vector<char> scratchpad;
+    X.resize(32 * lanes);
+    scratchpad.resize(1024 * 128 * lanes + 63);
+    void* V = (void*)(((uintptr_t)scratchpad.data() + 63) & ~(uintptr_t)63);
+    uint8_t B[128];
+
+    for (size_t l = 0; l < lanes; l++) {
+        PBKDF2_SHA256((const uint8_t*)inputs[l], 80, (const uint8_t*)inputs[l], 80, 1, B, 128);
+        for (size_t k = 0; k < 32; k++)
+            X[lanes * k + l] = le32dec(&B[4 * k]);
+    }
+
+    kernel.romix(X.data(), V);
+
+    for (size_t l = 0; l < lanes; l++) {
+        for (size_t k = 0; k < 32; k++)
+            le32enc(&B[4 * k], X[lanes * k + l]);
+        PBKDF2_SHA256((const uint8_t*)inputs[l], 80, B, 128, 1, (uint8_t*)outputs[l], 32);
+    }
+}
+
+} // namespace
+
+std::string scrypt_detect_multi(int allowed)
+{
+    std::string ret = "standard";
+    for (ROMixKernel& kernel : ROMixKernels) {
+        kernel.romix = NULL;
+    }
+
+#if defined(HAVE_GETCPUID) && !defined(BUILD_BITCOIN_INTERNAL)
+    uint32_t eax, ebx, ecx, edx;
+    GetCPUID(0, 0, eax, ebx, ecx, edx);
+    const uint32_t max_leaf = eax;
+    GetCPUID(1, 0, eax, ebx, ecx, edx);
+    const bool have_sse41 = (ecx >> 19) & 1;
+    const bool have_xsave = (ecx >> 27) & 1;
+    const bool have_avx = (ecx >> 28) & 1;
+    const uint64_t xcr0 = (have_xsave && have_avx) ? GetXCR0() : 0;
+    const bool have_os_avx = (xcr0 & 0x06) == 0x06;
+    const bool have_os_avx512 = (xcr0 & 0xe6) == 0xe6;
+    bool have_avx2 = false;
+    bool have_avx512 = false;
+    if (max_leaf >= 7) {
+        GetCPUID(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = (ebx >> 5) & 1;
+        have_avx512 = (ebx >> 16) & 1;
+    }
+
+#if defined(ENABLE_AVX512)
+    if (have_avx512 && have_os_avx512 && (allowed & SCRYPT_AVX512)) {
+        ROMixKernels[0].romix = scrypt_avx512::ROMix_16way;
+        ret += ",avx512(16way)";
+    }
+#endif
+
+#if defined(ENABLE_AVX2)
+    if (have_avx2 && have_os_avx && (allowed & SCRYPT_AVX2)) {
+        ROMixKernels[1].romix = scrypt_avx2::ROMix_8way;
+        ret += ",avx2(8way)";
+    }
+#endif
+
+#if defined(ENABLE_SSE41)
+    if (have_sse41 && (allowed & SCRYPT_SSE41)) {
+        ROMixKernels[2].romix = scrypt_sse41::ROMix_4way;
+        ret += ",sse41(4way)";
+    }
+#endif
+
+    // Silence unused warnings for features this build has no kernel for.
+    (void)have_sse41;
+    (void)have_os_avx;
+    (void)have_os_avx512;
+    (void)have_avx2;
+    (void)have_avx512;
+#endif
+
+    return ret;
+}
+
+void scrypt_1024_1_1_256_multi(const char* const inputs[], char* const outputs[], size_t n)
+{
+    for (const ROMixKernel& kernel : ROMixKernels) {
+        if (!kernel.romix) continue;
+        while (n >= kernel.lanes) {
+            scrypt_1024_1_1_256_lanes(kernel, inputs, outputs);
+            inputs += kernel.lanes;
+            outputs += kernel.lanes;
+            n -= kernel.lanes;
+        }
+    }
+    while (n) {
+        scrypt_1024_1_1_256(*inputs++, *outputs++);
+        --n;
+    }
+}
@@ -2,12 +2,35 @@
 #define SCRYPT_H
 #include <stdlib.h>
 #include <stdint.h>
+#include <string>
 
 static const int SCRYPT_SCRATCHPAD_SIZE = 131072 + 63;
 
 void scrypt_1024_1_1_256(const char *input, char *output);
 void scrypt_1024_1_1_256_sp_generic(const char *input, char *output, char *scratchpad);
 
+/** Optional multi-lane scrypt implementations, as a bitmask for scrypt_detect_multi. */
+enum ScryptImplementation {
+    SCRYPT_STANDARD = 0,
+    SCRYPT_SSE41 = 1 << 0,   //!< 4 lanes
+    SCRYPT_AVX2 = 1 << 1,    //!< 8 lanes
+    SCRYPT_AVX512 = 1 << 2,  //!< 16 lanes
+    SCRYPT_ALL = SCRYPT_SSE41 | SCRYPT_AVX2 | SCRYPT_AVX512,
+};
+
+/** Autodetect the multi-lane scrypt kernels this CPU supports, considering
+ *  only the implementations in the allowed mask.
+ *  Returns the name of the implementation.
+ */
+std::string scrypt_detect_multi(int allowed = SCRYPT_ALL);
+
+/** Compute the scrypt hashes of n independent 80-byte inputs.
+ *  Inputs are hashed 16, 8 or 4 at a time when AVX-512, AVX2 or SSE4.1
+ *  kernels are available; the remainder is hashed one at a time.
+ *  outputs[i] receives 32 bytes.
+ */
+void scrypt_1024_1_1_256_multi(const char* const inputs[], char* const outputs[], size_t n);
+
 #if defined(USE_SSE2)
 #if defined(_M_X64) || defined(__x86_64__) || defined(_M_AMD64) || (defined(MAC_OSX) && defined(__i386__))
 #define USE_SSE2_ALWAYS 1
@@ -0,0 +1,92 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This is an 8-way AVX2 implementation of the scrypt(1024, 1, 1) ROMix
+// core. Lane l of every vector belongs to the l-th independent input.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace scrypt_avx2 {
+namespace {
+
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi32(x, y); }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+__m256i inline RotL(__m256i x, int n) { return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n)); }
+
+/** B ^= Bx; B += Salsa20/8(B) on 8 interleaved lanes. */
+void inline XorSalsa8(__m256i* B, const __m256i* Bx)
+{
+    __m256i x[16];
+    for (int i = 0; i < 16; i++) x[i] = B[i] = Xor(B[i], Bx[i]);
+    for (int i = 0; i < 8; i += 2) {
+        /* Operate on columns. */
+        x[ 4] = Xor(x[ 4], RotL(Add(x[ 0], x[12]),  7));  x[ 9] = Xor(x[ 9], RotL(Add(x[ 5], x[ 1]),  7));
+        x[14] = Xor(x[14], RotL(Add(x[10], x[ 6]),  7));  x[ 3] = Xor(x[ 3], RotL(Add(x[15], x[11]),  7));
+
+        x[ 8] = Xor(x[ 8], RotL(Add(x[ 4], x[ 0]),  9));  x[13] = Xor(x[13], RotL(Add(x[ 9], x[ 5]),  9));
+        x[ 2] = Xor(x[ 2], RotL(Add(x[14], x[10]),  9));  x[ 7] = Xor(x[ 7], RotL(Add(x[ 3], x[15]),  9));
+
+        x[12] = Xor(x[12], RotL(Add(x[ 8], x[ 4]), 13));  x[ 1] = Xor(x[ 1], RotL(Add(x[13], x[ 9]), 13));
+        x[ 6] = Xor(x[ 6], RotL(Add(x[ 2], x[14]), 13));  x[11] = Xor(x[11], RotL(Add(x[ 7], x[ 3]), 13));
+
+        x[ 0] = Xor(x[ 0], RotL(Add(x[12], x[ 8]), 18));  x[ 5] = Xor(x[ 5], RotL(Add(x[ 1], x[13]), 18));
+        x[10] = Xor(x[10], RotL(Add(x[ 6], x[ 2]), 18));  x[15] = Xor(x[15], RotL(Add(x[11], x[ 7]), 18));
+
+        /* Operate on rows. */
+        x[ 1] = Xor(x[ 1], RotL(Add(x[ 0], x[ 3]),  7));  x[ 6] = Xor(x[ 6], RotL(Add(x[ 5], x[ 4]),  7));
+        x[11] = Xor(x[11], RotL(Add(x[10], x[ 9]),  7));  x[12] = Xor(x[12], RotL(Add(x[15], x[14]),  7));
+
+        x[ 2] = Xor(x[ 2], RotL(Add(x[ 1], x[ 0]),  9));  x[ 7] = Xor(x[ 7], RotL(Add(x[ 6], x[ 5]),  9));
+        x[ 8] = Xor(x[ 8], RotL(Add(x[11], x[10]),  9));  x[13] = Xor(x[13], RotL(Add(x[12], x[15]),  9));
+
+        x[ 3] = Xor(x[ 3], RotL(Add(x[ 2], x[ 1]), 13));  x[ 4] = Xor(x[ 4], RotL(Add(x[ 7], x[ 6]), 13));
+        x[ 9] = Xor(x[ 9], RotL(Add(x[ 8], x[11]), 13));  x[14] = Xor(x[14], RotL(Add(x[13], x[12]), 13));
+
+        x[ 0] = Xor(x[ 0], RotL(Add(x[ 3], x[ 2]), 18));  x[ 5] = Xor(x[ 5], RotL(Add(x[ 4], x[ 7]), 18));
+        x[10] = Xor(x[10], RotL(Add(x[ 9], x[ 8]), 18));  x[15] = Xor(x[15], RotL(Add(x[14], x[13]), 18));
+    }
+    for (int i = 0; i < 16; i++) B[i] = Add(B[i], x[i]);
+}
+
+}
+
+/** Run ROMix over 8 lanes.
+ *  X:          32 words of state per lane, interleaved (X[8 * k + lane]).
+ *  scratchpad: 1024 * 32 * 8 * 4 bytes, 32-byte aligned.
+ */
+void ROMix_8way(uint32_t* X, void* scratchpad)
+{
+    __m256i* V = (__m256i*)scratchpad;
+    __m256i x[32];
+    for (int k = 0; k < 32; k++) x[k] = _mm256_loadu_si256((const __m256i*)(X + 8 * k));
+
+    for (int i = 0; i < 1024; i++) {
+        for (int k = 0; k < 32; k++) _mm256_store_si256(V + 32 * i + k, x[k]);
+        XorSalsa8(&x[0], &x[16]);
+        XorSalsa8(&x[16], &x[0]);
+    }
+
+    // Each lane picks its own V entry, so the loads are gathered. The word
+    // offset of V[j][k] for lane l is (32 * j + k) * 8 + l.
+    const __m256i lanes = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256i mask = _mm256_set1_epi32(1023);
+    for (int i = 0; i < 1024; i++) {
+        __m256i idx = Add(_mm256_slli_epi32(_mm256_and_si256(x[16], mask), 8), lanes);
+        for (int k = 0; k < 32; k++) {
+            x[k] = Xor(x[k], _mm256_i32gather_epi32((const int*)V, idx, 4));
+            idx = Add(idx, _mm256_set1_epi32(8));
+        }
+        XorSalsa8(&x[0], &x[16]);
+        XorSalsa8(&x[16], &x[0]);
+    }
+
+    for (int k = 0; k < 32; k++) _mm256_storeu_si256((__m256i*)(X + 8 * k), x[k]);
+}
+
+}
+
+#endif
@@ -0,0 +1,92 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This is a 16-way AVX-512 implementation of the scrypt(1024, 1, 1) ROMix
+// core. Lane l of every vector belongs to the l-th independent input.
+
+#ifdef ENABLE_AVX512
+
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace scrypt_avx512 {
+namespace {
+
+__m512i inline Add(__m512i x, __m512i y) { return _mm512_add_epi32(x, y); }
+__m512i inline Xor(__m512i x, __m512i y) { return _mm512_xor_si512(x, y); }
+template <int n> __m512i inline RotL(__m512i x) { return _mm512_rol_epi32(x, n); }
+
+/** B ^= Bx; B += Salsa20/8(B) on 16 interleaved lanes. */
+void inline XorSalsa8(__m512i* B, const __m512i* Bx)
+{
+    __m512i x[16];
+    for (int i = 0; i < 16; i++) x[i] = B[i] = Xor(B[i], Bx[i]);
+    for (int i = 0; i < 8; i += 2) {
+        /* Operate on columns. */
+        x[ 4] = Xor(x[ 4], RotL<7>(Add(x[ 0], x[12])));  x[ 9] = Xor(x[ 9], RotL<7>(Add(x[ 5], x[ 1])));
+        x[14] = Xor(x[14], RotL<7>(Add(x[10], x[ 6])));  x[ 3] = Xor(x[ 3], RotL<7>(Add(x[15], x[11])));
+
+        x[ 8] = Xor(x[ 8], RotL<9>(Add(x[ 4], x[ 0])));  x[13] = Xor(x[13], RotL<9>(Add(x[ 9], x[ 5])));
+        x[ 2] = Xor(x[ 2], RotL<9>(Add(x[14], x[10])));  x[ 7] = Xor(x[ 7], RotL<9>(Add(x[ 3], x[15])));
+
+        x[12] = Xor(x[12], RotL<13>(Add(x[ 8], x[ 4])));  x[ 1] = Xor(x[ 1], RotL<13>(Add(x[13], x[ 9])));
+        x[ 6] = Xor(x[ 6], RotL<13>(Add(x[ 2], x[14])));  x[11] = Xor(x[11], RotL<13>(Add(x[ 7], x[ 3])));
+
+        x[ 0] = Xor(x[ 0], RotL<18>(Add(x[12], x[ 8])));  x[ 5] = Xor(x[ 5], RotL<18>(Add(x[ 1], x[13])));
+        x[10] = Xor(x[10], RotL<18>(Add(x[ 6], x[ 2])));  x[15] = Xor(x[15], RotL<18>(Add(x[11], x[ 7])));
+
+        /* Operate on rows. */
+        x[ 1] = Xor(x[ 1], RotL<7>(Add(x[ 0], x[ 3])));  x[ 6] = Xor(x[ 6], RotL<7>(Add(x[ 5], x[ 4])));
+        x[11] = Xor(x[11], RotL<7>(Add(x[10], x[ 9])));  x[12] = Xor(x[12], RotL<7>(Add(x[15], x[14])));
+
+        x[ 2] = Xor(x[ 2], RotL<9>(Add(x[ 1], x[ 0])));  x[ 7] = Xor(x[ 7], RotL<9>(Add(x[ 6], x[ 5])));
+        x[ 8] = Xor(x[ 8], RotL<9>(Add(x[11], x[10])));  x[13] = Xor(x[13], RotL<9>(Add(x[12], x[15])));
+
+        x[ 3] = Xor(x[ 3], RotL<13>(Add(x[ 2], x[ 1])));  x[ 4] = Xor(x[ 4], RotL<13>(Add(x[ 7], x[ 6])));
+        x[ 9] = Xor(x[ 9], RotL<13>(Add(x[ 8], x[11])));  x[14] = Xor(x[14], RotL<13>(Add(x[13], x[12])));
+
+        x[ 0] = Xor(x[ 0], RotL<18>(Add(x[ 3], x[ 2])));  x[ 5] = Xor(x[ 5], RotL<18>(Add(x[ 4], x[ 7])));
+        x[10] = Xor(x[10], RotL<18>(Add(x[ 9], x[ 8])));  x[15] = Xor(x[15], RotL<18>(Add(x[14], x[13])));
+    }
+    for (int i = 0; i < 16; i++) B[i] = Add(B[i], x[i]);
+}
+
+}
+
+/** Run ROMix over 16 lanes.
+ *  X:          32 words of state per lane, interleaved (X[16 * k + lane]).
+ *  scratchpad: 1024 * 32 * 16 * 4 bytes, 64-byte aligned.
+ */
+void ROMix_16way(uint32_t* X, void* scratchpad)
+{
+    __m512i* V = (__m512i*)scratchpad;
+    __m512i x[32];
+    for (int k = 0; k < 32; k++) x[k] = _mm512_loadu_si512((const void*)(X + 16 * k));
+
+    for (int i = 0; i < 1024; i++) {
+        for (int k = 0; k < 32; k++) _mm512_store_si512((void*)(V + 32 * i + k), x[k]);
+        XorSalsa8(&x[0], &x[16]);
+        XorSalsa8(&x[16], &x[0]);
+    }
+
+    // Each lane picks its own V entry, so the loads are gathered. The word
+    // offset of V[j][k] for lane l is (32 * j + k) * 16 + l.
+    const __m512i lanes = _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m512i mask = _mm512_set1_epi32(1023);
+    for (int i = 0; i < 1024; i++) {
+        __m512i idx = Add(_mm512_slli_epi32(_mm512_and_si512(x[16], mask), 9), lanes);
+        for (int k = 0; k < 32; k++) {
+            x[k] = Xor(x[k], _mm512_i32gather_epi32(idx, (const void*)V, 4));
+            idx = Add(idx, _mm512_set1_epi32(16));
+        }
+        XorSalsa8(&x[0], &x[16]);
+        XorSalsa8(&x[16], &x[0]);
+    }
+
+    for (int k = 0; k < 32; k++) _mm512_storeu_si512((void*)(X + 16 * k), x[k]);
+}
+
+}
+
+#endif
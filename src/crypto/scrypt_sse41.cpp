@@ -0,0 +1,92 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This is an 4-way SSE4.1 implementation of the scrypt(1024, 1, 1) ROMix
+// core. Lane l of every vector belongs to the l-th independent input.
+
+#ifdef ENABLE_SSE41
+
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace scrypt_sse41 {
+namespace {
+
+__m128i inline Add(__m128i x, __m128i y) { return _mm_add_epi32(x, y); }
+__m128i inline Xor(__m128i x, __m128i y) { return _mm_xor_si128(x, y); }
+__m128i inline RotL(__m128i x, int n) { return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n)); }
+
+/** B ^= Bx; B += Salsa20/8(B) on 4 interleaved lanes. */
+void inline XorSalsa8(__m128i* B, const __m128i* Bx)
+{
+    __m128i x[16];
+    for (int i = 0; i < 16; i++) x[i] = B[i] = Xor(B[i], Bx[i]);
+    for (int i = 0; i < 8; i += 2) {
+        /* Operate on columns. */
+        x[ 4] = Xor(x[ 4], RotL(Add(x[ 0], x[12]),  7));  x[ 9] = Xor(x[ 9], RotL(Add(x[ 5], x[ 1]),  7));
+        x[14] = Xor(x[14], RotL(Add(x[10], x[ 6]),  7));  x[ 3] = Xor(x[ 3], RotL(Add(x[15], x[11]),  7));
+
+        x[ 8] = Xor(x[ 8], RotL(Add(x[ 4], x[ 0]),  9));  x[13] = Xor(x[13], RotL(Add(x[ 9], x[ 5]),  9));
+        x[ 2] = Xor(x[ 2], RotL(Add(x[14], x[10]),  9));  x[ 7] = Xor(x[ 7], RotL(Add(x[ 3], x[15]),  9));
+
+        x[12] = Xor(x[12], RotL(Add(x[ 8], x[ 4]), 13));  x[ 1] = Xor(x[ 1], RotL(Add(x[13], x[ 9]), 13));
+        x[ 6] = Xor(x[ 6], RotL(Add(x[ 2], x[14]), 13));  x[11] = Xor(x[11], RotL(Add(x[ 7], x[ 3]), 13));
+
+        x[ 0] = Xor(x[ 0], RotL(Add(x[12], x[ 8]), 18));  x[ 5] = Xor(x[ 5], RotL(Add(x[ 1], x[13]), 18));
+        x[10] = Xor(x[10], RotL(Add(x[ 6], x[ 2]), 18));  x[15] = Xor(x[15], RotL(Add(x[11], x[ 7]), 18));
+
+        /* Operate on rows. */
+        x[ 1] = Xor(x[ 1], RotL(Add(x[ 0], x[ 3]),  7));  x[ 6] = Xor(x[ 6], RotL(Add(x[ 5], x[ 4]),  7));
+        x[11] = Xor(x[11], RotL(Add(x[10], x[ 9]),  7));  x[12] = Xor(x[12], RotL(Add(x[15], x[14]),  7));
+
+        x[ 2] = Xor(x[ 2], RotL(Add(x[ 1], x[ 0]),  9));  x[ 7] = Xor(x[ 7], RotL(Add(x[ 6], x[ 5]),  9));
+        x[ 8] = Xor(x[ 8], RotL(Add(x[11], x[10]),  9));  x[13] = Xor(x[13], RotL(Add(x[12], x[15]),  9));
+
+        x[ 3] = Xor(x[ 3], RotL(Add(x[ 2], x[ 1]), 13));  x[ 4] = Xor(x[ 4], RotL(Add(x[ 7], x[ 6]), 13));
+        x[ 9] = Xor(x[ 9], RotL(Add(x[ 8], x[11]), 13));  x[14] = Xor(x[14], RotL(Add(x[13], x[12]), 13));
+
+        x[ 0] = Xor(x[ 0], RotL(Add(x[ 3], x[ 2]), 18));  x[ 5] = Xor(x[ 5], RotL(Add(x[ 4], x[ 7]), 18));
+        x[10] = Xor(x[10], RotL(Add(x[ 9], x[ 8]), 18));  x[15] = Xor(x[15], RotL(Add(x[14], x[13]), 18));
+    }
+    for (int i = 0; i < 16; i++) B[i] = Add(B[i], x[i]);
+}
+
+}
+
+/** Run ROMix over 4 lanes.
+ *  X:          32 words of state per lane, interleaved (X[4 * k + lane]).
+ *  scratchpad: 1024 * 32 * 4 * 4 bytes, 16-byte aligned.
+ */
+void ROMix_4way(uint32_t* X, void* scratchpad)
+{
+    __m128i* V = (__m128i*)scratchpad;
+    __m128i x[32];
+    for (int k = 0; k < 32; k++) x[k] = _mm_loadu_si128((const __m128i*)(X + 4 * k));
+
+    for (int i = 0; i < 1024; i++) {
+        for (int k = 0; k < 32; k++) _mm_store_si128(V + 32 * i + k, x[k]);
+        XorSalsa8(&x[0], &x[16]);
+        XorSalsa8(&x[16], &x[0]);
+    }
+
+    // Each lane picks its own V entry; there is no gather in SSE4.1, so
+    // assemble the vectors from the four lanes' rows.
+    for (int i = 0; i < 1024; i++) {
+        const uint32_t* v0 = (const uint32_t*)(V + 32 * (_mm_extract_epi32(x[16], 0) & 1023));
+        const uint32_t* v1 = (const uint32_t*)(V + 32 * (_mm_extract_epi32(x[16], 1) & 1023)) + 1;
+        const uint32_t* v2 = (const uint32_t*)(V + 32 * (_mm_extract_epi32(x[16], 2) & 1023)) + 2;
+        const uint32_t* v3 = (const uint32_t*)(V + 32 * (_mm_extract_epi32(x[16], 3) & 1023)) + 3;
+        for (int k = 0; k < 32; k++) {
+            x[k] = Xor(x[k], _mm_set_epi32(v3[4 * k], v2[4 * k], v1[4 * k], v0[4 * k]));
+        }
+        XorSalsa8(&x[0], &x[16]);
+        XorSalsa8(&x[16], &x[0]);
+    }
+
+    for (int k = 0; k < 32; k++) _mm_storeu_si128((__m128i*)(X + 4 * k), x[k]);
+}
+
+}
+
+#endif
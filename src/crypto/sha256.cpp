@@ -6,6 +6,7 @@
 #include "crypto/sha256.h"
 
 #include "crypto/common.h"
+#include "compat/cpuid.h"
 
 #include <string.h>
 
@@ -30,6 +31,29 @@
 # endif
 #endif  /** ARM Headers */
 
+#if defined(HAVE_GETCPUID) && !defined(BUILD_BITCOIN_INTERNAL)
+#if defined(ENABLE_SSE41)
+namespace sha256d64_sse41
+{
+void Transform_4way(unsigned char* out, const unsigned char* in);
+}
+#endif
+
+#if defined(ENABLE_AVX2)
+namespace sha256d64_avx2
+{
+void Transform_8way(unsigned char* out, const unsigned char* in);
+}
+#endif
+
+#if defined(ENABLE_SHANI)
+namespace sha256_shani
+{
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
+}
+#endif
+#endif
+
 static const uint32_t K[] =
 {
     0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
@@ -332,9 +356,116 @@ void Transform(uint32_t* s, const unsigned char* chunk)
 #endif
 }
 
+/** Perform a number of consecutive SHA-256 transformations. */
+void TransformBlocks(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    while (blocks--) {
+        Transform(s, chunk);
+        chunk += 64;
+    }
+}
+
 } // namespace sha256
+
+typedef void (*TransformType)(uint32_t*, const unsigned char*, size_t);
+typedef void (*TransformD64Type)(unsigned char*, const unsigned char*);
+
+TransformType Transform = sha256::TransformBlocks;
+TransformD64Type TransformD64_4way = NULL;
+TransformD64Type TransformD64_8way = NULL;
+
+/** Double-SHA256 of a single 64-byte input, using the selected Transform. */
+void TransformD64(unsigned char* out, const unsigned char* in)
+{
+    static const unsigned char pad64[64] = {0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x02, 0x00};
+    uint32_t s[8];
+    unsigned char buf[64] = {0};
+
+    // First SHA-256 over the 64-byte input and its padding block.
+    sha256::Initialize(s);
+    Transform(s, in, 1);
+    Transform(s, pad64, 1);
+    for (int i = 0; i < 8; i++) {
+        WriteBE32(buf + 4 * i, s[i]);
+    }
+
+    // Second SHA-256 over the 32-byte result, padded into a single block.
+    buf[32] = 0x80;
+    buf[62] = 0x01;
+    sha256::Initialize(s);
+    Transform(s, buf, 1);
+    for (int i = 0; i < 8; i++) {
+        WriteBE32(out + 4 * i, s[i]);
+    }
+}
+
+#if defined(HAVE_GETCPUID) && !defined(BUILD_BITCOIN_INTERNAL)
+/** Check whether the OS saves the YMM registers on context switch. */
+bool AVXEnabled()
+{
+    return (GetXCR0() & 6) == 6;
+}
+#endif
 } // namespace
 
+std::string SHA256AutoDetect(int allowed)
+{
+    std::string ret = "standard";
+    Transform = sha256::TransformBlocks;
+    TransformD64_4way = NULL;
+    TransformD64_8way = NULL;
+
+#if defined(HAVE_GETCPUID) && !defined(BUILD_BITCOIN_INTERNAL)
+    uint32_t eax, ebx, ecx, edx;
+    GetCPUID(0, 0, eax, ebx, ecx, edx);
+    const uint32_t max_leaf = eax;
+    GetCPUID(1, 0, eax, ebx, ecx, edx);
+    const bool have_sse41 = (ecx >> 19) & 1;
+    const bool have_xsave = (ecx >> 27) & 1;
+    const bool have_avx = (ecx >> 28) & 1;
+    const bool have_os_avx = have_xsave && have_avx && AVXEnabled();
+    bool have_avx2 = false;
+    bool have_shani = false;
+    if (max_leaf >= 7) {
+        GetCPUID(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = (ebx >> 5) & 1;
+        have_shani = (ebx >> 29) & 1;
+    }
+
+#if defined(ENABLE_SHANI)
+    if (have_shani && have_sse41 && (allowed & SHA256_SHANI)) {
+        Transform = sha256_shani::Transform;
+        ret = "shani(1way)";
+    }
+#endif
+
+#if defined(ENABLE_SSE41)
+    if (have_sse41 && (allowed & SHA256_SSE41)) {
+        TransformD64_4way = sha256d64_sse41::Transform_4way;
+        ret += ",sse41(4way)";
+    }
+#endif
+
+#if defined(ENABLE_AVX2)
+    if (have_avx2 && have_os_avx && (allowed & SHA256_AVX2)) {
+        TransformD64_8way = sha256d64_avx2::Transform_8way;
+        ret += ",avx2(8way)";
+    }
+#endif
+
+    // Silence unused warnings for features this build has no kernel for.
+    (void)have_sse41;
+    (void)have_os_avx;
+    (void)have_avx2;
+    (void)have_shani;
+#endif
+
+    return ret;
+}
+
 
 ////// SHA-256
 
@@ -352,14 +483,15 @@ CSHA256& CSHA256::Write(const unsigned char* data, size_t len)
         memcpy(buf + bufsize, data, 64 - bufsize);
         bytes += 64 - bufsize;
         data += 64 - bufsize;
-        sha256::Transform(s, buf);
+        Transform(s, buf, 1);
         bufsize = 0;
     }
-    while (end >= data + 64) {
+    if (end - data >= 64) {
         // Process full chunks directly from the source.
-        sha256::Transform(s, data);
-        bytes += 64;
-        data += 64;
+        size_t blocks = (end - data) / 64;
+        Transform(s, data, blocks);
+        data += 64 * blocks;
+        bytes += 64 * blocks;
     }
     if (end > data) {
         // Fill the buffer with what remains.
@@ -392,3 +524,29 @@ CSHA256& CSHA256::Reset()
     sha256::Initialize(s);
     return *this;
 }
+
+void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
+{
+    if (TransformD64_8way) {
+        while (blocks >= 8) {
+            TransformD64_8way(out, in);
+            out += 256;
+            in += 512;
+            blocks -= 8;
+        }
+    }
+    if (TransformD64_4way) {
+        while (blocks >= 4) {
+            TransformD64_4way(out, in);
+            out += 128;
+            in += 256;
+            blocks -= 4;
+        }
+    }
+    while (blocks) {
+        TransformD64(out, in);
+        out += 32;
+        in += 64;
+        --blocks;
+    }
+}
@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string>
 
 /** A hasher class for SHA-256. */
 class CSHA256
@@ -25,4 +26,28 @@ public:
     CSHA256& Reset();
 };
 
+/** Optional SHA256 implementations, as a bitmask for SHA256AutoDetect. */
+enum SHA256Implementation {
+    SHA256_STANDARD = 0,
+    SHA256_SSE41 = 1 << 0,  //!< 4-way SHA256D64
+    SHA256_AVX2 = 1 << 1,   //!< 8-way SHA256D64
+    SHA256_SHANI = 1 << 2,  //!< single-block Transform
+    SHA256_ALL = SHA256_SSE41 | SHA256_AVX2 | SHA256_SHANI,
+};
+
+/** Autodetect the best available SHA256 implementation, considering only
+ *  the implementations in the allowed mask.
+ *  Returns the name of the implementation.
+ */
+std::string SHA256AutoDetect(int allowed = SHA256_ALL);
+
+/** Compute multiple double-SHA256's of 64-byte blobs.
+ *  output:  pointer to a blocks*32 byte output buffer
+ *  input:   pointer to a blocks*64 byte input buffer
+ *  blocks:  the number of hashes to compute.
+ *  Independent inputs are hashed 8 or 4 at a time when AVX2 or SSE4.1
+ *  kernels are available.
+ */
+void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
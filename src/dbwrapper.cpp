@@ -15,30 +15,85 @@
 #include <memenv.h>
 #include <stdint.h>
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+
+/** Open files of a database with the default profile */
+static const int DEFAULT_MAX_OPEN_FILES = 64;
+/** Databases that scale their open files keep one table open per this much cache */
+static const size_t CACHE_PER_OPEN_FILE = 512 << 10;
+/** Size of the tables the chain state is written to during initial sync */
+static const size_t IBD_MAX_FILE_SIZE = 32 << 20;
+
+static std::atomic<int> nExtraOpenFiles(0);
+
+void SetDBExtraOpenFiles(int nFiles)
+{
+    nExtraOpenFiles = std::max(nFiles, 0);
+}
+
+const char* DBProfileName(DBProfile profile)
+{
+    switch (profile) {
+    case DBProfile::DEFAULT: return "default";
+    case DBProfile::BLOCK_INDEX: return "blockindex";
+    case DBProfile::CHAINSTATE: return "chainstate";
+    case DBProfile::CHAINSTATE_IBD: return "chainstate_ibd";
+    }
+    assert(false);
+}
+
+static leveldb::Options GetOptions(size_t nCacheSize, DBProfile profile)
 {
     leveldb::Options options;
     options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
     options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
     options.filter_policy = leveldb::NewBloomFilterPolicy(10);
     options.compression = leveldb::kNoCompression;
-    options.max_open_files = 64;
+    options.max_open_files = DEFAULT_MAX_OPEN_FILES;
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
         // on corruption in later versions.
         options.paranoid_checks = true;
     }
+
+    switch (profile) {
+    case DBProfile::DEFAULT:
+        break;
+    case DBProfile::BLOCK_INDEX:
+        // Block headers and file info compress well. A leveldb built without
+        // snappy stores the blocks of the tables uncompressed instead.
+        options.compression = leveldb::kSnappyCompression;
+        break;
+    case DBProfile::CHAINSTATE_IBD:
+        // The coins cache absorbs most reads while syncing, so give more of
+        // the cache to the write buffer, and write larger tables that take
+        // fewer compactions to move down the levels.
+        delete options.block_cache;
+        options.block_cache = leveldb::NewLRUCache(nCacheSize / 4);
+        options.write_buffer_size = nCacheSize * 3 / 8;
+        options.max_file_size = IBD_MAX_FILE_SIZE;
+        // fall through
+    case DBProfile::CHAINSTATE:
+        // Reopening tables evicted from the table cache costs a read of their
+        // index and filter blocks, so keep as many open as the cache and the
+        // spare file descriptors allow.
+        options.max_open_files += std::min<int>(nExtraOpenFiles, nCacheSize / CACHE_PER_OPEN_FILE);
+        break;
+    }
     return options;
 }
 
-CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
+CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate, DBProfile profileIn) :
+    profile(profileIn)
 {
     penv = NULL;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    options = GetOptions(nCacheSize, profile);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -50,7 +105,7 @@ CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, b
             dbwrapper_private::HandleError(result);
         }
         TryCreateDirectory(path);
-        LogPrintf("Opening LevelDB in %s\n", path.string());
+        LogPrintf("Opening LevelDB in %s (%s profile, %d open files)\n", path.string(), DBProfileName(profile), options.max_open_files);
     }
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
@@ -122,6 +177,43 @@ bool CDBWrapper::IsEmpty()
     return !(it->Valid());
 }
 
+bool CDBWrapper::GetProperty(const std::string& strName, std::string& strValue) const
+{
+    return pdb->GetProperty(strName, &strValue);
+}
+
+size_t CDBWrapper::DynamicMemoryUsage() const
+{
+    std::string strMemory;
+    if (!GetProperty("leveldb.approximate-memory-usage", strMemory)) {
+        LogPrint("leveldb", "Failed to get approximate-memory-usage property\n");
+        return 0;
+    }
+    return atoi64(strMemory);
+}
+
+std::vector<CDBLevelStats> CDBWrapper::GetLevelStats() const
+{
+    // leveldb.stats is a table with a row per level:
+    //                                Compactions
+    // Level  Files Size(MB) Time(sec) Read(MB) Write(MB)
+    // --------------------------------------------------
+    //   0        2        0         0        0         0
+    std::vector<CDBLevelStats> vStats;
+    std::string strStats;
+    if (!GetProperty("leveldb.stats", strStats))
+        return vStats;
+    std::istringstream stream(strStats);
+    std::string strLine;
+    while (std::getline(stream, strLine)) {
+        CDBLevelStats stats;
+        if (sscanf(strLine.c_str(), "%d %d %lf %lf %lf %lf", &stats.nLevel, &stats.nFiles,
+                   &stats.dSizeMB, &stats.dTimeSec, &stats.dReadMB, &stats.dWriteMB) == 6)
+            vStats.push_back(stats);
+    }
+    return vStats;
+}
+
 CDBIterator::~CDBIterator() { delete piter; }
 bool CDBIterator::Valid() { return piter->Valid(); }
 void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
@@ -26,6 +26,38 @@ public:
     dbwrapper_error(const std::string& msg) : std::runtime_error(msg) {}
 };
 
+/** Tuning of the leveldb options of a database, by what is stored in it */
+enum class DBProfile {
+    //! Uncompressed 2 MiB tables, a bloom filter and at most 64 open files
+    DEFAULT,
+    //! Snappy compressed tables, for small records that compress well
+    BLOCK_INDEX,
+    //! Keeps more tables open the larger its cache is
+    CHAINSTATE,
+    //! Like CHAINSTATE with larger tables and a larger write buffer, which
+    //! compacts less while the chain state is built during initial sync
+    CHAINSTATE_IBD,
+};
+
+/** Name of the profile, as reported by getdbstats */
+const char* DBProfileName(DBProfile profile);
+
+/** Let the databases that scale their open files keep up to nFiles file
+ *  descriptors open in addition to the default. Has effect on databases
+ *  opened afterwards. */
+void SetDBExtraOpenFiles(int nFiles);
+
+/** Compaction statistics of one level of a database, from leveldb.stats */
+struct CDBLevelStats
+{
+    int nLevel;
+    int nFiles;
+    double dSizeMB;
+    double dTimeSec;
+    double dReadMB;
+    double dWriteMB;
+};
+
 class CDBWrapper;
 
 /** These should be considered an implementation detail of the specific database.
@@ -56,11 +88,19 @@ private:
     CDataStream ssKey;
     CDataStream ssValue;
 
+    size_t size_estimate;
+
 public:
     /**
      * @param[in] _parent   CDBWrapper that this batch is to be submitted to
      */
-    CDBBatch(const CDBWrapper &_parent) : parent(_parent), ssKey(SER_DISK, CLIENT_VERSION), ssValue(SER_DISK, CLIENT_VERSION) { };
+    CDBBatch(const CDBWrapper &_parent) : parent(_parent), ssKey(SER_DISK, CLIENT_VERSION), ssValue(SER_DISK, CLIENT_VERSION), size_estimate(0) { };
+
+    void Clear()
+    {
+        batch.Clear();
+        size_estimate = 0;
+    }
 
     template <typename K, typename V>
     void Write(const K& key, const V& value)
@@ -75,6 +115,14 @@ public:
         leveldb::Slice slValue(ssValue.data(), ssValue.size());
 
         batch.Put(slKey, slValue);
+        // LevelDB serializes writes as:
+        // - byte: header
+        // - varint: key length (1 byte up to 127B, 2 bytes up to 16383B, ...)
+        // - byte[]: key
+        // - varint: value length
+        // - byte[]: value
+        // The formula below assumes the key and value are both less than 16k.
+        size_estimate += 3 + (slKey.size() > 127) + slKey.size() + (slValue.size() > 127) + slValue.size();
         ssKey.clear();
         ssValue.clear();
     }
@@ -87,8 +135,16 @@ public:
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
 
         batch.Delete(slKey);
+        // LevelDB serializes erases as:
+        // - byte: header
+        // - varint: key length
+        // - byte[]: key
+        // The formula below assumes the key is less than 16kB.
+        size_estimate += 2 + (slKey.size() > 127) + slKey.size();
         ssKey.clear();
     }
+
+    size_t SizeEstimate() const { return size_estimate; }
 };
 
 class CDBIterator
@@ -179,6 +235,9 @@ private:
     //! the database itself
     leveldb::DB* pdb;
 
+    //! how the options of the database were tuned
+    DBProfile profile;
+
     //! a key used for optional XOR-obfuscation of the database
     std::vector<unsigned char> obfuscate_key;
 
@@ -198,8 +257,9 @@ public:
      * @param[in] fWipe       If true, remove all existing data.
      * @param[in] obfuscate   If true, store data obfuscated via simple XOR. If false, XOR
      *                        with a zero'd byte array.
+     * @param[in] profile     Tunes the leveldb options to what is stored in the database.
      */
-    CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false);
+    CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false, DBProfile profile = DBProfile::DEFAULT);
     ~CDBWrapper();
 
     template <typename K, typename V>
@@ -286,6 +346,33 @@ public:
      * Return true if the database managed by this class contains no entries.
      */
     bool IsEmpty();
+
+    DBProfile GetProfile() const { return profile; }
+
+    /** Read a leveldb property such as "leveldb.stats". */
+    bool GetProperty(const std::string& strName, std::string& strValue) const;
+
+    /** Memory used by the memtables and the block cache, in bytes. */
+    size_t DynamicMemoryUsage() const;
+
+    /** Compaction statistics of the levels that have files or were compacted. */
+    std::vector<CDBLevelStats> GetLevelStats() const;
+
+    /**
+     * Compact a certain range of keys in the database.
+     */
+    template<typename K>
+    void CompactRange(const K& key_begin, const K& key_end) const
+    {
+        CDataStream ssKey1(SER_DISK, CLIENT_VERSION), ssKey2(SER_DISK, CLIENT_VERSION);
+        ssKey1.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssKey2.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssKey1 << key_begin;
+        ssKey2 << key_end;
+        leveldb::Slice slKey1(ssKey1.data(), ssKey1.size());
+        leveldb::Slice slKey2(ssKey2.data(), ssKey2.size());
+        pdb->CompactRange(&slKey1, &slKey2);
+    }
 };
 
 #endif // BITCOIN_DBWRAPPER_H
@@ -86,7 +86,7 @@ unsigned int CalculateDogecoinNextWorkRequired(const CBlockIndex* pindexLast, in
     return bnNew.GetCompact();
 }
 
-bool CheckAuxPowProofOfWork(const CBlockHeader& block, const Consensus::Params& params)
+bool CheckAuxPowProofOfWork(const CBlockHeader& block, const Consensus::Params& params, const uint256* pPoWHash)
 {
     /* Except for legacy blocks with full version 1, ensure that
        the chain ID is correct.  Legacy blocks are not allowed since
@@ -110,7 +110,7 @@ bool CheckAuxPowProofOfWork(const CBlockHeader& block, const Consensus::Params&
             return true;
         }
 
-        if (!CheckProofOfWork(block.GetPoWHash(), block.nBits, params))
+        if (!CheckProofOfWork(pPoWHash ? *pPoWHash : block.GetPoWHash(), block.nBits, params))
             return error("%s : non-AUX proof of work failed", __func__);
 
         return true;
@@ -14,8 +14,9 @@ unsigned int CalculateDogecoinNextWorkRequired(const CBlockIndex* pindexLast, in
  * Check proof-of-work of a block header, taking auxpow into account.
  * @param block The block header.
  * @param params Consensus parameters.
+ * @param pPoWHash Precomputed scrypt hash of a non-auxpow header, or NULL.
  * @return True iff the PoW is correct.
  */
-bool CheckAuxPowProofOfWork(const CBlockHeader& block, const Consensus::Params& params);
+bool CheckAuxPowProofOfWork(const CBlockHeader& block, const Consensus::Params& params, const uint256* pPoWHash = NULL);
 
 
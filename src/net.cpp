@@ -27,6 +27,7 @@
 #include <string.h>
 #else
 #include <fcntl.h>
+#include <sys/uio.h>
 #endif
 
 #ifdef USE_UPNP
@@ -64,6 +65,13 @@ const static std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
 
 static const uint64_t RANDOMIZER_ID_NETGROUP = 0x6c0edd8036ef4036ULL; // SHA256("netgroup")[0:8]
 static const uint64_t RANDOMIZER_ID_LOCALHOSTNONCE = 0xd93e69e2bbfa5735ULL; // SHA256("localhostnonce")[0:8]
+
+/** Maximum number of buffers handed to one sendmsg() call (headers and payloads count separately). */
+static const size_t MAX_SEND_BUFFERS = 64;
+/** Maximum number of payload buffers kept for reuse. */
+static const size_t MAX_POOLED_NETMSG_BUFFERS = 256;
+/** Larger payload buffers are freed rather than pooled, so that block sized ones don't linger. */
+static const size_t MAX_POOLED_NETMSG_BUFFER_SIZE = 16 * 1024;
 //
 // Global state variables
 //
@@ -650,6 +658,8 @@ void CNode::copyStats(CNodeStats &stats)
         LOCK(cs_vSend);
         X(mapSendBytesPerMsgCmd);
         X(nSendBytes);
+        X(nSendBytesCopied);
+        X(nSendBytesShared);
     }
     {
         LOCK(cs_vRecv);
@@ -810,6 +820,52 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
     return nCopy;
 }
 
+namespace {
+struct CNetMsgBufferPool {
+    CCriticalSection cs;
+    std::vector<std::vector<unsigned char> > vBuffers;
+};
+
+CNetMsgBufferPool& GetNetMsgBufferPool()
+{
+    static CNetMsgBufferPool pool;
+    return pool;
+}
+}
+
+std::vector<unsigned char> GetNetMsgBuffer()
+{
+    std::vector<unsigned char> buffer;
+    CNetMsgBufferPool& pool = GetNetMsgBufferPool();
+    LOCK(pool.cs);
+    if (!pool.vBuffers.empty()) {
+        buffer.swap(pool.vBuffers.back());
+        pool.vBuffers.pop_back();
+    }
+    return buffer;
+}
+
+void ReleaseNetMsgBuffer(std::vector<unsigned char>&& buffer)
+{
+    if (buffer.capacity() == 0 || buffer.capacity() > MAX_POOLED_NETMSG_BUFFER_SIZE)
+        return;
+    buffer.clear();
+    CNetMsgBufferPool& pool = GetNetMsgBufferPool();
+    LOCK(pool.cs);
+    if (pool.vBuffers.size() < MAX_POOLED_NETMSG_BUFFERS)
+        pool.vBuffers.push_back(std::move(buffer));
+}
+
+CNetMsgPayload::CNetMsgPayload(std::vector<unsigned char>&& dataIn) : data(std::move(dataIn))
+{
+    hash = Hash(data.begin(), data.end());
+}
+
+CNetMsgPayload::~CNetMsgPayload()
+{
+    ReleaseNetMsgBuffer(std::move(data));
+}
+
 const uint256& CNetMessage::GetMessageHash() const
 {
     assert(complete());
@@ -833,26 +889,54 @@ size_t CConnman::SocketSendData(CNode *pnode) const
     size_t nSentSize = 0;
 
     while (it != pnode->vSendMsg.end()) {
-        const auto &data = *it;
-        assert(data.size() > pnode->nSendOffset);
+        assert(it->size() > pnode->nSendOffset);
+        // Gather the unsent parts of as many queued messages as fit into one
+        // call, starting nSendOffset bytes into the first.
+        std::vector<std::pair<const unsigned char*, size_t> > vBuffers;
+        size_t nOffset = pnode->nSendOffset;
+        for (auto itBuf = it; itBuf != pnode->vSendMsg.end() && vBuffers.size() + 2 <= MAX_SEND_BUFFERS; ++itBuf) {
+            const std::vector<unsigned char>& data = itBuf->payload->GetData();
+            if (nOffset < CMessageHeader::HEADER_SIZE)
+                vBuffers.emplace_back(itBuf->header + nOffset, CMessageHeader::HEADER_SIZE - nOffset);
+            size_t nDataOffset = std::max(nOffset, (size_t)CMessageHeader::HEADER_SIZE) - CMessageHeader::HEADER_SIZE;
+            if (nDataOffset < data.size())
+                vBuffers.emplace_back(data.data() + nDataOffset, data.size() - nDataOffset);
+            nOffset = 0;
+        }
         int nBytes = 0;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
-            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#ifdef WIN32
+            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(vBuffers[0].first), vBuffers[0].second, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+            struct iovec iov[MAX_SEND_BUFFERS];
+            for (size_t i = 0; i < vBuffers.size(); i++) {
+                iov[i].iov_base = const_cast<unsigned char*>(vBuffers[i].first);
+                iov[i].iov_len = vBuffers[i].second;
+            }
+            struct msghdr msg = {};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = vBuffers.size();
+            nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         }
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            // Retire the messages that went out completely
+            size_t nLeft = nBytes;
+            while (nLeft && nLeft >= it->size() - pnode->nSendOffset) {
+                nLeft -= it->size() - pnode->nSendOffset;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
-                pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+                pnode->nSendSize -= it->size();
                 it++;
-            } else {
+            }
+            pnode->nSendOffset += nLeft;
+            pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+            if (nLeft) {
                 // could not send full message; stop sending more
                 break;
             }
@@ -1186,23 +1270,15 @@ void CConnman::ThreadSocketHandler()
         //
         // Find which sockets have data to receive
         //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
+        // Sockets stay registered with socketEvents; only a change in what
+        // we wait for on a socket is passed on. Sockets that went away since
+        // the last round are dropped afterwards.
+        //
+        std::set<SOCKET> setWatched;
 
         BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = std::max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
+            WatchSocket(hListenSocket.socket, -1, CSocketEvents::EVENT_RECV);
+            setWatched.insert(hListenSocket.socket);
         }
 
         {
@@ -1210,12 +1286,12 @@ void CConnman::ThreadSocketHandler()
             BOOST_FOREACH(CNode* pnode, vNodes)
             {
                 // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
+                // * If there is data to send, wait for sending data. As this only
                 //   happens when optimistic write failed, we choose to first drain the
                 //   write buffer in this case before receiving more. This avoids
                 //   needlessly queueing received data, if the remote peer is not themselves
                 //   receiving data. This means properly utilizing TCP flow control signalling.
-                // * Otherwise, if there is space left in the receive buffer, select() for
+                // * Otherwise, if there is space left in the receive buffer, wait for
                 //   receiving data.
                 // * Hand off all complete messages to the processor, to be handled without
                 //   blocking here.
@@ -1231,46 +1307,52 @@ void CConnman::ThreadSocketHandler()
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
 
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = std::max(hSocketMax, pnode->hSocket);
-                have_fds = true;
-
-                if (select_send) {
-                    FD_SET(pnode->hSocket, &fdsetSend);
-                    continue;
-                }
-                if (select_recv) {
-                    FD_SET(pnode->hSocket, &fdsetRecv);
-                }
+                // Errors are always reported, even when waiting for nothing else.
+                int nEvents = 0;
+                if (select_send)
+                    nEvents = CSocketEvents::EVENT_SEND;
+                else if (select_recv)
+                    nEvents = CSocketEvents::EVENT_RECV;
+                WatchSocket(pnode->hSocket, pnode->id, nEvents);
+                setWatched.insert(pnode->hSocket);
             }
         }
 
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
-        if (interruptNet)
-            return;
+        for (std::map<SOCKET, NodeId>::iterator it = mapWatchedSockets.begin(); it != mapWatchedSockets.end(); ) {
+            if (setWatched.count(it->first)) {
+                ++it;
+                continue;
+            }
+            socketEvents.Unwatch(it->first);
+            mapWatchedSockets.erase(it++);
+        }
 
-        if (nSelect == SOCKET_ERROR)
+        // The timeout is how often the inactivity checks below run; new data
+        // to send and freed receive buffer space wake us up early.
+        std::map<SOCKET, int> mapReady;
+        if (!socketEvents.Wait(50, mapReady))
         {
-            if (have_fds)
+            if (interruptNet)
+                return;
+            if (!mapWatchedSockets.empty())
             {
                 int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
+                LogPrintf("socket %s error %s\n", socketEvents.GetBackendName(), NetworkErrorString(nErr));
+                for (const std::pair<const SOCKET, NodeId>& watched : mapWatchedSockets)
+                    mapReady[watched.first] = CSocketEvents::EVENT_RECV;
             }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            if (!interruptNet.sleep_for(std::chrono::milliseconds(timeout.tv_usec/1000)))
+            if (!interruptNet.sleep_for(std::chrono::milliseconds(50)))
                 return;
         }
+        if (interruptNet)
+            return;
 
         //
         // Accept new connections
         //
         BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            if (hListenSocket.socket != INVALID_SOCKET && mapReady.count(hListenSocket.socket))
             {
                 AcceptConnection(hListenSocket);
             }
@@ -1304,9 +1386,12 @@ void CConnman::ThreadSocketHandler()
                 LOCK(pnode->cs_hSocket);
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
-                recvSet = FD_ISSET(pnode->hSocket, &fdsetRecv);
-                sendSet = FD_ISSET(pnode->hSocket, &fdsetSend);
-                errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
+                std::map<SOCKET, int>::const_iterator it = mapReady.find(pnode->hSocket);
+                if (it != mapReady.end()) {
+                    recvSet = it->second & CSocketEvents::EVENT_RECV;
+                    sendSet = it->second & CSocketEvents::EVENT_SEND;
+                    errorSet = it->second & CSocketEvents::EVENT_ERR;
+                }
             }
             if (recvSet || errorSet)
             {
@@ -1437,6 +1522,25 @@ void CConnman::ThreadSocketHandler()
     }
 }
 
+void CConnman::WatchSocket(SOCKET hSocket, NodeId id, int nEvents)
+{
+    // A descriptor that was closed and reused for another node has to be
+    // registered afresh.
+    std::map<SOCKET, NodeId>::iterator it = mapWatchedSockets.find(hSocket);
+    if (it != mapWatchedSockets.end() && it->second != id) {
+        socketEvents.Unwatch(hSocket);
+        it->second = id;
+    } else if (it == mapWatchedSockets.end()) {
+        mapWatchedSockets.emplace(hSocket, id);
+    }
+    socketEvents.Watch(hSocket, nEvents);
+}
+
+void CConnman::WakeSocketHandler()
+{
+    socketEvents.Wake();
+}
+
 void CConnman::SetMaxConnections(int newMaxConnections)
 {
     newMaxConnections = std::max(newMaxConnections, MAX_ADDNODE_CONNECTIONS + PROTECTED_INBOUND_PEERS);
@@ -2006,6 +2110,7 @@ bool CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
     }
+    WakeSocketHandler();
 
     return true;
 }
@@ -2339,6 +2444,7 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     }
 
     // Send and receive from sockets, accept connections
+    LogPrintf("Waiting for socket events using %s\n", socketEvents.GetBackendName());
     threadSocketHandler = std::thread(&TraceThread<std::function<void()> >, "net", std::function<void()>(std::bind(&CConnman::ThreadSocketHandler, this)));
 
     if (!GetBoolArg("-dnsseed", true))
@@ -2386,6 +2492,7 @@ void CConnman::Interrupt()
     condMsgProc.notify_all();
 
     interruptNet();
+    socketEvents.Wake();
     InterruptSocks5(true);
 
     if (semOutbound) {
@@ -2714,6 +2821,8 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     nLastSend = 0;
     nLastRecv = 0;
     nSendBytes = 0;
+    nSendBytesCopied = 0;
+    nSendBytesShared = 0;
     nRecvBytes = 0;
     nTimeOffset = 0;
     addrName = addrNameIn == "" ? addr.ToStringIPPort() : addrNameIn;
@@ -2785,19 +2894,22 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
 
 void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 {
-    size_t nMessageSize = msg.data.size();
+    const bool fShared = msg.shared != nullptr;
+    CQueuedNetMsg queued;
+    queued.payload = fShared ? std::move(msg.shared) : std::make_shared<const CNetMsgPayload>(std::move(msg.data));
+    size_t nMessageSize = queued.payload->GetData().size();
     size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
     LogPrint("net", "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->id);
 
-    std::vector<unsigned char> serializedHeader;
-    serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
-    uint256 hash = Hash(msg.data.data(), msg.data.data() + nMessageSize);
+    // Lay out the header in place, as CMessageHeader would serialize it
     CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), nMessageSize);
-    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
-
-    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, serializedHeader, 0, hdr};
+    memcpy(queued.header, hdr.pchMessageStart, CMessageHeader::MESSAGE_START_SIZE);
+    memcpy(queued.header + CMessageHeader::MESSAGE_START_SIZE, hdr.pchCommand, CMessageHeader::COMMAND_SIZE);
+    WriteLE32(queued.header + CMessageHeader::MESSAGE_SIZE_OFFSET, nMessageSize);
+    memcpy(queued.header + CMessageHeader::CHECKSUM_OFFSET, queued.payload->GetHash().begin(), CMessageHeader::CHECKSUM_SIZE);
 
     size_t nBytesSent = 0;
+    bool fWakeSocketHandler = false;
     {
         LOCK(pnode->cs_vSend);
         bool optimisticSend(pnode->vSendMsg.empty());
@@ -2805,19 +2917,24 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
         //log total amount of bytes per command
         pnode->mapSendBytesPerMsgCmd[msg.command] += nTotalSize;
         pnode->nSendSize += nTotalSize;
+        pnode->nSendBytesCopied += fShared ? (size_t)CMessageHeader::HEADER_SIZE : nTotalSize;
+        pnode->nSendBytesShared += fShared ? nMessageSize : 0;
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize)
-            pnode->vSendMsg.push_back(std::move(msg.data));
+        pnode->vSendMsg.push_back(std::move(queued));
 
         // If write queue empty, attempt "optimistic write"
-        if (optimisticSend == true)
+        if (optimisticSend == true) {
             nBytesSent = SocketSendData(pnode);
+            // The socket handler isn't waiting to send on this socket yet
+            fWakeSocketHandler = !pnode->vSendMsg.empty();
+        }
     }
     if (nBytesSent)
         RecordBytesSent(nBytesSent);
+    if (fWakeSocketHandler)
+        WakeSocketHandler();
 }
 
 bool CConnman::ForNode(NodeId id, std::function<bool(CNode* pnode)> func)
@@ -15,6 +15,7 @@
 #include "hash.h"
 #include "limitedmap.h"
 #include "netaddress.h"
+#include "netbase.h"
 #include "protocol.h"
 #include "random.h"
 #include "streams.h"
@@ -107,6 +108,34 @@ class CTransaction;
 class CNodeStats;
 class CClientUIInterface;
 
+/** Take an empty buffer to serialize a message payload into, reusing a pooled one if possible. */
+std::vector<unsigned char> GetNetMsgBuffer();
+/** Give a payload buffer back to the pool. */
+void ReleaseNetMsgBuffer(std::vector<unsigned char>&& buffer);
+
+/**
+ * A serialized message payload, together with the hash its header checksum
+ * is taken from. Once made, a payload can be queued for any number of peers
+ * without copying it or hashing it again. Its buffer goes back to the pool
+ * when the last reference is dropped.
+ */
+class CNetMsgPayload
+{
+public:
+    explicit CNetMsgPayload(std::vector<unsigned char>&& dataIn);
+    ~CNetMsgPayload();
+    CNetMsgPayload(const CNetMsgPayload&) = delete;
+    CNetMsgPayload& operator=(const CNetMsgPayload&) = delete;
+
+    const std::vector<unsigned char>& GetData() const { return data; }
+    const uint256& GetHash() const { return hash; }
+
+private:
+    std::vector<unsigned char> data;
+    uint256 hash;
+};
+typedef std::shared_ptr<const CNetMsgPayload> CNetMsgPayloadRef;
+
 struct CSerializedNetMsg
 {
     CSerializedNetMsg() = default;
@@ -117,9 +146,20 @@ struct CSerializedNetMsg
     CSerializedNetMsg& operator=(const CSerializedNetMsg&) = delete;
 
     std::vector<unsigned char> data;
+    //! If set, sent instead of data without being copied
+    CNetMsgPayloadRef shared;
     std::string command;
 };
 
+/** A message waiting in a node's send queue. */
+struct CQueuedNetMsg
+{
+    unsigned char header[CMessageHeader::HEADER_SIZE];
+    CNetMsgPayloadRef payload;
+
+    size_t size() const { return CMessageHeader::HEADER_SIZE + payload->GetData().size(); }
+};
+
 
 class CConnman
 {
@@ -290,6 +330,8 @@ public:
     void SetMaxConnections(int newMaxConnections);
 
     void WakeMessageHandler();
+    /** Make the socket handler re-check which sockets to wait on, e.g. after queueing data to send. */
+    void WakeSocketHandler();
 private:
     struct ListenSocket {
         SOCKET socket;
@@ -303,6 +345,7 @@ private:
     void ThreadOpenConnections();
     void ThreadMessageHandler();
     void AcceptConnection(const ListenSocket& hListenSocket);
+    void WatchSocket(SOCKET hSocket, NodeId id, int nEvents);
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
 
@@ -405,6 +448,11 @@ private:
 
     CThreadInterrupt interruptNet;
 
+    /** Readiness of the listening and node sockets, only waited on by the socket handler. */
+    CSocketEvents socketEvents;
+    /** The node (or -1 for listening sockets) each watched socket belonged to when it was registered. */
+    std::map<SOCKET, NodeId> mapWatchedSockets;
+
     std::thread threadDNSAddressSeed;
     std::thread threadSocketHandler;
     std::thread threadOpenAddedConnections;
@@ -505,6 +553,8 @@ public:
     bool fAddnode;
     int nStartingHeight;
     uint64_t nSendBytes;
+    uint64_t nSendBytesCopied;
+    uint64_t nSendBytesShared;
     mapMsgCmdSize mapSendBytesPerMsgCmd;
     uint64_t nRecvBytes;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
@@ -578,7 +628,9 @@ public:
     size_t nSendSize; // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
-    std::deque<std::vector<unsigned char>> vSendMsg;
+    uint64_t nSendBytesCopied; // bytes queued that were serialized for this node alone
+    uint64_t nSendBytesShared; // bytes queued from payloads shared with other nodes
+    std::deque<CQueuedNetMsg> vSendMsg;
     CCriticalSection cs_vSend;
     CCriticalSection cs_hSocket;
     CCriticalSection cs_vRecv;
@@ -8,7 +8,9 @@
 
 #include "addrman.h"
 #include "arith_uint256.h"
+#include "blockcache.h"
 #include "blockencodings.h"
+#include "blockfilterindex.h"
 #include "chainparams.h"
 #include "consensus/validation.h"
 #include "hash.h"
@@ -64,6 +66,12 @@ static_assert(INBOUND_PEER_TX_DELAY >= MAX_GETDATA_RANDOM_DELAY,
 "To preserve security, MAX_GETDATA_RANDOM_DELAY should not exceed INBOUND_PEER_DELAY");
 /** Limit to avoid sending big packets. Not used in processing incoming GETDATA for compatibility */
 static const unsigned int MAX_GETDATA_SZ = 1000;
+/** Maximum number of compact filters that may be requested with one getcfilters. See BIP 157. */
+static constexpr uint32_t MAX_GETCFILTERS_SIZE = 1000;
+/** Maximum number of cf hashes that may be requested with one getcfheaders. See BIP 157. */
+static constexpr uint32_t MAX_GETCFHEADERS_SIZE = 2000;
+/** Interval between compact filter checkpoints. See BIP 157. */
+static constexpr int CFCHECKPT_INTERVAL = 1000;
 
 struct COrphanTx {
     // When modifying, adapt the copy of this definition in tests/DoS_tests.
@@ -967,8 +975,10 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
         most_recent_compact_block = pcmpctblock;
     }
 
-    connman->ForEachNode([this, &pcmpctblock, pindex, &msgMaker, fWitnessEnabled, &hashBlock](CNode* pnode) {
-        // TODO: Avoid the repeated-serialization here
+    // Serialized once, shared by all peers it is announced to
+    CNetMsgPayloadRef pcmpctpayload;
+
+    connman->ForEachNode([this, &pcmpctblock, &pcmpctpayload, pindex, &msgMaker, fWitnessEnabled, &hashBlock](CNode* pnode) {
         if (pnode->nVersion < INVALID_CB_NO_BAN_VERSION || pnode->fDisconnect)
             return;
         ProcessBlockAvailability(pnode->GetId());
@@ -980,7 +990,9 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
 
             LogPrint("net", "%s sending header-and-ids %s to peer=%d\n", "PeerLogicValidation::NewPoWValidBlock",
                     hashBlock.ToString(), pnode->id);
-            connman->PushMessage(pnode, msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
+            if (!pcmpctpayload)
+                pcmpctpayload = msgMaker.MakePayload(0, *pcmpctblock);
+            connman->PushMessage(pnode, CNetMsgMaker::MakeShared(NetMsgType::CMPCTBLOCK, pcmpctpayload));
             state.pindexBestHeaderSent = pindex;
         }
     });
@@ -1074,12 +1086,13 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
                 recentRejects->reset();
             }
 
-            // Use pcoinsTip->HaveCoinsInCache as a quick approximation to exclude
+            // Use pcoinsTip->HaveCoinInCache as a quick approximation to exclude
             // requesting or processing some txs which have already been included in a block
             return recentRejects->contains(inv.hash) ||
                    mempool.exists(inv.hash) ||
                    mapOrphanTransactions.count(inv.hash) ||
-                   pcoinsTip->HaveCoinsInCache(inv.hash);
+                   pcoinsTip->HaveCoinInCache(COutPoint(inv.hash, 0)) || // Best effort: only try output 0 and 1
+                   pcoinsTip->HaveCoinInCache(COutPoint(inv.hash, 1));
         }
     case MSG_BLOCK:
     case MSG_WITNESS_BLOCK:
@@ -1134,12 +1147,191 @@ static void RelayAddress(const CAddress& addr, bool fReachable, CConnman& connma
     connman.ForEachNodeThen(std::move(sortfunc), std::move(pushfunc));
 }
 
+/** Get the wire format of a block from the serve cache, or read it from disk
+ *  and add it. Must be called without cs_main held. */
+static CNetMsgPayloadRef GetBlockPayload(const uint256& hash, const CDiskBlockPos& pos, bool fWitness)
+{
+    CNetMsgPayloadRef payload = blockpayloadcache.Get(hash, fWitness);
+    if (payload)
+        return payload;
+
+    // Blocks are stored with their witness data, so that is the payload of
+    // a witness block as is.
+    std::vector<unsigned char> data;
+    if (!ReadRawBlockFromDisk(data, pos, Params().MessageStart()))
+        return CNetMsgPayloadRef();
+    if (!fWitness) {
+        CBlock block;
+        try {
+            CDataStream stream(data, SER_NETWORK, PROTOCOL_VERSION);
+            stream >> block;
+        } catch (const std::exception& e) {
+            error("%s: Deserialize error - %s at %s", __func__, e.what(), pos.ToString());
+            return CNetMsgPayloadRef();
+        }
+        data = GetNetMsgBuffer();
+        CVectorWriter(SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS, data, 0, block);
+    }
+    payload = std::make_shared<const CNetMsgPayload>(std::move(data));
+    blockpayloadcache.Add(hash, fWitness, payload);
+    return payload;
+}
+
+void static ProcessGetBlockData(CNode* pfrom, const Consensus::Params& consensusParams, const CInv& inv, CConnman& connman)
+{
+    const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
+    const CBlockIndex* pindex = NULL;
+    CDiskBlockPos pos;
+    bool fWitnessEnabled = false;
+    bool fPeerWantsWitness = false;
+    bool fSendCompact = false;
+    uint256 hashContinueTip;
+    {
+        LOCK(cs_main);
+        bool send = false;
+        BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
+        if (mi != mapBlockIndex.end())
+        {
+            if (mi->second->nChainTx && !mi->second->IsValid(BLOCK_VALID_SCRIPTS) &&
+                    mi->second->IsValid(BLOCK_VALID_TREE)) {
+                // If we have the block and all of its parents, but have not yet validated it,
+                // we might be in the middle of connecting it (ie in the unlock of cs_main
+                // before ActivateBestChain but after AcceptBlock).
+                // In this case, we need to run ActivateBestChain prior to checking the relay
+                // conditions below.
+                std::shared_ptr<const CBlock> a_recent_block;
+                {
+                    LOCK(cs_most_recent_block);
+                    a_recent_block = most_recent_block;
+                }
+                CValidationState dummy;
+                ActivateBestChain(dummy, Params(), a_recent_block);
+            }
+            if (chainActive.Contains(mi->second)) {
+                send = true;
+            } else {
+                static const int nOneMonth = 30 * 24 * 60 * 60;
+                // To prevent fingerprinting attacks, only send blocks outside of the active
+                // chain if they are valid, and no more than a month older (both in time, and in
+                // best equivalent proof of work) than the best header chain we know about.
+                send = mi->second->IsValid(BLOCK_VALID_SCRIPTS) && (pindexBestHeader != NULL) &&
+                    (pindexBestHeader->GetBlockTime() - mi->second->GetBlockTime() < nOneMonth) &&
+                    (GetBlockProofEquivalentTime(*pindexBestHeader, *mi->second, *pindexBestHeader, consensusParams) < nOneMonth);
+                if (!send) {
+                    LogPrintf("%s: ignoring request from peer=%i for old block that isn't in the main chain\n", __func__, pfrom->GetId());
+                }
+            }
+        }
+        // disconnect node in case we have reached the outbound limit for serving historical blocks
+        // never disconnect whitelisted nodes
+        static const int nOneWeek = 7 * 24 * 60 * 60; // assume > 1 week = historical
+        if (send && connman.OutboundTargetReached(true) && ( ((pindexBestHeader != NULL) && (pindexBestHeader->GetBlockTime() - mi->second->GetBlockTime() > nOneWeek)) || inv.type == MSG_FILTERED_BLOCK) && !pfrom->fWhitelisted)
+        {
+            LogPrint("net", "historical block serving limit reached, disconnect peer=%d\n", pfrom->GetId());
+
+            //disconnect node
+            pfrom->fDisconnect = true;
+            send = false;
+        }
+        // Pruned nodes may have deleted the block, so check whether
+        // it's available before trying to send.
+        if (!send || !(mi->second->nStatus & BLOCK_HAVE_DATA))
+            return;
+
+        // Everything needed from the index is copied here, so that the block
+        // itself can be read from disk without holding cs_main.
+        pindex = mi->second;
+        pos = pindex->GetBlockPos();
+        fWitnessEnabled = IsWitnessEnabled(pindex->pprev, consensusParams);
+        fPeerWantsWitness = State(pfrom->GetId())->fWantsCmpctWitness;
+        fSendCompact = CanDirectFetch(consensusParams) && pindex->nHeight >= chainActive.Height() - MAX_CMPCTBLOCK_DEPTH;
+        if (inv.hash == pfrom->hashContinue) {
+            hashContinueTip = chainActive.Tip()->GetBlockHash();
+            pfrom->hashContinue.SetNull();
+        }
+    }
+
+    bool fRead;
+    if (inv.type == MSG_BLOCK || inv.type == MSG_WITNESS_BLOCK || (inv.type == MSG_CMPCT_BLOCK && !fSendCompact))
+    {
+        // Full blocks are sent from the serve cache. Before segwit is active
+        // a block cannot have witness data, and both serializations are the same.
+        bool fWitness = !fWitnessEnabled || inv.type == MSG_WITNESS_BLOCK || (inv.type == MSG_CMPCT_BLOCK && fPeerWantsWitness);
+        CNetMsgPayloadRef payload = GetBlockPayload(inv.hash, pos, fWitness);
+        fRead = payload != nullptr;
+        if (fRead)
+            connman.PushMessage(pfrom, CNetMsgMaker::MakeShared(NetMsgType::BLOCK, std::move(payload)));
+    }
+    else
+    {
+        CBlock block;
+        fRead = ReadBlockFromDisk(block, pos, consensusParams, false) && block.GetHash() == inv.hash;
+        if (fRead && inv.type == MSG_FILTERED_BLOCK)
+        {
+            bool sendMerkleBlock = false;
+            CMerkleBlock merkleBlock;
+            {
+                LOCK(pfrom->cs_filter);
+                if (pfrom->pfilter) {
+                    sendMerkleBlock = true;
+                    merkleBlock = CMerkleBlock(block, *pfrom->pfilter);
+                }
+            }
+            if (sendMerkleBlock) {
+                connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::MERKLEBLOCK, merkleBlock));
+                // CMerkleBlock just contains hashes, so also push any transactions in the block the client did not see
+                // This avoids hurting performance by pointlessly requiring a round-trip
+                // Note that there is currently no way for a node to request any single transactions we didn't send here -
+                // they must either disconnect and retry or request the full block.
+                // Thus, the protocol spec specified allows for us to provide duplicate txn here,
+                // however we MUST always provide at least what the remote peer needs
+                typedef std::pair<unsigned int, uint256> PairType;
+                BOOST_FOREACH(PairType& pair, merkleBlock.vMatchedTxn)
+                    connman.PushMessage(pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::TX, *block.vtx[pair.first]));
+            }
+            // else
+                // no response
+        }
+        else if (fRead && inv.type == MSG_CMPCT_BLOCK)
+        {
+            // If a peer is asking for old blocks, we're almost guaranteed
+            // they won't have a useful mempool to match against a compact block,
+            // and we don't feel like constructing the object for them, so
+            // instead we respond with the full, non-compact block (see above).
+            int nSendFlags = fPeerWantsWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS;
+            CBlockHeaderAndShortTxIDs cmpctblock(block, fPeerWantsWitness);
+            connman.PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
+        }
+    }
+
+    if (!fRead) {
+        // The block may have been pruned after cs_main was released
+        LOCK(cs_main);
+        if (pindex->nStatus & BLOCK_HAVE_DATA)
+            LogPrintf("%s: cannot load block %s from disk, disconnect peer=%d\n", __func__, inv.hash.ToString(), pfrom->GetId());
+        else
+            LogPrint("net", "%s: block %s was pruned before it could be read, disconnect peer=%d\n", __func__, inv.hash.ToString(), pfrom->GetId());
+        pfrom->fDisconnect = true;
+        return;
+    }
+
+    // Trigger the peer node to send a getblocks request for the next batch of inventory
+    if (!hashContinueTip.IsNull())
+    {
+        // Bypass PushInventory, this must send even if redundant,
+        // and we want it right after the last block so they don't
+        // wait for other stuff first.
+        std::vector<CInv> vInv;
+        vInv.push_back(CInv(MSG_BLOCK, hashContinueTip));
+        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::INV, vInv));
+    }
+}
+
 void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParams, CConnman& connman, const std::atomic<bool>& interruptMsgProc)
 {
     std::deque<CInv>::iterator it = pfrom->vRecvGetData.begin();
     std::vector<CInv> vNotFound;
     const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
-    LOCK(cs_main);
 
     while (it != pfrom->vRecvGetData.end()) {
         // Don't bother if send buffer is too full to respond anyway
@@ -1155,119 +1347,12 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
 
             if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK || inv.type == MSG_WITNESS_BLOCK)
             {
-                bool send = false;
-                BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
-                if (mi != mapBlockIndex.end())
-                {
-                    if (mi->second->nChainTx && !mi->second->IsValid(BLOCK_VALID_SCRIPTS) &&
-                            mi->second->IsValid(BLOCK_VALID_TREE)) {
-                        // If we have the block and all of its parents, but have not yet validated it,
-                        // we might be in the middle of connecting it (ie in the unlock of cs_main
-                        // before ActivateBestChain but after AcceptBlock).
-                        // In this case, we need to run ActivateBestChain prior to checking the relay
-                        // conditions below.
-                        std::shared_ptr<const CBlock> a_recent_block;
-                        {
-                            LOCK(cs_most_recent_block);
-                            a_recent_block = most_recent_block;
-                        }
-                        CValidationState dummy;
-                        ActivateBestChain(dummy, Params(), a_recent_block);
-                    }
-                    if (chainActive.Contains(mi->second)) {
-                        send = true;
-                    } else {
-                        static const int nOneMonth = 30 * 24 * 60 * 60;
-                        // To prevent fingerprinting attacks, only send blocks outside of the active
-                        // chain if they are valid, and no more than a month older (both in time, and in
-                        // best equivalent proof of work) than the best header chain we know about.
-                        send = mi->second->IsValid(BLOCK_VALID_SCRIPTS) && (pindexBestHeader != NULL) &&
-                            (pindexBestHeader->GetBlockTime() - mi->second->GetBlockTime() < nOneMonth) &&
-                            (GetBlockProofEquivalentTime(*pindexBestHeader, *mi->second, *pindexBestHeader, consensusParams) < nOneMonth);
-                        if (!send) {
-                            LogPrintf("%s: ignoring request from peer=%i for old block that isn't in the main chain\n", __func__, pfrom->GetId());
-                        }
-                    }
-                }
-                // disconnect node in case we have reached the outbound limit for serving historical blocks
-                // never disconnect whitelisted nodes
-                static const int nOneWeek = 7 * 24 * 60 * 60; // assume > 1 week = historical
-                if (send && connman.OutboundTargetReached(true) && ( ((pindexBestHeader != NULL) && (pindexBestHeader->GetBlockTime() - mi->second->GetBlockTime() > nOneWeek)) || inv.type == MSG_FILTERED_BLOCK) && !pfrom->fWhitelisted)
-                {
-                    LogPrint("net", "historical block serving limit reached, disconnect peer=%d\n", pfrom->GetId());
-
-                    //disconnect node
-                    pfrom->fDisconnect = true;
-                    send = false;
-                }
-                // Pruned nodes may have deleted the block, so check whether
-                // it's available before trying to send.
-                if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
-                {
-                    // Send block from disk
-                    CBlock block;
-                    if (!ReadBlockFromDisk(block, (*mi).second, consensusParams, false))
-                        assert(!"cannot load block from disk");
-                    if (inv.type == MSG_BLOCK)
-                        connman.PushMessage(pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, block));
-                    else if (inv.type == MSG_WITNESS_BLOCK)
-                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, block));
-                    else if (inv.type == MSG_FILTERED_BLOCK)
-                    {
-                        bool sendMerkleBlock = false;
-                        CMerkleBlock merkleBlock;
-                        {
-                            LOCK(pfrom->cs_filter);
-                            if (pfrom->pfilter) {
-                                sendMerkleBlock = true;
-                                merkleBlock = CMerkleBlock(block, *pfrom->pfilter);
-                            }
-                        }
-                        if (sendMerkleBlock) {
-                            connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::MERKLEBLOCK, merkleBlock));
-                            // CMerkleBlock just contains hashes, so also push any transactions in the block the client did not see
-                            // This avoids hurting performance by pointlessly requiring a round-trip
-                            // Note that there is currently no way for a node to request any single transactions we didn't send here -
-                            // they must either disconnect and retry or request the full block.
-                            // Thus, the protocol spec specified allows for us to provide duplicate txn here,
-                            // however we MUST always provide at least what the remote peer needs
-                            typedef std::pair<unsigned int, uint256> PairType;
-                            BOOST_FOREACH(PairType& pair, merkleBlock.vMatchedTxn)
-                                connman.PushMessage(pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::TX, *block.vtx[pair.first]));
-                        }
-                        // else
-                            // no response
-                    }
-                    else if (inv.type == MSG_CMPCT_BLOCK)
-                    {
-                        // If a peer is asking for old blocks, we're almost guaranteed
-                        // they won't have a useful mempool to match against a compact block,
-                        // and we don't feel like constructing the object for them, so
-                        // instead we respond with the full, non-compact block.
-                        bool fPeerWantsWitness = State(pfrom->GetId())->fWantsCmpctWitness;
-                        int nSendFlags = fPeerWantsWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS;
-                        if (CanDirectFetch(consensusParams) && mi->second->nHeight >= chainActive.Height() - MAX_CMPCTBLOCK_DEPTH) {
-                            CBlockHeaderAndShortTxIDs cmpctblock(block, fPeerWantsWitness);
-                            connman.PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
-                        } else
-                            connman.PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::BLOCK, block));
-                    }
-
-                    // Trigger the peer node to send a getblocks request for the next batch of inventory
-                    if (inv.hash == pfrom->hashContinue)
-                    {
-                        // Bypass PushInventory, this must send even if redundant,
-                        // and we want it right after the last block so they don't
-                        // wait for other stuff first.
-                        std::vector<CInv> vInv;
-                        vInv.push_back(CInv(MSG_BLOCK, chainActive.Tip()->GetBlockHash()));
-                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::INV, vInv));
-                        pfrom->hashContinue.SetNull();
-                    }
-                }
+                ProcessGetBlockData(pfrom, consensusParams, inv, connman);
+                break;
             }
             else if (inv.type == MSG_TX || inv.type == MSG_WITNESS_TX)
             {
+                LOCK(cs_main);
                 // Send stream from relay memory
                 bool push = false;
                 auto mi = mapRelay.find(inv.hash);
@@ -1288,9 +1373,6 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                     vNotFound.push_back(inv);
                 }
             }
-
-            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK || inv.type == MSG_WITNESS_BLOCK)
-                break;
         }
     }
 
@@ -1340,6 +1422,146 @@ inline void static SendBlockTransactions(const CBlock& block, const BlockTransac
     connman.PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::BLOCKTXN, resp));
 }
 
+/**
+ * Validate a getcfilters, getcfheaders or getcfcheckpt request. Disconnects
+ * the peer if the request is invalid or asks for a filter type that is not
+ * served.
+ *
+ * @param[out] pindexStop      The block the request ends at.
+ * @param[out] pfilterIndex    The index to serve the request from.
+ * @return                     True if the request can be served.
+ */
+static bool PrepareBlockFilterRequest(CNode* pfrom, BlockFilterType filterType, uint32_t nStartHeight, const uint256& hashStop,
+                                      uint32_t nMaxHeightDiff, const CBlockIndex*& pindexStop, BlockFilterIndex*& pfilterIndex)
+{
+    if (filterType != BASIC || !(pfrom->GetLocalServices() & NODE_COMPACT_FILTERS)) {
+        LogPrint("net", "peer %d requested unsupported block filter type: %d\n", pfrom->id, static_cast<uint8_t>(filterType));
+        pfrom->fDisconnect = true;
+        return false;
+    }
+
+    {
+        LOCK(cs_main);
+        BlockMap::iterator it = mapBlockIndex.find(hashStop);
+        // Filters are only built for blocks that were connected
+        if (it == mapBlockIndex.end() || !it->second->IsValid(BLOCK_VALID_SCRIPTS)) {
+            LogPrint("net", "peer %d requested invalid block hash: %s\n", pfrom->id, hashStop.ToString());
+            pfrom->fDisconnect = true;
+            return false;
+        }
+        pindexStop = it->second;
+    }
+
+    uint32_t nStopHeight = pindexStop->nHeight;
+    if (nStartHeight > nStopHeight) {
+        LogPrint("net", "peer %d sent invalid getcfilters/getcfheaders with start height %d and stop height %d\n",
+                 pfrom->id, nStartHeight, nStopHeight);
+        pfrom->fDisconnect = true;
+        return false;
+    }
+    if (nStopHeight - nStartHeight >= nMaxHeightDiff) {
+        LogPrint("net", "peer %d requested too many cfilters/cfheaders: %d / %d\n",
+                 pfrom->id, nStopHeight - nStartHeight + 1, nMaxHeightDiff);
+        pfrom->fDisconnect = true;
+        return false;
+    }
+
+    pfilterIndex = GetBlockFilterIndex(filterType);
+    if (pfilterIndex == NULL) {
+        LogPrint("net", "Filter index for supported type %s not found\n", BlockFilterTypeName(filterType));
+        return false;
+    }
+    return true;
+}
+
+/** Answer a getcfilters request with one cfilter message per block. */
+static void ProcessGetCFilters(CNode* pfrom, CDataStream& vRecv, CConnman& connman)
+{
+    uint8_t nFilterType;
+    uint32_t nStartHeight;
+    uint256 hashStop;
+    vRecv >> nFilterType >> nStartHeight >> hashStop;
+
+    const BlockFilterType filterType = static_cast<BlockFilterType>(nFilterType);
+    const CBlockIndex* pindexStop;
+    BlockFilterIndex* pfilterIndex;
+    if (!PrepareBlockFilterRequest(pfrom, filterType, nStartHeight, hashStop, MAX_GETCFILTERS_SIZE, pindexStop, pfilterIndex))
+        return;
+
+    std::vector<BlockFilter> filters;
+    if (!pfilterIndex->LookupFilterRange(nStartHeight, pindexStop, filters)) {
+        LogPrint("net", "Failed to find block filter in index: filter_type=%s, start_height=%d, stop_hash=%s\n",
+                 BlockFilterTypeName(filterType), nStartHeight, hashStop.ToString());
+        return;
+    }
+
+    const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
+    for (const BlockFilter& filter : filters)
+        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::CFILTER, filter));
+}
+
+/** Answer a getcfheaders request with the header before the range and the filter hashes in it. */
+static void ProcessGetCFHeaders(CNode* pfrom, CDataStream& vRecv, CConnman& connman)
+{
+    uint8_t nFilterType;
+    uint32_t nStartHeight;
+    uint256 hashStop;
+    vRecv >> nFilterType >> nStartHeight >> hashStop;
+
+    const BlockFilterType filterType = static_cast<BlockFilterType>(nFilterType);
+    const CBlockIndex* pindexStop;
+    BlockFilterIndex* pfilterIndex;
+    if (!PrepareBlockFilterRequest(pfrom, filterType, nStartHeight, hashStop, MAX_GETCFHEADERS_SIZE, pindexStop, pfilterIndex))
+        return;
+
+    uint256 hashPrevHeader;
+    if (nStartHeight > 0) {
+        const CBlockIndex* pindexPrev = pindexStop->GetAncestor(static_cast<int>(nStartHeight - 1));
+        if (!pfilterIndex->LookupFilterHeader(pindexPrev, hashPrevHeader)) {
+            LogPrint("net", "Failed to find block filter header in index: filter_type=%s, block_hash=%s\n",
+                     BlockFilterTypeName(filterType), pindexPrev->GetBlockHash().ToString());
+            return;
+        }
+    }
+
+    std::vector<uint256> hashes;
+    if (!pfilterIndex->LookupFilterHashRange(nStartHeight, pindexStop, hashes)) {
+        LogPrint("net", "Failed to find block filter hashes in index: filter_type=%s, start_height=%d, stop_hash=%s\n",
+                 BlockFilterTypeName(filterType), nStartHeight, hashStop.ToString());
+        return;
+    }
+
+    const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
+    connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::CFHEADERS, nFilterType, pindexStop->GetBlockHash(), hashPrevHeader, hashes));
+}
+
+/** Answer a getcfcheckpt request with the filter header of every CFCHECKPT_INTERVAL'th block up to the stop block. */
+static void ProcessGetCFCheckPt(CNode* pfrom, CDataStream& vRecv, CConnman& connman)
+{
+    uint8_t nFilterType;
+    uint256 hashStop;
+    vRecv >> nFilterType >> hashStop;
+
+    const BlockFilterType filterType = static_cast<BlockFilterType>(nFilterType);
+    const CBlockIndex* pindexStop;
+    BlockFilterIndex* pfilterIndex;
+    if (!PrepareBlockFilterRequest(pfrom, filterType, 0, hashStop, std::numeric_limits<uint32_t>::max(), pindexStop, pfilterIndex))
+        return;
+
+    std::vector<uint256> headers(pindexStop->nHeight / CFCHECKPT_INTERVAL);
+    for (size_t i = 0; i < headers.size(); i++) {
+        const CBlockIndex* pindex = pindexStop->GetAncestor((i + 1) * CFCHECKPT_INTERVAL);
+        if (!pfilterIndex->LookupFilterHeader(pindex, headers[i])) {
+            LogPrint("net", "Failed to find block filter header in index: filter_type=%s, block_hash=%s\n",
+                     BlockFilterTypeName(filterType), pindex->GetBlockHash().ToString());
+            return;
+        }
+    }
+
+    const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
+    connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::CFCHECKPT, nFilterType, pindexStop->GetBlockHash(), headers));
+}
+
 bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, int64_t nTimeReceived, const CChainParams& chainparams, CConnman& connman, const std::atomic<bool>& interruptMsgProc)
 {
     LogPrint("net", "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->id);
@@ -2835,6 +3057,18 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         }
     }
 
+    else if (strCommand == NetMsgType::GETCFILTERS) {
+        ProcessGetCFilters(pfrom, vRecv, connman);
+    }
+
+    else if (strCommand == NetMsgType::GETCFHEADERS) {
+        ProcessGetCFHeaders(pfrom, vRecv, connman);
+    }
+
+    else if (strCommand == NetMsgType::GETCFCHECKPT) {
+        ProcessGetCFCheckPt(pfrom, vRecv, connman);
+    }
+
     else if (strCommand == NetMsgType::NOTFOUND) {
         // Remove the NOTFOUND transactions from the peer
         LOCK(cs_main);
@@ -2934,8 +3168,12 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
             // Just take one message
             msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
             pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
+            const bool fWasPaused = pfrom->fPauseRecv;
             pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman.GetReceiveFloodSize();
             fMoreWork = !pfrom->vProcessMsg.empty();
+            // Let the socket handler start receiving from this peer again
+            if (fWasPaused && !pfrom->fPauseRecv)
+                connman.WakeSocketHandler();
         }
         CNetMessage& msg(msgs.front());
 
@@ -22,6 +22,12 @@
 #ifndef WIN32
 #include <fcntl.h>
 #endif
+#ifdef USE_POLL
+#include <poll.h>
+#endif
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
 
 #include <boost/algorithm/string/case_conv.hpp> // for to_lower()
 #include <boost/algorithm/string/predicate.hpp> // for startswith() and endswith()
@@ -199,6 +205,27 @@ struct timeval MillisToTimeval(uint64_t nTimeout)
     return timeout;
 }
 
+/**
+ * Wait up to nTimeout milliseconds for a single socket to become readable
+ * (or writable, if fWrite). Returns like select(): SOCKET_ERROR on failure,
+ * 0 on timeout and a positive value otherwise.
+ */
+static int WaitForSocket(SOCKET hSocket, bool fWrite, int64_t nTimeout)
+{
+#ifdef USE_POLL
+    struct pollfd pollfd = {};
+    pollfd.fd = hSocket;
+    pollfd.events = fWrite ? POLLOUT : POLLIN;
+    return poll(&pollfd, 1, nTimeout);
+#else
+    struct timeval tval = MillisToTimeval(nTimeout);
+    fd_set fdset;
+    FD_ZERO(&fdset);
+    FD_SET(hSocket, &fdset);
+    return select(hSocket + 1, fWrite ? NULL : &fdset, fWrite ? &fdset : NULL, NULL, &tval);
+#endif
+}
+
 enum class IntrRecvError {
     OK,
     Timeout,
@@ -238,11 +265,7 @@ static IntrRecvError InterruptibleRecv(char* data, size_t len, uint64_t timeout,
                 if (!IsSelectableSocket(hSocket)) {
                     return IntrRecvError::NetworkError;
                 }
-                struct timeval tval = MillisToTimeval(std::min(endTime - curTime, maxWait));
-                fd_set fdset;
-                FD_ZERO(&fdset);
-                FD_SET(hSocket, &fdset);
-                int nRet = select(hSocket + 1, &fdset, NULL, NULL, &tval);
+                int nRet = WaitForSocket(hSocket, false, std::min(endTime - curTime, maxWait));
                 if (nRet == SOCKET_ERROR) {
                     return IntrRecvError::NetworkError;
                 }
@@ -455,11 +478,7 @@ bool static ConnectSocketDirectly(const CService &addrConnect, SOCKET& hSocketRe
         // WSAEINVAL is here because some legacy version of winsock uses it
         if (nErr == WSAEINPROGRESS || nErr == WSAEWOULDBLOCK || nErr == WSAEINVAL)
         {
-            struct timeval timeout = MillisToTimeval(nTimeout);
-            fd_set fdset;
-            FD_ZERO(&fdset);
-            FD_SET(hSocket, &fdset);
-            int nRet = select(hSocket + 1, NULL, &fdset, NULL, &timeout);
+            int nRet = WaitForSocket(hSocket, true, nTimeout);
             if (nRet == 0)
             {
                 LogPrint("net", "connection to %s timeout\n", addrConnect.ToString());
@@ -468,7 +487,7 @@ bool static ConnectSocketDirectly(const CService &addrConnect, SOCKET& hSocketRe
             }
             if (nRet == SOCKET_ERROR)
             {
-                LogPrintf("select() for %s failed: %s\n", addrConnect.ToString(), NetworkErrorString(WSAGetLastError()));
+                LogPrintf("waiting for %s failed: %s\n", addrConnect.ToString(), NetworkErrorString(WSAGetLastError()));
                 CloseSocket(hSocket);
                 return false;
             }
@@ -485,7 +504,7 @@ bool static ConnectSocketDirectly(const CService &addrConnect, SOCKET& hSocketRe
             }
             if (nRet != 0)
             {
-                LogPrintf("connect() to %s failed after select(): %s\n", addrConnect.ToString(), NetworkErrorString(nRet));
+                LogPrintf("connect() to %s failed after waiting: %s\n", addrConnect.ToString(), NetworkErrorString(nRet));
                 CloseSocket(hSocket);
                 return false;
             }
@@ -736,3 +755,274 @@ void InterruptSocks5(bool interrupt)
 {
     interruptSocks5Recv = interrupt;
 }
+
+CSocketEvents::CSocketEvents()
+{
+#if defined(USE_EPOLL)
+    Init(BACKEND_EPOLL);
+#elif defined(USE_POLL)
+    Init(BACKEND_POLL);
+#else
+    Init(BACKEND_SELECT);
+#endif
+}
+
+CSocketEvents::CSocketEvents(Backend backendIn)
+{
+    Init(backendIn);
+}
+
+void CSocketEvents::Init(Backend backendIn)
+{
+    backend = backendIn;
+    fWakePending = false;
+#ifdef USE_EPOLL
+    hEpoll = -1;
+    if (backend == BACKEND_EPOLL) {
+        hEpoll = epoll_create1(EPOLL_CLOEXEC);
+        if (hEpoll == -1) {
+            LogPrintf("epoll_create1 failed: %s, falling back to poll()\n", NetworkErrorString(errno));
+            backend = BACKEND_POLL;
+        }
+    }
+#else
+    if (backend == BACKEND_EPOLL)
+        backend = BACKEND_POLL;
+#endif
+#ifndef USE_POLL
+    if (backend == BACKEND_POLL)
+        backend = BACKEND_SELECT;
+#endif
+#ifndef WIN32
+    hWakeRead = hWakeWrite = -1;
+    int fds[2];
+    if (pipe(fds) == 0) {
+        hWakeRead = fds[0];
+        hWakeWrite = fds[1];
+        fcntl(hWakeRead, F_SETFL, fcntl(hWakeRead, F_GETFL, 0) | O_NONBLOCK);
+        fcntl(hWakeWrite, F_SETFL, fcntl(hWakeWrite, F_GETFL, 0) | O_NONBLOCK);
+        fcntl(hWakeRead, F_SETFD, FD_CLOEXEC);
+        fcntl(hWakeWrite, F_SETFD, FD_CLOEXEC);
+    } else {
+        LogPrintf("Creating the socket wakeup pipe failed: %s\n", NetworkErrorString(errno));
+    }
+#ifdef USE_EPOLL
+    if (hEpoll != -1 && hWakeRead != -1) {
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = hWakeRead;
+        epoll_ctl(hEpoll, EPOLL_CTL_ADD, hWakeRead, &event);
+    }
+#endif
+#endif
+}
+
+CSocketEvents::~CSocketEvents()
+{
+#ifdef USE_EPOLL
+    if (hEpoll != -1)
+        close(hEpoll);
+#endif
+#ifndef WIN32
+    if (hWakeRead != -1)
+        close(hWakeRead);
+    if (hWakeWrite != -1)
+        close(hWakeWrite);
+#endif
+}
+
+std::string CSocketEvents::GetBackendName() const
+{
+    switch (backend) {
+    case BACKEND_SELECT: return "select";
+    case BACKEND_POLL: return "poll";
+    case BACKEND_EPOLL: return "epoll";
+    }
+    return "unknown";
+}
+
+//! Whether select() can watch hSocket, whichever backend is compiled in
+static bool CanSelect(SOCKET hSocket)
+{
+#ifdef WIN32
+    return true;
+#else
+    return hSocket < FD_SETSIZE;
+#endif
+}
+
+#ifdef USE_EPOLL
+static uint32_t ToEpollEvents(int nEvents)
+{
+    uint32_t nEpollEvents = 0;
+    if (nEvents & CSocketEvents::EVENT_RECV) nEpollEvents |= EPOLLIN;
+    if (nEvents & CSocketEvents::EVENT_SEND) nEpollEvents |= EPOLLOUT;
+    return nEpollEvents;
+}
+#endif
+
+void CSocketEvents::Watch(SOCKET hSocket, int nEvents)
+{
+    nEvents &= EVENT_RECV | EVENT_SEND;
+    std::map<SOCKET, int>::iterator it = mapWatched.find(hSocket);
+    if (it != mapWatched.end() && it->second == nEvents)
+        return;
+#ifdef USE_EPOLL
+    if (backend == BACKEND_EPOLL) {
+        struct epoll_event event = {};
+        event.events = ToEpollEvents(nEvents);
+        event.data.fd = hSocket;
+        int op = it == mapWatched.end() ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+        if (epoll_ctl(hEpoll, op, hSocket, &event) != 0) {
+            // Retry with the other operation in case our view of the
+            // registration went stale.
+            op = op == EPOLL_CTL_ADD ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+            if (epoll_ctl(hEpoll, op, hSocket, &event) != 0) {
+                LogPrint("net", "epoll_ctl for socket %d failed: %s\n", hSocket, NetworkErrorString(errno));
+                return;
+            }
+        }
+    }
+#endif
+    mapWatched[hSocket] = nEvents;
+}
+
+void CSocketEvents::Unwatch(SOCKET hSocket)
+{
+    if (!mapWatched.erase(hSocket))
+        return;
+#ifdef USE_EPOLL
+    // Closing a descriptor already removes it from the epoll set, so this
+    // is allowed to fail.
+    if (backend == BACKEND_EPOLL)
+        epoll_ctl(hEpoll, EPOLL_CTL_DEL, hSocket, NULL);
+#endif
+}
+
+void CSocketEvents::Wake()
+{
+#ifndef WIN32
+    if (hWakeWrite != -1 && !fWakePending.exchange(true)) {
+        char c = 0;
+        if (write(hWakeWrite, &c, 1) != 1) {
+            // The pipe is full, so a wakeup is pending anyway
+        }
+    }
+#endif
+}
+
+void CSocketEvents::DrainWake()
+{
+#ifndef WIN32
+    // Clear the flag first, so that a Wake() racing with this writes again.
+    fWakePending = false;
+    char buf[64];
+    while (read(hWakeRead, buf, sizeof(buf)) > 0) {}
+#endif
+}
+
+bool CSocketEvents::Wait(int64_t nTimeout, std::map<SOCKET, int>& mapReady)
+{
+    mapReady.clear();
+#ifdef USE_EPOLL
+    if (backend == BACKEND_EPOLL) {
+        std::vector<struct epoll_event> vEvents(mapWatched.size() + 1);
+        int nReady = epoll_wait(hEpoll, vEvents.data(), vEvents.size(), nTimeout);
+        if (nReady < 0)
+            return errno == EINTR;
+        for (int i = 0; i < nReady; i++) {
+            const struct epoll_event& event = vEvents[i];
+            if (event.data.fd == hWakeRead) {
+                DrainWake();
+                continue;
+            }
+            int nEvents = 0;
+            if (event.events & EPOLLIN) nEvents |= EVENT_RECV;
+            if (event.events & EPOLLOUT) nEvents |= EVENT_SEND;
+            if (event.events & (EPOLLERR | EPOLLHUP)) nEvents |= EVENT_ERR;
+            mapReady[event.data.fd] = nEvents;
+        }
+        return true;
+    }
+#endif
+#ifdef USE_POLL
+    if (backend == BACKEND_POLL) {
+        std::vector<struct pollfd> vPollfds;
+        vPollfds.reserve(mapWatched.size() + 1);
+        for (const std::pair<const SOCKET, int>& watched : mapWatched) {
+            struct pollfd pollfd = {};
+            pollfd.fd = watched.first;
+            pollfd.events = ((watched.second & EVENT_RECV) ? POLLIN : 0) | ((watched.second & EVENT_SEND) ? POLLOUT : 0);
+            vPollfds.push_back(pollfd);
+        }
+        if (hWakeRead != -1) {
+            struct pollfd pollfd = {};
+            pollfd.fd = hWakeRead;
+            pollfd.events = POLLIN;
+            vPollfds.push_back(pollfd);
+        }
+        int nReady = poll(vPollfds.data(), vPollfds.size(), nTimeout);
+        if (nReady < 0)
+            return errno == EINTR;
+        for (const struct pollfd& pollfd : vPollfds) {
+            if (!pollfd.revents)
+                continue;
+            if (pollfd.fd == hWakeRead) {
+                DrainWake();
+                continue;
+            }
+            int nEvents = 0;
+            if (pollfd.revents & POLLIN) nEvents |= EVENT_RECV;
+            if (pollfd.revents & POLLOUT) nEvents |= EVENT_SEND;
+            if (pollfd.revents & (POLLERR | POLLHUP | POLLNVAL)) nEvents |= EVENT_ERR;
+            mapReady[pollfd.fd] = nEvents;
+        }
+        return true;
+    }
+#endif
+    struct timeval timeout = MillisToTimeval(nTimeout);
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+    bool have_fds = false;
+    for (const std::pair<const SOCKET, int>& watched : mapWatched) {
+        if (!CanSelect(watched.first))
+            continue;
+        FD_SET(watched.first, &fdsetError);
+        if (watched.second & EVENT_RECV)
+            FD_SET(watched.first, &fdsetRecv);
+        if (watched.second & EVENT_SEND)
+            FD_SET(watched.first, &fdsetSend);
+        hSocketMax = std::max(hSocketMax, watched.first);
+        have_fds = true;
+    }
+#ifndef WIN32
+    if (hWakeRead != -1 && CanSelect(hWakeRead)) {
+        FD_SET(hWakeRead, &fdsetRecv);
+        hSocketMax = std::max(hSocketMax, (SOCKET)hWakeRead);
+        have_fds = true;
+    }
+#endif
+    int nSelect = select(have_fds ? hSocketMax + 1 : 0, &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+    if (nSelect == SOCKET_ERROR)
+        return WSAGetLastError() == WSAEINTR;
+#ifndef WIN32
+    if (hWakeRead != -1 && CanSelect(hWakeRead) && FD_ISSET(hWakeRead, &fdsetRecv))
+        DrainWake();
+#endif
+    for (const std::pair<const SOCKET, int>& watched : mapWatched) {
+        if (!CanSelect(watched.first))
+            continue;
+        int nEvents = 0;
+        if (FD_ISSET(watched.first, &fdsetRecv)) nEvents |= EVENT_RECV;
+        if (FD_ISSET(watched.first, &fdsetSend)) nEvents |= EVENT_SEND;
+        if (FD_ISSET(watched.first, &fdsetError)) nEvents |= EVENT_ERR;
+        if (nEvents)
+            mapReady[watched.first] = nEvents;
+    }
+    return true;
+}
@@ -14,6 +14,8 @@
 #include "netaddress.h"
 #include "serialize.h"
 
+#include <atomic>
+#include <map>
 #include <stdint.h>
 #include <string>
 #include <vector>
@@ -66,4 +68,71 @@ bool SetSocketNonBlocking(SOCKET& hSocket, bool fNonBlocking);
 struct timeval MillisToTimeval(uint64_t nTimeout);
 void InterruptSocks5(bool interrupt);
 
+/**
+ * Waits for a set of sockets to become ready. Sockets stay registered
+ * between calls, so with the epoll backend only a change in the events of
+ * interest costs a system call. The poll() and select() backends rebuild
+ * their descriptor sets on every Wait().
+ *
+ * Watch(), Unwatch() and Wait() must be called from a single thread;
+ * Wake() may be called from any thread.
+ */
+class CSocketEvents
+{
+public:
+    enum Backend {
+        BACKEND_SELECT,
+        BACKEND_POLL,
+        BACKEND_EPOLL,
+    };
+
+    //! Event flags
+    enum {
+        EVENT_RECV = 1,
+        EVENT_SEND = 2,
+        //! Reported for errors and hang-ups, whether or not it was asked for
+        EVENT_ERR = 4,
+    };
+
+    //! Use the best backend this platform supports
+    CSocketEvents();
+    explicit CSocketEvents(Backend backendIn);
+    ~CSocketEvents();
+    CSocketEvents(const CSocketEvents&) = delete;
+    CSocketEvents& operator=(const CSocketEvents&) = delete;
+
+    Backend GetBackend() const { return backend; }
+    std::string GetBackendName() const;
+
+    /** Wait for nEvents (EVENT_RECV and/or EVENT_SEND) on hSocket, replacing any earlier interest. */
+    void Watch(SOCKET hSocket, int nEvents);
+    /** Stop watching hSocket. Must be called before a closed socket's descriptor can be watched again. */
+    void Unwatch(SOCKET hSocket);
+    /** Make a concurrent (or else the next) Wait() return immediately. */
+    void Wake();
+    /**
+     * Wait up to nTimeout milliseconds for a watched socket to become ready
+     * or for Wake() to be called. The ready sockets and their events are
+     * returned in mapReady. Returns false if waiting failed.
+     */
+    bool Wait(int64_t nTimeout, std::map<SOCKET, int>& mapReady);
+
+private:
+    Backend backend;
+    //! The events each socket is watched for
+    std::map<SOCKET, int> mapWatched;
+#ifdef USE_EPOLL
+    int hEpoll;
+#endif
+#ifndef WIN32
+    //! Wake() writes to hWakeWrite; hWakeRead is watched by Wait()
+    int hWakeRead;
+    int hWakeWrite;
+#endif
+    std::atomic<bool> fWakePending;
+
+    void Init(Backend backendIn);
+    void DrainWake();
+};
+
 #endif // BITCOIN_NETBASE_H
@@ -19,6 +19,7 @@ public:
     {
         CSerializedNetMsg msg;
         msg.command = std::move(sCommand);
+        msg.data = GetNetMsgBuffer();
         CVectorWriter{ SER_NETWORK, nFlags | nVersion, msg.data, 0, std::forward<Args>(args)... };
         return msg;
     }
@@ -29,6 +30,23 @@ public:
         return Make(0, std::move(sCommand), std::forward<Args>(args)...);
     }
 
+    /** Serialize a payload once, to be sent to several peers with MakeShared(). */
+    template <typename... Args>
+    CNetMsgPayloadRef MakePayload(int nFlags, Args&&... args) const
+    {
+        std::vector<unsigned char> data = GetNetMsgBuffer();
+        CVectorWriter{ SER_NETWORK, nFlags | nVersion, data, 0, std::forward<Args>(args)... };
+        return std::make_shared<const CNetMsgPayload>(std::move(data));
+    }
+
+    static CSerializedNetMsg MakeShared(std::string sCommand, CNetMsgPayloadRef payload)
+    {
+        CSerializedNetMsg msg;
+        msg.command = std::move(sCommand);
+        msg.shared = std::move(payload);
+        return msg;
+    }
+
 private:
     const int nVersion;
 };
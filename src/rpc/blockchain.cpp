@@ -5,10 +5,12 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "amount.h"
+#include "blockfilterindex.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "coins.h"
+#include "coinstats.h"
 #include "consensus/validation.h"
 #include "core_io.h"
 #include "validation.h"
@@ -17,6 +19,8 @@
 #include "rpc/server.h"
 #include "streams.h"
 #include "sync.h"
+#include "txdb.h"
+#include "txindex.h"
 #include "txmempool.h"
 #include "util.h"
 #include "utilstrencodings.h"
@@ -29,6 +33,7 @@
 
 #include <univalue.h>
 
+#include <boost/filesystem.hpp>
 #include <boost/thread/thread.hpp> // boost::thread::interrupt
 
 #include <mutex>
@@ -738,6 +743,204 @@ UniValue getblockheader(const JSONRPCRequest& request)
     return blockheaderToJSON(pblockindex);
 }
 
+UniValue getblockfilter(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw runtime_error(
+            "getblockfilter \"blockhash\" ( \"filtertype\" )\n"
+            "\nRetrieve a BIP 157 content filter for a particular block.\n"
+            "\nArguments:\n"
+            "1. \"blockhash\"     (string, required) The hash of the block\n"
+            "2. \"filtertype\"    (string, optional, default=\"basic\") The type name of the filter\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"filter\" : \"hex\",   (string) the hex-encoded filter data\n"
+            "  \"header\" : \"hash\",  (string) the hex-encoded filter header\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\" \"basic\"")
+            + HelpExampleRpc("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\", \"basic\"")
+        );
+
+    uint256 hashBlock(ParseHashV(request.params[0], "blockhash"));
+    std::string strFilterType = BlockFilterTypeName(BASIC);
+    if (request.params.size() > 1)
+        strFilterType = request.params[1].get_str();
+
+    BlockFilterType filterType;
+    if (!BlockFilterTypeByName(strFilterType, filterType))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown filtertype");
+
+    BlockFilterIndex* pindexFilter = GetBlockFilterIndex(filterType);
+    if (pindexFilter == NULL)
+        throw JSONRPCError(RPC_MISC_ERROR, "Index is not enabled for filtertype " + strFilterType);
+
+    const CBlockIndex* pblockindex;
+    bool fBlockWasConnected;
+    {
+        LOCK(cs_main);
+        BlockMap::const_iterator it = mapBlockIndex.find(hashBlock);
+        if (it == mapBlockIndex.end())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        pblockindex = it->second;
+        fBlockWasConnected = pblockindex->IsValid(BLOCK_VALID_SCRIPTS);
+    }
+
+    bool fIndexReady = pindexFilter->BlockUntilSyncedToCurrentChain();
+
+    BlockFilter filter;
+    uint256 header;
+    if (!pindexFilter->LookupFilter(pblockindex, filter) ||
+        !pindexFilter->LookupFilterHeader(pblockindex, header)) {
+        std::string strError;
+        if (!fBlockWasConnected) {
+            strError = "Block was not connected to active chain.";
+        } else if (!fIndexReady) {
+            strError = "Block filters are still in the process of being indexed.";
+        } else {
+            strError = "This error is unexpected and indicates index corruption.";
+        }
+        throw JSONRPCError(RPC_MISC_ERROR, strError);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("filter", HexStr(filter.GetEncodedFilter()));
+    ret.pushKV("header", header.GetHex());
+    return ret;
+}
+
+static UniValue IndexSummary(const CBaseIndex& index)
+{
+    const CBlockIndex* pindexBest = index.GetBestBlockIndex();
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("synced", index.IsSynced());
+    ret.pushKV("best_block_height", pindexBest ? pindexBest->nHeight : -1);
+    return ret;
+}
+
+UniValue getindexinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw runtime_error(
+            "getindexinfo ( \"index_name\" )\n"
+            "\nReturns the status of one or all available indices currently running in the node.\n"
+            "\nArguments:\n"
+            "1. \"index_name\"    (string, optional) Filter results for an index with a specific name.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"name\" : {                  (json object) The name of the index\n"
+            "    \"synced\" : true|false,     (boolean) Whether the index caught up with the active chain\n"
+            "    \"best_block_height\" : n,   (numeric) The block height to which the index is synced\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getindexinfo", "")
+            + HelpExampleRpc("getindexinfo", "")
+            + HelpExampleCli("getindexinfo", "txindex")
+            + HelpExampleRpc("getindexinfo", "txindex")
+        );
+
+    std::string strIndexName;
+    if (request.params.size() > 0)
+        strIndexName = request.params[0].get_str();
+
+    UniValue result(UniValue::VOBJ);
+    if (g_txindex && (strIndexName.empty() || strIndexName == "txindex"))
+        result.pushKV("txindex", IndexSummary(*g_txindex));
+
+    ForEachBlockFilterIndex([&](const BlockFilterIndex& index) {
+        std::string strName = BlockFilterTypeName(index.GetFilterType()) + " block filter index";
+        if (strIndexName.empty() || strIndexName == strName)
+            result.pushKV(strName, IndexSummary(index));
+    });
+
+    return result;
+}
+
+static UniValue DBStats(const CDBWrapper& db)
+{
+    UniValue levels(UniValue::VARR);
+    for (const CDBLevelStats& stats : db.GetLevelStats()) {
+        UniValue level(UniValue::VOBJ);
+        level.pushKV("level", stats.nLevel);
+        level.pushKV("files", stats.nFiles);
+        level.pushKV("size_mb", stats.dSizeMB);
+        level.pushKV("compaction_time", stats.dTimeSec);
+        level.pushKV("compaction_read_mb", stats.dReadMB);
+        level.pushKV("compaction_write_mb", stats.dWriteMB);
+        levels.push_back(level);
+    }
+
+    std::string strStats;
+    db.GetProperty("leveldb.stats", strStats);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("profile", DBProfileName(db.GetProfile()));
+    ret.pushKV("approximate_memory_usage", (uint64_t)db.DynamicMemoryUsage());
+    ret.pushKV("levels", levels);
+    ret.pushKV("stats", strStats);
+    return ret;
+}
+
+UniValue getdbstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw runtime_error(
+            "getdbstats ( \"db_name\" )\n"
+            "\nReturns statistics of the LevelDB databases of the node.\n"
+            "\nArguments:\n"
+            "1. \"db_name\"    (string, optional) Only return the statistics of this database.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"name\" : {                       (json object) The name of the database\n"
+            "    \"profile\" : \"xxxx\",            (string) How the options of the database are tuned\n"
+            "    \"approximate_memory_usage\" : n, (numeric) Memory used by the memtables and the block cache, in bytes\n"
+            "    \"levels\" : [                    (array) The levels that have files or were compacted\n"
+            "      {\n"
+            "        \"level\" : n,                (numeric) The level\n"
+            "        \"files\" : n,                (numeric) Number of tables in the level\n"
+            "        \"size_mb\" : n,              (numeric) Size of the tables in the level, in MB\n"
+            "        \"compaction_time\" : n,      (numeric) Time spent compacting into the level, in seconds\n"
+            "        \"compaction_read_mb\" : n,   (numeric) Data read by compactions into the level, in MB\n"
+            "        \"compaction_write_mb\" : n   (numeric) Data written by compactions into the level, in MB\n"
+            "      }, ...\n"
+            "    ],\n"
+            "    \"stats\" : \"xxxx\"               (string) The leveldb.stats property as LevelDB formats it\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdbstats", "")
+            + HelpExampleRpc("getdbstats", "")
+            + HelpExampleCli("getdbstats", "chainstate")
+            + HelpExampleRpc("getdbstats", "chainstate")
+        );
+
+    std::string strDBName;
+    if (request.params.size() > 0)
+        strDBName = request.params[0].get_str();
+
+    UniValue result(UniValue::VOBJ);
+    {
+        LOCK(cs_main);
+        if (pblocktree && (strDBName.empty() || strDBName == "blockindex"))
+            result.pushKV("blockindex", DBStats(*pblocktree));
+        if (pcoinsdbview && (strDBName.empty() || strDBName == "chainstate"))
+            result.pushKV("chainstate", DBStats(pcoinsdbview->GetDB()));
+    }
+    if (g_txindex && (strDBName.empty() || strDBName == "txindex"))
+        result.pushKV("txindex", DBStats(g_txindex->GetDatabase()));
+
+    ForEachBlockFilterIndex([&](const BlockFilterIndex& index) {
+        std::string strName = BlockFilterTypeName(index.GetFilterType()) + " block filter index";
+        if (strDBName.empty() || strDBName == strName)
+            result.pushKV(strName, DBStats(index.GetDatabase()));
+    });
+
+    return result;
+}
+
 static CBlock GetBlockChecked(const CBlockIndex* pblockindex)
 {
     CBlock block;
@@ -975,9 +1178,9 @@ UniValue getblockstats(const JSONRPCRequest& request) {
       if (loop_inputs) {
           CAmount tx_total_in = 0;
           const auto& txundo = blockUndo.vtxundo.at(i - 1);
-          for (const CTxInUndo& prevoutput: txundo.vprevout) {
+          for (const Coin& prevoutput: txundo.vprevout) {
 
-              tx_total_in += prevoutput.txout.nValue;
+              tx_total_in += prevoutput.out.nValue;
               utxo_size_inc -= GetSerializeSize(prevoutput, PROTOCOL_VERSION) + PER_UTXO_OVERHEAD;
           }
 
@@ -1146,60 +1349,6 @@ UniValue getblock(const JSONRPCRequest& request)
     return blockToJSON(block, pblockindex, verbosity >= 2);
 }
 
-struct CCoinsStats
-{
-    int nHeight;
-    uint256 hashBlock;
-    uint64_t nTransactions;
-    uint64_t nTransactionOutputs;
-    uint64_t nSerializedSize;
-    uint256 hashSerialized;
-    arith_uint256 nTotalAmount;
-
-    CCoinsStats() : nHeight(0), nTransactions(0), nTransactionOutputs(0), nSerializedSize(0), nTotalAmount(0) {}
-};
-
-//! Calculate statistics about the unspent transaction output set
-static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
-{
-    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
-
-    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
-    stats.hashBlock = pcursor->GetBestBlock();
-    {
-        LOCK(cs_main);
-        stats.nHeight = mapBlockIndex.find(stats.hashBlock)->second->nHeight;
-    }
-    ss << stats.hashBlock;
-    arith_uint256 nTotalAmount = 0;
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        uint256 key;
-        CCoins coins;
-        if (pcursor->GetKey(key) && pcursor->GetValue(coins)) {
-            stats.nTransactions++;
-            ss << key;
-            for (unsigned int i=0; i<coins.vout.size(); i++) {
-                const CTxOut &out = coins.vout[i];
-                if (!out.IsNull()) {
-                    stats.nTransactionOutputs++;
-                    ss << VARINT(i+1);
-                    ss << out;
-                    nTotalAmount += out.nValue;
-                }
-            }
-            stats.nSerializedSize += 32 + pcursor->GetValueSize();
-            ss << VARINT(0);
-        } else {
-            return error("%s: unable to read value", __func__);
-        }
-        pcursor->Next();
-    }
-    stats.hashSerialized = ss.GetHash();
-    stats.nTotalAmount = nTotalAmount;
-    return true;
-}
-
 UniValue pruneblockchain(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -1251,37 +1400,64 @@ UniValue pruneblockchain(const JSONRPCRequest& request)
 
 UniValue gettxoutsetinfo(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 0)
+    if (request.fHelp || request.params.size() > 1)
         throw runtime_error(
-            "gettxoutsetinfo\n"
+            "gettxoutsetinfo ( full_scan )\n"
             "\nReturns statistics about the unspent transaction output set.\n"
-            "Note this call may take some time.\n"
+            "The statistics marked with * need a scan of the whole set, which may take some time.\n"
+            "The others are kept up to date as blocks are connected; until they are known, a scan is done anyway.\n"
+            "\nArguments:\n"
+            "1. full_scan      (boolean, optional, default=false) Scan the whole set for all statistics\n"
             "\nResult:\n"
             "{\n"
             "  \"height\":n,     (numeric) The current block height (index)\n"
             "  \"bestblock\": \"hex\",   (string) the best block hash hex\n"
-            "  \"transactions\": n,      (numeric) The number of transactions\n"
+            "  \"transactions\": n,      (numeric) * The number of transactions\n"
             "  \"txouts\": n,            (numeric) The number of output transactions\n"
-            "  \"bytes_serialized\": n,  (numeric) The serialized size\n"
-            "  \"hash_serialized\": \"hash\",   (string) The serialized hash\n"
+            "  \"bytes_serialized\": n,  (numeric) * The serialized size\n"
+            "  \"hash_serialized\": \"hash\",   (string) * The serialized hash\n"
+            "  \"muhash\": \"hash\",     (string) The order-independent MuHash3072 of the set\n"
             "  \"total_amount\": x.xxx          (numeric) The total amount\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("gettxoutsetinfo", "")
+            + HelpExampleCli("gettxoutsetinfo", "true")
             + HelpExampleRpc("gettxoutsetinfo", "")
         );
 
+    bool fFullScan = false;
+    if (request.params.size() > 0)
+        fFullScan = request.params[0].get_bool();
+
     UniValue ret(UniValue::VOBJ);
 
+    CCoinsRollingStats rolling;
+    if (!fFullScan && GetRollingCoinsStats(rolling)) {
+        int nHeight;
+        {
+            LOCK(cs_main);
+            nHeight = mapBlockIndex.find(rolling.hashBlock)->second->nHeight;
+        }
+        ret.pushKV("height", (int64_t)nHeight);
+        ret.pushKV("bestblock", rolling.hashBlock.GetHex());
+        ret.pushKV("txouts", rolling.nTransactionOutputs);
+        ret.pushKV("muhash", rolling.GetHash().GetHex());
+        ret.pushKV("total_amount", ValueFromAmount(rolling.nTotalAmount));
+        return ret;
+    }
+
     CCoinsStats stats;
     FlushStateToDisk();
-    if (GetUTXOStats(pcoinsTip, stats)) {
+    if (GetUTXOStats(pcoinsTip, stats, &rolling)) {
+        // Keep the rolling statistics up to date from now on
+        SetRollingCoinsStats(rolling);
         ret.pushKV("height", (int64_t)stats.nHeight);
         ret.pushKV("bestblock", stats.hashBlock.GetHex());
         ret.pushKV("transactions", (int64_t)stats.nTransactions);
         ret.pushKV("txouts", (int64_t)stats.nTransactionOutputs);
         ret.pushKV("bytes_serialized", (int64_t)stats.nSerializedSize);
         ret.pushKV("hash_serialized", stats.hashSerialized.GetHex());
+        ret.pushKV("muhash", rolling.GetHash().GetHex());
         ret.pushKV("total_amount", ValueFromAmount(stats.nTotalAmount));
     } else {
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
@@ -1289,6 +1465,93 @@ UniValue gettxoutsetinfo(const JSONRPCRequest& request)
     return ret;
 }
 
+UniValue dumptxoutset(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw runtime_error(
+            "dumptxoutset \"path\"\n"
+            "\nWrites the unspent transaction output set at the current tip to a snapshot file,\n"
+            "which can be loaded by another node with loadtxoutset.\n"
+            "Note this call may take some time.\n"
+            "\nArguments:\n"
+            "1. \"path\"            (string, required) The snapshot file to create. Relative paths are relative to the data directory.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"coins_written\": n,        (numeric) The number of unspent transaction outputs written\n"
+            "  \"base_hash\": \"hash\",       (string) The hash of the block the snapshot was taken at\n"
+            "  \"base_height\": n,          (numeric) The height of that block\n"
+            "  \"path\": \"path\",            (string) The absolute path of the snapshot file\n"
+            "  \"hash_serialized\": \"hash\", (string) The hash the snapshot commits to, which is the hash_serialized of gettxoutsetinfo at that block\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("dumptxoutset", "\"utxo.dat\"")
+            + HelpExampleRpc("dumptxoutset", "\"utxo.dat\"")
+        );
+
+    boost::filesystem::path path = boost::filesystem::absolute(request.params[0].get_str(), GetDataDir());
+    if (boost::filesystem::exists(path))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists");
+
+    CUTXOSnapshotMetadata metadata;
+    std::string strError;
+    if (!DumpUTXOSnapshot(path, metadata, strError))
+        throw JSONRPCError(RPC_MISC_ERROR, strError);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("coins_written", (int64_t)metadata.nCoins);
+    ret.pushKV("base_hash", metadata.hashBlock.GetHex());
+    ret.pushKV("base_height", metadata.nHeight);
+    ret.pushKV("path", path.string());
+    ret.pushKV("hash_serialized", metadata.hashSerialized.GetHex());
+    return ret;
+}
+
+UniValue loadtxoutset(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw runtime_error(
+            "loadtxoutset \"path\" ( \"hash_serialized\" )\n"
+            "\nReplaces the unspent transaction output set by the one of a snapshot file written by\n"
+            "dumptxoutset, and makes the block it was taken at the new tip. The header of that block\n"
+            "has to be known already, and it must have at least as much work as the current tip.\n"
+            "Blocks before it are not downloaded or verified, and the chain cannot be reorganized to\n"
+            "below it. Compare the hash the snapshot commits to with gettxoutsetinfo on a trusted node,\n"
+            "or pass the expected hash to have it checked.\n"
+            "\nArguments:\n"
+            "1. \"path\"              (string, required) The snapshot file. Relative paths are relative to the data directory.\n"
+            "2. \"hash_serialized\"   (string, optional) The hash_serialized the snapshot has to commit to\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"coins_loaded\": n,         (numeric) The number of unspent transaction outputs loaded\n"
+            "  \"base_hash\": \"hash\",       (string) The hash of the block the snapshot was taken at, which is the new tip\n"
+            "  \"base_height\": n,          (numeric) The height of that block\n"
+            "  \"path\": \"path\",            (string) The absolute path of the snapshot file\n"
+            "  \"hash_serialized\": \"hash\", (string) The hash the snapshot commits to\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("loadtxoutset", "\"utxo.dat\"")
+            + HelpExampleRpc("loadtxoutset", "\"utxo.dat\"")
+        );
+
+    boost::filesystem::path path = boost::filesystem::absolute(request.params[0].get_str(), GetDataDir());
+    uint256 hashExpected;
+    if (request.params.size() > 1)
+        hashExpected = ParseHashV(request.params[1], "hash_serialized");
+
+    CUTXOSnapshotMetadata metadata;
+    std::string strError;
+    if (!LoadUTXOSnapshot(path, hashExpected, metadata, strError))
+        throw JSONRPCError(RPC_MISC_ERROR, strError);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("coins_loaded", (int64_t)metadata.nCoins);
+    ret.pushKV("base_hash", metadata.hashBlock.GetHex());
+    ret.pushKV("base_height", metadata.nHeight);
+    ret.pushKV("path", path.string());
+    ret.pushKV("hash_serialized", metadata.hashSerialized.GetHex());
+    return ret;
+}
+
 UniValue gettxout(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 2 || request.params.size() > 3)
@@ -1314,7 +1577,6 @@ UniValue gettxout(const JSONRPCRequest& request)
             "        ,...\n"
             "     ]\n"
             "  },\n"
-            "  \"version\" : n,            (numeric) The version\n"
             "  \"coinbase\" : true|false   (boolean) Coinbase or not\n"
             "}\n"
 
@@ -1338,33 +1600,33 @@ UniValue gettxout(const JSONRPCRequest& request)
     if (request.params.size() > 2)
         fMempool = request.params[2].get_bool();
 
-    CCoins coins;
+    COutPoint out(hash, n);
+    Coin coin;
     if (fMempool) {
         LOCK(mempool.cs);
         CCoinsViewMemPool view(pcoinsTip, mempool);
-        if (!view.GetCoins(hash, coins))
+        if (!view.GetCoin(out, coin) || mempool.isSpent(out)) { // TODO: filtering spent coins should be done by the CCoinsViewMemPool
             return NullUniValue;
-        mempool.pruneSpent(hash, coins); // TODO: this should be done by the CCoinsViewMemPool
+        }
     } else {
-        if (!pcoinsTip->GetCoins(hash, coins))
+        if (!pcoinsTip->GetCoin(out, coin)) {
             return NullUniValue;
+        }
     }
-    if (n<0 || (unsigned int)n>=coins.vout.size() || coins.vout[n].IsNull())
-        return NullUniValue;
 
     BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
     CBlockIndex *pindex = it->second;
     ret.pushKV("bestblock", pindex->GetBlockHash().GetHex());
-    if ((unsigned int)coins.nHeight == MEMPOOL_HEIGHT)
+    if (coin.nHeight == MEMPOOL_HEIGHT) {
         ret.pushKV("confirmations", 0);
-    else
-        ret.pushKV("confirmations", pindex->nHeight - coins.nHeight + 1);
-    ret.pushKV("value", ValueFromAmount(coins.vout[n].nValue));
+    } else {
+        ret.pushKV("confirmations", (int64_t)(pindex->nHeight - coin.nHeight + 1));
+    }
+    ret.pushKV("value", ValueFromAmount(coin.out.nValue));
     UniValue o(UniValue::VOBJ);
-    ScriptPubKeyToJSON(coins.vout[n].scriptPubKey, o, true);
+    ScriptPubKeyToJSON(coin.out.scriptPubKey, o, true);
     ret.pushKV("scriptPubKey", o);
-    ret.pushKV("version", coins.nVersion);
-    ret.pushKV("coinbase", coins.fCoinBase);
+    ret.pushKV("coinbase", (bool)coin.fCoinBase);
 
     return ret;
 }
@@ -1480,6 +1742,10 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
             "  \"initialblockdownload\": xxxx, (bool) (debug information) estimate of whether this node is in Initial Block Download mode.\n"
             "  \"chainwork\": \"xxxx\"     (string) total amount of work in active chain, in hexadecimal\n"
             "  \"size_on_disk\": xxxxxx,   (numeric) the estimated size of the block and undo files on disk\n"
+            "  \"coinsprefetch\": {        (object) inputs of connected blocks, as seen by the coins prefetcher\n"
+            "     \"hits\": xxxxxx,          (numeric) inputs whose coin was already in the coins cache\n"
+            "     \"misses\": xxxxxx         (numeric) inputs whose coin was read from the coins database ahead of validation\n"
+            "  },\n"
             "  \"pruned\": xx,             (boolean) if the blocks are subject to pruning\n"
             "  \"pruneheight\": xxxxxx,    (numeric) lowest-height complete block stored (only present if pruning is enabled)\n"
             "  \"automatic_pruning\": xx,  (boolean) whether automatic pruning is enabled (only present if pruning is enabled)\n"
@@ -1521,6 +1787,11 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
     obj.pushKV("initialblockdownload",  IsInitialBlockDownload());
     obj.pushKV("chainwork",             chainActive.Tip()->nChainWork.GetHex());
     obj.pushKV("size_on_disk",          CalculateCurrentUsage());
+    CCoinsPrefetchStats prefetchStats = GetCoinsPrefetchStats();
+    UniValue coinsprefetch(UniValue::VOBJ);
+    coinsprefetch.pushKV("hits",        (uint64_t)prefetchStats.nHits);
+    coinsprefetch.pushKV("misses",      (uint64_t)prefetchStats.nMisses);
+    obj.pushKV("coinsprefetch",         coinsprefetch);
     obj.pushKV("pruned",                fPruneMode);
     if (fPruneMode) {
         CBlockIndex* block = chainActive.Tip();
@@ -1830,6 +2101,9 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getblockstats",          &getblockstats,          true,  {"hash_or_height","stats"} },
     { "blockchain",         "getblockhash",           &getblockhash,           true,  {"height"} },
     { "blockchain",         "getblockheader",         &getblockheader,         true,  {"blockhash","verbose"} },
+    { "blockchain",         "getblockfilter",         &getblockfilter,         true,  {"blockhash","filtertype"} },
+    { "blockchain",         "getindexinfo",           &getindexinfo,           true,  {"index_name"} },
+    { "blockchain",         "getdbstats",             &getdbstats,             true,  {"db_name"} },
     { "blockchain",         "getchaintips",           &getchaintips,           true,  {} },
     { "blockchain",         "getdifficulty",          &getdifficulty,          true,  {} },
     { "blockchain",         "getmempoolancestors",    &getmempoolancestors,    true,  {"txid","verbose"} },
@@ -1838,7 +2112,9 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true,  {} },
     { "blockchain",         "getrawmempool",          &getrawmempool,          true,  {"verbose"} },
     { "blockchain",         "gettxout",               &gettxout,               true,  {"txid","n","include_mempool"} },
-    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true,  {} },
+    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true,  {"full_scan"} },
+    { "blockchain",         "dumptxoutset",           &dumptxoutset,           true,  {"path"} },
+    { "blockchain",         "loadtxoutset",           &loadtxoutset,           false, {"path","hash_serialized"} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        true,  {"height"} },
     { "blockchain",         "verifychain",            &verifychain,            true,  {"checklevel","nblocks"} },
 
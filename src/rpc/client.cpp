@@ -88,6 +88,12 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "listunspent", 4, "query_options" },
     { "getblock", 1, "verbose" },
     { "getblockheader", 1, "verbose" },
+    { "gettxoutsetinfo", 0, "full_scan" },
+    { "getaddressutxos", 0, "addresses" },
+    { "getaddressbalance", 0, "addresses" },
+    { "getaddresstxids", 0, "addresses" },
+    { "getaddresstxids", 1, "start" },
+    { "getaddresstxids", 2, "end" },
     { "gettransaction", 1, "include_watchonly" },
     { "getrawtransaction", 1, "verbose" },
     { "createrawtransaction", 0, "inputs" },
@@ -12,6 +12,7 @@
 #include "consensus/params.h"
 #include "consensus/validation.h"
 #include "core_io.h"
+#include "crypto/scrypt.h"
 #include "init.h"
 #include "validation.h"
 #include "miner.h"
@@ -97,6 +98,42 @@ UniValue getnetworkhashps(const JSONRPCRequest& request)
     return GetNetworkHashPS(request.params.size() > 0 ? request.params[0].get_int() : 120, request.params.size() > 1 ? request.params[1].get_int() : -1);
 }
 
+/**
+ * Try nonces of header until one satisfies nBits, nMaxTries runs out or the
+ * nonce reaches nMaxNonce. Nonces are hashed in growing batches so that the
+ * multi-lane scrypt kernels can be used without wasting work on easy targets.
+ */
+static bool ScanPoWNonces(CPureBlockHeader& header, unsigned int nBits, const Consensus::Params& params, uint64_t& nMaxTries, uint32_t nMaxNonce)
+{
+    static const uint32_t nMaxBatch = 16;
+    uint32_t nBatch = 1;
+    CPureBlockHeader headers[nMaxBatch];
+    uint256 hashes[nMaxBatch];
+    const char* inputs[nMaxBatch];
+    char* outputs[nMaxBatch];
+    while (nMaxTries > 0 && header.nNonce < nMaxNonce) {
+        const uint32_t n = std::min<uint64_t>(std::min<uint64_t>(nBatch, nMaxTries), nMaxNonce - header.nNonce);
+        for (uint32_t i = 0; i < n; i++) {
+            headers[i] = header;
+            headers[i].nNonce = header.nNonce + i;
+            inputs[i] = BEGIN(headers[i].nVersion);
+            outputs[i] = BEGIN(hashes[i]);
+        }
+        scrypt_1024_1_1_256_multi(inputs, outputs, n);
+        for (uint32_t i = 0; i < n; i++) {
+            if (CheckProofOfWork(hashes[i], nBits, params)) {
+                header.nNonce += i;
+                nMaxTries -= i;
+                return true;
+            }
+        }
+        header.nNonce += n;
+        nMaxTries -= n;
+        nBatch = std::min(nBatch * 2, nMaxBatch);
+    }
+    return false;
+}
+
 UniValue generateBlocks(boost::shared_ptr<CReserveScript> coinbaseScript, int nGenerate, uint64_t nMaxTries, bool keepScript, int nMineAuxPow)
 {
     // Dogecoin: Never mine witness tx
@@ -125,17 +162,11 @@ UniValue generateBlocks(boost::shared_ptr<CReserveScript> coinbaseScript, int nG
             IncrementExtraNonce(pblock, chainActive.Tip(), nExtraNonce);
         }
         if (!nMineAuxPow) {
-            while (nMaxTries > 0 && pblock->nNonce < nInnerLoopCount && !CheckProofOfWork(pblock->GetPoWHash(), pblock->nBits, Params().GetConsensus(nHeight))) {
-                ++pblock->nNonce;
-                --nMaxTries;
-            }
+            ScanPoWNonces(*pblock, pblock->nBits, Params().GetConsensus(nHeight), nMaxTries, nInnerLoopCount);
         } else {
             CAuxPow::initAuxPow(*pblock);
             CPureBlockHeader& miningHeader = pblock->auxpow->parentBlock;
-            while (nMaxTries > 0 && miningHeader.nNonce < nInnerLoopCount && !CheckProofOfWork(miningHeader.GetPoWHash(), pblock->nBits, Params().GetConsensus(nHeight))) {
-                ++miningHeader.nNonce;
-                --nMaxTries;
-            }
+            ScanPoWNonces(miningHeader, pblock->nBits, Params().GetConsensus(nHeight), nMaxTries, nInnerLoopCount);
         }
         if (nMaxTries == 0) {
             break;
@@ -4,6 +4,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "addressindex.h"
 #include "base58.h"
 #include "clientversion.h"
 #include "init.h"
@@ -12,6 +13,7 @@
 #include "netbase.h"
 #include "rpc/server.h"
 #include "timedata.h"
+#include "txdb.h"
 #include "util.h"
 #include "utilstrencodings.h"
 #ifdef ENABLE_WALLET
@@ -497,6 +499,175 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
     return obj;
 }
 
+/** Check that the address index can answer queries, which it can once it caught up with the active chain */
+static void EnsureAddressIndex()
+{
+    if (!fAddressIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index not enabled, restart with -addressindex");
+    LOCK(cs_main);
+    if (!fAddressIndexSynced)
+        throw JSONRPCError(RPC_IN_WARMUP, "Address index is still being built");
+}
+
+/** Parse a single address or an array of addresses into the script hashes they are indexed by */
+static std::vector<std::pair<uint160, std::string> > ParseAddressIndexAddresses(const UniValue& param)
+{
+    std::vector<std::string> vstrAddresses;
+    if (param.isStr()) {
+        vstrAddresses.push_back(param.get_str());
+    } else {
+        const UniValue& addresses = param.get_array();
+        for (size_t i = 0; i < addresses.size(); i++)
+            vstrAddresses.push_back(addresses[i].get_str());
+    }
+
+    std::vector<std::pair<uint160, std::string> > vAddresses;
+    std::set<uint160> setSeen;
+    for (const std::string& strAddress : vstrAddresses) {
+        CBitcoinAddress address(strAddress);
+        if (!address.IsValid())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, string("Invalid Dogecoin address: ") + strAddress);
+        uint160 hashScript = GetAddressIndexScriptHash(GetScriptForDestination(address.Get()));
+        if (setSeen.insert(hashScript).second)
+            vAddresses.push_back(std::make_pair(hashScript, strAddress));
+    }
+    return vAddresses;
+}
+
+UniValue getaddressutxos(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw runtime_error(
+            "getaddressutxos [\"address\",...]\n"
+            "\nReturns the unspent outputs of the given addresses in the active chain (requires -addressindex).\n"
+            "\nArguments:\n"
+            "1. \"addresses\"     (array, required) The dogecoin addresses\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"address\" : \"address\",   (string) The address the output pays to\n"
+            "    \"txid\" : \"hash\",         (string) The transaction id\n"
+            "    \"vout\" : n,                (numeric) The output number\n"
+            "    \"scriptPubKey\" : \"hex\",  (string) The script of the output\n"
+            "    \"amount\" : x.xxx,          (numeric) The output value in " + CURRENCY_UNIT + "\n"
+            "    \"height\" : n               (numeric) The height of the block the output was created in\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddressutxos", "\"[\\\"DTaXouBvXCDfViRZzSCaVNQBAyt1D9zThT\\\"]\"")
+            + HelpExampleRpc("getaddressutxos", "[\"DTaXouBvXCDfViRZzSCaVNQBAyt1D9zThT\"]")
+        );
+
+    std::vector<std::pair<uint160, std::string> > vAddresses = ParseAddressIndexAddresses(request.params[0]);
+    EnsureAddressIndex();
+
+    UniValue result(UniValue::VARR);
+    for (const auto& address : vAddresses) {
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vUnspent;
+        if (!pblocktree->ReadAddressUnspentIndex(address.first, vUnspent))
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index");
+        for (const auto& unspent : vUnspent) {
+            UniValue output(UniValue::VOBJ);
+            output.pushKV("address", address.second);
+            output.pushKV("txid", unspent.first.txhash.GetHex());
+            output.pushKV("vout", (int)unspent.first.nIndex);
+            output.pushKV("scriptPubKey", HexStr(unspent.second.script.begin(), unspent.second.script.end()));
+            output.pushKV("amount", ValueFromAmount(unspent.second.nValue));
+            output.pushKV("height", unspent.second.nHeight);
+            result.push_back(output);
+        }
+    }
+    return result;
+}
+
+UniValue getaddressbalance(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw runtime_error(
+            "getaddressbalance [\"address\",...]\n"
+            "\nReturns the balance of the given addresses in the active chain (requires -addressindex).\n"
+            "\nArguments:\n"
+            "1. \"addresses\"     (array, required) The dogecoin addresses\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"balance\" : x.xxx,          (numeric) The sum of the unspent outputs in " + CURRENCY_UNIT + "\n"
+            "  \"received\" : x.xxx          (numeric) The sum of all outputs ever received in " + CURRENCY_UNIT + "\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddressbalance", "\"[\\\"DTaXouBvXCDfViRZzSCaVNQBAyt1D9zThT\\\"]\"")
+            + HelpExampleRpc("getaddressbalance", "[\"DTaXouBvXCDfViRZzSCaVNQBAyt1D9zThT\"]")
+        );
+
+    std::vector<std::pair<uint160, std::string> > vAddresses = ParseAddressIndexAddresses(request.params[0]);
+    EnsureAddressIndex();
+
+    CAmount nBalance = 0;
+    CAmount nReceived = 0;
+    for (const auto& address : vAddresses) {
+        std::vector<std::pair<CAddressIndexKey, CAmount> > vHistory;
+        if (!pblocktree->ReadAddressIndex(address.first, 0, -1, vHistory))
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index");
+        for (const auto& entry : vHistory) {
+            nBalance += entry.second;
+            if (!entry.first.fSpending)
+                nReceived += entry.second;
+        }
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("balance", ValueFromAmount(nBalance));
+    result.pushKV("received", ValueFromAmount(nReceived));
+    return result;
+}
+
+UniValue getaddresstxids(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 3)
+        throw runtime_error(
+            "getaddresstxids [\"address\",...] ( start end )\n"
+            "\nReturns the ids of the transactions in the active chain that pay to or spend from the given addresses,\n"
+            "ordered by height (requires -addressindex).\n"
+            "\nArguments:\n"
+            "1. \"addresses\"     (array, required) The dogecoin addresses\n"
+            "2. start           (numeric, optional, default=0) The height to start at\n"
+            "3. end             (numeric, optional) The last height to include, default is the tip\n"
+            "\nResult:\n"
+            "[\n"
+            "  \"txid\"          (string) The transaction id\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddresstxids", "\"[\\\"DTaXouBvXCDfViRZzSCaVNQBAyt1D9zThT\\\"]\" 1000 2000")
+            + HelpExampleRpc("getaddresstxids", "[\"DTaXouBvXCDfViRZzSCaVNQBAyt1D9zThT\"], 1000, 2000")
+        );
+
+    std::vector<std::pair<uint160, std::string> > vAddresses = ParseAddressIndexAddresses(request.params[0]);
+    int nStart = 0;
+    int nEnd = -1;
+    if (request.params.size() > 1 && !request.params[1].isNull())
+        nStart = request.params[1].get_int();
+    if (request.params.size() > 2 && !request.params[2].isNull())
+        nEnd = request.params[2].get_int();
+    if (nStart < 0 || (request.params.size() > 2 && !request.params[2].isNull() && nEnd < nStart))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid height range");
+    EnsureAddressIndex();
+
+    std::set<std::pair<int, uint256> > setTxids;
+    for (const auto& address : vAddresses) {
+        std::vector<std::pair<CAddressIndexKey, CAmount> > vHistory;
+        if (!pblocktree->ReadAddressIndex(address.first, nStart, nEnd, vHistory))
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index");
+        for (const auto& entry : vHistory)
+            setTxids.insert(std::make_pair(entry.first.nHeight, entry.first.txhash));
+    }
+
+    UniValue result(UniValue::VARR);
+    for (const auto& txid : setTxids)
+        result.push_back(txid.second.GetHex());
+    return result;
+}
+
 UniValue echo(const JSONRPCRequest& request)
 {
     if (request.fHelp)
@@ -520,6 +691,10 @@ static const CRPCCommand commands[] =
     { "util",               "verifymessage",          &verifymessage,          true,  {"address","signature","message"} },
     { "util",               "signmessagewithprivkey", &signmessagewithprivkey, true,  {"privkey","message"} },
 
+    { "addressindex",       "getaddressutxos",        &getaddressutxos,        true,  {"addresses"} },
+    { "addressindex",       "getaddressbalance",      &getaddressbalance,      true,  {"addresses"} },
+    { "addressindex",       "getaddresstxids",        &getaddresstxids,        true,  {"addresses","start","end"} },
+
     /* Not shown in help */
     { "hidden",             "setmocktime",            &setmocktime,            true,  {"timestamp"}},
     { "hidden",             "echo",                   &echo,                   true,  {"arg0","arg1","arg2","arg3","arg4","arg5","arg6","arg7","arg8","arg9"}},
@@ -118,6 +118,8 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
             "    \"lastrecv\": ttt,           (numeric) The time in seconds since epoch (Jan 1 1970 GMT) of the last receive\n"
             "    \"bytessent\": n,            (numeric) The total bytes sent\n"
             "    \"bytesrecv\": n,            (numeric) The total bytes received\n"
+            "    \"bytesqueued_copied\": n,   (numeric) The bytes queued for sending that were serialized for this peer alone\n"
+            "    \"bytesqueued_shared\": n,   (numeric) The bytes queued for sending from payloads shared with other peers\n"
             "    \"conntime\": ttt,           (numeric) The connection time in seconds since epoch (Jan 1 1970 GMT)\n"
             "    \"timeoffset\": ttt,         (numeric) The time offset in seconds\n"
             "    \"pingtime\": n,             (numeric) ping time (if available)\n"
@@ -177,6 +179,8 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
         obj.pushKV("lastrecv", stats.nLastRecv);
         obj.pushKV("bytessent", stats.nSendBytes);
         obj.pushKV("bytesrecv", stats.nRecvBytes);
+        obj.pushKV("bytesqueued_copied", stats.nSendBytesCopied);
+        obj.pushKV("bytesqueued_shared", stats.nSendBytesShared);
         obj.pushKV("conntime", stats.nTimeConnected);
         obj.pushKV("timeoffset", stats.nTimeOffset);
         if (stats.dPingTime > 0.0)
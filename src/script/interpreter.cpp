@@ -1168,11 +1168,32 @@ uint256 GetOutputsHash(const CTransaction& txTo) {
 
 } // anon namespace
 
-PrecomputedTransactionData::PrecomputedTransactionData(const CTransaction& txTo)
+PrecomputedTransactionData::PrecomputedTransactionData(const CTransaction& txTo) : ptxTo(&txTo), fComputed(false)
 {
-    hashPrevouts = GetPrevoutHash(txTo);
-    hashSequence = GetSequenceHash(txTo);
-    hashOutputs = GetOutputsHash(txTo);
+}
+
+PrecomputedTransactionData::PrecomputedTransactionData(const PrecomputedTransactionData& other) : ptxTo(other.ptxTo), fComputed(false)
+{
+    std::lock_guard<std::mutex> lock(other.mutex);
+    if (other.fComputed) {
+        hashPrevouts = other.hashPrevouts;
+        hashSequence = other.hashSequence;
+        hashOutputs = other.hashOutputs;
+        fComputed = true;
+    }
+}
+
+void PrecomputedTransactionData::Compute() const
+{
+    if (fComputed.load(std::memory_order_acquire))
+        return;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fComputed.load(std::memory_order_relaxed))
+        return;
+    hashPrevouts = GetPrevoutHash(*ptxTo);
+    hashSequence = GetSequenceHash(*ptxTo);
+    hashOutputs = GetOutputsHash(*ptxTo);
+    fComputed.store(true, std::memory_order_release);
 }
 
 uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const CAmount& amount, SigVersion sigversion, ChainSigVersion chainSigVersion, const PrecomputedTransactionData* cache)
@@ -1183,16 +1204,16 @@ uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsig
         uint256 hashOutputs;
 
         if (!(nHashType & SIGHASH_ANYONECANPAY)) {
-            hashPrevouts = cache ? cache->hashPrevouts : GetPrevoutHash(txTo);
+            hashPrevouts = cache ? cache->GetHashPrevouts() : GetPrevoutHash(txTo);
         }
 
         if (!(nHashType & SIGHASH_ANYONECANPAY) && (nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE) {
-            hashSequence = cache ? cache->hashSequence : GetSequenceHash(txTo);
+            hashSequence = cache ? cache->GetHashSequence() : GetSequenceHash(txTo);
         }
 
 
         if ((nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE) {
-            hashOutputs = cache ? cache->hashOutputs : GetOutputsHash(txTo);
+            hashOutputs = cache ? cache->GetHashOutputs() : GetOutputsHash(txTo);
         } else if ((nHashType & 0x1f) == SIGHASH_SINGLE && nIn < txTo.vout.size()) {
             CHashWriter ss(SER_GETHASH, 0);
             ss << txTo.vout[nIn];
@@ -9,6 +9,8 @@
 #include "script_error.h"
 #include "primitives/transaction.h"
 
+#include <atomic>
+#include <mutex>
 #include <vector>
 #include <stdint.h>
 #include <string>
@@ -112,11 +114,28 @@ static const uint256 CHAIN_ID = uint256S("0x4c55434b59434f494e5f5245564956414c")
 
 bool CheckSignatureEncoding(const std::vector<unsigned char> &vchSig, unsigned int flags, ScriptError* serror);
 
+/**
+ * Signature hash midstates that are shared by all inputs of a transaction.
+ * They are computed on first use, by whichever thread asks first, so that
+ * transactions without witness v0 signatures never pay for them. The
+ * transaction must outlive this object.
+ */
 struct PrecomputedTransactionData
 {
-    uint256 hashPrevouts, hashSequence, hashOutputs;
-
     PrecomputedTransactionData(const CTransaction& tx);
+    PrecomputedTransactionData(const PrecomputedTransactionData& other);
+
+    const uint256& GetHashPrevouts() const { Compute(); return hashPrevouts; }
+    const uint256& GetHashSequence() const { Compute(); return hashSequence; }
+    const uint256& GetHashOutputs() const { Compute(); return hashOutputs; }
+
+private:
+    const CTransaction* ptxTo;
+    mutable std::mutex mutex;
+    mutable std::atomic<bool> fComputed;
+    mutable uint256 hashPrevouts, hashSequence, hashOutputs;
+
+    void Compute() const;
 };
 
 enum SigVersion
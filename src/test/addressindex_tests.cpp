@@ -0,0 +1,124 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "addressindex.h"
+#include "chain.h"
+#include "random.h"
+#include "txdb.h"
+#include "undo.h"
+#include "validation.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(addressindex_tests, TestingSetup)
+
+static CMutableTransaction MakeTx(const COutPoint& prevout, const std::vector<CTxOut>& vout)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = prevout;
+    tx.vout = vout;
+    return tx;
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_connect_disconnect)
+{
+    CScript scriptA = CScript() << OP_TRUE << 1;
+    CScript scriptB = CScript() << OP_TRUE << 2;
+    uint160 hashA = GetAddressIndexScriptHash(scriptA);
+    uint160 hashB = GetAddressIndexScriptHash(scriptB);
+
+    // A coinbase paying to A, a transaction spending an older output of B,
+    // and one spending an output created in the same block
+    COutPoint prevout(GetRandHash(), 1);
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(MakeTx(COutPoint(), {CTxOut(100, scriptA)})));
+    block.vtx.push_back(MakeTransactionRef(MakeTx(prevout, {CTxOut(30, scriptA), CTxOut(20, scriptB), CTxOut(0, CScript() << OP_RETURN)})));
+    block.vtx.push_back(MakeTransactionRef(MakeTx(COutPoint(block.vtx[1]->GetHash(), 0), {CTxOut(25, scriptB)})));
+    CBlockUndo blockundo;
+    blockundo.vtxundo.resize(2);
+    blockundo.vtxundo[0].vprevout.push_back(Coin(CTxOut(50, scriptB), 5, false));
+    blockundo.vtxundo[1].vprevout.push_back(Coin(block.vtx[1]->vout[0], 10, false));
+
+    uint256 hashPrev = GetRandHash();
+    uint256 hashBlock = GetRandHash();
+    CBlockIndex indexPrev;
+    indexPrev.phashBlock = &hashPrev;
+    indexPrev.nHeight = 9;
+    CBlockIndex index;
+    index.phashBlock = &hashBlock;
+    index.pprev = &indexPrev;
+    index.nHeight = 10;
+
+    CAddressIndexBatch batch;
+    batch.ConnectBlock(block, blockundo, &index);
+    BOOST_CHECK(batch.hashBlock == hashBlock);
+    BOOST_CHECK(pblocktree->WriteAddressIndex(batch));
+    uint256 hashBest;
+    BOOST_CHECK(pblocktree->ReadAddressIndexBestBlock(hashBest));
+    BOOST_CHECK(hashBest == hashBlock);
+
+    // The output spent within the block is not unspent
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vUnspent;
+    BOOST_CHECK(pblocktree->ReadAddressUnspentIndex(hashA, vUnspent));
+    BOOST_REQUIRE_EQUAL(vUnspent.size(), 1U);
+    BOOST_CHECK(vUnspent[0].first.txhash == block.vtx[0]->GetHash());
+    BOOST_CHECK_EQUAL(vUnspent[0].second.nValue, 100);
+    BOOST_CHECK_EQUAL(vUnspent[0].second.nHeight, 10);
+    BOOST_CHECK(vUnspent[0].second.script == scriptA);
+    vUnspent.clear();
+    BOOST_CHECK(pblocktree->ReadAddressUnspentIndex(hashB, vUnspent));
+    BOOST_CHECK_EQUAL(vUnspent.size(), 2U);
+
+    // History includes spends with negative amounts
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vHistory;
+    BOOST_CHECK(pblocktree->ReadAddressIndex(hashA, 0, -1, vHistory));
+    BOOST_CHECK_EQUAL(vHistory.size(), 3U);
+    CAmount nBalance = 0;
+    for (const auto& entry : vHistory)
+        nBalance += entry.second;
+    BOOST_CHECK_EQUAL(nBalance, 100);
+    vHistory.clear();
+    BOOST_CHECK(pblocktree->ReadAddressIndex(hashB, 10, 10, vHistory));
+    BOOST_CHECK_EQUAL(vHistory.size(), 3U);
+    nBalance = 0;
+    for (const auto& entry : vHistory)
+        nBalance += entry.second;
+    BOOST_CHECK_EQUAL(nBalance, 20 + 25 - 50);
+
+    // Height ranges that don't include the block
+    vHistory.clear();
+    BOOST_CHECK(pblocktree->ReadAddressIndex(hashB, 11, -1, vHistory));
+    BOOST_CHECK(pblocktree->ReadAddressIndex(hashB, 0, 9, vHistory));
+    BOOST_CHECK(vHistory.empty());
+
+    // Disconnecting restores the spent output and removes the history
+    batch.Clear();
+    batch.DisconnectBlock(block, blockundo, &index);
+    BOOST_CHECK(batch.hashBlock == hashPrev);
+    BOOST_CHECK(pblocktree->WriteAddressIndex(batch));
+    vUnspent.clear();
+    BOOST_CHECK(pblocktree->ReadAddressUnspentIndex(hashA, vUnspent));
+    BOOST_CHECK(vUnspent.empty());
+    BOOST_CHECK(pblocktree->ReadAddressUnspentIndex(hashB, vUnspent));
+    BOOST_REQUIRE_EQUAL(vUnspent.size(), 1U);
+    BOOST_CHECK(vUnspent[0].first.txhash == prevout.hash);
+    BOOST_CHECK_EQUAL(vUnspent[0].first.nIndex, prevout.n);
+    BOOST_CHECK_EQUAL(vUnspent[0].second.nValue, 50);
+    BOOST_CHECK_EQUAL(vUnspent[0].second.nHeight, 5);
+    BOOST_CHECK(pblocktree->ReadAddressIndex(hashA, 0, -1, vHistory));
+    BOOST_CHECK(pblocktree->ReadAddressIndex(hashB, 0, -1, vHistory));
+    BOOST_CHECK(vHistory.empty());
+
+    // Erasing the index forgets where it was
+    BOOST_CHECK(pblocktree->EraseAddressIndex());
+    BOOST_CHECK(!pblocktree->ReadAddressIndexBestBlock(hashBest));
+    vUnspent.clear();
+    BOOST_CHECK(pblocktree->ReadAddressUnspentIndex(hashB, vUnspent));
+    BOOST_CHECK(vUnspent.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
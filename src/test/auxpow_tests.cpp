@@ -3,12 +3,14 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "auxpow.h"
+#include "auxpowstore.h"
 #include "chainparams.h"
 #include "coins.h"
 #include "consensus/merkle.h"
 #include "dogecoin.h"
 #include "primitives/block.h"
 #include "script/script.h"
+#include "txdb.h"
 #include "uint256.h"
 #include "utilstrencodings.h"
 #include "validation.h"
@@ -443,4 +445,42 @@ BOOST_AUTO_TEST_CASE(auxpow_pow)
 
 /* ************************************************************************** */
 
+BOOST_AUTO_TEST_CASE(auxpow_store)
+{
+    CBlockTreeDB db(1 << 20, true);
+    CAuxPowStore store(2);
+
+    CAuxpowBuilder builder(2, 42);
+    std::vector<uint256> hashes;
+    std::vector<boost::shared_ptr<CAuxPow> > auxpows;
+    for (int i = 0; i < 4; ++i) {
+        builder.setCoinbase(CScript() << i);
+        hashes.push_back(ArithToUint256(arith_uint256(i + 1)));
+        auxpows.push_back(boost::shared_ptr<CAuxPow>(new CAuxPow(builder.get())));
+        store.Add(hashes.back(), auxpows.back());
+    }
+
+    /* Unwritten entries stay available even beyond the LRU size.  */
+    BOOST_CHECK_EQUAL(store.CachedEntries(), 2);
+    BOOST_CHECK_EQUAL(store.UnwrittenEntries(), 4);
+    for (int i = 0; i < 4; ++i)
+        BOOST_CHECK(store.Get(hashes[i], NULL) == auxpows[i]);
+    BOOST_CHECK(!store.Get(ArithToUint256(arith_uint256(5)), &db));
+
+    /* After flushing, evicted entries are read back from the database.  */
+    BOOST_CHECK(store.Flush(db));
+    BOOST_CHECK_EQUAL(store.UnwrittenEntries(), 0);
+    store.Clear();
+    BOOST_CHECK(!store.Get(hashes[0], NULL));
+    for (int i = 0; i < 4; ++i) {
+        boost::shared_ptr<CAuxPow> auxpow = store.Get(hashes[i], &db);
+        BOOST_REQUIRE(auxpow);
+        BOOST_CHECK(auxpow->parentBlock.GetHash() == auxpows[i]->parentBlock.GetHash());
+        BOOST_CHECK(auxpow->tx->GetHash() == auxpows[i]->tx->GetHash());
+    }
+    BOOST_CHECK_EQUAL(store.CachedEntries(), 2);
+}
+
+/* ************************************************************************** */
+
 BOOST_AUTO_TEST_SUITE_END()
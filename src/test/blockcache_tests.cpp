@@ -0,0 +1,70 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockcache.h"
+
+#include "random.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockcache_tests, BasicTestingSetup)
+
+static CNetMsgPayloadRef MakePayload(size_t nSize)
+{
+    return std::make_shared<const CNetMsgPayload>(std::vector<unsigned char>(nSize, 0x42));
+}
+
+BOOST_AUTO_TEST_CASE(blockcache_lru)
+{
+    CBlockPayloadCache cache(1000);
+    uint256 hash1 = GetRandHash(), hash2 = GetRandHash(), hash3 = GetRandHash();
+    CNetMsgPayloadRef payload1 = MakePayload(400);
+
+    BOOST_CHECK(!cache.Get(hash1, true));
+    cache.Add(hash1, true, payload1);
+    BOOST_CHECK(cache.Get(hash1, true) == payload1);
+    // The serialization without witness data is a different entry
+    BOOST_CHECK(!cache.Get(hash1, false));
+    BOOST_CHECK_EQUAL(cache.Hits(), 1U);
+    BOOST_CHECK_EQUAL(cache.Misses(), 2U);
+
+    cache.Add(hash2, true, MakePayload(400));
+    BOOST_CHECK_EQUAL(cache.CachedBytes(), 800U);
+
+    // Using hash1 makes hash2 the least recently used entry, which has to
+    // go to make room for hash3
+    BOOST_CHECK(cache.Get(hash1, true));
+    cache.Add(hash3, true, MakePayload(400));
+    BOOST_CHECK(cache.Get(hash1, true));
+    BOOST_CHECK(!cache.Get(hash2, true));
+    BOOST_CHECK(cache.Get(hash3, true));
+    BOOST_CHECK_EQUAL(cache.CachedEntries(), 2U);
+    BOOST_CHECK_EQUAL(cache.CachedBytes(), 800U);
+
+    // Adding an entry that is already cached changes nothing
+    cache.Add(hash1, true, MakePayload(100));
+    BOOST_CHECK(cache.Get(hash1, true) == payload1);
+    BOOST_CHECK_EQUAL(cache.CachedBytes(), 800U);
+
+    // Payloads larger than the cache are never kept
+    cache.Add(hash2, true, MakePayload(1001));
+    BOOST_CHECK(!cache.Get(hash2, true));
+    BOOST_CHECK_EQUAL(cache.CachedEntries(), 2U);
+
+    // Shrinking evicts from the least recently used end
+    cache.SetMaxSize(500);
+    BOOST_CHECK_EQUAL(cache.CachedEntries(), 1U);
+    BOOST_CHECK(cache.Get(hash1, true));
+
+    // Payloads handed out stay valid after eviction
+    cache.SetMaxSize(0);
+    BOOST_CHECK_EQUAL(cache.CachedEntries(), 0U);
+    BOOST_CHECK_EQUAL(cache.CachedBytes(), 0U);
+    BOOST_CHECK_EQUAL(payload1->GetData().size(), 400U);
+    cache.Add(hash1, true, payload1);
+    BOOST_CHECK(!cache.Get(hash1, true));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,93 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilemap.h"
+
+#include "chain.h"
+#include "chainparams.h"
+#include "consensus/merkle.h"
+#include "random.h"
+#include "validation.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockfilemap_tests, TestingSetup)
+
+static CBlock MakeBlock(size_t nOutputs)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout.SetNull();
+    tx.vin[0].scriptSig = CScript() << OP_0 << OP_0;
+    tx.vout.resize(nOutputs);
+    for (CTxOut& txout : tx.vout) {
+        txout.nValue = GetRand(MAX_MONEY);
+        txout.scriptPubKey = CScript() << OP_TRUE;
+    }
+    CBlock block;
+    block.hashPrevBlock = GetRandHash();
+    block.vtx.push_back(MakeTransactionRef(std::move(tx)));
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    return block;
+}
+
+BOOST_AUTO_TEST_CASE(blockfilemap_read)
+{
+    // A file number far above anything the test chain writes to
+    const int nFile = 7;
+    const Consensus::Params& params = Params().GetConsensus(0);
+    std::vector<CBlock> vBlocks;
+    std::vector<CDiskBlockPos> vPos;
+    unsigned int nNextPos = 0;
+    for (int i = 0; i < 3; i++) {
+        vBlocks.push_back(MakeBlock(10 + i * 100));
+        CDiskBlockPos pos(nFile, nNextPos);
+        BOOST_CHECK(WriteBlockToDisk(vBlocks.back(), pos, Params().MessageStart()));
+        nNextPos = pos.nPos + ::GetSerializeSize(vBlocks.back(), SER_DISK, CLIENT_VERSION);
+        vPos.push_back(pos);
+    }
+
+    // Files that may still be appended to are not mapped
+    blockfilemap.SetEnabled(true);
+    blockfilemap.SetFinalizedFiles(nFile);
+    BOOST_CHECK(!blockfilemap.Get(vPos[0], false, 0));
+    blockfilemap.SetFinalizedFiles(nFile + 1);
+    CMappedBlockFileRef mapped = blockfilemap.Get(vPos[0], false, 0);
+    BOOST_CHECK(mapped);
+    BOOST_CHECK_EQUAL(mapped->size(), nNextPos);
+
+    for (size_t i = 0; i < vBlocks.size(); i++) {
+        CBlock block;
+        BOOST_CHECK(ReadBlockFromDisk(block, vPos[i], params, false));
+        BOOST_CHECK(block.GetHash() == vBlocks[i].GetHash());
+        BOOST_CHECK(block.vtx[0]->GetHash() == vBlocks[i].vtx[0]->GetHash());
+
+        std::vector<unsigned char> raw;
+        BOOST_CHECK(ReadRawBlockFromDisk(raw, vPos[i], Params().MessageStart()));
+        CDataStream stream(SER_DISK, CLIENT_VERSION);
+        stream << vBlocks[i];
+        BOOST_CHECK(raw == std::vector<unsigned char>(stream.begin(), stream.end()));
+    }
+
+    // A block appended after the file was mapped is found by mapping it again
+    CBlock blockAppended = MakeBlock(1000);
+    CDiskBlockPos posAppended(nFile, nNextPos);
+    BOOST_CHECK(WriteBlockToDisk(blockAppended, posAppended, Params().MessageStart()));
+    CBlock block;
+    BOOST_CHECK(ReadBlockFromDisk(block, posAppended, params, false));
+    BOOST_CHECK(block.GetHash() == blockAppended.GetHash());
+    BOOST_CHECK(blockfilemap.Get(posAppended, false, 0)->size() > mapped->size());
+
+    // References handed out stay usable after the mapping is dropped
+    blockfilemap.Forget(nFile);
+    CBlock blockOld;
+    CSpanReader(SER_DISK, CLIENT_VERSION, mapped->data() + vPos[1].nPos, mapped->data() + mapped->size()) >> blockOld;
+    BOOST_CHECK(blockOld.GetHash() == vBlocks[1].GetHash());
+
+    blockfilemap.SetEnabled(false);
+    blockfilemap.SetFinalizedFiles(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
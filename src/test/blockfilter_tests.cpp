@@ -0,0 +1,215 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilter.h"
+#include "blockfilterindex.h"
+#include "chain.h"
+#include "chainparams.h"
+#include "random.h"
+#include "streams.h"
+#include "utiltime.h"
+#include "validation.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockfilter_tests, BasicTestingSetup)
+
+static GCSFilter::Element RandomElement()
+{
+    GCSFilter::Element element(32);
+    GetRandBytes(element.data(), element.size());
+    return element;
+}
+
+BOOST_AUTO_TEST_CASE(gcsfilter_test)
+{
+    GCSFilter::ElementSet included_elements, excluded_elements;
+    for (int i = 0; i < 100; ++i) {
+        included_elements.insert(RandomElement());
+        excluded_elements.insert(RandomElement());
+    }
+
+    GCSFilter filter({0, 0, 10, 1 << 10}, included_elements);
+    for (const auto& element : included_elements) {
+        BOOST_CHECK(filter.Match(element));
+
+        auto insertion = excluded_elements.insert(element);
+        BOOST_CHECK(filter.MatchAny(excluded_elements));
+        excluded_elements.erase(insertion.first);
+    }
+
+    // The encoding decodes back to the same filter
+    GCSFilter decoded(filter.GetParams(), filter.GetEncoded());
+    BOOST_CHECK_EQUAL(decoded.GetN(), 100U);
+    for (const auto& element : included_elements)
+        BOOST_CHECK(decoded.Match(element));
+}
+
+BOOST_AUTO_TEST_CASE(gcsfilter_default_constructor)
+{
+    GCSFilter filter;
+    BOOST_CHECK_EQUAL(filter.GetN(), 0U);
+    BOOST_CHECK_EQUAL(filter.GetEncoded().size(), 1U);
+
+    const GCSFilter::Params& params = filter.GetParams();
+    BOOST_CHECK_EQUAL(params.m_siphash_k0, 0U);
+    BOOST_CHECK_EQUAL(params.m_siphash_k1, 0U);
+    BOOST_CHECK_EQUAL(params.m_P, 0);
+    BOOST_CHECK_EQUAL(params.m_M, 1U);
+}
+
+BOOST_AUTO_TEST_CASE(gcsfilter_malformed)
+{
+    GCSFilter filter({0, 0, 10, 1 << 10}, GCSFilter::ElementSet{RandomElement(), RandomElement()});
+    std::vector<unsigned char> encoded = filter.GetEncoded();
+
+    // Missing and excess data are both rejected
+    std::vector<unsigned char> truncated(encoded.begin(), encoded.end() - 1);
+    BOOST_CHECK_THROW(GCSFilter(filter.GetParams(), truncated), std::ios_base::failure);
+    encoded.push_back(0);
+    BOOST_CHECK_THROW(GCSFilter(filter.GetParams(), encoded), std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_CASE(blockfilter_basic_test)
+{
+    CScript included_scripts[5], excluded_scripts[4];
+
+    // First two are outputs on a single transaction.
+    included_scripts[0] << std::vector<unsigned char>(0, 65) << OP_CHECKSIG;
+    included_scripts[1] << OP_DUP << OP_HASH160 << std::vector<unsigned char>(1, 20) << OP_EQUALVERIFY << OP_CHECKSIG;
+
+    // Third is an output on in a second transaction.
+    included_scripts[2] << OP_1 << std::vector<unsigned char>(2, 33) << OP_1 << OP_CHECKMULTISIG;
+
+    // Last two are spent by a single transaction.
+    included_scripts[3] << OP_0 << std::vector<unsigned char>(3, 32);
+    included_scripts[4] << OP_4 << OP_ADD << OP_8 << OP_EQUAL;
+
+    // OP_RETURN output is an output on the second transaction.
+    excluded_scripts[0] << OP_RETURN << std::vector<unsigned char>(4, 40);
+
+    // This script is not related to the block at all.
+    excluded_scripts[1] << std::vector<unsigned char>(5, 33) << OP_CHECKSIG;
+
+    // OP_RETURN is non-standard since it's not followed by a data push, but is still excluded from
+    // filter.
+    excluded_scripts[2] << OP_RETURN << OP_4 << OP_ADD << OP_8 << OP_EQUAL;
+
+    CMutableTransaction tx_1;
+    tx_1.vout.push_back(CTxOut(100, included_scripts[0]));
+    tx_1.vout.push_back(CTxOut(200, included_scripts[1]));
+    tx_1.vout.push_back(CTxOut(0, excluded_scripts[0]));
+
+    CMutableTransaction tx_2;
+    tx_2.vout.push_back(CTxOut(300, included_scripts[2]));
+    tx_2.vout.push_back(CTxOut(0, excluded_scripts[2]));
+    tx_2.vout.push_back(CTxOut(400, excluded_scripts[3])); // Script is empty
+
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(tx_1));
+    block.vtx.push_back(MakeTransactionRef(tx_2));
+
+    CBlockUndo block_undo;
+    block_undo.vtxundo.emplace_back();
+    block_undo.vtxundo.back().vprevout.push_back(Coin(CTxOut(500, included_scripts[3]), 1000, true));
+    block_undo.vtxundo.back().vprevout.push_back(Coin(CTxOut(600, included_scripts[4]), 10000, false));
+    block_undo.vtxundo.back().vprevout.push_back(Coin(CTxOut(700, excluded_scripts[3]), 100000, false));
+
+    BlockFilter block_filter(BASIC, block, block_undo);
+    const GCSFilter& filter = block_filter.GetFilter();
+
+    for (const CScript& script : included_scripts) {
+        BOOST_CHECK(filter.Match(GCSFilter::Element(script.begin(), script.end())));
+    }
+    for (const CScript& script : excluded_scripts) {
+        BOOST_CHECK(!filter.Match(GCSFilter::Element(script.begin(), script.end())));
+    }
+
+    // Test serialization/unserialization.
+    BlockFilter block_filter2;
+
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << block_filter;
+    stream >> block_filter2;
+
+    BOOST_CHECK_EQUAL(block_filter.GetFilterType(), block_filter2.GetFilterType());
+    BOOST_CHECK(block_filter.GetBlockHash() == block_filter2.GetBlockHash());
+    BOOST_CHECK(block_filter.GetEncodedFilter() == block_filter2.GetEncodedFilter());
+    BOOST_CHECK(block_filter.GetHash() == block_filter2.GetHash());
+
+    // Headers chain onto the previous one
+    uint256 header = block_filter.ComputeHeader(uint256());
+    BOOST_CHECK(header != block_filter.ComputeHeader(header));
+}
+
+BOOST_AUTO_TEST_CASE(blockfilter_type_names)
+{
+    BOOST_CHECK_EQUAL(BlockFilterTypeName(BASIC), "basic");
+    BOOST_CHECK_EQUAL(BlockFilterTypeName(static_cast<BlockFilterType>(1)), "");
+
+    BlockFilterType filter_type;
+    BOOST_CHECK(BlockFilterTypeByName("basic", filter_type));
+    BOOST_CHECK_EQUAL(filter_type, BASIC);
+
+    BOOST_CHECK(!BlockFilterTypeByName("unknown", filter_type));
+}
+
+BOOST_FIXTURE_TEST_CASE(blockfilterindex_genesis, TestingSetup)
+{
+    BOOST_REQUIRE(InitBlockFilterIndex(BASIC, 1 << 20, true, true));
+    BOOST_CHECK(!InitBlockFilterIndex(BASIC, 1 << 20, true, true));
+    BlockFilterIndex* pindexFilter = GetBlockFilterIndex(BASIC);
+    BOOST_REQUIRE(pindexFilter != NULL);
+
+    const CBlockIndex* pindexGenesis;
+    {
+        LOCK(cs_main);
+        pindexGenesis = chainActive.Genesis();
+    }
+
+    // Nothing is found before the index caught up
+    BlockFilter filter;
+    uint256 header;
+    BOOST_CHECK(!pindexFilter->LookupFilter(pindexGenesis, filter));
+    BOOST_CHECK(!pindexFilter->IsSynced());
+
+    boost::thread_group indexThreads;
+    BOOST_REQUIRE(pindexFilter->Start(indexThreads));
+    for (int i = 0; i < 500 && !pindexFilter->IsSynced(); i++)
+        MilliSleep(10);
+    BOOST_CHECK(pindexFilter->IsSynced());
+    BOOST_CHECK(pindexFilter->BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK(pindexFilter->GetBestBlockIndex() == pindexGenesis);
+
+    // The filter of the genesis block chains onto the null header
+    CBlock block;
+    BOOST_REQUIRE(ReadBlockFromDisk(block, pindexGenesis, Params().GetConsensus(0)));
+    BlockFilter expected(BASIC, block, CBlockUndo());
+    BOOST_REQUIRE(pindexFilter->LookupFilter(pindexGenesis, filter));
+    BOOST_CHECK(filter.GetBlockHash() == pindexGenesis->GetBlockHash());
+    BOOST_CHECK(filter.GetEncodedFilter() == expected.GetEncodedFilter());
+    BOOST_REQUIRE(pindexFilter->LookupFilterHeader(pindexGenesis, header));
+    BOOST_CHECK(header == expected.ComputeHeader(uint256()));
+
+    std::vector<BlockFilter> filters;
+    BOOST_CHECK(pindexFilter->LookupFilterRange(0, pindexGenesis, filters));
+    BOOST_CHECK_EQUAL(filters.size(), 1U);
+    std::vector<uint256> hashes;
+    BOOST_CHECK(pindexFilter->LookupFilterHashRange(0, pindexGenesis, hashes));
+    BOOST_REQUIRE_EQUAL(hashes.size(), 1U);
+    BOOST_CHECK(hashes[0] == expected.GetHash());
+    BOOST_CHECK(!pindexFilter->LookupFilterRange(1, pindexGenesis, filters));
+
+    indexThreads.interrupt_all();
+    indexThreads.join_all();
+    ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Stop(); });
+    DestroyAllBlockFilterIndexes();
+    BOOST_CHECK(GetBlockFilterIndex(BASIC) == NULL);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
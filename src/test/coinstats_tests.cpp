@@ -0,0 +1,125 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "coins.h"
+#include "coinstats.h"
+#include "random.h"
+#include "txdb.h"
+#include "validation.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(coinstats_tests, TestingSetup)
+
+static std::vector<std::pair<COutPoint, Coin> > MakeCoins(int nCount)
+{
+    std::vector<std::pair<COutPoint, Coin> > coins;
+    for (int i = 0; i < nCount; i++) {
+        CTxOut out(1000 * (i + 1), CScript() << OP_TRUE << i);
+        coins.emplace_back(COutPoint(GetRandHash(), i % 3), Coin(out, i, i % 5 == 0));
+    }
+    return coins;
+}
+
+BOOST_AUTO_TEST_CASE(rolling_stats_updates)
+{
+    std::vector<std::pair<COutPoint, Coin> > coins = MakeCoins(20);
+
+    // Adding coins in any order, or collecting them in a delta first, gives the same statistics
+    CCoinsRollingStats forward, backward, delta;
+    for (size_t i = 0; i < coins.size(); i++) {
+        forward.AddCoin(coins[i].first, coins[i].second);
+        backward.AddCoin(coins[coins.size() - 1 - i].first, coins[coins.size() - 1 - i].second);
+        if (i >= 10)
+            delta.AddCoin(coins[i].first, coins[i].second);
+    }
+    BOOST_CHECK(forward.GetHash() == backward.GetHash());
+    BOOST_CHECK_EQUAL(forward.nTransactionOutputs, 20);
+
+    CCoinsRollingStats combined;
+    for (size_t i = 0; i < 10; i++)
+        combined.AddCoin(coins[i].first, coins[i].second);
+    combined += delta;
+    BOOST_CHECK(combined.GetHash() == forward.GetHash());
+    BOOST_CHECK(combined.nTotalAmount == forward.nTotalAmount);
+
+    // Removing coins before they are added cancels out too
+    CCoinsRollingStats removeFirst;
+    removeFirst.RemoveCoin(coins[0].first, coins[0].second);
+    removeFirst += forward;
+    for (size_t i = 1; i < coins.size(); i++)
+        backward.RemoveCoin(coins[i].first, coins[i].second);
+    BOOST_CHECK(backward.GetHash() != removeFirst.GetHash());
+    backward.RemoveCoin(coins[0].first, coins[0].second);
+    BOOST_CHECK(backward.GetHash() == CCoinsRollingStats().GetHash());
+    BOOST_CHECK_EQUAL(backward.nTransactionOutputs, 0);
+    BOOST_CHECK(backward.nTotalAmount == 0);
+    BOOST_CHECK_EQUAL(removeFirst.nTransactionOutputs, 19);
+
+    // Serialization keeps the pending removals
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << removeFirst;
+    CCoinsRollingStats restored;
+    ss >> restored;
+    BOOST_CHECK(restored.GetHash() == removeFirst.GetHash());
+    BOOST_CHECK_EQUAL(restored.nTransactionOutputs, removeFirst.nTransactionOutputs);
+    BOOST_CHECK(restored.nTotalAmount == removeFirst.nTotalAmount);
+}
+
+BOOST_AUTO_TEST_CASE(rolling_stats_chainstate)
+{
+    // The statistics of a new chainstate are known from the start
+    CCoinsRollingStats rolling;
+    BOOST_CHECK(GetRollingCoinsStats(rolling));
+    BOOST_CHECK(rolling.hashBlock == chainActive.Tip()->GetBlockHash());
+    BOOST_CHECK_EQUAL(rolling.nTransactionOutputs, 0);
+
+    std::vector<std::pair<COutPoint, Coin> > coins = MakeCoins(50);
+    CCoinsRollingStats expected;
+    expected.hashBlock = rolling.hashBlock;
+    {
+        LOCK(cs_main);
+        for (const auto& coin : coins) {
+            pcoinsTip->AddCoin(coin.first, Coin(coin.second), false);
+            expected.AddCoin(coin.first, coin.second);
+        }
+    }
+    FlushStateToDisk();
+
+    // A full scan computes the same statistics, and they can be taken over
+    CCoinsStats stats;
+    CCoinsRollingStats scanned;
+    BOOST_CHECK(GetUTXOStats(pcoinsdbview, stats, &scanned));
+    BOOST_CHECK(scanned.hashBlock == expected.hashBlock);
+    BOOST_CHECK(scanned.GetHash() == expected.GetHash());
+    BOOST_CHECK_EQUAL(scanned.nTransactionOutputs, (int64_t)stats.nTransactionOutputs);
+    BOOST_CHECK(scanned.nTotalAmount == stats.nTotalAmount);
+    SetRollingCoinsStats(scanned);
+    BOOST_CHECK(GetRollingCoinsStats(rolling));
+    BOOST_CHECK(rolling.GetHash() == expected.GetHash());
+
+    // They are stored with the best block
+    FlushStateToDisk();
+    CCoinsRollingStats stored;
+    BOOST_CHECK(pcoinsdbview->ReadRollingStats(stored));
+    BOOST_CHECK(stored.GetHash() == expected.GetHash());
+
+    // Statistics at another block are neither taken over nor stored
+    CCoinsRollingStats other = scanned;
+    other.hashBlock = GetRandHash();
+    SetRollingCoinsStats(other);
+    BOOST_CHECK(GetRollingCoinsStats(rolling));
+    BOOST_CHECK(rolling.hashBlock == expected.hashBlock);
+    pcoinsdbview->SetRollingStats(&other);
+    {
+        LOCK(cs_main);
+        CCoinsMap mapCoins;
+        BOOST_CHECK(pcoinsdbview->BatchWrite(mapCoins, expected.hashBlock));
+    }
+    BOOST_CHECK(!pcoinsdbview->ReadRollingStats(stored));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,12 +3,14 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "crypto/aes.h"
+#include "crypto/muhash.h"
 #include "crypto/ripemd160.h"
 #include "crypto/sha1.h"
 #include "crypto/sha256.h"
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "hash.h"
 #include "utilstrencodings.h"
 #include "test/test_bitcoin.h"
 #include "test/test_random.h"
@@ -233,7 +235,7 @@ BOOST_AUTO_TEST_CASE(sha1_testvectors) {
     TestSHA1(test1, "b7755760681cbfd971451668f32af5774f4656b5");
 }
 
-BOOST_AUTO_TEST_CASE(sha256_testvectors) {
+static void TestSHA256Vectors() {
     TestSHA256("", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
     TestSHA256("abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
     TestSHA256("message digest",
@@ -255,6 +257,37 @@ BOOST_AUTO_TEST_CASE(sha256_testvectors) {
     TestSHA256(test1, "a316d55510b49662420f49d145d42fb83f31ef8dc016aa4e32df049991a91e26");
 }
 
+BOOST_AUTO_TEST_CASE(sha256_testvectors) {
+    // Run the vectors against every implementation this CPU supports.
+    static const int impls[] = {SHA256_STANDARD, SHA256_SHANI, SHA256_ALL};
+    for (int impl : impls) {
+        BOOST_TEST_MESSAGE("Using the '" << SHA256AutoDetect(impl) << "' SHA256 implementation");
+        TestSHA256Vectors();
+    }
+    SHA256AutoDetect();
+}
+
+BOOST_AUTO_TEST_CASE(sha256d64)
+{
+    static const int impls[] = {SHA256_STANDARD, SHA256_SSE41, SHA256_AVX2, SHA256_ALL};
+    for (int impl : impls) {
+        BOOST_TEST_MESSAGE("Using the '" << SHA256AutoDetect(impl) << "' SHA256 implementation");
+        for (int i = 1; i <= 34; ++i) {
+            unsigned char in[64 * 34];
+            unsigned char out1[32 * 34], out2[32 * 34];
+            for (int j = 0; j < 64 * i; ++j) {
+                in[j] = insecure_rand();
+            }
+            for (int j = 0; j < i; ++j) {
+                CHash256().Write(in + 64 * j, 64).Finalize(out1 + 32 * j);
+            }
+            SHA256D64(out2, in, i);
+            BOOST_CHECK(memcmp(out1, out2, 32 * i) == 0);
+        }
+    }
+    SHA256AutoDetect();
+}
+
 BOOST_AUTO_TEST_CASE(sha512_testvectors) {
     TestSHA512("",
                "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
@@ -439,4 +472,72 @@ BOOST_AUTO_TEST_CASE(aes_cbc_testvectors) {
                   "b2eb05e2c39be9fcda6c19078c6a9d1b3f461796d6b0d6b2e0c2a72b4d80e644");
 }
 
+static uint256 FinalizeMuHash(MuHash3072 muhash)
+{
+    uint256 out;
+    muhash.Finalize(out.begin());
+    return out;
+}
+
+BOOST_AUTO_TEST_CASE(muhash_tests) {
+    // (p-1)^2 = 1 (mod p) exercises the reduction of the largest product
+    unsigned char data[Num3072::BYTE_SIZE];
+    memset(data, 0xff, sizeof(data));
+    data[0] = 0x9a; data[1] = 0x28; data[2] = 0xef;
+    Num3072 minusone(data);
+    minusone.Multiply(minusone);
+    minusone.ToBytes(data);
+    BOOST_CHECK_EQUAL(data[0], 1);
+    for (size_t i = 1; i < sizeof(data); i++)
+        BOOST_CHECK_EQUAL(data[i], 0);
+
+    // x * x^-1 = 1
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = insecure_rand();
+    Num3072 x(data);
+    x.Multiply(x.GetInverse());
+    x.ToBytes(data);
+    BOOST_CHECK_EQUAL(data[0], 1);
+    for (size_t i = 1; i < sizeof(data); i++)
+        BOOST_CHECK_EQUAL(data[i], 0);
+
+    std::vector<std::vector<unsigned char> > elements;
+    for (int i = 0; i < 8; i++) {
+        uint256 element = GetRandHash();
+        elements.push_back(std::vector<unsigned char>(element.begin(), element.end()));
+    }
+    uint256 empty = FinalizeMuHash(MuHash3072());
+
+    // The hash does not depend on the order elements were added and removed in
+    MuHash3072 forward, backward, partial;
+    for (size_t i = 0; i < elements.size(); i++) {
+        forward.Insert(elements[i].data(), elements[i].size());
+        backward.Insert(elements[elements.size() - 1 - i].data(), elements[elements.size() - 1 - i].size());
+        if (i % 2)
+            partial.Insert(elements[i].data(), elements[i].size());
+    }
+    BOOST_CHECK(FinalizeMuHash(forward) == FinalizeMuHash(backward));
+    BOOST_CHECK(FinalizeMuHash(forward) != empty);
+    for (size_t i = 0; i < elements.size(); i++) {
+        if (i % 2 == 0)
+            backward.Remove(elements[i].data(), elements[i].size());
+    }
+    BOOST_CHECK(FinalizeMuHash(backward) == FinalizeMuHash(partial));
+
+    // Sets can be combined and taken apart again
+    MuHash3072 combined = partial;
+    combined *= backward;
+    combined /= partial;
+    BOOST_CHECK(FinalizeMuHash(combined) == FinalizeMuHash(partial));
+    combined /= partial;
+    BOOST_CHECK(FinalizeMuHash(combined) == empty);
+
+    // Serialization keeps removals pending
+    unsigned char serialized[MuHash3072::SERIALIZED_SIZE];
+    backward.ToBytes(serialized);
+    MuHash3072 restored;
+    restored.FromBytes(serialized);
+    BOOST_CHECK(FinalizeMuHash(restored) == FinalizeMuHash(partial));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,1551 @@
+namespace json_tests{
+static unsigned const char base58_keys_valid[] = {
+0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x44, 0x44, 0x34, 0x4b, 0x53, 0x53, 0x75, 
+0x42, 0x4a, 0x71, 0x63, 0x6a, 0x75, 0x54, 0x63, 
+0x76, 0x55, 0x67, 0x31, 0x43, 0x67, 0x55, 0x4b, 
+0x65, 0x75, 0x72, 0x50, 0x55, 0x46, 0x65, 0x45, 
+0x5a, 0x6b, 0x45, 0x22, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x35, 
+0x36, 0x64, 0x39, 0x62, 0x31, 0x64, 0x36, 0x38, 
+0x34, 0x64, 0x35, 0x61, 0x62, 0x65, 0x66, 0x33, 
+0x32, 0x31, 0x33, 0x34, 0x65, 0x62, 0x63, 0x36, 
+0x38, 0x38, 0x33, 0x64, 0x37, 0x35, 0x64, 0x33, 
+0x61, 0x35, 0x33, 0x65, 0x39, 0x62, 0x65, 0x22, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x61, 0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 
+0x65, 0x22, 0x3a, 0x20, 0x22, 0x70, 0x75, 0x62, 
+0x6b, 0x65, 0x79, 0x22, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 
+0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 
+0x61, 0x6c, 0x73, 0x65, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 
+0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x66, 
+0x61, 0x6c, 0x73, 0x65, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5d, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x41, 0x37, 0x48, 
+0x52, 0x51, 0x6b, 0x33, 0x47, 0x46, 0x43, 0x57, 
+0x32, 0x51, 0x61, 0x73, 0x76, 0x64, 0x5a, 0x78, 
+0x58, 0x75, 0x59, 0x6a, 0x38, 0x6b, 0x6b, 0x51, 
+0x4b, 0x35, 0x51, 0x72, 0x59, 0x4c, 0x73, 0x22, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x61, 0x32, 0x64, 0x64, 0x37, 
+0x31, 0x66, 0x33, 0x34, 0x66, 0x65, 0x37, 0x33, 
+0x33, 0x31, 0x34, 0x64, 0x36, 0x65, 0x33, 0x37, 
+0x63, 0x34, 0x34, 0x30, 0x33, 0x35, 0x35, 0x31, 
+0x33, 0x66, 0x32, 0x30, 0x33, 0x61, 0x61, 0x34, 
+0x30, 0x30, 0x62, 0x22, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 0x64, 0x64, 
+0x72, 0x54, 0x79, 0x70, 0x65, 0x22, 0x3a, 0x20, 
+0x22, 0x73, 0x63, 0x72, 0x69, 0x70, 0x74, 0x22, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 
+0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 
+0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x6e, 0x68, 0x52, 0x73, 0x72, 0x55, 0x61, 
+0x78, 0x5a, 0x6f, 0x75, 0x36, 0x73, 0x65, 0x77, 
+0x6a, 0x71, 0x61, 0x53, 0x33, 0x37, 0x63, 0x4a, 
+0x72, 0x4d, 0x52, 0x4a, 0x52, 0x67, 0x77, 0x56, 
+0x58, 0x64, 0x6b, 0x22, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x39, 
+0x31, 0x33, 0x31, 0x63, 0x32, 0x39, 0x33, 0x38, 
+0x34, 0x66, 0x30, 0x30, 0x30, 0x63, 0x30, 0x64, 
+0x36, 0x35, 0x31, 0x36, 0x36, 0x30, 0x65, 0x65, 
+0x66, 0x61, 0x66, 0x31, 0x37, 0x31, 0x37, 0x63, 
+0x38, 0x63, 0x61, 0x31, 0x38, 0x35, 0x35, 0x22, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x61, 0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 
+0x65, 0x22, 0x3a, 0x20, 0x22, 0x70, 0x75, 0x62, 
+0x6b, 0x65, 0x79, 0x22, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 
+0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 
+0x61, 0x6c, 0x73, 0x65, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 
+0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x74, 
+0x72, 0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5d, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x32, 0x4d, 0x73, 0x76, 
+0x79, 0x47, 0x31, 0x32, 0x6b, 0x78, 0x78, 0x69, 
+0x70, 0x65, 0x32, 0x37, 0x36, 0x41, 0x75, 0x34, 
+0x7a, 0x4b, 0x71, 0x76, 0x64, 0x32, 0x78, 0x64, 
+0x72, 0x42, 0x75, 0x48, 0x57, 0x62, 0x33, 0x22, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x30, 0x37, 0x38, 0x34, 0x35, 
+0x37, 0x65, 0x33, 0x35, 0x37, 0x63, 0x36, 0x63, 
+0x34, 0x64, 0x38, 0x37, 0x33, 0x36, 0x35, 0x31, 
+0x35, 0x64, 0x31, 0x34, 0x34, 0x38, 0x32, 0x30, 
+0x38, 0x39, 0x64, 0x64, 0x32, 0x61, 0x31, 0x66, 
+0x39, 0x66, 0x38, 0x22, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 0x64, 0x64, 
+0x72, 0x54, 0x79, 0x70, 0x65, 0x22, 0x3a, 0x20, 
+0x22, 0x73, 0x63, 0x72, 0x69, 0x70, 0x74, 0x22, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 
+0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 
+0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x36, 0x4b, 0x37, 0x61, 0x38, 0x77, 0x5a, 0x57, 
+0x38, 0x41, 0x31, 0x6f, 0x5a, 0x78, 0x4e, 0x64, 
+0x37, 0x77, 0x5a, 0x7a, 0x38, 0x50, 0x68, 0x67, 
+0x41, 0x41, 0x61, 0x44, 0x78, 0x79, 0x62, 0x6b, 
+0x7a, 0x4e, 0x70, 0x44, 0x31, 0x73, 0x47, 0x56, 
+0x76, 0x6d, 0x53, 0x61, 0x42, 0x6d, 0x63, 0x33, 
+0x48, 0x67, 0x32, 0x22, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x38, 
+0x31, 0x35, 0x31, 0x37, 0x66, 0x64, 0x38, 0x34, 
+0x38, 0x65, 0x62, 0x66, 0x65, 0x64, 0x61, 0x37, 
+0x65, 0x32, 0x63, 0x36, 0x38, 0x34, 0x65, 0x37, 
+0x61, 0x33, 0x66, 0x35, 0x65, 0x62, 0x62, 0x62, 
+0x32, 0x38, 0x62, 0x31, 0x35, 0x64, 0x35, 0x32, 
+0x64, 0x33, 0x33, 0x64, 0x38, 0x61, 0x32, 0x30, 
+0x31, 0x64, 0x38, 0x38, 0x37, 0x33, 0x61, 0x30, 
+0x63, 0x64, 0x61, 0x66, 0x37, 0x36, 0x31, 0x22, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x43, 0x6f, 0x6d, 0x70, 0x72, 
+0x65, 0x73, 0x73, 0x65, 0x64, 0x22, 0x3a, 0x20, 
+0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 
+0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 
+0x74, 0x72, 0x75, 0x65, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 
+0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x66, 
+0x61, 0x6c, 0x73, 0x65, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5d, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x51, 0x50, 0x35, 
+0x72, 0x51, 0x78, 0x70, 0x61, 0x50, 0x38, 0x48, 
+0x48, 0x50, 0x45, 0x64, 0x43, 0x45, 0x71, 0x78, 
+0x54, 0x6a, 0x69, 0x48, 0x47, 0x57, 0x52, 0x76, 
+0x73, 0x79, 0x50, 0x76, 0x7a, 0x5a, 0x4a, 0x65, 
+0x4a, 0x39, 0x42, 0x43, 0x78, 0x70, 0x66, 0x54, 
+0x31, 0x33, 0x46, 0x4e, 0x39, 0x56, 0x65, 0x73, 
+0x51, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x30, 0x65, 0x30, 
+0x31, 0x37, 0x63, 0x63, 0x36, 0x61, 0x64, 0x39, 
+0x38, 0x63, 0x36, 0x36, 0x34, 0x36, 0x61, 0x31, 
+0x31, 0x33, 0x39, 0x31, 0x31, 0x34, 0x65, 0x38, 
+0x64, 0x63, 0x64, 0x39, 0x62, 0x66, 0x32, 0x35, 
+0x33, 0x37, 0x66, 0x33, 0x65, 0x30, 0x33, 0x30, 
+0x36, 0x61, 0x32, 0x66, 0x34, 0x33, 0x64, 0x65, 
+0x61, 0x30, 0x33, 0x66, 0x39, 0x31, 0x66, 0x65, 
+0x61, 0x33, 0x37, 0x30, 0x61, 0x30, 0x22, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x43, 0x6f, 0x6d, 0x70, 0x72, 0x65, 
+0x73, 0x73, 0x65, 0x64, 0x22, 0x3a, 0x20, 0x74, 
+0x72, 0x75, 0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 
+0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x74, 0x72, 
+0x75, 0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 
+0x65, 0x74, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 
+0x73, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5d, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x39, 0x36, 0x4d, 0x41, 0x65, 
+0x50, 0x6e, 0x46, 0x38, 0x70, 0x70, 0x51, 0x6d, 
+0x38, 0x31, 0x36, 0x35, 0x41, 0x42, 0x76, 0x7a, 
+0x53, 0x45, 0x53, 0x68, 0x6e, 0x4e, 0x79, 0x33, 
+0x76, 0x67, 0x78, 0x6a, 0x6d, 0x4d, 0x68, 0x63, 
+0x71, 0x45, 0x6b, 0x51, 0x56, 0x5a, 0x39, 0x46, 
+0x74, 0x50, 0x56, 0x32, 0x58, 0x4c, 0x22, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x37, 0x33, 0x34, 0x32, 0x33, 0x62, 
+0x66, 0x31, 0x66, 0x61, 0x36, 0x35, 0x32, 0x36, 
+0x65, 0x65, 0x35, 0x37, 0x31, 0x66, 0x33, 0x62, 
+0x34, 0x62, 0x34, 0x61, 0x64, 0x31, 0x39, 0x37, 
+0x39, 0x39, 0x63, 0x38, 0x31, 0x64, 0x34, 0x30, 
+0x63, 0x65, 0x35, 0x63, 0x31, 0x38, 0x61, 0x33, 
+0x37, 0x64, 0x38, 0x37, 0x64, 0x63, 0x33, 0x38, 
+0x62, 0x35, 0x35, 0x37, 0x34, 0x36, 0x36, 0x32, 
+0x37, 0x64, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x43, 0x6f, 
+0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 
+0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 
+0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 
+0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x63, 
+0x6b, 0x61, 0x44, 0x6a, 0x78, 0x68, 0x44, 0x73, 
+0x56, 0x79, 0x5a, 0x54, 0x48, 0x4c, 0x55, 0x46, 
+0x37, 0x75, 0x6f, 0x6f, 0x6a, 0x43, 0x58, 0x56, 
+0x59, 0x63, 0x63, 0x69, 0x55, 0x47, 0x65, 0x45, 
+0x6b, 0x35, 0x33, 0x56, 0x46, 0x7a, 0x4b, 0x55, 
+0x4a, 0x73, 0x4b, 0x55, 0x4b, 0x68, 0x6e, 0x62, 
+0x55, 0x6e, 0x5a, 0x22, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 
+0x65, 0x30, 0x33, 0x33, 0x39, 0x38, 0x36, 0x35, 
+0x35, 0x62, 0x32, 0x39, 0x66, 0x38, 0x30, 0x62, 
+0x61, 0x64, 0x66, 0x31, 0x65, 0x36, 0x39, 0x30, 
+0x39, 0x65, 0x37, 0x35, 0x63, 0x63, 0x66, 0x39, 
+0x62, 0x63, 0x64, 0x62, 0x36, 0x30, 0x36, 0x32, 
+0x65, 0x38, 0x38, 0x38, 0x36, 0x64, 0x30, 0x61, 
+0x63, 0x61, 0x34, 0x62, 0x33, 0x64, 0x34, 0x36, 
+0x61, 0x38, 0x32, 0x61, 0x61, 0x38, 0x33, 0x30, 
+0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x43, 0x6f, 0x6d, 0x70, 
+0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 0x22, 0x3a, 
+0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 
+0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 
+0x74, 0x72, 0x75, 0x65, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 
+0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x74, 
+0x72, 0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5d, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x44, 0x42, 0x6a, 0x57, 
+0x36, 0x6b, 0x6e, 0x61, 0x37, 0x72, 0x55, 0x50, 
+0x45, 0x34, 0x4d, 0x6a, 0x39, 0x6a, 0x34, 0x42, 
+0x33, 0x6f, 0x4b, 0x33, 0x78, 0x56, 0x41, 0x31, 
+0x53, 0x44, 0x48, 0x72, 0x64, 0x74, 0x22, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x34, 0x38, 0x35, 0x32, 0x39, 0x30, 
+0x38, 0x36, 0x35, 0x62, 0x34, 0x30, 0x37, 0x36, 
+0x35, 0x37, 0x65, 0x30, 0x61, 0x65, 0x64, 0x62, 
+0x64, 0x62, 0x62, 0x34, 0x61, 0x61, 0x36, 0x36, 
+0x31, 0x38, 0x33, 0x31, 0x30, 0x61, 0x66, 0x35, 
+0x30, 0x64, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x61, 0x64, 0x64, 0x72, 
+0x54, 0x79, 0x70, 0x65, 0x22, 0x3a, 0x20, 0x22, 
+0x70, 0x75, 0x62, 0x6b, 0x65, 0x79, 0x22, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 
+0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 
+0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x41, 0x33, 0x52, 0x48, 0x6f, 0x41, 0x51, 0x4c, 
+0x50, 0x44, 0x53, 0x75, 0x42, 0x65, 0x77, 0x62, 
+0x75, 0x76, 0x74, 0x35, 0x4e, 0x4d, 0x71, 0x45, 
+0x4b, 0x61, 0x73, 0x71, 0x73, 0x39, 0x74, 0x79, 
+0x33, 0x43, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x37, 0x38, 
+0x37, 0x39, 0x65, 0x61, 0x30, 0x66, 0x31, 0x30, 
+0x35, 0x33, 0x62, 0x63, 0x62, 0x64, 0x34, 0x63, 
+0x36, 0x30, 0x63, 0x38, 0x38, 0x66, 0x39, 0x32, 
+0x32, 0x66, 0x37, 0x36, 0x64, 0x32, 0x37, 0x65, 
+0x36, 0x32, 0x32, 0x65, 0x31, 0x65, 0x22, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x61, 0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 0x65, 
+0x22, 0x3a, 0x20, 0x22, 0x73, 0x63, 0x72, 0x69, 
+0x70, 0x74, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 
+0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 0x61, 
+0x6c, 0x73, 0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 
+0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x66, 0x61, 
+0x6c, 0x73, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5d, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x6e, 0x67, 0x62, 0x53, 
+0x67, 0x72, 0x31, 0x64, 0x68, 0x43, 0x71, 0x73, 
+0x4c, 0x67, 0x36, 0x5a, 0x35, 0x74, 0x70, 0x73, 
+0x61, 0x43, 0x73, 0x70, 0x77, 0x72, 0x48, 0x37, 
+0x32, 0x78, 0x32, 0x5a, 0x6b, 0x33, 0x22, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x38, 0x38, 0x30, 0x38, 0x63, 0x39, 
+0x34, 0x64, 0x61, 0x61, 0x61, 0x32, 0x65, 0x34, 
+0x66, 0x35, 0x33, 0x31, 0x30, 0x32, 0x37, 0x30, 
+0x33, 0x62, 0x32, 0x63, 0x33, 0x64, 0x65, 0x35, 
+0x33, 0x34, 0x64, 0x36, 0x37, 0x30, 0x65, 0x38, 
+0x37, 0x65, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x61, 0x64, 0x64, 0x72, 
+0x54, 0x79, 0x70, 0x65, 0x22, 0x3a, 0x20, 0x22, 
+0x70, 0x75, 0x62, 0x6b, 0x65, 0x79, 0x22, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 
+0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 
+0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x32, 
+0x4d, 0x76, 0x59, 0x31, 0x42, 0x42, 0x61, 0x75, 
+0x32, 0x43, 0x36, 0x6a, 0x52, 0x43, 0x31, 0x68, 
+0x4e, 0x58, 0x35, 0x4c, 0x6d, 0x76, 0x69, 0x4c, 
+0x72, 0x70, 0x76, 0x56, 0x47, 0x33, 0x38, 0x36, 
+0x54, 0x4d, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x32, 0x34, 
+0x31, 0x34, 0x63, 0x30, 0x66, 0x33, 0x38, 0x36, 
+0x32, 0x64, 0x32, 0x35, 0x31, 0x37, 0x38, 0x38, 
+0x33, 0x30, 0x66, 0x62, 0x31, 0x61, 0x65, 0x30, 
+0x31, 0x64, 0x39, 0x38, 0x32, 0x62, 0x38, 0x33, 
+0x38, 0x35, 0x65, 0x65, 0x61, 0x34, 0x22, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x61, 0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 0x65, 
+0x22, 0x3a, 0x20, 0x22, 0x73, 0x63, 0x72, 0x69, 
+0x70, 0x74, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 
+0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 0x61, 
+0x6c, 0x73, 0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 
+0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x74, 0x72, 
+0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5d, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x36, 0x4b, 0x56, 0x6e, 0x47, 
+0x42, 0x50, 0x39, 0x32, 0x37, 0x74, 0x31, 0x72, 
+0x66, 0x6f, 0x77, 0x44, 0x70, 0x52, 0x63, 0x71, 
+0x59, 0x79, 0x45, 0x37, 0x57, 0x55, 0x58, 0x39, 
+0x77, 0x38, 0x31, 0x34, 0x69, 0x43, 0x4e, 0x79, 
+0x59, 0x77, 0x74, 0x51, 0x45, 0x71, 0x4b, 0x78, 
+0x45, 0x71, 0x38, 0x6b, 0x42, 0x61, 0x22, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x62, 0x33, 0x62, 0x66, 0x32, 0x38, 
+0x65, 0x38, 0x35, 0x36, 0x39, 0x33, 0x39, 0x33, 
+0x36, 0x64, 0x61, 0x30, 0x35, 0x35, 0x62, 0x63, 
+0x34, 0x37, 0x65, 0x38, 0x34, 0x36, 0x36, 0x35, 
+0x37, 0x31, 0x37, 0x33, 0x65, 0x30, 0x38, 0x61, 
+0x64, 0x33, 0x30, 0x65, 0x31, 0x34, 0x33, 0x61, 
+0x61, 0x66, 0x32, 0x38, 0x32, 0x35, 0x65, 0x62, 
+0x61, 0x63, 0x61, 0x63, 0x33, 0x32, 0x35, 0x64, 
+0x36, 0x61, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x43, 0x6f, 
+0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 
+0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 
+0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 
+0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x51, 0x56, 0x69, 0x38, 0x36, 0x72, 0x64, 0x4c, 
+0x33, 0x41, 0x50, 0x61, 0x36, 0x54, 0x58, 0x58, 
+0x77, 0x50, 0x64, 0x52, 0x6e, 0x4b, 0x66, 0x71, 
+0x56, 0x66, 0x7a, 0x47, 0x76, 0x36, 0x61, 0x39, 
+0x39, 0x33, 0x45, 0x35, 0x4c, 0x65, 0x69, 0x48, 
+0x58, 0x61, 0x47, 0x47, 0x6a, 0x45, 0x37, 0x63, 
+0x70, 0x61, 0x68, 0x31, 0x22, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x64, 0x33, 0x62, 0x30, 0x36, 0x38, 0x62, 0x62, 
+0x35, 0x39, 0x34, 0x66, 0x31, 0x39, 0x63, 0x31, 
+0x63, 0x37, 0x30, 0x39, 0x33, 0x31, 0x64, 0x38, 
+0x61, 0x61, 0x31, 0x39, 0x61, 0x62, 0x37, 0x37, 
+0x34, 0x31, 0x34, 0x37, 0x66, 0x39, 0x34, 0x36, 
+0x30, 0x32, 0x31, 0x37, 0x33, 0x37, 0x63, 0x39, 
+0x38, 0x38, 0x63, 0x61, 0x66, 0x62, 0x35, 0x31, 
+0x39, 0x38, 0x30, 0x66, 0x35, 0x33, 0x66, 0x61, 
+0x30, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x43, 0x6f, 0x6d, 
+0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 0x22, 
+0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 
+0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 
+0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 
+0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 
+0x66, 0x61, 0x6c, 0x73, 0x65, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x39, 0x35, 
+0x7a, 0x67, 0x75, 0x4b, 0x64, 0x54, 0x4a, 0x39, 
+0x46, 0x7a, 0x6e, 0x52, 0x76, 0x54, 0x34, 0x6f, 
+0x55, 0x75, 0x42, 0x64, 0x71, 0x55, 0x78, 0x66, 
+0x72, 0x58, 0x65, 0x36, 0x71, 0x5a, 0x62, 0x79, 
+0x35, 0x33, 0x45, 0x31, 0x47, 0x4b, 0x73, 0x63, 
+0x31, 0x79, 0x35, 0x4b, 0x37, 0x31, 0x33, 0x70, 
+0x65, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x34, 0x34, 0x63, 
+0x32, 0x39, 0x63, 0x31, 0x39, 0x31, 0x30, 0x33, 
+0x33, 0x35, 0x30, 0x34, 0x37, 0x65, 0x34, 0x34, 
+0x63, 0x66, 0x35, 0x35, 0x64, 0x37, 0x31, 0x64, 
+0x36, 0x61, 0x39, 0x38, 0x62, 0x39, 0x39, 0x33, 
+0x35, 0x30, 0x31, 0x34, 0x30, 0x31, 0x36, 0x38, 
+0x32, 0x30, 0x35, 0x33, 0x32, 0x66, 0x30, 0x36, 
+0x37, 0x62, 0x36, 0x35, 0x34, 0x36, 0x62, 0x36, 
+0x31, 0x39, 0x63, 0x62, 0x66, 0x22, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x43, 0x6f, 0x6d, 0x70, 0x72, 0x65, 0x73, 
+0x73, 0x65, 0x64, 0x22, 0x3a, 0x20, 0x66, 0x61, 
+0x6c, 0x73, 0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 
+0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x74, 0x72, 
+0x75, 0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 
+0x65, 0x74, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 
+0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5d, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x63, 0x6d, 0x63, 0x46, 0x50, 0x32, 
+0x43, 0x35, 0x59, 0x4d, 0x68, 0x50, 0x51, 0x70, 
+0x78, 0x76, 0x33, 0x58, 0x32, 0x69, 0x36, 0x62, 
+0x79, 0x48, 0x78, 0x74, 0x32, 0x31, 0x56, 0x59, 
+0x79, 0x75, 0x6a, 0x75, 0x37, 0x6b, 0x43, 0x69, 
+0x56, 0x6d, 0x55, 0x58, 0x71, 0x69, 0x68, 0x4d, 
+0x50, 0x73, 0x68, 0x4e, 0x4b, 0x65, 0x22, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x63, 0x63, 0x65, 0x34, 0x62, 0x36, 
+0x33, 0x66, 0x61, 0x33, 0x37, 0x36, 0x61, 0x39, 
+0x64, 0x39, 0x64, 0x31, 0x38, 0x32, 0x38, 0x39, 
+0x31, 0x39, 0x64, 0x38, 0x64, 0x66, 0x38, 0x34, 
+0x33, 0x35, 0x62, 0x64, 0x64, 0x61, 0x38, 0x35, 
+0x33, 0x31, 0x39, 0x33, 0x62, 0x37, 0x66, 0x63, 
+0x38, 0x65, 0x66, 0x66, 0x39, 0x39, 0x37, 0x61, 
+0x31, 0x31, 0x34, 0x34, 0x62, 0x66, 0x38, 0x64, 
+0x36, 0x65, 0x30, 0x22, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x43, 
+0x6f, 0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 
+0x64, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 
+0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 
+0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x44, 
+0x37, 0x37, 0x5a, 0x31, 0x6e, 0x6d, 0x67, 0x53, 
+0x5a, 0x78, 0x4a, 0x54, 0x6d, 0x74, 0x4e, 0x36, 
+0x35, 0x6e, 0x32, 0x4d, 0x56, 0x46, 0x39, 0x79, 
+0x76, 0x4c, 0x53, 0x42, 0x34, 0x4d, 0x70, 0x69, 
+0x43, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x31, 0x35, 0x61, 
+0x35, 0x38, 0x35, 0x30, 0x34, 0x32, 0x65, 0x39, 
+0x36, 0x33, 0x30, 0x30, 0x62, 0x35, 0x61, 0x64, 
+0x34, 0x66, 0x39, 0x64, 0x37, 0x63, 0x37, 0x63, 
+0x36, 0x63, 0x62, 0x61, 0x32, 0x64, 0x35, 0x36, 
+0x61, 0x30, 0x39, 0x38, 0x39, 0x22, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 
+0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 0x65, 0x22, 
+0x3a, 0x20, 0x22, 0x70, 0x75, 0x62, 0x6b, 0x65, 
+0x79, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 
+0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 
+0x73, 0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 
+0x65, 0x74, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 
+0x73, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5d, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x39, 0x7a, 0x59, 0x6e, 0x56, 
+0x52, 0x61, 0x65, 0x6b, 0x50, 0x74, 0x64, 0x4b, 
+0x42, 0x59, 0x75, 0x50, 0x77, 0x35, 0x51, 0x69, 
+0x42, 0x74, 0x76, 0x33, 0x4e, 0x4e, 0x72, 0x7a, 
+0x44, 0x32, 0x4c, 0x4c, 0x57, 0x22, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x35, 0x38, 0x66, 0x63, 0x36, 0x36, 0x62, 
+0x66, 0x36, 0x34, 0x62, 0x33, 0x63, 0x38, 0x64, 
+0x38, 0x61, 0x63, 0x63, 0x64, 0x38, 0x30, 0x31, 
+0x31, 0x30, 0x62, 0x62, 0x36, 0x64, 0x66, 0x36, 
+0x63, 0x31, 0x33, 0x37, 0x33, 0x35, 0x39, 0x33, 
+0x37, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x61, 0x64, 0x64, 0x72, 0x54, 
+0x79, 0x70, 0x65, 0x22, 0x3a, 0x20, 0x22, 0x73, 
+0x63, 0x72, 0x69, 0x70, 0x74, 0x22, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 
+0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 
+0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 
+0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 
+0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x6e, 
+0x67, 0x61, 0x6f, 0x34, 0x71, 0x38, 0x61, 0x75, 
+0x53, 0x36, 0x59, 0x75, 0x44, 0x4b, 0x59, 0x50, 
+0x6b, 0x7a, 0x6a, 0x74, 0x37, 0x7a, 0x4b, 0x59, 
+0x59, 0x54, 0x38, 0x4c, 0x7a, 0x6b, 0x47, 0x5a, 
+0x53, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x38, 0x37, 0x65, 
+0x39, 0x36, 0x31, 0x63, 0x37, 0x61, 0x37, 0x35, 
+0x63, 0x37, 0x30, 0x34, 0x38, 0x64, 0x65, 0x33, 
+0x37, 0x35, 0x38, 0x61, 0x64, 0x36, 0x37, 0x32, 
+0x33, 0x64, 0x35, 0x65, 0x30, 0x34, 0x37, 0x61, 
+0x30, 0x61, 0x36, 0x36, 0x64, 0x22, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 
+0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 0x65, 0x22, 
+0x3a, 0x20, 0x22, 0x70, 0x75, 0x62, 0x6b, 0x65, 
+0x79, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 
+0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 
+0x73, 0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 
+0x65, 0x74, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 
+0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5d, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x32, 0x4e, 0x32, 0x32, 0x76, 0x75, 
+0x69, 0x4d, 0x47, 0x68, 0x66, 0x71, 0x44, 0x37, 
+0x37, 0x76, 0x50, 0x71, 0x73, 0x58, 0x50, 0x69, 
+0x41, 0x4c, 0x42, 0x66, 0x6e, 0x36, 0x6f, 0x55, 
+0x54, 0x74, 0x46, 0x74, 0x48, 0x22, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x36, 0x30, 0x36, 0x35, 0x65, 0x32, 0x34, 
+0x34, 0x30, 0x65, 0x30, 0x62, 0x35, 0x64, 0x63, 
+0x62, 0x31, 0x30, 0x38, 0x65, 0x34, 0x65, 0x62, 
+0x30, 0x31, 0x39, 0x37, 0x37, 0x37, 0x65, 0x31, 
+0x61, 0x38, 0x33, 0x37, 0x37, 0x63, 0x64, 0x32, 
+0x32, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x61, 0x64, 0x64, 0x72, 0x54, 
+0x79, 0x70, 0x65, 0x22, 0x3a, 0x20, 0x22, 0x73, 
+0x63, 0x72, 0x69, 0x70, 0x74, 0x22, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 
+0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 
+0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 
+0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 
+0x20, 0x74, 0x72, 0x75, 0x65, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x36, 0x4a, 
+0x7a, 0x39, 0x66, 0x72, 0x56, 0x6a, 0x42, 0x32, 
+0x67, 0x34, 0x46, 0x37, 0x74, 0x41, 0x4c, 0x76, 
+0x6b, 0x74, 0x36, 0x79, 0x79, 0x74, 0x57, 0x6f, 
+0x35, 0x76, 0x51, 0x62, 0x4c, 0x65, 0x47, 0x64, 
+0x76, 0x48, 0x50, 0x50, 0x33, 0x54, 0x52, 0x74, 
+0x5a, 0x38, 0x4e, 0x44, 0x7a, 0x37, 0x61, 0x79, 
+0x53, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x37, 0x30, 0x37, 
+0x37, 0x35, 0x35, 0x39, 0x32, 0x62, 0x61, 0x62, 
+0x66, 0x33, 0x63, 0x65, 0x39, 0x35, 0x37, 0x36, 
+0x39, 0x32, 0x32, 0x39, 0x65, 0x36, 0x37, 0x33, 
+0x35, 0x61, 0x34, 0x62, 0x35, 0x37, 0x65, 0x30, 
+0x63, 0x36, 0x62, 0x37, 0x38, 0x66, 0x32, 0x63, 
+0x32, 0x64, 0x63, 0x37, 0x66, 0x62, 0x36, 0x37, 
+0x62, 0x35, 0x39, 0x65, 0x38, 0x35, 0x65, 0x61, 
+0x37, 0x62, 0x64, 0x30, 0x33, 0x22, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x43, 0x6f, 0x6d, 0x70, 0x72, 0x65, 0x73, 
+0x73, 0x65, 0x64, 0x22, 0x3a, 0x20, 0x66, 0x61, 
+0x6c, 0x73, 0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 
+0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x74, 0x72, 
+0x75, 0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 
+0x65, 0x74, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 
+0x73, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5d, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x51, 0x50, 0x79, 0x76, 0x47, 
+0x7a, 0x42, 0x65, 0x6e, 0x73, 0x4b, 0x53, 0x36, 
+0x33, 0x73, 0x74, 0x77, 0x76, 0x7a, 0x73, 0x78, 
+0x72, 0x71, 0x51, 0x61, 0x66, 0x77, 0x64, 0x46, 
+0x74, 0x59, 0x59, 0x71, 0x71, 0x6d, 0x44, 0x68, 
+0x75, 0x78, 0x79, 0x53, 0x70, 0x59, 0x31, 0x6a, 
+0x6b, 0x45, 0x4b, 0x5a, 0x36, 0x6b, 0x72, 0x22, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x32, 0x38, 0x63, 0x61, 0x37, 
+0x34, 0x35, 0x66, 0x39, 0x32, 0x62, 0x30, 0x62, 
+0x39, 0x62, 0x32, 0x63, 0x61, 0x32, 0x62, 0x34, 
+0x65, 0x62, 0x65, 0x35, 0x36, 0x36, 0x62, 0x36, 
+0x36, 0x35, 0x62, 0x33, 0x66, 0x63, 0x61, 0x35, 
+0x32, 0x32, 0x38, 0x35, 0x35, 0x34, 0x38, 0x32, 
+0x63, 0x38, 0x34, 0x30, 0x66, 0x34, 0x35, 0x37, 
+0x62, 0x32, 0x61, 0x36, 0x63, 0x65, 0x66, 0x35, 
+0x35, 0x33, 0x35, 0x30, 0x22, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x43, 0x6f, 0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 
+0x65, 0x64, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 
+0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 
+0x79, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 
+0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x39, 0x36, 0x53, 0x4a, 0x59, 0x31, 0x46, 
+0x72, 0x57, 0x48, 0x52, 0x76, 0x44, 0x75, 0x57, 
+0x74, 0x41, 0x4d, 0x43, 0x62, 0x66, 0x5a, 0x50, 
+0x71, 0x55, 0x6b, 0x41, 0x36, 0x4a, 0x78, 0x51, 
+0x70, 0x71, 0x6a, 0x69, 0x68, 0x6a, 0x70, 0x62, 
+0x77, 0x72, 0x71, 0x46, 0x59, 0x63, 0x6d, 0x4c, 
+0x42, 0x75, 0x4d, 0x57, 0x22, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x37, 0x65, 0x65, 0x62, 0x62, 0x34, 0x30, 0x64, 
+0x65, 0x30, 0x39, 0x39, 0x66, 0x31, 0x66, 0x65, 
+0x65, 0x66, 0x38, 0x36, 0x34, 0x66, 0x38, 0x38, 
+0x30, 0x38, 0x33, 0x35, 0x62, 0x35, 0x64, 0x38, 
+0x36, 0x31, 0x34, 0x61, 0x64, 0x35, 0x63, 0x66, 
+0x33, 0x66, 0x64, 0x31, 0x65, 0x38, 0x61, 0x31, 
+0x31, 0x33, 0x62, 0x39, 0x32, 0x30, 0x63, 0x65, 
+0x36, 0x38, 0x37, 0x36, 0x34, 0x39, 0x36, 0x64, 
+0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x43, 0x6f, 0x6d, 0x70, 
+0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 0x22, 0x3a, 
+0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 
+0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 
+0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 
+0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 
+0x74, 0x72, 0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5d, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x63, 0x6a, 0x4e, 
+0x34, 0x53, 0x51, 0x34, 0x70, 0x48, 0x42, 0x4c, 
+0x4e, 0x6e, 0x73, 0x79, 0x44, 0x50, 0x77, 0x6a, 
+0x54, 0x50, 0x52, 0x54, 0x74, 0x6f, 0x50, 0x4e, 
+0x34, 0x59, 0x5a, 0x6f, 0x53, 0x74, 0x68, 0x70, 
+0x41, 0x73, 0x32, 0x79, 0x73, 0x75, 0x46, 0x38, 
+0x6b, 0x4c, 0x6e, 0x55, 0x59, 0x63, 0x31, 0x32, 
+0x43, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x38, 0x39, 0x65, 
+0x62, 0x35, 0x66, 0x66, 0x38, 0x35, 0x30, 0x35, 
+0x33, 0x63, 0x30, 0x37, 0x65, 0x62, 0x31, 0x66, 
+0x65, 0x65, 0x66, 0x65, 0x61, 0x30, 0x37, 0x65, 
+0x61, 0x31, 0x30, 0x36, 0x35, 0x36, 0x34, 0x65, 
+0x30, 0x32, 0x32, 0x39, 0x65, 0x33, 0x62, 0x32, 
+0x63, 0x39, 0x39, 0x64, 0x38, 0x38, 0x66, 0x32, 
+0x66, 0x38, 0x39, 0x63, 0x38, 0x38, 0x34, 0x64, 
+0x64, 0x37, 0x61, 0x33, 0x39, 0x30, 0x22, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x43, 0x6f, 0x6d, 0x70, 0x72, 0x65, 
+0x73, 0x73, 0x65, 0x64, 0x22, 0x3a, 0x20, 0x74, 
+0x72, 0x75, 0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 
+0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x74, 0x72, 
+0x75, 0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 
+0x65, 0x74, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 
+0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5d, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x44, 0x47, 0x59, 0x64, 0x77, 0x37, 
+0x6a, 0x43, 0x31, 0x37, 0x62, 0x39, 0x53, 0x61, 
+0x70, 0x70, 0x6a, 0x73, 0x72, 0x41, 0x73, 0x61, 
+0x67, 0x68, 0x68, 0x44, 0x54, 0x53, 0x38, 0x73, 
+0x56, 0x35, 0x4d, 0x78, 0x22, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x37, 0x64, 0x31, 0x64, 0x32, 0x38, 0x33, 0x66, 
+0x66, 0x33, 0x32, 0x66, 0x33, 0x61, 0x34, 0x32, 
+0x35, 0x65, 0x61, 0x32, 0x32, 0x64, 0x32, 0x31, 
+0x30, 0x33, 0x32, 0x65, 0x31, 0x62, 0x63, 0x61, 
+0x37, 0x64, 0x31, 0x34, 0x65, 0x66, 0x61, 0x61, 
+0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x61, 0x64, 0x64, 0x72, 0x54, 0x79, 
+0x70, 0x65, 0x22, 0x3a, 0x20, 0x22, 0x70, 0x75, 
+0x62, 0x6b, 0x65, 0x79, 0x22, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 
+0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 
+0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 
+0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 
+0x66, 0x61, 0x6c, 0x73, 0x65, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x41, 0x33, 
+0x59, 0x55, 0x75, 0x69, 0x5a, 0x6a, 0x6e, 0x33, 
+0x46, 0x7a, 0x57, 0x32, 0x69, 0x36, 0x4b, 0x71, 
+0x46, 0x56, 0x67, 0x48, 0x61, 0x4e, 0x35, 0x72, 
+0x35, 0x66, 0x6a, 0x76, 0x77, 0x45, 0x4a, 0x31, 
+0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x37, 0x39, 0x64, 0x36, 
+0x31, 0x61, 0x34, 0x61, 0x36, 0x33, 0x39, 0x35, 
+0x36, 0x31, 0x33, 0x39, 0x34, 0x31, 0x34, 0x62, 
+0x34, 0x65, 0x30, 0x36, 0x39, 0x38, 0x35, 0x38, 
+0x38, 0x63, 0x66, 0x62, 0x32, 0x63, 0x33, 0x34, 
+0x36, 0x36, 0x62, 0x66, 0x22, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 0x64, 
+0x64, 0x72, 0x54, 0x79, 0x70, 0x65, 0x22, 0x3a, 
+0x20, 0x22, 0x73, 0x63, 0x72, 0x69, 0x70, 0x74, 
+0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 
+0x79, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 
+0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 
+0x74, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 
+0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5d, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x6e, 0x62, 0x6f, 0x37, 0x76, 0x79, 
+0x43, 0x75, 0x69, 0x4d, 0x78, 0x69, 0x59, 0x57, 
+0x34, 0x74, 0x68, 0x77, 0x77, 0x75, 0x61, 0x54, 
+0x48, 0x51, 0x64, 0x43, 0x6f, 0x71, 0x69, 0x6e, 
+0x6d, 0x7a, 0x4a, 0x7a, 0x22, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x35, 0x33, 0x36, 0x35, 0x37, 0x64, 0x65, 0x39, 
+0x34, 0x65, 0x33, 0x62, 0x30, 0x65, 0x63, 0x66, 
+0x32, 0x32, 0x61, 0x33, 0x31, 0x38, 0x38, 0x65, 
+0x31, 0x62, 0x63, 0x32, 0x32, 0x30, 0x62, 0x37, 
+0x62, 0x61, 0x30, 0x62, 0x62, 0x66, 0x66, 0x39, 
+0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x61, 0x64, 0x64, 0x72, 0x54, 0x79, 
+0x70, 0x65, 0x22, 0x3a, 0x20, 0x22, 0x70, 0x75, 
+0x62, 0x6b, 0x65, 0x79, 0x22, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 
+0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 
+0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 
+0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 
+0x74, 0x72, 0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5d, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x32, 0x4e, 0x31, 
+0x47, 0x7a, 0x39, 0x37, 0x72, 0x4e, 0x37, 0x50, 
+0x36, 0x56, 0x43, 0x6a, 0x39, 0x78, 0x66, 0x36, 
+0x34, 0x77, 0x57, 0x46, 0x71, 0x51, 0x5a, 0x67, 
+0x70, 0x55, 0x6e, 0x67, 0x31, 0x6d, 0x4d, 0x33, 
+0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x35, 0x38, 0x31, 0x36, 
+0x34, 0x37, 0x35, 0x62, 0x36, 0x64, 0x33, 0x34, 
+0x31, 0x39, 0x30, 0x39, 0x39, 0x64, 0x62, 0x33, 
+0x39, 0x34, 0x64, 0x66, 0x64, 0x39, 0x62, 0x38, 
+0x31, 0x32, 0x30, 0x30, 0x64, 0x36, 0x36, 0x31, 
+0x38, 0x62, 0x39, 0x63, 0x22, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 0x64, 
+0x64, 0x72, 0x54, 0x79, 0x70, 0x65, 0x22, 0x3a, 
+0x20, 0x22, 0x73, 0x63, 0x72, 0x69, 0x70, 0x74, 
+0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 
+0x79, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 
+0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 
+0x74, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x36, 0x4b, 0x72, 0x32, 0x70, 0x51, 0x34, 
+0x65, 0x39, 0x6e, 0x47, 0x47, 0x5a, 0x48, 0x38, 
+0x7a, 0x59, 0x5a, 0x4d, 0x47, 0x57, 0x62, 0x65, 
+0x4d, 0x34, 0x62, 0x66, 0x74, 0x34, 0x4c, 0x38, 
+0x65, 0x66, 0x73, 0x67, 0x34, 0x6a, 0x68, 0x4e, 
+0x33, 0x72, 0x68, 0x4d, 0x43, 0x4a, 0x66, 0x42, 
+0x32, 0x50, 0x6b, 0x78, 0x22, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x65, 0x31, 0x62, 0x61, 0x39, 0x66, 0x34, 0x34, 
+0x30, 0x32, 0x61, 0x35, 0x37, 0x38, 0x62, 0x63, 
+0x62, 0x30, 0x39, 0x37, 0x30, 0x31, 0x37, 0x35, 
+0x37, 0x62, 0x34, 0x39, 0x63, 0x65, 0x33, 0x37, 
+0x30, 0x31, 0x37, 0x35, 0x31, 0x30, 0x64, 0x32, 
+0x63, 0x63, 0x33, 0x30, 0x34, 0x64, 0x62, 0x33, 
+0x30, 0x32, 0x37, 0x62, 0x62, 0x39, 0x62, 0x63, 
+0x63, 0x39, 0x33, 0x32, 0x66, 0x64, 0x66, 0x66, 
+0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x43, 0x6f, 0x6d, 0x70, 
+0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 0x22, 0x3a, 
+0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 
+0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 
+0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 
+0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 
+0x66, 0x61, 0x6c, 0x73, 0x65, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x51, 0x55, 
+0x73, 0x4e, 0x4e, 0x77, 0x39, 0x33, 0x34, 0x73, 
+0x53, 0x38, 0x44, 0x6a, 0x6a, 0x54, 0x4e, 0x4b, 
+0x41, 0x6b, 0x70, 0x5a, 0x62, 0x4e, 0x32, 0x52, 
+0x55, 0x46, 0x57, 0x31, 0x59, 0x61, 0x4e, 0x7a, 
+0x36, 0x50, 0x48, 0x59, 0x67, 0x6b, 0x46, 0x4d, 
+0x61, 0x6a, 0x38, 0x75, 0x57, 0x68, 0x43, 0x75, 
+0x4c, 0x63, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x62, 0x61, 
+0x39, 0x62, 0x62, 0x37, 0x66, 0x34, 0x38, 0x39, 
+0x36, 0x39, 0x65, 0x39, 0x34, 0x33, 0x30, 0x31, 
+0x30, 0x32, 0x35, 0x33, 0x31, 0x33, 0x63, 0x32, 
+0x39, 0x38, 0x39, 0x31, 0x36, 0x62, 0x32, 0x39, 
+0x31, 0x33, 0x66, 0x62, 0x37, 0x65, 0x65, 0x63, 
+0x65, 0x66, 0x65, 0x39, 0x38, 0x62, 0x39, 0x31, 
+0x32, 0x38, 0x65, 0x66, 0x34, 0x64, 0x38, 0x37, 
+0x65, 0x34, 0x30, 0x65, 0x61, 0x34, 0x30, 0x22, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x43, 0x6f, 0x6d, 0x70, 0x72, 
+0x65, 0x73, 0x73, 0x65, 0x64, 0x22, 0x3a, 0x20, 
+0x74, 0x72, 0x75, 0x65, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 
+0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x74, 
+0x72, 0x75, 0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 
+0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x66, 0x61, 
+0x6c, 0x73, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5d, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x39, 0x37, 0x39, 0x47, 
+0x51, 0x6b, 0x31, 0x65, 0x67, 0x77, 0x44, 0x54, 
+0x66, 0x43, 0x57, 0x6e, 0x7a, 0x65, 0x79, 0x4e, 
+0x56, 0x78, 0x45, 0x69, 0x71, 0x66, 0x6f, 0x4b, 
+0x42, 0x75, 0x64, 0x7a, 0x31, 0x46, 0x52, 0x56, 
+0x6f, 0x6f, 0x45, 0x7a, 0x63, 0x54, 0x43, 0x62, 
+0x38, 0x4a, 0x41, 0x39, 0x64, 0x61, 0x75, 0x22, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x64, 0x62, 0x65, 0x65, 0x64, 
+0x62, 0x33, 0x33, 0x36, 0x66, 0x62, 0x30, 0x66, 
+0x37, 0x36, 0x62, 0x33, 0x64, 0x65, 0x30, 0x30, 
+0x39, 0x64, 0x32, 0x34, 0x38, 0x66, 0x63, 0x66, 
+0x35, 0x35, 0x64, 0x32, 0x61, 0x30, 0x61, 0x37, 
+0x33, 0x63, 0x63, 0x66, 0x37, 0x35, 0x30, 0x39, 
+0x36, 0x61, 0x61, 0x39, 0x39, 0x37, 0x32, 0x34, 
+0x38, 0x39, 0x31, 0x35, 0x66, 0x63, 0x30, 0x33, 
+0x33, 0x37, 0x31, 0x22, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x43, 
+0x6f, 0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 
+0x64, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 
+0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 
+0x79, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 
+0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x63, 0x66, 0x32, 0x4e, 0x72, 0x76, 0x79, 0x67, 
+0x41, 0x36, 0x38, 0x79, 0x36, 0x5a, 0x43, 0x41, 
+0x6b, 0x57, 0x32, 0x75, 0x65, 0x43, 0x75, 0x51, 
+0x31, 0x42, 0x38, 0x71, 0x7a, 0x79, 0x57, 0x70, 
+0x6a, 0x47, 0x59, 0x33, 0x38, 0x71, 0x68, 0x6a, 
+0x76, 0x51, 0x67, 0x5a, 0x41, 0x46, 0x4c, 0x68, 
+0x52, 0x57, 0x47, 0x42, 0x22, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x30, 0x38, 0x37, 0x31, 0x63, 0x61, 0x35, 0x65, 
+0x30, 0x38, 0x39, 0x64, 0x65, 0x66, 0x64, 0x34, 
+0x34, 0x62, 0x35, 0x30, 0x37, 0x36, 0x65, 0x65, 
+0x63, 0x62, 0x32, 0x30, 0x64, 0x63, 0x63, 0x63, 
+0x61, 0x61, 0x39, 0x63, 0x39, 0x37, 0x61, 0x64, 
+0x35, 0x33, 0x32, 0x35, 0x33, 0x35, 0x39, 0x35, 
+0x64, 0x38, 0x39, 0x35, 0x37, 0x32, 0x33, 0x39, 
+0x63, 0x31, 0x31, 0x34, 0x31, 0x30, 0x66, 0x62, 
+0x30, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x43, 0x6f, 0x6d, 
+0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 0x22, 
+0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 
+0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 
+0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 
+0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 
+0x74, 0x72, 0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5d, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x44, 0x45, 0x78, 
+0x57, 0x75, 0x6e, 0x72, 0x53, 0x6b, 0x46, 0x32, 
+0x50, 0x39, 0x4e, 0x41, 0x7a, 0x57, 0x34, 0x4a, 
+0x70, 0x45, 0x65, 0x43, 0x33, 0x38, 0x75, 0x43, 
+0x33, 0x7a, 0x33, 0x36, 0x63, 0x43, 0x6b, 0x22, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x36, 0x62, 0x62, 0x31, 0x30, 
+0x36, 0x62, 0x66, 0x37, 0x63, 0x63, 0x33, 0x66, 
+0x38, 0x30, 0x65, 0x35, 0x63, 0x66, 0x65, 0x62, 
+0x33, 0x65, 0x61, 0x63, 0x64, 0x64, 0x38, 0x66, 
+0x37, 0x64, 0x64, 0x39, 0x32, 0x30, 0x31, 0x66, 
+0x61, 0x30, 0x39, 0x22, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 0x64, 0x64, 
+0x72, 0x54, 0x79, 0x70, 0x65, 0x22, 0x3a, 0x20, 
+0x22, 0x70, 0x75, 0x62, 0x6b, 0x65, 0x79, 0x22, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 
+0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 
+0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x41, 0x46, 0x56, 0x6b, 0x57, 0x38, 0x57, 
+0x67, 0x50, 0x50, 0x32, 0x72, 0x73, 0x54, 0x64, 
+0x41, 0x65, 0x79, 0x6f, 0x67, 0x46, 0x4b, 0x39, 
+0x6b, 0x38, 0x67, 0x58, 0x4a, 0x31, 0x4c, 0x5a, 
+0x77, 0x72, 0x62, 0x22, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x66, 
+0x63, 0x66, 0x33, 0x36, 0x31, 0x38, 0x30, 0x62, 
+0x36, 0x32, 0x65, 0x66, 0x32, 0x32, 0x30, 0x61, 
+0x31, 0x38, 0x32, 0x62, 0x31, 0x62, 0x32, 0x34, 
+0x36, 0x35, 0x37, 0x31, 0x62, 0x62, 0x32, 0x66, 
+0x63, 0x65, 0x33, 0x30, 0x65, 0x63, 0x38, 0x22, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x61, 0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 
+0x65, 0x22, 0x3a, 0x20, 0x22, 0x73, 0x63, 0x72, 
+0x69, 0x70, 0x74, 0x22, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 
+0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 
+0x61, 0x6c, 0x73, 0x65, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 
+0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x66, 
+0x61, 0x6c, 0x73, 0x65, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5d, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x6e, 0x61, 0x67, 
+0x47, 0x6e, 0x47, 0x44, 0x4b, 0x57, 0x59, 0x70, 
+0x76, 0x6e, 0x70, 0x68, 0x66, 0x39, 0x72, 0x67, 
+0x6f, 0x33, 0x78, 0x74, 0x51, 0x68, 0x41, 0x78, 
+0x69, 0x45, 0x4d, 0x31, 0x51, 0x47, 0x44, 0x22, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x34, 0x37, 0x32, 0x31, 0x64, 
+0x37, 0x38, 0x32, 0x38, 0x35, 0x64, 0x30, 0x33, 
+0x62, 0x62, 0x62, 0x39, 0x36, 0x38, 0x35, 0x33, 
+0x37, 0x66, 0x38, 0x30, 0x34, 0x32, 0x36, 0x62, 
+0x35, 0x61, 0x66, 0x32, 0x34, 0x34, 0x65, 0x31, 
+0x63, 0x33, 0x31, 0x22, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 0x64, 0x64, 
+0x72, 0x54, 0x79, 0x70, 0x65, 0x22, 0x3a, 0x20, 
+0x22, 0x70, 0x75, 0x62, 0x6b, 0x65, 0x79, 0x22, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 
+0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 
+0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x32, 0x4e, 0x32, 0x66, 0x37, 0x76, 0x41, 0x35, 
+0x6a, 0x39, 0x32, 0x47, 0x43, 0x47, 0x75, 0x4e, 
+0x74, 0x38, 0x36, 0x38, 0x7a, 0x69, 0x68, 0x71, 
+0x44, 0x42, 0x65, 0x78, 0x45, 0x64, 0x44, 0x6d, 
+0x4a, 0x38, 0x56, 0x22, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x36, 
+0x37, 0x33, 0x65, 0x30, 0x63, 0x31, 0x35, 0x32, 
+0x65, 0x31, 0x36, 0x37, 0x37, 0x61, 0x39, 0x61, 
+0x38, 0x66, 0x64, 0x35, 0x35, 0x64, 0x66, 0x37, 
+0x38, 0x62, 0x62, 0x31, 0x65, 0x61, 0x62, 0x33, 
+0x64, 0x62, 0x33, 0x63, 0x35, 0x33, 0x63, 0x22, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x61, 0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 
+0x65, 0x22, 0x3a, 0x20, 0x22, 0x73, 0x63, 0x72, 
+0x69, 0x70, 0x74, 0x22, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 
+0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 
+0x61, 0x6c, 0x73, 0x65, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 
+0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x74, 
+0x72, 0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5d, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x36, 0x4b, 0x61, 0x50, 
+0x75, 0x35, 0x73, 0x36, 0x34, 0x59, 0x6b, 0x56, 
+0x43, 0x7a, 0x35, 0x6e, 0x34, 0x6f, 0x63, 0x35, 
+0x46, 0x45, 0x46, 0x56, 0x4c, 0x36, 0x71, 0x56, 
+0x43, 0x68, 0x39, 0x61, 0x38, 0x53, 0x64, 0x64, 
+0x36, 0x42, 0x59, 0x6f, 0x45, 0x31, 0x53, 0x4e, 
+0x32, 0x61, 0x77, 0x45, 0x67, 0x62, 0x35, 0x22, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x62, 0x65, 0x33, 0x39, 0x36, 
+0x64, 0x30, 0x65, 0x64, 0x37, 0x35, 0x30, 0x64, 
+0x63, 0x37, 0x33, 0x36, 0x65, 0x66, 0x31, 0x63, 
+0x61, 0x62, 0x64, 0x36, 0x35, 0x65, 0x38, 0x31, 
+0x33, 0x62, 0x33, 0x62, 0x66, 0x37, 0x34, 0x31, 
+0x37, 0x64, 0x32, 0x31, 0x31, 0x35, 0x39, 0x39, 
+0x31, 0x39, 0x66, 0x34, 0x39, 0x64, 0x64, 0x37, 
+0x63, 0x64, 0x32, 0x66, 0x61, 0x36, 0x62, 0x34, 
+0x36, 0x37, 0x65, 0x22, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x43, 
+0x6f, 0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 
+0x64, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 
+0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 
+0x79, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 
+0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x51, 0x52, 0x79, 0x33, 0x56, 0x70, 0x66, 
+0x65, 0x51, 0x39, 0x68, 0x79, 0x6e, 0x46, 0x75, 
+0x5a, 0x65, 0x37, 0x77, 0x4a, 0x37, 0x61, 0x50, 
+0x55, 0x4e, 0x54, 0x74, 0x46, 0x6d, 0x4c, 0x72, 
+0x58, 0x6f, 0x57, 0x51, 0x44, 0x74, 0x55, 0x59, 
+0x37, 0x66, 0x6b, 0x6f, 0x46, 0x51, 0x73, 0x4e, 
+0x44, 0x4c, 0x69, 0x54, 0x75, 0x22, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x36, 0x34, 0x30, 0x33, 0x65, 0x37, 0x30, 
+0x34, 0x35, 0x31, 0x33, 0x39, 0x30, 0x31, 0x33, 
+0x34, 0x66, 0x32, 0x62, 0x64, 0x64, 0x62, 0x65, 
+0x35, 0x65, 0x63, 0x62, 0x33, 0x33, 0x63, 0x35, 
+0x62, 0x32, 0x36, 0x34, 0x61, 0x66, 0x32, 0x39, 
+0x32, 0x66, 0x63, 0x62, 0x66, 0x32, 0x63, 0x64, 
+0x64, 0x39, 0x37, 0x64, 0x65, 0x61, 0x61, 0x63, 
+0x37, 0x65, 0x31, 0x65, 0x38, 0x66, 0x37, 0x62, 
+0x61, 0x30, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x43, 0x6f, 
+0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 
+0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 
+0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 
+0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 
+0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x39, 
+0x36, 0x66, 0x54, 0x76, 0x4c, 0x6e, 0x33, 0x76, 
+0x59, 0x56, 0x70, 0x33, 0x7a, 0x74, 0x67, 0x53, 
+0x45, 0x4a, 0x64, 0x48, 0x34, 0x4c, 0x66, 0x55, 
+0x4e, 0x55, 0x76, 0x4e, 0x64, 0x47, 0x61, 0x76, 
+0x38, 0x53, 0x47, 0x44, 0x31, 0x68, 0x7a, 0x70, 
+0x75, 0x75, 0x70, 0x58, 0x56, 0x51, 0x75, 0x45, 
+0x57, 0x6d, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x39, 0x63, 
+0x63, 0x65, 0x36, 0x34, 0x38, 0x31, 0x38, 0x65, 
+0x34, 0x64, 0x35, 0x30, 0x66, 0x37, 0x36, 0x31, 
+0x64, 0x31, 0x66, 0x63, 0x62, 0x32, 0x33, 0x30, 
+0x65, 0x39, 0x62, 0x38, 0x61, 0x30, 0x66, 0x32, 
+0x30, 0x66, 0x63, 0x30, 0x39, 0x63, 0x30, 0x30, 
+0x63, 0x38, 0x37, 0x65, 0x36, 0x61, 0x37, 0x30, 
+0x34, 0x63, 0x62, 0x66, 0x63, 0x35, 0x64, 0x64, 
+0x30, 0x36, 0x33, 0x34, 0x38, 0x39, 0x22, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x43, 0x6f, 0x6d, 0x70, 0x72, 0x65, 
+0x73, 0x73, 0x65, 0x64, 0x22, 0x3a, 0x20, 0x66, 
+0x61, 0x6c, 0x73, 0x65, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 
+0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x74, 
+0x72, 0x75, 0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 
+0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x74, 0x72, 
+0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5d, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x63, 0x6b, 0x6f, 0x75, 0x62, 
+0x6a, 0x68, 0x31, 0x79, 0x72, 0x31, 0x48, 0x79, 
+0x67, 0x38, 0x4e, 0x50, 0x74, 0x47, 0x77, 0x44, 
+0x7a, 0x34, 0x74, 0x78, 0x39, 0x31, 0x62, 0x36, 
+0x71, 0x7a, 0x74, 0x78, 0x72, 0x4a, 0x5a, 0x67, 
+0x54, 0x74, 0x64, 0x52, 0x34, 0x45, 0x64, 0x39, 
+0x43, 0x71, 0x41, 0x56, 0x35, 0x63, 0x6e, 0x22, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x62, 0x35, 0x30, 0x64, 0x63, 
+0x36, 0x65, 0x31, 0x31, 0x36, 0x66, 0x34, 0x66, 
+0x34, 0x61, 0x65, 0x38, 0x62, 0x30, 0x35, 0x66, 
+0x61, 0x36, 0x63, 0x62, 0x31, 0x39, 0x37, 0x63, 
+0x64, 0x66, 0x64, 0x32, 0x37, 0x62, 0x64, 0x30, 
+0x63, 0x36, 0x31, 0x65, 0x31, 0x63, 0x35, 0x33, 
+0x63, 0x31, 0x63, 0x61, 0x38, 0x33, 0x66, 0x63, 
+0x62, 0x39, 0x62, 0x35, 0x36, 0x64, 0x35, 0x39, 
+0x61, 0x38, 0x33, 0x30, 0x22, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x43, 0x6f, 0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 
+0x65, 0x64, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 
+0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 
+0x79, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 
+0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x44, 0x4d, 0x59, 0x46, 0x44, 0x73, 0x75, 0x46, 
+0x61, 0x6d, 0x53, 0x34, 0x6b, 0x6f, 0x67, 0x73, 
+0x69, 0x71, 0x78, 0x51, 0x52, 0x58, 0x4b, 0x39, 
+0x64, 0x69, 0x43, 0x66, 0x6d, 0x4a, 0x7a, 0x4e, 
+0x4c, 0x68, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x62, 0x33, 
+0x65, 0x32, 0x64, 0x33, 0x66, 0x34, 0x39, 0x39, 
+0x33, 0x32, 0x30, 0x38, 0x31, 0x62, 0x64, 0x30, 
+0x61, 0x39, 0x39, 0x33, 0x36, 0x64, 0x30, 0x63, 
+0x63, 0x32, 0x33, 0x39, 0x61, 0x61, 0x66, 0x65, 
+0x64, 0x35, 0x31, 0x61, 0x36, 0x34, 0x22, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x61, 0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 0x65, 
+0x22, 0x3a, 0x20, 0x22, 0x70, 0x75, 0x62, 0x6b, 
+0x65, 0x79, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 
+0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 0x61, 
+0x6c, 0x73, 0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 
+0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x66, 0x61, 
+0x6c, 0x73, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5d, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x41, 0x32, 0x43, 0x55, 
+0x62, 0x79, 0x45, 0x74, 0x71, 0x47, 0x55, 0x6a, 
+0x6e, 0x67, 0x41, 0x6a, 0x78, 0x70, 0x47, 0x6d, 
+0x4d, 0x35, 0x4e, 0x77, 0x68, 0x72, 0x7a, 0x37, 
+0x32, 0x67, 0x68, 0x32, 0x33, 0x76, 0x22, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x36, 0x62, 0x31, 0x35, 0x36, 0x36, 
+0x66, 0x61, 0x34, 0x63, 0x37, 0x30, 0x61, 0x36, 
+0x39, 0x64, 0x66, 0x31, 0x32, 0x62, 0x61, 0x63, 
+0x63, 0x31, 0x33, 0x38, 0x65, 0x66, 0x66, 0x66, 
+0x64, 0x39, 0x62, 0x39, 0x63, 0x62, 0x30, 0x65, 
+0x37, 0x32, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x61, 0x64, 0x64, 0x72, 
+0x54, 0x79, 0x70, 0x65, 0x22, 0x3a, 0x20, 0x22, 
+0x73, 0x63, 0x72, 0x69, 0x70, 0x74, 0x22, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 
+0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 
+0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x6e, 0x69, 0x63, 0x73, 0x37, 0x46, 0x69, 0x47, 
+0x73, 0x73, 0x53, 0x4b, 0x54, 0x75, 0x44, 0x72, 
+0x66, 0x4e, 0x62, 0x48, 0x58, 0x61, 0x39, 0x31, 
+0x33, 0x57, 0x34, 0x4c, 0x72, 0x4c, 0x4c, 0x4b, 
+0x32, 0x77, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x39, 0x65, 
+0x33, 0x64, 0x64, 0x36, 0x65, 0x30, 0x34, 0x64, 
+0x31, 0x61, 0x33, 0x35, 0x62, 0x38, 0x34, 0x37, 
+0x34, 0x30, 0x65, 0x39, 0x61, 0x31, 0x62, 0x37, 
+0x31, 0x63, 0x32, 0x38, 0x30, 0x39, 0x66, 0x37, 
+0x63, 0x35, 0x37, 0x38, 0x64, 0x34, 0x22, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x61, 0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 0x65, 
+0x22, 0x3a, 0x20, 0x22, 0x70, 0x75, 0x62, 0x6b, 
+0x65, 0x79, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 
+0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 0x61, 
+0x6c, 0x73, 0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 
+0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x74, 0x72, 
+0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5d, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x32, 0x4d, 0x74, 0x48, 0x7a, 
+0x73, 0x58, 0x51, 0x48, 0x4b, 0x4a, 0x43, 0x57, 
+0x36, 0x73, 0x36, 0x4d, 0x69, 0x6b, 0x54, 0x56, 
+0x4d, 0x31, 0x34, 0x6b, 0x6b, 0x38, 0x61, 0x71, 
+0x46, 0x33, 0x57, 0x6d, 0x5a, 0x76, 0x22, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x30, 0x62, 0x37, 0x65, 0x36, 0x63, 
+0x61, 0x65, 0x38, 0x34, 0x61, 0x30, 0x32, 0x37, 
+0x62, 0x64, 0x62, 0x36, 0x30, 0x63, 0x39, 0x64, 
+0x36, 0x37, 0x36, 0x30, 0x63, 0x33, 0x32, 0x39, 
+0x62, 0x39, 0x38, 0x63, 0x65, 0x38, 0x37, 0x64, 
+0x34, 0x35, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x61, 0x64, 0x64, 0x72, 
+0x54, 0x79, 0x70, 0x65, 0x22, 0x3a, 0x20, 0x22, 
+0x73, 0x63, 0x72, 0x69, 0x70, 0x74, 0x22, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 
+0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 
+0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x36, 
+0x4b, 0x57, 0x52, 0x76, 0x6d, 0x57, 0x42, 0x31, 
+0x59, 0x58, 0x54, 0x70, 0x35, 0x34, 0x7a, 0x54, 
+0x4b, 0x42, 0x50, 0x53, 0x34, 0x51, 0x55, 0x48, 
+0x62, 0x61, 0x67, 0x37, 0x61, 0x50, 0x32, 0x43, 
+0x4b, 0x6b, 0x4a, 0x35, 0x65, 0x4e, 0x37, 0x59, 
+0x71, 0x46, 0x63, 0x66, 0x46, 0x52, 0x6a, 0x46, 
+0x61, 0x4d, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x62, 0x35, 
+0x33, 0x38, 0x61, 0x34, 0x63, 0x63, 0x33, 0x39, 
+0x30, 0x63, 0x61, 0x35, 0x63, 0x32, 0x39, 0x62, 
+0x66, 0x32, 0x63, 0x62, 0x30, 0x36, 0x64, 0x35, 
+0x62, 0x38, 0x35, 0x31, 0x34, 0x31, 0x38, 0x61, 
+0x61, 0x32, 0x65, 0x65, 0x66, 0x30, 0x65, 0x31, 
+0x37, 0x35, 0x65, 0x30, 0x62, 0x36, 0x35, 0x35, 
+0x64, 0x61, 0x64, 0x63, 0x66, 0x64, 0x36, 0x62, 
+0x39, 0x66, 0x30, 0x32, 0x38, 0x34, 0x22, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x43, 0x6f, 0x6d, 0x70, 0x72, 0x65, 
+0x73, 0x73, 0x65, 0x64, 0x22, 0x3a, 0x20, 0x66, 
+0x61, 0x6c, 0x73, 0x65, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 
+0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x74, 
+0x72, 0x75, 0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 
+0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x66, 0x61, 
+0x6c, 0x73, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x5d, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x51, 0x56, 0x44, 0x77, 
+0x69, 0x37, 0x52, 0x46, 0x77, 0x42, 0x31, 0x68, 
+0x4c, 0x32, 0x75, 0x70, 0x6e, 0x6e, 0x45, 0x42, 
+0x6e, 0x31, 0x48, 0x6a, 0x61, 0x54, 0x65, 0x78, 
+0x4e, 0x57, 0x53, 0x59, 0x74, 0x6b, 0x59, 0x70, 
+0x64, 0x45, 0x31, 0x56, 0x68, 0x63, 0x59, 0x33, 
+0x6e, 0x37, 0x66, 0x61, 0x51, 0x33, 0x32, 0x44, 
+0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x22, 0x63, 0x35, 0x33, 0x31, 
+0x35, 0x32, 0x36, 0x30, 0x34, 0x35, 0x65, 0x34, 
+0x35, 0x38, 0x35, 0x66, 0x33, 0x38, 0x39, 0x33, 
+0x64, 0x66, 0x61, 0x36, 0x65, 0x36, 0x65, 0x36, 
+0x62, 0x37, 0x31, 0x61, 0x66, 0x34, 0x66, 0x61, 
+0x35, 0x31, 0x37, 0x62, 0x61, 0x32, 0x38, 0x30, 
+0x30, 0x33, 0x39, 0x62, 0x33, 0x35, 0x36, 0x36, 
+0x37, 0x62, 0x36, 0x30, 0x61, 0x39, 0x35, 0x64, 
+0x65, 0x39, 0x65, 0x32, 0x30, 0x22, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 
+0x73, 0x43, 0x6f, 0x6d, 0x70, 0x72, 0x65, 0x73, 
+0x73, 0x65, 0x64, 0x22, 0x3a, 0x20, 0x74, 0x72, 
+0x75, 0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 
+0x65, 0x79, 0x22, 0x3a, 0x20, 0x74, 0x72, 0x75, 
+0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 
+0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 0x65, 
+0x74, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 
+0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5d, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x5b, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x39, 0x35, 0x63, 0x64, 0x48, 0x7a, 
+0x74, 0x77, 0x70, 0x57, 0x4b, 0x67, 0x41, 0x34, 
+0x64, 0x67, 0x77, 0x38, 0x63, 0x68, 0x77, 0x39, 
+0x68, 0x6a, 0x52, 0x34, 0x79, 0x6a, 0x78, 0x4e, 
+0x46, 0x5a, 0x72, 0x50, 0x72, 0x39, 0x6f, 0x74, 
+0x71, 0x67, 0x50, 0x4c, 0x35, 0x6d, 0x48, 0x39, 
+0x50, 0x47, 0x65, 0x73, 0x4a, 0x22, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x31, 0x32, 0x61, 0x61, 0x34, 0x62, 0x38, 
+0x35, 0x35, 0x65, 0x65, 0x64, 0x63, 0x37, 0x30, 
+0x32, 0x36, 0x66, 0x62, 0x37, 0x30, 0x36, 0x65, 
+0x63, 0x31, 0x35, 0x39, 0x38, 0x30, 0x32, 0x33, 
+0x64, 0x30, 0x34, 0x65, 0x39, 0x35, 0x32, 0x35, 
+0x36, 0x63, 0x37, 0x62, 0x65, 0x65, 0x62, 0x64, 
+0x36, 0x35, 0x35, 0x36, 0x66, 0x62, 0x65, 0x39, 
+0x34, 0x39, 0x33, 0x62, 0x65, 0x34, 0x64, 0x36, 
+0x31, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x43, 0x6f, 0x6d, 
+0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 0x22, 
+0x3a, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 
+0x50, 0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 
+0x3a, 0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 
+0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 
+0x20, 0x74, 0x72, 0x75, 0x65, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x63, 0x6b, 
+0x72, 0x68, 0x48, 0x66, 0x42, 0x35, 0x6b, 0x37, 
+0x4e, 0x7a, 0x56, 0x45, 0x71, 0x45, 0x73, 0x6b, 
+0x73, 0x59, 0x47, 0x76, 0x68, 0x32, 0x78, 0x53, 
+0x6a, 0x5a, 0x69, 0x54, 0x37, 0x31, 0x6f, 0x56, 
+0x47, 0x47, 0x53, 0x79, 0x73, 0x50, 0x39, 0x37, 
+0x62, 0x47, 0x4d, 0x43, 0x6b, 0x6d, 0x33, 0x45, 
+0x67, 0x4b, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x62, 0x36, 
+0x37, 0x63, 0x65, 0x38, 0x66, 0x33, 0x38, 0x36, 
+0x30, 0x31, 0x65, 0x32, 0x66, 0x33, 0x35, 0x62, 
+0x63, 0x63, 0x61, 0x39, 0x62, 0x39, 0x63, 0x63, 
+0x39, 0x61, 0x63, 0x37, 0x66, 0x35, 0x65, 0x64, 
+0x37, 0x62, 0x66, 0x61, 0x64, 0x37, 0x38, 0x33, 
+0x63, 0x66, 0x38, 0x65, 0x63, 0x64, 0x62, 0x32, 
+0x31, 0x61, 0x31, 0x66, 0x39, 0x31, 0x32, 0x30, 
+0x38, 0x36, 0x63, 0x66, 0x34, 0x64, 0x30, 0x22, 
+0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x43, 0x6f, 0x6d, 0x70, 0x72, 
+0x65, 0x73, 0x73, 0x65, 0x64, 0x22, 0x3a, 0x20, 
+0x74, 0x72, 0x75, 0x65, 0x2c, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 
+0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 0x20, 0x74, 
+0x72, 0x75, 0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 
+0x6e, 0x65, 0x74, 0x22, 0x3a, 0x20, 0x74, 0x72, 
+0x75, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5d, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x5b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x44, 0x51, 0x4a, 0x58, 0x43, 
+0x68, 0x74, 0x79, 0x75, 0x4e, 0x33, 0x61, 0x69, 
+0x55, 0x33, 0x57, 0x36, 0x70, 0x47, 0x34, 0x6d, 
+0x67, 0x6e, 0x79, 0x6b, 0x69, 0x73, 0x48, 0x48, 
+0x35, 0x68, 0x71, 0x73, 0x74, 0x22, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x64, 0x32, 0x33, 0x32, 0x62, 0x38, 0x39, 
+0x39, 0x35, 0x35, 0x66, 0x38, 0x66, 0x37, 0x37, 
+0x65, 0x32, 0x37, 0x65, 0x65, 0x61, 0x35, 0x62, 
+0x38, 0x31, 0x38, 0x63, 0x34, 0x35, 0x39, 0x61, 
+0x61, 0x38, 0x66, 0x38, 0x64, 0x33, 0x36, 0x34, 
+0x64, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x7b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x22, 0x61, 0x64, 0x64, 0x72, 0x54, 
+0x79, 0x70, 0x65, 0x22, 0x3a, 0x20, 0x22, 0x70, 
+0x75, 0x62, 0x6b, 0x65, 0x79, 0x22, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x50, 
+0x72, 0x69, 0x76, 0x6b, 0x65, 0x79, 0x22, 0x3a, 
+0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x69, 0x73, 0x54, 
+0x65, 0x73, 0x74, 0x6e, 0x65, 0x74, 0x22, 0x3a, 
+0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x0a, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x7d, 
+0x0a, 0x20, 0x20, 0x20, 0x20, 0x5d, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x5b, 0x0a, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x41, 
+0x44, 0x32, 0x31, 0x70, 0x4b, 0x6f, 0x43, 0x57, 
+0x63, 0x72, 0x71, 0x72, 0x55, 0x57, 0x34, 0x6f, 
+0x52, 0x76, 0x35, 0x78, 0x55, 0x61, 0x47, 0x77, 
+0x43, 0x66, 0x58, 0x68, 0x69, 0x79, 0x78, 0x36, 
+0x79, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x22, 0x65, 0x31, 0x63, 
+0x34, 0x34, 0x33, 0x66, 0x65, 0x62, 0x31, 0x65, 
+0x65, 0x64, 0x65, 0x36, 0x30, 0x39, 0x36, 0x32, 
+0x64, 0x63, 0x38, 0x30, 0x38, 0x38, 0x39, 0x39, 
+0x30, 0x38, 0x36, 0x66, 0x38, 0x64, 0x63, 0x35, 
+0x38, 0x39, 0x33, 0x33, 0x36, 0x22, 0x2c, 0x0a, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x22, 0x61, 
+0x64, 0x64, 0x72, 0x54, 0x79, 0x70, 0x65, 0x22, 
+0x3a, 0x20, 0x22, 0x73, 0x63, 0x72, 0x69, 0x70, 
+0x74, 0x22, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x50, 0x72, 0x69, 0x76, 0x6b, 
+0x65, 0x79, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 
+0x73, 0x65, 0x2c, 0x0a, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x22, 0x69, 0x73, 0x54, 0x65, 0x73, 0x74, 0x6e, 
+0x65, 0x74, 0x22, 0x3a, 0x20, 0x66, 0x61, 0x6c, 
+0x73, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 
+0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 
+0x20, 0x5d, 0x0a, 0x5d, 0x0a,    
+};};
@@ -122,6 +122,49 @@ BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
     }
 }
 
+// Test that data written with one profile reads back with the others, and
+// that the statistics of the database are reported.
+BOOST_AUTO_TEST_CASE(dbwrapper_profiles)
+{
+    boost::filesystem::path ph = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    const DBProfile profiles[] = {DBProfile::DEFAULT, DBProfile::BLOCK_INDEX, DBProfile::CHAINSTATE, DBProfile::CHAINSTATE_IBD};
+
+    std::vector<uint256> values;
+    for (DBProfile profile : profiles) {
+        CDBWrapper dbw(ph, (1 << 20), false, false, true, profile);
+        BOOST_CHECK(dbw.GetProfile() == profile);
+
+        for (unsigned int i = 0; i < values.size(); i++) {
+            uint256 res;
+            BOOST_CHECK(dbw.Read(i, res));
+            BOOST_CHECK(res == values[i]);
+        }
+        for (unsigned int i = 0; i < 100; i++) {
+            values.push_back(GetRandHash());
+            BOOST_CHECK(dbw.Write((unsigned int)values.size() - 1, values.back()));
+        }
+
+        // Compacting moves the records from the memtable to a table on disk
+        dbw.CompactRange((unsigned int)0, (unsigned int)values.size());
+        std::vector<CDBLevelStats> stats = dbw.GetLevelStats();
+        BOOST_REQUIRE(!stats.empty());
+        int nFiles = 0;
+        for (const CDBLevelStats& level : stats) {
+            BOOST_CHECK(level.nLevel >= 0 && level.nLevel < 7);
+            nFiles += level.nFiles;
+        }
+        BOOST_CHECK(nFiles > 0);
+
+        std::string strStats;
+        BOOST_CHECK(dbw.GetProperty("leveldb.stats", strStats));
+        BOOST_CHECK(!dbw.GetProperty("leveldb.unknown-property", strStats));
+        BOOST_CHECK(dbw.DynamicMemoryUsage() > 0);
+    }
+
+    BOOST_CHECK_EQUAL(DBProfileName(DBProfile::BLOCK_INDEX), "blockindex");
+    BOOST_CHECK_EQUAL(DBProfileName(DBProfile::CHAINSTATE_IBD), "chainstate_ibd");
+}
+
 // Test that we do not obfuscation if there is existing data.
 BOOST_AUTO_TEST_CASE(existing_data_no_obfuscate)
 {
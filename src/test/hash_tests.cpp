@@ -2,10 +2,13 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "crypto/common.h"
 #include "hash.h"
+#include "random.h"
 #include "utilstrencodings.h"
 #include "test/test_bitcoin.h"
 
+#include <limits>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -128,6 +131,19 @@ BOOST_AUTO_TEST_CASE(siphash)
     tx.nVersion = 1;
     ss << tx;
     BOOST_CHECK_EQUAL(SipHashUint256(1, 2, ss.GetHash()), 0x79751e980c2a0a35ULL);
+
+    // Check consistency between CSipHasher and SipHashUint256Extra.
+    for (int i = 0; i < 16; ++i) {
+        uint64_t k1 = GetRand(std::numeric_limits<uint64_t>::max());
+        uint64_t k2 = GetRand(std::numeric_limits<uint64_t>::max());
+        uint256 x = GetRandHash();
+        uint32_t n = GetRand(std::numeric_limits<uint32_t>::max());
+        uint8_t nb[4];
+        WriteLE32(nb, n);
+        CSipHasher sip288 = CSipHasher(k1, k2).Write(x.begin(), 32);
+        sip288.Write(nb, 4);
+        BOOST_CHECK_EQUAL(SipHashUint256Extra(k1, k2, x, n), sip288.Finalize());
+    }
 }
 
 BOOST_AUTO_TEST_SUITE_END()
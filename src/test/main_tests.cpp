@@ -3,7 +3,10 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "base58.h"
 #include "chainparams.h"
+#include "coins.h"
+#include "script/standard.h"
 #include "validation.h"
 #include "net.h"
 
@@ -30,4 +33,49 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+BOOST_AUTO_TEST_CASE(blacklisted_inputs)
+{
+    const CChainParams& mainParams = Params(CBaseChainParams::MAIN);
+    const CChainParams& testnetParams = Params(CBaseChainParams::TESTNET);
+
+    std::vector<unsigned char> vchAddress;
+    BOOST_CHECK(DecodeBase58Check("L982ZRRKrxayUbZhdXEBAyjm539hXJmmhN", vchAddress));
+    BOOST_CHECK_EQUAL(vchAddress.size(), 21U);
+    CKeyID keyID(uint160(std::vector<unsigned char>(vchAddress.begin() + 1, vchAddress.end())));
+
+    BOOST_CHECK(!isBlacklisted(keyID, mainParams, 275299));
+    BOOST_CHECK(isBlacklisted(keyID, mainParams, 275300));
+    BOOST_CHECK(!isBlacklisted(keyID, testnetParams, 275300));
+    BOOST_CHECK(!isBlacklisted(uint160(), mainParams, 275300));
+
+    // The key id may be pushed with any push opcode, as in Solver()
+    std::vector<std::vector<unsigned char> > vPushHeaders = {
+        {20}, {OP_PUSHDATA1, 20}, {OP_PUSHDATA2, 20, 0}, {OP_PUSHDATA4, 20, 0, 0, 0}
+    };
+    CMutableTransaction txFrom;
+    txFrom.vout.resize(vPushHeaders.size() + 2, CTxOut(COIN, CScript()));
+    for (unsigned int i = 0; i < vPushHeaders.size(); i++) {
+        CScript& script = txFrom.vout[i].scriptPubKey;
+        script << OP_DUP << OP_HASH160;
+        script.insert(script.end(), vPushHeaders[i].begin(), vPushHeaders[i].end());
+        script.insert(script.end(), keyID.begin(), keyID.end());
+        script << OP_EQUALVERIFY << OP_CHECKSIG;
+    }
+    txFrom.vout[vPushHeaders.size()].scriptPubKey = GetScriptForDestination(CKeyID());
+    txFrom.vout[vPushHeaders.size() + 1].scriptPubKey = GetScriptForDestination(CScriptID(keyID));
+
+    CCoinsView coinsDummy;
+    CCoinsViewCache coins(&coinsDummy);
+    AddCoins(coins, txFrom, 0);
+
+    for (unsigned int i = 0; i < txFrom.vout.size(); i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(txFrom.GetHash(), i);
+        bool fBlacklisted = i < vPushHeaders.size();
+        BOOST_CHECK_EQUAL(HasBlacklistedInput(tx, coins, mainParams, 275300), fBlacklisted);
+        BOOST_CHECK(!HasBlacklistedInput(tx, coins, mainParams, 275299));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
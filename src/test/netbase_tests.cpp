@@ -5,6 +5,7 @@
 
 #include "netbase.h"
 #include "test/test_bitcoin.h"
+#include "utiltime.h"
 
 #include <string>
 
@@ -285,4 +286,53 @@ BOOST_AUTO_TEST_CASE(netbase_getgroup)
 
 }
 
+#ifndef WIN32
+BOOST_AUTO_TEST_CASE(netbase_socketevents)
+{
+    for (CSocketEvents::Backend backend : {CSocketEvents::BACKEND_SELECT, CSocketEvents::BACKEND_POLL, CSocketEvents::BACKEND_EPOLL}) {
+        int fds[2];
+        BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        SOCKET hLocal = fds[0], hRemote = fds[1];
+        CSocketEvents events(backend);
+        std::map<SOCKET, int> mapReady;
+
+        // Nothing to receive yet, but the send buffer has room
+        events.Watch(hLocal, CSocketEvents::EVENT_RECV);
+        BOOST_CHECK(events.Wait(0, mapReady));
+        BOOST_CHECK(mapReady.empty());
+        events.Watch(hLocal, CSocketEvents::EVENT_RECV | CSocketEvents::EVENT_SEND);
+        BOOST_CHECK(events.Wait(1000, mapReady));
+        BOOST_CHECK_EQUAL(mapReady[hLocal], CSocketEvents::EVENT_SEND);
+
+        // Data arrives
+        events.Watch(hLocal, CSocketEvents::EVENT_RECV);
+        char c = 'x';
+        BOOST_CHECK_EQUAL(send(hRemote, &c, 1, 0), 1);
+        BOOST_CHECK(events.Wait(1000, mapReady));
+        BOOST_CHECK_EQUAL(mapReady[hLocal], CSocketEvents::EVENT_RECV);
+
+        // Sockets that are no longer watched are not reported
+        events.Unwatch(hLocal);
+        BOOST_CHECK(events.Wait(0, mapReady));
+        BOOST_CHECK(mapReady.empty());
+
+        // Wake() interrupts a pending wait, and only once
+        events.Wake();
+        int64_t nStart = GetTimeMillis();
+        BOOST_CHECK(events.Wait(10000, mapReady));
+        BOOST_CHECK(mapReady.empty());
+        BOOST_CHECK(GetTimeMillis() - nStart < 5000);
+        BOOST_CHECK(events.Wait(0, mapReady));
+        BOOST_CHECK(mapReady.empty());
+
+        // A hang-up is reported as readable
+        events.Watch(hLocal, CSocketEvents::EVENT_RECV);
+        CloseSocket(hRemote);
+        BOOST_CHECK(events.Wait(1000, mapReady));
+        BOOST_CHECK(mapReady[hLocal] & CSocketEvents::EVENT_RECV);
+        CloseSocket(hLocal);
+    }
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -7,6 +7,9 @@
 #include "chainparams.h"
 #include "pow.h"
 #include "random.h"
+#include "streams.h"
+#include "utilstrencodings.h"
+#include "validation.h"
 #include "util.h"
 #include "test/test_bitcoin.h"
 
@@ -95,4 +98,45 @@ BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
     }
 }
 
+/* Test the batched proof-of-work pre-check used for header sync */
+BOOST_AUTO_TEST_CASE(check_headers_pow)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    // Legacy (non-auxpow) headers with valid scrypt proof of work
+    const char* headershex[] = {
+        "020000004c1271c211717198227392b029a64a7971931d351b387bb80db027f270411e398a07046f7d4a08dd815412a8712f874a7ebf0507e3878bd24e20a3b73fd750a667d2f451eac7471b00de6659",
+        "0200000011503ee6a855e900c00cfdd98f5f55fffeaee9b6bf55bea9b852d9de2ce35828e204eef76acfd36949ae56d1fbe81c1ac9c0209e6331ad56414f9072506a77f8c6faf551eac7471b00389d01",
+        "02000000a72c8a177f523946f42f22c3e86b8023221b4105e8007e59e81f6beb013e29aaf635295cb9ac966213fb56e046dc71df5b3f7f67ceaeab24038e743f883aff1aaafaf551eac7471b0166249b",
+        "010000007824bc3a8a1b4628485eee3024abd8626721f7f870f8ad4d2f33a27155167f6a4009d1285049603888fe85a84b6c803a53305a8d497965a5e896e1a00568359589faf551eac7471b0065434e",
+        "0200000050bfd4e4a307a8cb6ef4aef69abc5c0f2d579648bd80d7733e1ccc3fbc90ed664a7f74006cb11bde87785f229ecd366c2d4e44432832580e0608c579e4cb76f383f7f551eac7471b00c36982",
+    };
+    std::vector<CBlockHeader> headers;
+    for (const char* hex : headershex) {
+        CDataStream stream(ParseHex(hex), SER_NETWORK, PROTOCOL_VERSION);
+        CPureBlockHeader header;
+        stream >> header;
+        headers.push_back(CBlockHeader());
+        *(CPureBlockHeader*)&headers.back() = header;
+    }
+    // Pad to more than one batch, with every fourth header invalid
+    while (headers.size() < 40) {
+        headers.push_back(headers[headers.size() % 5]);
+        if (headers.size() % 4 == 0)
+            headers.back().nNonce ^= 1;
+    }
+
+    std::vector<char> vfValid;
+    CheckBlockHeadersPoW(headers, 0, vfValid);
+    BOOST_CHECK_EQUAL(vfValid.size(), headers.size());
+    for (size_t i = 0; i < headers.size(); i++) {
+        BOOST_CHECK_EQUAL(vfValid[i], i < 5 || (i + 1) % 4 != 0);
+    }
+
+    // Headers before nStart are skipped and reported as unchecked
+    CheckBlockHeadersPoW(headers, 20, vfValid);
+    for (size_t i = 0; i < headers.size(); i++) {
+        BOOST_CHECK_EQUAL(vfValid[i], i >= 20 && (i + 1) % 4 != 0);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -1,11 +1,13 @@
 #include <boost/test/unit_test.hpp>
 
 #include "crypto/scrypt.h"
+#include "test/test_bitcoin.h"
+#include "test/test_random.h"
 #include "uint256.h"
 #include "util.h"
 #include "utilstrencodings.h"
 
-BOOST_AUTO_TEST_SUITE(scrypt_tests)
+BOOST_FIXTURE_TEST_SUITE(scrypt_tests, BasicTestingSetup)
 
 BOOST_AUTO_TEST_CASE(scrypt_hashtest)
 {
@@ -32,4 +34,29 @@ BOOST_AUTO_TEST_CASE(scrypt_hashtest)
     }
 }
 
+BOOST_AUTO_TEST_CASE(scrypt_multi)
+{
+    // Every batch size up to two of the widest kernel, so that each kernel
+    // and the single-lane remainder get exercised.
+    static const int impls[] = {SCRYPT_STANDARD, SCRYPT_SSE41, SCRYPT_AVX2, SCRYPT_AVX512, SCRYPT_ALL};
+    for (int impl : impls) {
+        BOOST_TEST_MESSAGE("Using the '" << scrypt_detect_multi(impl) << "' multi-lane scrypt implementation");
+        for (size_t n = 1; n <= 33; n += (impl == SCRYPT_ALL ? 1 : 7)) {
+            std::vector<std::vector<char> > in(n, std::vector<char>(80));
+            std::vector<uint256> out1(n), out2(n);
+            std::vector<const char*> inputs(n);
+            std::vector<char*> outputs(n);
+            for (size_t i = 0; i < n; i++) {
+                for (char& c : in[i]) c = insecure_rand();
+                scrypt_1024_1_1_256(in[i].data(), BEGIN(out1[i]));
+                inputs[i] = in[i].data();
+                outputs[i] = BEGIN(out2[i]);
+            }
+            scrypt_1024_1_1_256_multi(inputs.data(), outputs.data(), n);
+            BOOST_CHECK(out1 == out2);
+        }
+    }
+    scrypt_detect_multi();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -17,6 +17,7 @@
 #include "version.h"
 
 #include <iostream>
+#include <thread>
 
 #include <boost/test/unit_test.hpp>
 
@@ -166,6 +167,48 @@ BOOST_AUTO_TEST_CASE(sighash_test)
     #endif
 }
 
+// Goal: check that witness v0 signature hashes taken through a lazily filled
+// PrecomputedTransactionData match the uncached ones, also when several
+// threads race to fill it.
+BOOST_AUTO_TEST_CASE(sighash_precomputed)
+{
+    seed_insecure_rand(false);
+
+    for (int i=0; i<100; i++) {
+        int nHashType = insecure_rand();
+        CMutableTransaction txMut;
+        RandomTransaction(txMut, (nHashType & 0x1f) == SIGHASH_SINGLE);
+        const CTransaction txTo(txMut);
+        CScript scriptCode;
+        RandomScript(scriptCode);
+        const CAmount amount = insecure_rand();
+
+        std::vector<uint256> vExpected;
+        for (unsigned int nIn = 0; nIn < txTo.vin.size(); nIn++)
+            vExpected.push_back(SignatureHash(scriptCode, txTo, nIn, nHashType, amount, SIGVERSION_WITNESS_V0));
+
+        PrecomputedTransactionData txdata(txTo);
+        std::vector<std::vector<uint256> > vResults(4);
+        std::vector<std::thread> vThreads;
+        for (std::vector<uint256>& vResult : vResults) {
+            vThreads.emplace_back([&] {
+                for (unsigned int nIn = 0; nIn < txTo.vin.size(); nIn++)
+                    vResult.push_back(SignatureHash(scriptCode, txTo, nIn, nHashType, amount, SIGVERSION_WITNESS_V0, CHAINSIG_VERSION_LATEST, &txdata));
+            });
+        }
+        for (std::thread& thread : vThreads)
+            thread.join();
+        for (const std::vector<uint256>& vResult : vResults)
+            BOOST_CHECK(vResult == vExpected);
+
+        // Copies carry over the computed hashes
+        PrecomputedTransactionData txdataCopy(txdata);
+        BOOST_CHECK(txdataCopy.GetHashPrevouts() == txdata.GetHashPrevouts());
+        BOOST_CHECK(txdataCopy.GetHashSequence() == txdata.GetHashSequence());
+        BOOST_CHECK(txdataCopy.GetHashOutputs() == txdata.GetHashOutputs());
+    }
+}
+
 // Goal: check that SignatureHash generates correct hash
 BOOST_AUTO_TEST_CASE(sighash_from_data)
 {
@@ -72,6 +72,34 @@ BOOST_AUTO_TEST_CASE(streams_vector_writer)
     vch.clear();
 }
 
+BOOST_AUTO_TEST_CASE(streams_span_reader)
+{
+    std::vector<unsigned char> vch = {1, 255, 3, 4, 5, 6};
+
+    CSpanReader reader(SER_NETWORK, INIT_PROTO_VERSION, vch.data(), vch.data() + vch.size());
+    BOOST_CHECK_EQUAL(reader.size(), 6U);
+    unsigned char a, b;
+    reader >> a >> b;
+    BOOST_CHECK_EQUAL(a, 1);
+    BOOST_CHECK_EQUAL(b, 255);
+    BOOST_CHECK_EQUAL(reader.size(), 4U);
+
+    uint16_t c;
+    reader >> c;
+    BOOST_CHECK_EQUAL(c, 0x0403);
+    reader.ignore(1);
+    BOOST_CHECK_EQUAL(reader.size(), 1U);
+    BOOST_CHECK(reader.data() == vch.data() + 5);
+
+    // Reads past the end throw and consume nothing
+    uint32_t d;
+    BOOST_CHECK_THROW(reader >> d, std::ios_base::failure);
+    BOOST_CHECK_THROW(reader.ignore(2), std::ios_base::failure);
+    reader >> a;
+    BOOST_CHECK_EQUAL(a, 6);
+    BOOST_CHECK(reader.empty());
+}
+
 BOOST_AUTO_TEST_CASE(streams_serializedata_xor)
 {
     std::vector<char> in;
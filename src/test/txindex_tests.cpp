@@ -0,0 +1,94 @@
+// Copyright (c) 2017-2018 The Bitcoin Core developers
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chain.h"
+#include "chainparams.h"
+#include "random.h"
+#include "txdb.h"
+#include "txindex.h"
+#include "utiltime.h"
+#include "validation.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(txindex_tests, TestingSetup)
+
+static void WaitForSync(TxIndex& txindex)
+{
+    for (int i = 0; i < 500 && !txindex.IsSynced(); i++)
+        MilliSleep(10);
+}
+
+BOOST_AUTO_TEST_CASE(txindex_initial_sync)
+{
+    TxIndex txindex(1 << 20, true);
+
+    CBlock block;
+    const CBlockIndex* pindexGenesis = chainActive.Genesis();
+    BOOST_REQUIRE(ReadBlockFromDisk(block, pindexGenesis, Params().GetConsensus(0)));
+    const uint256& txid = block.vtx[0]->GetHash();
+
+    // Nothing is found before the index caught up
+    CTransactionRef tx;
+    uint256 hashBlock;
+    BOOST_CHECK(!txindex.FindTx(txid, hashBlock, tx));
+    BOOST_CHECK(!txindex.IsSynced());
+
+    boost::thread_group indexThreads;
+    BOOST_REQUIRE(txindex.Start(indexThreads));
+    WaitForSync(txindex);
+    BOOST_CHECK(txindex.IsSynced());
+    BOOST_CHECK(txindex.BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK(txindex.GetBestBlockIndex() == pindexGenesis);
+
+    BOOST_REQUIRE(txindex.FindTx(txid, hashBlock, tx));
+    BOOST_CHECK(tx->GetHash() == txid);
+    BOOST_CHECK(hashBlock == pindexGenesis->GetBlockHash());
+    BOOST_CHECK(!txindex.FindTx(GetRandHash(), hashBlock, tx));
+
+    indexThreads.interrupt_all();
+    indexThreads.join_all();
+    txindex.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(txindex_migrate_legacy)
+{
+    CBlock block;
+    const CBlockIndex* pindexGenesis = chainActive.Genesis();
+    BOOST_REQUIRE(ReadBlockFromDisk(block, pindexGenesis, Params().GetConsensus(0)));
+    const uint256& txid = block.vtx[0]->GetHash();
+
+    // An entry of the index as older versions kept it in the block tree
+    // database
+    const std::pair<char, uint256> key('t', txid);
+    BOOST_REQUIRE(pblocktree->Write(key, CDiskTxPos(pindexGenesis->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()))));
+    BOOST_REQUIRE(pblocktree->WriteFlag("txindex", true));
+
+    TxIndex txindex(1 << 20, true);
+    boost::thread_group indexThreads;
+    BOOST_REQUIRE(txindex.Start(indexThreads));
+    WaitForSync(txindex);
+    BOOST_CHECK(txindex.IsSynced());
+
+    // The entry was moved and the legacy index is forgotten
+    bool fLegacy = true;
+    BOOST_CHECK(pblocktree->ReadFlag("txindex", fLegacy));
+    BOOST_CHECK(!fLegacy);
+    BOOST_CHECK(!pblocktree->Exists(key));
+
+    CTransactionRef tx;
+    uint256 hashBlock;
+    BOOST_REQUIRE(txindex.FindTx(txid, hashBlock, tx));
+    BOOST_CHECK(hashBlock == pindexGenesis->GetBlockHash());
+
+    indexThreads.interrupt_all();
+    indexThreads.join_all();
+    txindex.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,105 @@
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "coinstats.h"
+#include "random.h"
+#include "txdb.h"
+#include "validation.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(utxosnapshot_tests, TestingSetup)
+
+static void FlipLastByte(const boost::filesystem::path& path)
+{
+    FILE* file = fopen(path.string().c_str(), "r+b");
+    BOOST_REQUIRE(file);
+    fseek(file, -1, SEEK_END);
+    int ch = fgetc(file);
+    fseek(file, -1, SEEK_END);
+    fputc(ch ^ 1, file);
+    fclose(file);
+}
+
+BOOST_AUTO_TEST_CASE(utxosnapshot_roundtrip)
+{
+    // Mining blocks on regtest is too slow here, so fill the UTXO set of the
+    // genesis block with made up coins instead.
+    {
+        LOCK(cs_main);
+        for (int i = 0; i < 500; i++) {
+            uint256 txid = GetRandHash();
+            for (uint32_t n = 0; n < 1 + (uint32_t)(i % 4); n++) {
+                CTxOut out(1000 * (i + 1) + n, CScript() << OP_TRUE << i);
+                pcoinsTip->AddCoin(COutPoint(txid, n), Coin(out, i % 7, i % 5 == 0), false);
+            }
+        }
+    }
+    FlushStateToDisk();
+    CCoinsStats stats;
+    BOOST_CHECK(GetUTXOStats(pcoinsdbview, stats));
+    BOOST_CHECK_EQUAL(stats.nTransactions, 500U);
+
+    boost::filesystem::path path = pathTemp / "utxo.dat";
+    CUTXOSnapshotMetadata metadata;
+    std::string strError;
+    BOOST_CHECK(DumpUTXOSnapshot(path, metadata, strError));
+    BOOST_CHECK(!boost::filesystem::exists(path.string() + ".incomplete"));
+
+    // The snapshot commits to what gettxoutsetinfo reports
+    BOOST_CHECK(metadata.hashBlock == chainActive.Tip()->GetBlockHash());
+    BOOST_CHECK_EQUAL(metadata.nHeight, chainActive.Height());
+    BOOST_CHECK_EQUAL(metadata.nChainTx, chainActive.Tip()->nChainTx);
+    BOOST_CHECK_EQUAL(metadata.nCoins, stats.nTransactionOutputs);
+    BOOST_CHECK(metadata.hashSerialized == stats.hashSerialized);
+
+    // A snapshot that doesn't commit to the expected hash is rejected
+    CUTXOSnapshotMetadata loaded;
+    BOOST_CHECK(!LoadUTXOSnapshot(path, uint256S("0x01"), loaded, strError));
+    BOOST_CHECK(!pcoinsdbview->IsSnapshotLoadIncomplete());
+
+    // Wipe the UTXO set, then load the snapshot back into it
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(pcoinsdbview->BeginSnapshotLoad(metadata.hashBlock));
+        BOOST_CHECK(pcoinsdbview->FinishSnapshotLoad(metadata.hashBlock, metadata.nChainTx));
+    }
+    CCoinsStats statsEmpty;
+    BOOST_CHECK(GetUTXOStats(pcoinsdbview, statsEmpty));
+    BOOST_CHECK_EQUAL(statsEmpty.nTransactionOutputs, 0U);
+
+    BOOST_CHECK(LoadUTXOSnapshot(path, stats.hashSerialized, loaded, strError));
+    BOOST_CHECK_EQUAL(loaded.nCoins, metadata.nCoins);
+    BOOST_CHECK(chainActive.Tip()->GetBlockHash() == metadata.hashBlock);
+    uint256 hashBase;
+    uint64_t nChainTx = 0;
+    BOOST_CHECK(pcoinsdbview->ReadSnapshotBase(hashBase, nChainTx));
+    BOOST_CHECK(hashBase == metadata.hashBlock);
+    BOOST_CHECK_EQUAL(nChainTx, metadata.nChainTx);
+    CCoinsStats statsLoaded;
+    BOOST_CHECK(GetUTXOStats(pcoinsdbview, statsLoaded));
+    BOOST_CHECK(statsLoaded.hashSerialized == stats.hashSerialized);
+    BOOST_CHECK_EQUAL(statsLoaded.nSerializedSize, stats.nSerializedSize);
+
+    // A corrupted snapshot is detected before the chainstate is touched
+    FlipLastByte(path);
+    BOOST_CHECK(!LoadUTXOSnapshot(path, uint256(), loaded, strError));
+    BOOST_CHECK(!pcoinsdbview->IsSnapshotLoadIncomplete());
+    CCoinsStats statsCorrupt;
+    BOOST_CHECK(GetUTXOStats(pcoinsdbview, statsCorrupt));
+    BOOST_CHECK(statsCorrupt.hashSerialized == stats.hashSerialized);
+
+    // Other files are not taken for snapshots
+    boost::filesystem::path pathBad = pathTemp / "bad.dat";
+    FILE* file = fopen(pathBad.string().c_str(), "wb");
+    BOOST_REQUIRE(file);
+    fputs("not a snapshot", file);
+    fclose(file);
+    BOOST_CHECK(!LoadUTXOSnapshot(pathBad, uint256(), loaded, strError));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -5,15 +5,20 @@
 
 #include "txdb.h"
 
+#include "auxpow.h"
 #include "chainparams.h"
 #include "hash.h"
+#include "init.h"
 #include "pow.h"
+#include "ui_interface.h"
 #include "uint256.h"
+#include "util.h"
 
 #include <stdint.h>
 
 #include <boost/thread.hpp>
 
+static const char DB_COIN = 'C';
 static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
@@ -23,18 +28,56 @@ static const char DB_BEST_BLOCK = 'B';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_AUXPOW = 'a';
+static const char DB_SNAPSHOT_BASE = 'S';
+static const char DB_SNAPSHOT_LOADING = 'L';
+static const char DB_ROLLING_STATS = 'U';
+static const char DB_ADDRESSINDEX = 'A';
+static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_ADDRESSINDEX_BEST = 'x';
+
+//! Size of the batches in which coins are erased or written by a snapshot load
+static const size_t SNAPSHOT_BATCH_SIZE = 1 << 24;
+//! Size of the batches in which a stale address index is erased
+static const size_t ADDRESS_INDEX_ERASE_BATCH_SIZE = 1 << 24;
+//! Size of the batches in which the transaction index is moved to its own database
+static const size_t TXINDEX_MIGRATE_BATCH_SIZE = 1 << 24;
+
+
+namespace {
+
+struct CoinEntry {
+    COutPoint* outpoint;
+    char key;
+    CoinEntry(const COutPoint* ptr) : outpoint(const_cast<COutPoint*>(ptr)), key(DB_COIN)  {}
+
+    template<typename Stream>
+    void Serialize(Stream &s) const {
+        s << key;
+        s << outpoint->hash;
+        s << VARINT(outpoint->n);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        s >> key;
+        s >> outpoint->hash;
+        s >> VARINT(outpoint->n);
+    }
+};
 
+}
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true) 
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe, DBProfile profile) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true, profile), fRollingStats(false)
 {
 }
 
-bool CCoinsViewDB::GetCoins(const uint256 &txid, CCoins &coins) const {
-    return db.Read(std::make_pair(DB_COINS, txid), coins);
+bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const {
+    return db.Read(CoinEntry(&outpoint), coin);
 }
 
-bool CCoinsViewDB::HaveCoins(const uint256 &txid) const {
-    return db.Exists(std::make_pair(DB_COINS, txid));
+bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
+    return db.Exists(CoinEntry(&outpoint));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
@@ -50,24 +93,109 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     size_t changed = 0;
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
-            if (it->second.coins.IsPruned())
-                batch.Erase(std::make_pair(DB_COINS, it->first));
+            CoinEntry entry(&it->first);
+            if (it->second.coin.IsSpent())
+                batch.Erase(entry);
             else
-                batch.Write(std::make_pair(DB_COINS, it->first), it->second.coins);
+                batch.Write(entry, it->second.coin);
             changed++;
         }
         count++;
         CCoinsMap::iterator itOld = it++;
         mapCoins.erase(itOld);
     }
-    if (!hashBlock.IsNull())
+    if (!hashBlock.IsNull()) {
         batch.Write(DB_BEST_BLOCK, hashBlock);
+        if (fRollingStats && rollingStats.hashBlock == hashBlock)
+            batch.Write(DB_ROLLING_STATS, rollingStats);
+        else
+            batch.Erase(DB_ROLLING_STATS);
+    }
 
-    LogPrint("coindb", "Committing %u changed transactions (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
+    LogPrint("coindb", "Committing %u changed outputs (out of %u) to coin database, %u bytes...\n", (unsigned int)changed, (unsigned int)count, (unsigned int)batch.SizeEstimate());
     return db.WriteBatch(batch);
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
+bool CCoinsViewDB::BeginSnapshotLoad(const uint256 &hashBlock) {
+    CDBBatch batch(db);
+    batch.Write(DB_SNAPSHOT_LOADING, hashBlock);
+    batch.Erase(DB_BEST_BLOCK);
+    batch.Erase(DB_SNAPSHOT_BASE);
+    batch.Erase(DB_ROLLING_STATS);
+    if (!db.WriteBatch(batch, true))
+        return false;
+
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek(DB_COIN);
+    batch.Clear();
+    size_t count = 0;
+    COutPoint outpoint;
+    CoinEntry entry(&outpoint);
+    while (pcursor->Valid() && pcursor->GetKey(entry) && entry.key == DB_COIN) {
+        batch.Erase(entry);
+        count++;
+        if (batch.SizeEstimate() > SNAPSHOT_BATCH_SIZE) {
+            if (!db.WriteBatch(batch))
+                return false;
+            batch.Clear();
+        }
+        pcursor->Next();
+    }
+    LogPrint("coindb", "Erasing %u outputs from coin database before loading a snapshot\n", (unsigned int)count);
+    return db.WriteBatch(batch);
+}
+
+bool CCoinsViewDB::WriteSnapshotCoins(const std::vector<std::pair<COutPoint, Coin> > &coins) {
+    CDBBatch batch(db);
+    for (const auto& coin : coins) {
+        batch.Write(CoinEntry(&coin.first), coin.second);
+        if (batch.SizeEstimate() > SNAPSHOT_BATCH_SIZE) {
+            if (!db.WriteBatch(batch))
+                return false;
+            batch.Clear();
+        }
+    }
+    return db.WriteBatch(batch);
+}
+
+bool CCoinsViewDB::FinishSnapshotLoad(const uint256 &hashBlock, uint64_t nChainTx) {
+    CDBBatch batch(db);
+    batch.Write(DB_BEST_BLOCK, hashBlock);
+    batch.Write(DB_SNAPSHOT_BASE, std::make_pair(hashBlock, nChainTx));
+    batch.Erase(DB_SNAPSHOT_LOADING);
+    return db.WriteBatch(batch, true);
+}
+
+bool CCoinsViewDB::IsSnapshotLoadIncomplete() const {
+    return db.Exists(DB_SNAPSHOT_LOADING);
+}
+
+bool CCoinsViewDB::ReadSnapshotBase(uint256 &hashBlock, uint64_t &nChainTx) const {
+    std::pair<uint256, uint64_t> base;
+    if (!db.Read(DB_SNAPSHOT_BASE, base))
+        return false;
+    hashBlock = base.first;
+    nChainTx = base.second;
+    return true;
+}
+
+void CCoinsViewDB::SetRollingStats(const CCoinsRollingStats* pstats) {
+    fRollingStats = pstats != NULL;
+    if (pstats)
+        rollingStats = *pstats;
+}
+
+bool CCoinsViewDB::ReadRollingStats(CCoinsRollingStats &stats) const {
+    uint256 hashBestBlock = GetBestBlock();
+    if (hashBestBlock.IsNull()) {
+        // A new database holds the empty set
+        stats = CCoinsRollingStats();
+        return true;
+    }
+    return db.Read(DB_ROLLING_STATS, stats) && stats.hashBlock == hashBestBlock;
+}
+
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, false, DBProfile::BLOCK_INDEX) {
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -96,29 +224,31 @@ CCoinsViewCursor *CCoinsViewDB::Cursor() const
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
        that restriction.  */
-    i->pcursor->Seek(DB_COINS);
+    i->pcursor->Seek(DB_COIN);
     // Cache key of first record
     if (i->pcursor->Valid()) {
-        i->pcursor->GetKey(i->keyTmp);
+        CoinEntry entry(&i->keyTmp.second);
+        i->pcursor->GetKey(entry);
+        i->keyTmp.first = entry.key;
     } else {
         i->keyTmp.first = 0; // Make sure Valid() and GetKey() return false
     }
     return i;
 }
 
-bool CCoinsViewDBCursor::GetKey(uint256 &key) const
+bool CCoinsViewDBCursor::GetKey(COutPoint &key) const
 {
     // Return cached key
-    if (keyTmp.first == DB_COINS) {
+    if (keyTmp.first == DB_COIN) {
         key = keyTmp.second;
         return true;
     }
     return false;
 }
 
-bool CCoinsViewDBCursor::GetValue(CCoins &coins) const
+bool CCoinsViewDBCursor::GetValue(Coin &coin) const
 {
-    return pcursor->GetValue(coins);
+    return pcursor->GetValue(coin);
 }
 
 unsigned int CCoinsViewDBCursor::GetValueSize() const
@@ -128,14 +258,18 @@ unsigned int CCoinsViewDBCursor::GetValueSize() const
 
 bool CCoinsViewDBCursor::Valid() const
 {
-    return keyTmp.first == DB_COINS;
+    return keyTmp.first == DB_COIN;
 }
 
 void CCoinsViewDBCursor::Next()
 {
     pcursor->Next();
-    if (!pcursor->Valid() || !pcursor->GetKey(keyTmp))
+    CoinEntry entry(&keyTmp.second);
+    if (!pcursor->Valid() || !pcursor->GetKey(entry)) {
         keyTmp.first = 0; // Invalidate cached key after last record so that Valid() and GetKey() return false
+    } else {
+        keyTmp.first = entry.key;
+    }
 }
 
 bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo) {
@@ -150,14 +284,142 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     return WriteBatch(batch, true);
 }
 
-bool CBlockTreeDB::ReadTxIndex(const uint256 &txid, CDiskTxPos &pos) {
-    return Read(std::make_pair(DB_TXINDEX, txid), pos);
+bool CBlockTreeDB::MigrateTxIndex(CDBWrapper &db) {
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(DB_TXINDEX);
+
+    // Entries are written to the new database before they are erased here,
+    // so an interrupted migration loses nothing and is picked up again
+    CDBBatch batchTo(db);
+    CDBBatch batchFrom(*this);
+    std::pair<char, uint256> key;
+    CDiskTxPos pos;
+    uint64_t nMoved = 0;
+    int64_t nLastLog = GetTime();
+    while (true) {
+        bool fEnd = !pcursor->Valid() || !pcursor->GetKey(key) || key.first != DB_TXINDEX;
+        if (!fEnd) {
+            if (!pcursor->GetValue(pos))
+                return error("%s: failed to read transaction index entry", __func__);
+            batchTo.Write(key, pos);
+            batchFrom.Erase(key);
+            nMoved++;
+            pcursor->Next();
+        }
+        if (fEnd || batchTo.SizeEstimate() > TXINDEX_MIGRATE_BATCH_SIZE) {
+            if (!db.WriteBatch(batchTo, true) || !WriteBatch(batchFrom))
+                return error("%s: failed to move transaction index entries", __func__);
+            batchTo.Clear();
+            batchFrom.Clear();
+            if (GetTime() - nLastLog >= 10) {
+                LogPrintf("Moved %u transaction index entries\n", nMoved);
+                nLastLog = GetTime();
+            }
+        }
+        if (fEnd)
+            break;
+        if (ShutdownRequested())
+            return error("%s: interrupted", __func__);
+    }
+    LogPrintf("Moved %u transaction index entries\n", nMoved);
+    return true;
+}
+
+bool CBlockTreeDB::ReadAddressIndexBestBlock(uint256 &hashBlock) {
+    return Read(DB_ADDRESSINDEX_BEST, hashBlock);
+}
+
+bool CBlockTreeDB::WriteAddressIndex(const CAddressIndexBatch &batch) {
+    CDBBatch dbbatch(*this);
+    for (std::set<CAddressIndexKey>::const_iterator it = batch.setHistoryErased.begin(); it != batch.setHistoryErased.end(); it++)
+        dbbatch.Erase(std::make_pair(DB_ADDRESSINDEX, *it));
+    for (std::map<CAddressIndexKey, CAmount>::const_iterator it = batch.mapHistory.begin(); it != batch.mapHistory.end(); it++)
+        dbbatch.Write(std::make_pair(DB_ADDRESSINDEX, it->first), it->second);
+    for (std::set<CAddressUnspentKey>::const_iterator it = batch.setUnspentErased.begin(); it != batch.setUnspentErased.end(); it++)
+        dbbatch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, *it));
+    for (std::map<CAddressUnspentKey, CAddressUnspentValue>::const_iterator it = batch.mapUnspent.begin(); it != batch.mapUnspent.end(); it++)
+        dbbatch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
+    dbbatch.Write(DB_ADDRESSINDEX_BEST, batch.hashBlock);
+    return WriteBatch(dbbatch);
+}
+
+namespace {
+
+/** Erase all entries of the block tree database of the given type, in batches */
+template<typename K>
+bool EraseAll(CDBWrapper &db, char prefix)
+{
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek(prefix);
+    CDBBatch batch(db);
+    std::pair<char, K> key;
+    while (pcursor->Valid() && pcursor->GetKey(key) && key.first == prefix) {
+        boost::this_thread::interruption_point();
+        batch.Erase(key);
+        if (batch.SizeEstimate() > ADDRESS_INDEX_ERASE_BATCH_SIZE) {
+            if (!db.WriteBatch(batch))
+                return false;
+            batch.Clear();
+        }
+        pcursor->Next();
+    }
+    return db.WriteBatch(batch);
+}
+
+} // anon namespace
+
+bool CBlockTreeDB::EraseAddressIndex() {
+    // Forget where the index was first, so that it is rebuilt if erasing is interrupted
+    if (!Erase(DB_ADDRESSINDEX_BEST, true))
+        return false;
+    return EraseAll<CAddressIndexKey>(*this, DB_ADDRESSINDEX) &&
+           EraseAll<CAddressUnspentKey>(*this, DB_ADDRESSUNSPENTINDEX);
+}
+
+bool CBlockTreeDB::ReadAddressIndex(const uint160 &hashScript, int nStartHeight, int nEndHeight, std::vector<std::pair<CAddressIndexKey, CAmount> > &vHistory) {
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexKey(hashScript, nStartHeight, uint256(), 0, false)));
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CAddressIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX || key.second.hashScript != hashScript)
+            break;
+        if (nEndHeight >= 0 && key.second.nHeight > nEndHeight)
+            break;
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue))
+            return error("%s: failed to read address index value", __func__);
+        vHistory.push_back(std::make_pair(key.second, nValue));
+        pcursor->Next();
+    }
+    return true;
+}
+
+bool CBlockTreeDB::ReadAddressUnspentIndex(const uint160 &hashScript, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vUnspent) {
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressUnspentKey(hashScript, uint256(), 0)));
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CAddressUnspentKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSUNSPENTINDEX || key.second.hashScript != hashScript)
+            break;
+        CAddressUnspentValue value;
+        if (!pcursor->GetValue(value))
+            return error("%s: failed to read address unspent index value", __func__);
+        vUnspent.push_back(std::make_pair(key.second, value));
+        pcursor->Next();
+    }
+    return true;
+}
+
+bool CBlockTreeDB::ReadAuxPow(const uint256 &hash, CAuxPow &auxpow) {
+    return Read(std::make_pair(DB_AUXPOW, hash), auxpow);
 }
 
-bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> >&vect) {
+bool CBlockTreeDB::WriteAuxPow(const std::vector<std::pair<uint256, const CAuxPow*> >&vect) {
     CDBBatch batch(*this);
-    for (std::vector<std::pair<uint256,CDiskTxPos> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Write(std::make_pair(DB_TXINDEX, it->first), it->second);
+    for (std::vector<std::pair<uint256, const CAuxPow*> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+        batch.Write(std::make_pair(DB_AUXPOW, it->first), *it->second);
     return WriteBatch(batch);
 }
 
@@ -217,3 +479,128 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
 
     return true;
 }
+
+namespace {
+
+//! Legacy class to deserialize pre-pertxout database entries without reindex.
+class CCoins
+{
+public:
+    //! whether transaction is a coinbase
+    bool fCoinBase;
+
+    //! unspent transaction outputs; spent outputs are .IsNull(); spent outputs at the end of the array are dropped
+    std::vector<CTxOut> vout;
+
+    //! at which height this transaction was included in the active block chain
+    int nHeight;
+
+    //! empty constructor
+    CCoins() : fCoinBase(false), vout(0), nHeight(0) { }
+
+    template<typename Stream>
+    void Unserialize(Stream &s) {
+        unsigned int nCode = 0;
+        // version
+        int nVersionDummy;
+        ::Unserialize(s, VARINT(nVersionDummy));
+        // header code
+        ::Unserialize(s, VARINT(nCode));
+        fCoinBase = nCode & 1;
+        std::vector<bool> vAvail(2, false);
+        vAvail[0] = (nCode & 2) != 0;
+        vAvail[1] = (nCode & 4) != 0;
+        unsigned int nMaskCode = (nCode / 8) + ((nCode & 6) != 0 ? 0 : 1);
+        // spentness bitmask
+        while (nMaskCode > 0) {
+            unsigned char chAvail = 0;
+            ::Unserialize(s, chAvail);
+            for (unsigned int p = 0; p < 8; p++) {
+                bool f = (chAvail & (1 << p)) != 0;
+                vAvail.push_back(f);
+            }
+            if (chAvail != 0)
+                nMaskCode--;
+        }
+        // txouts themself
+        vout.assign(vAvail.size(), CTxOut());
+        for (unsigned int i = 0; i < vAvail.size(); i++) {
+            if (vAvail[i])
+                ::Unserialize(s, REF(CTxOutCompressor(vout[i])));
+        }
+        // coinbase height
+        ::Unserialize(s, VARINT(nHeight));
+    }
+};
+
+}
+
+/** Upgrade the database from older formats.
+ *
+ * Currently implemented: from the per-tx utxo model (0.8..1.14.x) to per-txout.
+ * Every batch writes the new records and erases the old ones atomically, so an
+ * interrupted upgrade simply continues with the remaining records on the next
+ * start.
+ */
+bool CCoinsViewDB::Upgrade() {
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek(std::make_pair(DB_COINS, uint256()));
+    if (!pcursor->Valid()) {
+        return true;
+    }
+
+    int64_t count = 0;
+    LogPrintf("Upgrading utxo-set database...\n");
+    LogPrintf("[0%%]...");
+    size_t batch_size = 1 << 24;
+    CDBBatch batch(db);
+    int reportDone = 0;
+    std::pair<unsigned char, uint256> key;
+    std::pair<unsigned char, uint256> prev_key = std::make_pair(DB_COINS, uint256());
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        if (ShutdownRequested()) {
+            break;
+        }
+        if (pcursor->GetKey(key) && key.first == DB_COINS) {
+            if (count++ % 256 == 0) {
+                uint32_t high = 0x100 * *key.second.begin() + *(key.second.begin() + 1);
+                int percentageDone = (int)(high * 100.0 / 65536.0 + 0.5);
+                uiInterface.ShowProgress(_("Upgrading UTXO database"), percentageDone);
+                if (reportDone < percentageDone/10) {
+                    // report max. every 10% step
+                    LogPrintf("[%d%%]...", percentageDone);
+                    reportDone = percentageDone/10;
+                }
+            }
+            CCoins old_coins;
+            if (!pcursor->GetValue(old_coins)) {
+                return error("%s: cannot parse CCoins record", __func__);
+            }
+            COutPoint outpoint(key.second, 0);
+            for (size_t i = 0; i < old_coins.vout.size(); ++i) {
+                if (!old_coins.vout[i].IsNull() && !old_coins.vout[i].scriptPubKey.IsUnspendable()) {
+                    Coin newcoin(std::move(old_coins.vout[i]), old_coins.nHeight, old_coins.fCoinBase);
+                    outpoint.n = i;
+                    CoinEntry entry(&outpoint);
+                    batch.Write(entry, newcoin);
+                }
+            }
+            batch.Erase(key);
+            if (batch.SizeEstimate() > batch_size) {
+                db.WriteBatch(batch);
+                batch.Clear();
+                db.CompactRange(prev_key, key);
+                prev_key = key;
+            }
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+    db.WriteBatch(batch);
+    db.CompactRange(std::make_pair((unsigned char)DB_COINS, uint256()), key);
+    uiInterface.ShowProgress("", 100);
+    LogPrintf("[%s].\n", ShutdownRequested() ? "CANCELLED" : "DONE");
+    return !ShutdownRequested();
+}
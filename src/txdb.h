@@ -6,7 +6,9 @@
 #ifndef BITCOIN_TXDB_H
 #define BITCOIN_TXDB_H
 
+#include "addressindex.h"
 #include "coins.h"
+#include "coinstats.h"
 #include "dbwrapper.h"
 #include "chain.h"
 
@@ -17,6 +19,7 @@
 
 #include <boost/function.hpp>
 
+class CAuxPow;
 class CBlockIndex;
 class CCoinsViewDBCursor;
 class uint256;
@@ -72,14 +75,40 @@ class CCoinsViewDB : public CCoinsView
 {
 protected:
     CDBWrapper db;
+    //! Rolling statistics to store along with the next best block they belong to
+    bool fRollingStats;
+    CCoinsRollingStats rollingStats;
 public:
-    CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, DBProfile profile = DBProfile::CHAINSTATE);
 
-    bool GetCoins(const uint256 &txid, CCoins &coins) const;
-    bool HaveCoins(const uint256 &txid) const;
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const;
+    bool HaveCoin(const COutPoint &outpoint) const;
     uint256 GetBestBlock() const;
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock);
     CCoinsViewCursor *Cursor() const;
+
+    //! Attempt to update from an older database format. Returns whether an error occurred.
+    bool Upgrade();
+
+    //! Erase all coins before the snapshot of hashBlock is written. Until
+    //! FinishSnapshotLoad() the database is marked as incomplete.
+    bool BeginSnapshotLoad(const uint256 &hashBlock);
+    //! Write coins of a snapshot, which come sorted by outpoint.
+    bool WriteSnapshotCoins(const std::vector<std::pair<COutPoint, Coin> > &coins);
+    //! Make hashBlock the best block once all coins of its snapshot were written.
+    bool FinishSnapshotLoad(const uint256 &hashBlock, uint64_t nChainTx);
+    //! Whether loading a snapshot was started but never finished.
+    bool IsSnapshotLoadIncomplete() const;
+    //! Read the block the coins were loaded from a snapshot of, and its chain transaction count.
+    bool ReadSnapshotBase(uint256 &hashBlock, uint64_t &nChainTx) const;
+
+    //! Set the rolling statistics that BatchWrite() stores if they are at its
+    //! best block, or stop storing them if pstats is NULL.
+    void SetRollingStats(const CCoinsRollingStats* pstats);
+    //! Read the stored rolling statistics. Fails unless they are at the best block.
+    bool ReadRollingStats(CCoinsRollingStats &stats) const;
+
+    const CDBWrapper& GetDB() const { return db; }
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
@@ -88,8 +117,8 @@ class CCoinsViewDBCursor: public CCoinsViewCursor
 public:
     ~CCoinsViewDBCursor() {}
 
-    bool GetKey(uint256 &key) const;
-    bool GetValue(CCoins &coins) const;
+    bool GetKey(COutPoint &key) const;
+    bool GetValue(Coin &coin) const;
     unsigned int GetValueSize() const;
 
     bool Valid() const;
@@ -99,7 +128,7 @@ private:
     CCoinsViewDBCursor(CDBIterator* pcursorIn, const uint256 &hashBlockIn):
         CCoinsViewCursor(hashBlockIn), pcursor(pcursorIn) {}
     std::unique_ptr<CDBIterator> pcursor;
-    std::pair<char, uint256> keyTmp;
+    std::pair<char, COutPoint> keyTmp;
 
     friend class CCoinsViewDB;
 };
@@ -118,8 +147,16 @@ public:
     bool ReadLastBlockFile(int &nFile);
     bool WriteReindexing(bool fReindex);
     bool ReadReindexing(bool &fReindex);
-    bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos);
-    bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &list);
+    //! Move the entries of the transaction index kept here by older versions to db, under the same keys
+    bool MigrateTxIndex(CDBWrapper &db);
+    bool ReadAddressIndexBestBlock(uint256 &hashBlock);
+    bool WriteAddressIndex(const CAddressIndexBatch &batch);
+    bool EraseAddressIndex();
+    //! Read the history of a script from nStartHeight up to nEndHeight, or the tip if nEndHeight is negative
+    bool ReadAddressIndex(const uint160 &hashScript, int nStartHeight, int nEndHeight, std::vector<std::pair<CAddressIndexKey, CAmount> > &vHistory);
+    bool ReadAddressUnspentIndex(const uint160 &hashScript, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vUnspent);
+    bool ReadAuxPow(const uint256 &hash, CAuxPow &auxpow);
+    bool WriteAuxPow(const std::vector<std::pair<uint256, const CAuxPow*> > &list);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
     bool LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex);
@@ -0,0 +1,95 @@
+// Copyright (c) 2017-2018 The Bitcoin Core developers
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txindex.h"
+
+#include "chain.h"
+#include "clientversion.h"
+#include "streams.h"
+#include "txdb.h"
+#include "util.h"
+#include "validation.h"
+
+#include <boost/filesystem.hpp>
+
+/* The database of the transaction index maps 't' + txid to the CDiskTxPos of
+ * the transaction, the same keys older versions used in the block tree
+ * database. */
+static const char DB_TXINDEX = 't';
+
+std::unique_ptr<TxIndex> g_txindex;
+
+TxIndex::TxIndex(size_t nCacheSize, bool fMemory, bool fWipe)
+{
+    boost::filesystem::create_directories(GetDataDir() / "indexes");
+    pdb.reset(new CBaseIndex::DB(GetDataDir() / "indexes" / "txindex", nCacheSize, fMemory, fWipe));
+}
+
+bool TxIndex::MigrateLegacyData()
+{
+    bool fLegacy = false;
+    if (!pblocktree->ReadFlag("txindex", fLegacy) || !fLegacy)
+        return true;
+
+    LogPrintf("Moving the transaction index to %s...\n", (GetDataDir() / "indexes" / "txindex").string());
+    if (!pblocktree->MigrateTxIndex(*pdb))
+        return false;
+
+    // The legacy index was written along with the chain state, so it is at
+    // the tip. Store that before forgetting about the legacy index, so that
+    // an interrupted migration is simply done again.
+    CBlockLocator locator;
+    {
+        LOCK(cs_main);
+        locator = chainActive.GetLocator();
+    }
+    CDBBatch batch(*pdb);
+    pdb->WriteBestBlock(batch, locator);
+    if (!pdb->WriteBatch(batch, true))
+        return false;
+    return pblocktree->WriteFlag("txindex", false);
+}
+
+bool TxIndex::Init()
+{
+    if (!MigrateLegacyData())
+        return error("%s: failed to move the transaction index out of the block tree database", __func__);
+    return CBaseIndex::Init();
+}
+
+bool TxIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
+    CDBBatch batch(*pdb);
+    for (const CTransactionRef& tx : block.vtx) {
+        batch.Write(std::make_pair(DB_TXINDEX, tx->GetHash()), pos);
+        pos.nTxOffset += ::GetSerializeSize(*tx, SER_DISK, CLIENT_VERSION);
+    }
+    return pdb->WriteBatch(batch);
+}
+
+bool TxIndex::FindTx(const uint256& txid, uint256& hashBlock, CTransactionRef& tx) const
+{
+    CDiskTxPos postx;
+    if (!pdb->Read(std::make_pair(DB_TXINDEX, txid), postx))
+        return false;
+
+    CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull())
+        return error("%s: OpenBlockFile failed", __func__);
+    CBlockHeader header;
+    try {
+        file >> header;
+        if (fseek(file.Get(), postx.nTxOffset, SEEK_CUR))
+            return error("%s: fseek(...) failed", __func__);
+        file >> tx;
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    }
+    if (tx->GetHash() != txid)
+        return error("%s: txid mismatch", __func__);
+    hashBlock = header.GetHash();
+    return true;
+}
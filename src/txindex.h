@@ -0,0 +1,58 @@
+// Copyright (c) 2017-2018 The Bitcoin Core developers
+// Copyright (c) 2022 The Dogecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_TXINDEX_H
+#define BITCOIN_TXINDEX_H
+
+#include "baseindex.h"
+#include "primitives/transaction.h"
+
+#include <memory>
+
+/** Max memory allocated to the transaction index database (MiB).
+ *  Unlike for the UTXO database, the leveldb cache makes a meaningful
+ *  difference for the transaction index. */
+static const int64_t nMaxTxIndexCache = 1024;
+
+/**
+ * TxIndex is used to look up transactions included in the blockchain by
+ * hash. The index is written to a LevelDB database of its own under
+ * indexes/txindex and records the filesystem location of each transaction
+ * by transaction hash. It follows the active chain on a thread of its own,
+ * so enabling it does not need a reindex.
+ */
+class TxIndex : public CBaseIndex
+{
+private:
+    std::unique_ptr<CBaseIndex::DB> pdb;
+
+    /** Move the entries of the index that older versions kept in the block
+     *  tree database over to the database of the index. */
+    bool MigrateLegacyData();
+
+protected:
+    bool Init() override;
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+    CBaseIndex::DB& GetDB() const override { return *pdb; }
+    const char* GetName() const override { return "txindex"; }
+
+public:
+    /** Constructs the index, which becomes available to be queried. */
+    TxIndex(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    /** Look up a transaction by hash.
+     *
+     * @param[in]   txid        The hash of the transaction to be returned.
+     * @param[out]  hashBlock   The hash of the block the transaction is found in.
+     * @param[out]  tx          The transaction itself.
+     * @return  true if transaction is found, false otherwise
+     */
+    bool FindTx(const uint256& txid, uint256& hashBlock, CTransactionRef& tx) const;
+};
+
+/** The global transaction index, used in GetTransaction. May be NULL. */
+extern std::unique_ptr<TxIndex> g_txindex;
+
+#endif // BITCOIN_TXINDEX_H
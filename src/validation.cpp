@@ -6,13 +6,19 @@
 
 #include "validation.h"
 
+#include "addressindex.h"
 #include "arith_uint256.h"
+#include "auxpowstore.h"
+#include "blockfilemap.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
+#include "coinstats.h"
 #include "consensus/consensus.h"
 #include "consensus/merkle.h"
 #include "consensus/validation.h"
+#include "crypto/common.h"
+#include "crypto/scrypt.h"
 #include "dogecoin.h"
 #include "dogecoin-fees.h"
 #include "hash.h"
@@ -30,6 +36,7 @@
 #include "timedata.h"
 #include "tinyformat.h"
 #include "txdb.h"
+#include "txindex.h"
 #include "txmempool.h"
 #include "ui_interface.h"
 #include "undo.h"
@@ -70,7 +77,7 @@ CConditionVariable cvBlockChange;
 int nScriptCheckThreads = 0;
 std::atomic_bool fImporting(false);
 bool fReindex = false;
-bool fTxIndex = false;
+bool fAddressIndex = false;
 bool fHavePruned = false;
 bool fPruneMode = false;
 bool fIsBareMultisigStd = DEFAULT_PERMIT_BAREMULTISIG;
@@ -128,6 +135,14 @@ namespace {
 
     CBlockIndex *pindexBestInvalid;
 
+    /** The block the UTXO set was loaded from a snapshot of, if any. The blocks
+     *  before it may never have been downloaded, let alone connected. */
+    CBlockIndex *pindexSnapshotBase = NULL;
+
+    /** Rolling statistics of the UTXO set at the best block of pcoinsTip, if they are known. */
+    CCoinsRollingStats rollingCoinsStats;
+    bool fHaveRollingCoinsStats = false;
+
     /**
      * The set of all CBlockIndex entries with BLOCK_VALID_TRANSACTIONS (for itself and all ancestors) and
      * as good as our current tip or better. Entries may be failed, though, and pruning nodes may be
@@ -243,6 +258,7 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 }
 
 CCoinsViewCache *pcoinsTip = NULL;
+CCoinsViewDB *pcoinsdbview = NULL;
 CBlockTreeDB *pblocktree = NULL;
 
 enum FlushStateMode {
@@ -431,15 +447,15 @@ bool CheckSequenceLocks(const CTransaction &tx, int flags, LockPoints* lp, bool
         prevheights.resize(tx.vin.size());
         for (size_t txinIndex = 0; txinIndex < tx.vin.size(); txinIndex++) {
             const CTxIn& txin = tx.vin[txinIndex];
-            CCoins coins;
-            if (!viewMemPool.GetCoins(txin.prevout.hash, coins)) {
+            Coin coin;
+            if (!viewMemPool.GetCoin(txin.prevout, coin)) {
                 return error("%s: Missing input", __func__);
             }
-            if (coins.nHeight == MEMPOOL_HEIGHT) {
+            if (coin.nHeight == MEMPOOL_HEIGHT) {
                 // Assume all mempool transaction confirm in the next block
                 prevheights[txinIndex] = tip->nHeight + 1;
             } else {
-                prevheights[txinIndex] = coins.nHeight;
+                prevheights[txinIndex] = coin.nHeight;
             }
         }
         lockPair = CalculateSequenceLocks(tx, flags, &prevheights, index);
@@ -495,7 +511,9 @@ unsigned int GetP2SHSigOpCount(const CTransaction& tx, const CCoinsViewCache& in
     unsigned int nSigOps = 0;
     for (unsigned int i = 0; i < tx.vin.size(); i++)
     {
-        const CTxOut &prevout = inputs.GetOutputFor(tx.vin[i]);
+        const Coin& coin = inputs.AccessCoin(tx.vin[i].prevout);
+        assert(!coin.IsSpent());
+        const CTxOut &prevout = coin.out;
         if (prevout.scriptPubKey.IsPayToScriptHash())
             nSigOps += prevout.scriptPubKey.GetSigOpCount(tx.vin[i].scriptSig);
     }
@@ -515,7 +533,9 @@ int64_t GetTransactionSigOpCost(const CTransaction& tx, const CCoinsViewCache& i
 
     for (unsigned int i = 0; i < tx.vin.size(); i++)
     {
-        const CTxOut &prevout = inputs.GetOutputFor(tx.vin[i]);
+        const Coin& coin = inputs.AccessCoin(tx.vin[i].prevout);
+        assert(!coin.IsSpent());
+        const CTxOut &prevout = coin.out;
         nSigOps += CountWitnessSigOps(tx.vin[i].scriptSig, prevout.scriptPubKey, &tx.vin[i].scriptWitness, flags);
     }
     return nSigOps;
@@ -579,9 +599,9 @@ void LimitMempoolSize(CTxMemPool& pool, size_t limit, unsigned long age) {
     if (expired != 0)
         LogPrint("mempool", "Expired %i transactions from the memory pool\n", expired);
 
-    std::vector<uint256> vNoSpendsRemaining;
+    std::vector<COutPoint> vNoSpendsRemaining;
     pool.TrimToSize(limit, &vNoSpendsRemaining);
-    BOOST_FOREACH(const uint256& removed, vNoSpendsRemaining)
+    BOOST_FOREACH(const COutPoint& removed, vNoSpendsRemaining)
         pcoinsTip->Uncache(removed);
 }
 
@@ -608,7 +628,7 @@ static bool IsCurrentForFeeEstimation()
 
 bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const CTransactionRef& ptx, bool fLimitFree,
                               bool* pfMissingInputs, int64_t nAcceptTime, std::list<CTransactionRef>* plTxnReplaced,
-                              bool fOverrideMempoolLimit, const CAmount& nAbsurdFee, std::vector<uint256>& vHashTxnToUncache)
+                              bool fOverrideMempoolLimit, const CAmount& nAbsurdFee, std::vector<COutPoint>& coins_to_uncache)
 {
     const CTransaction& tx = *ptx;
     const uint256 hash = tx.GetHash();
@@ -702,21 +722,19 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
         CCoinsViewMemPool viewMemPool(pcoinsTip, pool);
         view.SetBackend(viewMemPool);
 
-        // do we already have it?
-        bool fHadTxInCache = pcoinsTip->HaveCoinsInCache(hash);
-        if (view.HaveCoins(hash)) {
-            if (!fHadTxInCache)
-                vHashTxnToUncache.push_back(hash);
-            return state.Invalid(false, REJECT_ALREADY_KNOWN, "txn-already-known");
-        }
-
         // do all inputs exist?
-        // Note that this does not check for the presence of actual outputs (see the next check for that),
-        // and only helps with filling in pfMissingInputs (to determine missing vs spent).
         BOOST_FOREACH(const CTxIn txin, tx.vin) {
-            if (!pcoinsTip->HaveCoinsInCache(txin.prevout.hash))
-                vHashTxnToUncache.push_back(txin.prevout.hash);
-            if (!view.HaveCoins(txin.prevout.hash)) {
+            if (!pcoinsTip->HaveCoinInCache(txin.prevout))
+                coins_to_uncache.push_back(txin.prevout);
+            if (!view.HaveCoin(txin.prevout)) {
+                // Are inputs missing because we already have the tx?
+                for (size_t out = 0; out < tx.vout.size(); out++) {
+                    // Optimistically just do efficient check of cache for outputs
+                    if (pcoinsTip->HaveCoinInCache(COutPoint(hash, out))) {
+                        return state.Invalid(false, REJECT_ALREADY_KNOWN, "txn-already-known");
+                    }
+                }
+                // Otherwise assume this might be an orphan tx for which we just haven't seen parents yet
                 if (pfMissingInputs)
                     *pfMissingInputs = true;
                 return false; // fMissingInputs and !state.IsInvalid() is used to detect this condition, don't set state.Invalid()
@@ -727,6 +745,10 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
         if (!view.HaveInputs(tx))
             return state.Invalid(false, REJECT_DUPLICATE, "bad-txns-inputs-spent");
 
+        // Transactions spending from blacklisted addresses can never be mined
+        if (HasBlacklistedInput(tx, view, Params(), chainActive.Height() + 1))
+            return state.Invalid(false, REJECT_INVALID, "bad-blacklisted-address");
+
         // Bring the best block into scope
         view.GetBestBlock();
 
@@ -768,8 +790,8 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
         // during reorgs to ensure COINBASE_MATURITY is still met.
         bool fSpendsCoinbase = false;
         BOOST_FOREACH(const CTxIn &txin, tx.vin) {
-            const CCoins *coins = view.AccessCoins(txin.prevout.hash);
-            if (coins->IsCoinBase()) {
+            const Coin &coin = view.AccessCoin(txin.prevout);
+            if (coin.IsCoinBase()) {
                 fSpendsCoinbase = true;
                 break;
             }
@@ -1054,10 +1076,10 @@ bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CValidationState &state, const
                         bool* pfMissingInputs, int64_t nAcceptTime, std::list<CTransactionRef>* plTxnReplaced,
                         bool fOverrideMempoolLimit, const CAmount nAbsurdFee)
 {
-    std::vector<uint256> vHashTxToUncache;
-    bool res = AcceptToMemoryPoolWorker(pool, state, tx, fLimitFree, pfMissingInputs, nAcceptTime, plTxnReplaced, fOverrideMempoolLimit, nAbsurdFee, vHashTxToUncache);
+    std::vector<COutPoint> coins_to_uncache;
+    bool res = AcceptToMemoryPoolWorker(pool, state, tx, fLimitFree, pfMissingInputs, nAcceptTime, plTxnReplaced, fOverrideMempoolLimit, nAbsurdFee, coins_to_uncache);
     if (!res) {
-        BOOST_FOREACH(const uint256& hashTx, vHashTxToUncache)
+        BOOST_FOREACH(const COutPoint& hashTx, coins_to_uncache)
             pcoinsTip->Uncache(hashTx);
     }
     // After we've (potentially) uncached entries, ensure our coins cache is still within its size limits
@@ -1078,8 +1100,6 @@ bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus
 {
     CBlockIndex *pindexSlow = NULL;
 
-    LOCK(cs_main);
-
     CTransactionRef ptx = mempool.get(hash);
     if (ptx)
     {
@@ -1087,37 +1107,15 @@ bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus
         return true;
     }
 
-    if (fTxIndex) {
-        CDiskTxPos postx;
-        if (pblocktree->ReadTxIndex(hash, postx)) {
-            CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-            if (file.IsNull())
-                return error("%s: OpenBlockFile failed", __func__);
-            CBlockHeader header;
-            try {
-                file >> header;
-                fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
-                file >> txOut;
-            } catch (const std::exception& e) {
-                return error("%s: Deserialize or I/O error - %s", __func__, e.what());
-            }
-            hashBlock = header.GetHash();
-            if (txOut->GetHash() != hash)
-                return error("%s: txid mismatch", __func__);
-            return true;
-        }
-    }
+    // The transaction index has a database of its own and is looked up without cs_main
+    if (g_txindex && g_txindex->FindTx(hash, hashBlock, txOut))
+        return true;
+
+    LOCK(cs_main);
 
     if (fAllowSlow) { // use coin database to locate block that contains transaction, and scan it
-        int nHeight = -1;
-        {
-            const CCoinsViewCache& view = *pcoinsTip;
-            const CCoins* coins = view.AccessCoins(hash);
-            if (coins)
-                nHeight = coins->nHeight;
-        }
-        if (nHeight > 0)
-            pindexSlow = chainActive[nHeight];
+        const Coin& coin = AccessByTxid(*pcoinsTip, hash);
+        if (!coin.IsSpent()) pindexSlow = chainActive[coin.nHeight];
     }
 
     if (pindexSlow) {
@@ -1167,6 +1165,34 @@ bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHea
     return true;
 }
 
+/** Locate the block or undo data stored at pos in a memory mapped file.
+ *  Its size is taken from the index header in front of it, and nTrailing
+ *  more bytes (the checksum of undo data) have to follow it. Returns false
+ *  if the file isn't mapped, in which case the caller reads the file. */
+static bool GetMappedData(const CDiskBlockPos& pos, bool fUndo, size_t nTrailing, CMappedBlockFileRef& file, const unsigned char*& pbegin, const unsigned char*& pend)
+{
+    const size_t nHeaderSize = CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int);
+    if (pos.nPos < nHeaderSize)
+        return false;
+    file = blockfilemap.Get(pos, fUndo, pos.nPos);
+    if (!file)
+        return false;
+    const unsigned char* pheader = file->data() + pos.nPos - nHeaderSize;
+    if (memcmp(pheader, Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
+        return false;
+    size_t nSize = ReadLE32(pheader + CMessageHeader::MESSAGE_START_SIZE);
+    size_t nEnd = (size_t)pos.nPos + nSize + nTrailing;
+    if (file->size() < nEnd) {
+        file = blockfilemap.Get(pos, fUndo, nEnd);
+        if (!file)
+            return false;
+    }
+    file->NoteRead(pos.nPos, nSize + nTrailing);
+    pbegin = file->data() + pos.nPos;
+    pend = pbegin + nSize;
+    return true;
+}
+
 /* Generic implementation of block reading that can handle
    both a block and its header.  */
 
@@ -1175,17 +1201,28 @@ static bool ReadBlockOrHeader(T& block, const CDiskBlockPos& pos, const Consensu
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+    CMappedBlockFileRef mapped;
+    const unsigned char *pbegin, *pend;
+    if (GetMappedData(pos, false, 0, mapped, pbegin, pend)) {
+        try {
+            CSpanReader(SER_DISK, CLIENT_VERSION, pbegin, pend) >> block;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize error - %s at %s", __func__, e.what(), pos.ToString());
+        }
+    } else {
+        // Open history file to read
+        CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
 
-    // Read block
-    try {
-        filein >> block;
-    }
-    catch (const std::exception& e) {
-        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        // Read block
+        try {
+            filein >> block;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        }
     }
 
     // Check the header
@@ -1221,6 +1258,44 @@ bool ReadBlockHeaderFromDisk(CBlockHeader& block, const CBlockIndex* pindex, con
     return ReadBlockOrHeader(block, pindex, consensusParams, fCheckPOW);
 }
 
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart)
+{
+    // The block is preceded by the message start and its size
+    if (pos.nPos < CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int))
+        return error("%s: Invalid block position %s", __func__, pos.ToString());
+
+    CMappedBlockFileRef mapped;
+    const unsigned char *pbegin, *pend;
+    if (GetMappedData(pos, false, 0, mapped, pbegin, pend)) {
+        if ((size_t)(pend - pbegin) > MAX_BLOCK_SERIALIZED_SIZE)
+            return error("%s: Block size %u too large at %s", __func__, (size_t)(pend - pbegin), pos.ToString());
+        block.assign(pbegin, pend);
+        return true;
+    }
+
+    CDiskBlockPos posHeader(pos.nFile, pos.nPos - CMessageHeader::MESSAGE_START_SIZE - sizeof(unsigned int));
+    CAutoFile filein(OpenBlockFile(posHeader, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+
+    try {
+        CMessageHeader::MessageStartChars blockStart;
+        unsigned int nSize;
+        filein >> FLATDATA(blockStart) >> nSize;
+        if (memcmp(blockStart, messageStart, CMessageHeader::MESSAGE_START_SIZE))
+            return error("%s: Block magic mismatch at %s", __func__, pos.ToString());
+        if (nSize > MAX_BLOCK_SERIALIZED_SIZE)
+            return error("%s: Block size %u too large at %s", __func__, nSize, pos.ToString());
+        block.resize(nSize);
+        filein.read((char*)block.data(), nSize);
+    }
+    catch (const std::exception& e) {
+        return error("%s: Read error - %s at %s", __func__, e.what(), pos.ToString());
+    }
+
+    return true;
+}
+
 bool IsInitialBlockDownload()
 {
     const CChainParams& chainParams = Params();
@@ -1372,24 +1447,13 @@ void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, CTxUndo &txund
     if (!tx.IsCoinBase()) {
         txundo.vprevout.reserve(tx.vin.size());
         BOOST_FOREACH(const CTxIn &txin, tx.vin) {
-            CCoinsModifier coins = inputs.ModifyCoins(txin.prevout.hash);
-            unsigned nPos = txin.prevout.n;
-
-            if (nPos >= coins->vout.size() || coins->vout[nPos].IsNull())
-                assert(false);
-            // mark an outpoint spent, and construct undo information
-            txundo.vprevout.push_back(CTxInUndo(coins->vout[nPos]));
-            coins->Spend(nPos);
-            if (coins->vout.size() == 0) {
-                CTxInUndo& undo = txundo.vprevout.back();
-                undo.nHeight = coins->nHeight;
-                undo.fCoinBase = coins->fCoinBase;
-                undo.nVersion = coins->nVersion;
-            }
+            txundo.vprevout.emplace_back();
+            bool is_spent = inputs.SpendCoin(txin.prevout, &txundo.vprevout.back());
+            assert(is_spent);
         }
     }
     // add outputs
-    inputs.ModifyNewCoins(tx.GetHash(), tx.IsCoinBase())->FromTx(tx, nHeight);
+    AddCoins(inputs, tx, nHeight);
 }
 
 void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight)
@@ -1427,22 +1491,22 @@ bool CheckTxInputs(const CChainParams& params, const CTransaction& tx, CValidati
         for (unsigned int i = 0; i < tx.vin.size(); i++)
         {
             const COutPoint &prevout = tx.vin[i].prevout;
-            const CCoins *coins = inputs.AccessCoins(prevout.hash);
-            assert(coins);
+            const Coin& coin = inputs.AccessCoin(prevout);
+            assert(!coin.IsSpent());
 
             // If prev is coinbase, check that it's matured
-            if (coins->IsCoinBase()) {
+            if (coin.IsCoinBase()) {
                 // Dogecoin: Switch maturity at depth 145,000
-                int nCoinbaseMaturity = params.GetConsensus(coins->nHeight).nCoinbaseMaturity;
-                if (nSpendHeight - coins->nHeight < nCoinbaseMaturity)
+                int nCoinbaseMaturity = params.GetConsensus(coin.nHeight).nCoinbaseMaturity;
+                if (nSpendHeight - coin.nHeight < nCoinbaseMaturity)
                     return state.Invalid(false,
                         REJECT_INVALID, "bad-txns-premature-spend-of-coinbase",
-                        strprintf("tried to spend coinbase at depth %d", nSpendHeight - coins->nHeight));
+                        strprintf("tried to spend coinbase at depth %d", nSpendHeight - coin.nHeight));
             }
 
             // Check for negative or overflow input values
-            nValueIn += coins->vout[prevout.n].nValue;
-            if (!MoneyRange(coins->vout[prevout.n].nValue) || !MoneyRange(nValueIn))
+            nValueIn += coin.out.nValue;
+            if (!MoneyRange(coin.out.nValue) || !MoneyRange(nValueIn))
                 return state.DoS(100, false, REJECT_INVALID, "bad-txns-inputvalues-outofrange");
 
         }
@@ -1484,11 +1548,11 @@ bool CheckInputs(ChainSigVersion chainSigVersion, const CTransaction& tx, CValid
         if (fScriptChecks) {
             for (unsigned int i = 0; i < tx.vin.size(); i++) {
                 const COutPoint &prevout = tx.vin[i].prevout;
-                const CCoins* coins = inputs.AccessCoins(prevout.hash);
-                assert(coins);
+                const Coin& coin = inputs.AccessCoin(prevout);
+                assert(!coin.IsSpent());
 
                 // Verify signature
-                CScriptCheck check(*coins, tx, i, flags, cacheStore, &txdata, chainSigVersion);
+                CScriptCheck check(coin.out, tx, i, flags, cacheStore, &txdata, chainSigVersion);
                 if (pvChecks) {
                     pvChecks->push_back(CScriptCheck());
                     check.swap(pvChecks->back());
@@ -1500,7 +1564,7 @@ bool CheckInputs(ChainSigVersion chainSigVersion, const CTransaction& tx, CValid
                         // arguments; if so, don't trigger DoS protection to
                         // avoid splitting the network between upgraded and
                         // non-upgraded nodes.
-                        CScriptCheck check2(*coins, tx, i,
+                        CScriptCheck check2(coin.out, tx, i,
                                 flags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, cacheStore, &txdata, chainSigVersion);
                         if (check2())
                             return state.Invalid(false, REJECT_NONSTANDARD, strprintf("non-mandatory-script-verify-flag (%s)", ScriptErrorString(check.GetScriptError())));
@@ -1552,6 +1616,28 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
 
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock)
 {
+    CMappedBlockFileRef mapped;
+    const unsigned char *pbegin, *pend;
+    if (GetMappedData(pos, true, sizeof(uint256), mapped, pbegin, pend)) {
+        uint256 hashChecksum;
+        try {
+            CSpanReader(SER_DISK, CLIENT_VERSION, pbegin, pend) >> blockundo;
+            CSpanReader(SER_DISK, CLIENT_VERSION, pend, pend + sizeof(uint256)) >> hashChecksum;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize error - %s", __func__, e.what());
+        }
+
+        // Verify checksum, over the stored bytes rather than a reserialization
+        CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+        hasher << hashBlock;
+        hasher.write((const char*)pbegin, pend - pbegin);
+        if (hashChecksum != hasher.GetHash())
+            return error("%s: Checksum mismatch", __func__);
+
+        return true;
+    }
+
     // Open history file to read
     CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
@@ -1597,40 +1683,45 @@ bool AbortNode(CValidationState& state, const std::string& strMessage, const std
 
 } // anon namespace
 
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    CDiskBlockPos pos = pindex->GetUndoPos();
+    if (pos.IsNull())
+        return error("%s: no undo data available for %s", __func__, pindex->GetBlockHash().ToString());
+    return UndoReadFromDisk(blockundo, pos, pindex->pprev->GetBlockHash());
+}
+
 /**
- * Apply the undo operation of a CTxInUndo to the given chain state.
- * @param undo The undo object.
+ * Restore the UTXO in a Coin at a given COutPoint
+ * @param undo The Coin to be restored.
  * @param view The coins view to which to apply the changes.
  * @param out The out point that corresponds to the tx input.
  * @return True on success.
  */
-bool ApplyTxInUndo(const CTxInUndo& undo, CCoinsViewCache& view, const COutPoint& out)
+bool ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out)
 {
     bool fClean = true;
 
-    CCoinsModifier coins = view.ModifyCoins(out.hash);
-    if (undo.nHeight != 0) {
-        // undo data contains height: this is the last output of the prevout tx being spent
-        if (!coins->IsPruned())
-            fClean = fClean && error("%s: undo data overwriting existing transaction", __func__);
-        coins->Clear();
-        coins->fCoinBase = undo.fCoinBase;
-        coins->nHeight = undo.nHeight;
-        coins->nVersion = undo.nVersion;
-    } else {
-        if (coins->IsPruned())
-            fClean = fClean && error("%s: undo data adding output to missing transaction", __func__);
-    }
-    if (coins->IsAvailable(out.n))
+    if (view.HaveCoin(out))
         fClean = fClean && error("%s: undo data overwriting existing output", __func__);
-    if (coins->vout.size() < out.n+1)
-        coins->vout.resize(out.n+1);
-    coins->vout[out.n] = undo.txout;
+
+    if (undo.nHeight == 0) {
+        // Missing undo metadata (height and coinbase). Older versions included this
+        // information only in undo records for the last spend of a transactions'
+        // outputs. This implies that it must be present for some other output of the same tx.
+        const Coin& alternate = AccessByTxid(view, out.hash);
+        if (alternate.IsSpent())
+            return error("%s: undo data adding output to missing transaction", __func__);
+        undo.nHeight = alternate.nHeight;
+        undo.fCoinBase = alternate.fCoinBase;
+    }
+    view.AddCoin(out, std::move(undo), !fClean);
 
     return fClean;
 }
 
-bool DisconnectBlock(const CBlock& block, CValidationState& state, const CBlockIndex* pindex, CCoinsViewCache& view, bool* pfClean)
+bool DisconnectBlock(const CBlock& block, CValidationState& state, const CBlockIndex* pindex, CCoinsViewCache& view, bool* pfClean,
+                     CCoinsRollingStats* pstats, CAddressIndexBatch* paddressindex)
 {
     assert(pindex->GetBlockHash() == view.GetBestBlock());
 
@@ -1649,40 +1740,41 @@ bool DisconnectBlock(const CBlock& block, CValidationState& state, const CBlockI
     if (blockUndo.vtxundo.size() + 1 != block.vtx.size())
         return error("DisconnectBlock(): block and undo data inconsistent");
 
+    // Changes to the rolling statistics, applied only if the block is disconnected cleanly
+    CCoinsRollingStats statsDelta;
+
     // undo transactions in reverse order
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
         const CTransaction &tx = *(block.vtx[i]);
         uint256 hash = tx.GetHash();
 
+        bool is_coinbase = tx.IsCoinBase();
+
         // Check that all outputs are available and match the outputs in the block itself
         // exactly.
-        {
-        CCoinsModifier outs = view.ModifyCoins(hash);
-        outs->ClearUnspendable();
-
-        CCoins outsBlock(tx, pindex->nHeight);
-        // The CCoins serialization does not serialize negative numbers.
-        // No network rules currently depend on the version here, so an inconsistency is harmless
-        // but it must be corrected before txout nversion ever influences a network rule.
-        if (outsBlock.nVersion < 0)
-            outs->nVersion = outsBlock.nVersion;
-        if (*outs != outsBlock)
-            fClean = fClean && error("DisconnectBlock(): added transaction mismatch? database corrupted");
-
-        // remove outputs
-        outs->Clear();
+        for (size_t o = 0; o < tx.vout.size(); o++) {
+            if (!tx.vout[o].scriptPubKey.IsUnspendable()) {
+                COutPoint out(hash, o);
+                Coin coin;
+                bool is_spent = view.SpendCoin(out, &coin);
+                if (!is_spent || tx.vout[o] != coin.out || pindex->nHeight != coin.nHeight || is_coinbase != coin.fCoinBase)
+                    fClean = fClean && error("DisconnectBlock(): added transaction mismatch? database corrupted");
+                if (pstats && is_spent)
+                    statsDelta.RemoveCoin(out, coin);
+            }
         }
 
         // restore inputs
         if (i > 0) { // not coinbases
-            const CTxUndo &txundo = blockUndo.vtxundo[i-1];
+            CTxUndo &txundo = blockUndo.vtxundo[i-1];
             if (txundo.vprevout.size() != tx.vin.size())
                 return error("DisconnectBlock(): transaction and undo data inconsistent");
             for (unsigned int j = tx.vin.size(); j-- > 0;) {
                 const COutPoint &out = tx.vin[j].prevout;
-                const CTxInUndo &undo = txundo.vprevout[j];
-                if (!ApplyTxInUndo(undo, view, out))
+                if (!ApplyTxInUndo(std::move(txundo.vprevout[j]), view, out))
                     fClean = false;
+                else if (pstats)
+                    statsDelta.AddCoin(out, view.AccessCoin(out));
             }
         }
     }
@@ -1690,6 +1782,14 @@ bool DisconnectBlock(const CBlock& block, CValidationState& state, const CBlockI
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
+    if (pstats && fClean) {
+        *pstats += statsDelta;
+        pstats->hashBlock = pindex->pprev->GetBlockHash();
+    }
+
+    if (paddressindex)
+        paddressindex->DisconnectBlock(block, blockUndo, pindex);
+
     if (pfClean) {
         *pfClean = fClean;
         return true;
@@ -1730,6 +1830,46 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+/** Number of headers covered by a single CHeaderPoWCheck. */
+static const size_t HEADER_CHECK_BATCH_SIZE = 16;
+
+static CCheckQueue<CHeaderPoWCheck> headercheckqueue(1);
+
+void ThreadHeaderCheck() {
+    RenameThread("dogecoin-headerch");
+    headercheckqueue.Thread();
+}
+
+/** Number of outpoints covered by a single CCoinsPrefetchCheck. */
+static const size_t COINS_PREFETCH_BATCH_SIZE = 16;
+
+static CCheckQueue<CCoinsPrefetchCheck> coinsprefetchqueue(1);
+
+void ThreadCoinsPrefetch() {
+    RenameThread("dogecoin-prefetch");
+    coinsprefetchqueue.Thread();
+}
+
+/** Number of imported blocks covered by a single CImportBlockCheck. */
+static const size_t IMPORT_CHECK_BATCH_SIZE = 4;
+/** Blocks handed from the import scanner to the importing thread at once */
+static const size_t IMPORT_BATCH_BLOCKS = 500;
+static const uint64_t IMPORT_BATCH_SIZE = 4 * 1024 * 1024;
+/** Checked batches the import scanner may get ahead of the importing thread */
+static const size_t IMPORT_BATCHES_QUEUED = 2;
+/** How far back the import scanner may have to restart a scan (a batch and the block after it) */
+static const uint64_t IMPORT_MAX_REWIND = IMPORT_BATCH_SIZE + 2 * (MAX_BLOCK_SERIALIZED_SIZE + 8);
+
+static CCheckQueue<CImportBlockCheck> importcheckqueue(1);
+
+void ThreadImportCheck() {
+    RenameThread("dogecoin-importch");
+    importcheckqueue.Thread();
+}
+
+// Protected by cs_main
+static CCoinsPrefetchStats coinsPrefetchStats;
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -1780,6 +1920,8 @@ static int64_t nTimeForks = 0;
 static int64_t nTimeVerify = 0;
 static int64_t nTimeConnect = 0;
 static int64_t nTimeIndex = 0;
+static int64_t nTimeRollingStats = 0;
+static int64_t nTimeAddressIndexing = 0;
 static int64_t nTimeCallbacks = 0;
 static int64_t nTimeTotal = 0;
 
@@ -2460,37 +2602,93 @@ std::set<std::string> setBlacklistedAddresses = {
     "LBj8archLMQquKnVtw5TKieZ7MmWKJLRd6"
 };
 
-std::string EncodeDestination(const CTxDestination& dest, const CChainParams& params) {
-	std::vector<unsigned char> data;
+/**
+ * setBlacklistedAddresses decoded once into sorted (version byte, key id)
+ * pairs, so that lookups neither hash nor base58-encode anything. Keeping
+ * the version byte makes a lookup match exactly when the address encoded
+ * with the active chain's PUBKEY_ADDRESS prefix is in the list.
+ */
+static const std::vector<std::pair<unsigned char, uint160> >& GetBlacklistedKeyIDs()
+{
+    static const std::vector<std::pair<unsigned char, uint160> > vKeyIDs = [] {
+        std::vector<std::pair<unsigned char, uint160> > v;
+        v.reserve(setBlacklistedAddresses.size());
+        for (const std::string& strAddress : setBlacklistedAddresses) {
+            std::vector<unsigned char> vchData;
+            if (!DecodeBase58Check(strAddress, vchData) || vchData.size() != 1 + sizeof(uint160))
+                continue;
+            v.push_back(std::make_pair(vchData[0], uint160(std::vector<unsigned char>(vchData.begin() + 1, vchData.end()))));
+        }
+        std::sort(v.begin(), v.end());
+        return v;
+    }();
+    return vKeyIDs;
+}
 
-	if (const CKeyID* keyID = boost::get<CKeyID>(&dest)) {
-		// Add prefix for PUBKEY_ADDRESS
-		data = params.Base58Prefix(CChainParams::PUBKEY_ADDRESS);
-		data.insert(data.end(), keyID->begin(), keyID->end());
-	} else if (const CScriptID* scriptID = boost::get<CScriptID>(&dest)) {
-		// Add prefix for SCRIPT_ADDRESS
-		data = params.Base58Prefix(CChainParams::SCRIPT_ADDRESS);
-		data.insert(data.end(), scriptID->begin(), scriptID->end());
-	} else {
-		return ""; // Unsupported destination
-	}
+/**
+ * Extract the key id from a pay-to-pubkey-hash script without going
+ * through Solver(). Like the TX_PUBKEYHASH template, this accepts the key
+ * id in any push encoding, not just the minimal one.
+ */
+static bool MatchPayToPubKeyHash(const CScript& script, uint160& keyID)
+{
+    if (script.size() < 25 || script[0] != OP_DUP || script[1] != OP_HASH160)
+        return false;
 
-	return EncodeBase58Check(data);
+    unsigned int nPushHeader;
+    if (script[2] == 20)
+        nPushHeader = 1;
+    else if (script[2] == OP_PUSHDATA1 && script[3] == 20)
+        nPushHeader = 2;
+    else if (script[2] == OP_PUSHDATA2 && script[3] == 20 && script[4] == 0)
+        nPushHeader = 3;
+    else if (script[2] == OP_PUSHDATA4 && script[3] == 20 && script[4] == 0 && script[5] == 0 && script[6] == 0)
+        nPushHeader = 5;
+    else
+        return false;
+
+    const unsigned int nKeyID = 2 + nPushHeader;
+    if (script.size() != nKeyID + 20 + 2 || script[nKeyID + 20] != OP_EQUALVERIFY || script[nKeyID + 21] != OP_CHECKSIG)
+        return false;
+    memcpy(keyID.begin(), &script[nKeyID], 20);
+    return true;
 }
 
-bool isBlacklisted(const uint160& scriptHash, const CChainParams& chainParams, int currentBlockHeight) {
-    if (currentBlockHeight < 275300) {
+bool isBlacklisted(const uint160& keyID, const CChainParams& chainParams, int nHeight) {
+    if (nHeight < 275300) {
         return false;
     }
 
-    CTxDestination dest = CKeyID(scriptHash);
-    std::string address = EncodeDestination(dest, chainParams);
+    const std::vector<unsigned char>& vchPrefix = chainParams.Base58Prefix(CChainParams::PUBKEY_ADDRESS);
+    if (vchPrefix.size() != 1) {
+        return false;
+    }
 
-    return setBlacklistedAddresses.find(address) != setBlacklistedAddresses.end();
+    const std::vector<std::pair<unsigned char, uint160> >& vKeyIDs = GetBlacklistedKeyIDs();
+    return std::binary_search(vKeyIDs.begin(), vKeyIDs.end(), std::make_pair(vchPrefix[0], keyID));
+}
+
+bool HasBlacklistedInput(const CTransaction& tx, const CCoinsViewCache& inputs, const CChainParams& chainParams, int nHeight)
+{
+    if (nHeight < 275300 || tx.IsCoinBase())
+        return false;
+
+    uint160 keyID;
+    for (const auto& txin : tx.vin) {
+        const Coin& coin = inputs.AccessCoin(txin.prevout);
+        assert(!coin.IsSpent());
+
+        if (MatchPayToPubKeyHash(coin.out.scriptPubKey, keyID) &&
+            isBlacklisted(keyID, chainParams, nHeight)) {
+            return true;
+        }
+    }
+    return false;
 }
 
 bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
-                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck)
+                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck, CCoinsRollingStats* pstats,
+                  CAddressIndexBatch* paddressindex)
 {
     AssertLockHeld(cs_main);
 
@@ -2531,6 +2729,10 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     if (block.GetHash() == Params().GetConsensus(0).hashGenesisBlock) {
         if (!fJustCheck)
             view.SetBestBlock(pindex->GetBlockHash());
+        if (pstats)
+            pstats->hashBlock = pindex->GetBlockHash();
+        if (paddressindex)
+            paddressindex->hashBlock = pindex->GetBlockHash();
         return true;
     }
 
@@ -2590,10 +2792,12 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
     if (fEnforceBIP30) {
         for (const auto& tx : block.vtx) {
-            const CCoins* coins = view.AccessCoins(tx->GetHash());
-            if (coins && !coins->IsPruned())
-                return state.DoS(100, error("ConnectBlock(): tried to overwrite transaction"),
-                                 REJECT_INVALID, "bad-txns-BIP30");
+            for (size_t o = 0; o < tx->vout.size(); o++) {
+                if (view.HaveCoin(COutPoint(tx->GetHash(), o))) {
+                    return state.DoS(100, error("ConnectBlock(): tried to overwrite transaction"),
+                                     REJECT_INVALID, "bad-txns-BIP30");
+                }
+            }
         }
     }
 
@@ -2637,9 +2841,6 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     CAmount nFees = 0;
     int nInputs = 0;
     int64_t nSigOpsCost = 0;
-    CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
-    std::vector<std::pair<uint256, CDiskTxPos> > vPos;
-    vPos.reserve(block.vtx.size());
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
     std::vector<PrecomputedTransactionData> txdata;
     txdata.reserve(block.vtx.size()); // Required so that pointers to individual PrecomputedTransactionData don't get invalidated
@@ -2655,33 +2856,16 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                 return state.DoS(100, error("ConnectBlock(): inputs missing/spent"),
                                  REJECT_INVALID, "bad-txns-inputs-missingorspent");
 
-            for (const auto& txin : tx.vin) {
-                const CCoins* coins = view.AccessCoins(txin.prevout.hash);
-                if (!coins)
-                    return state.DoS(100, error("ConnectBlock(): input not found in UTXO set"),
-                                    REJECT_INVALID, "bad-txns-inputs-missingorspent");
-
-                const CScript& prevOutScript = coins->vout[txin.prevout.n].scriptPubKey;
-
-                std::vector<std::vector<unsigned char>> vSolutions;
-                txnouttype whichType;
-                if (Solver(prevOutScript, whichType, vSolutions)) {
-                    if (whichType == TX_PUBKEYHASH && vSolutions.size() > 0) {
-                        uint160 pubKeyHash = uint160(vSolutions[0]);
-                        if (isBlacklisted(pubKeyHash, chainparams, pindex->nHeight)) {
-                            return state.Invalid(false, REJECT_INVALID, "bad-blacklisted-address",
-                                                "Block has a TX input from blacklisted address");
-                        }
-                    }
-                }
-            }
+            if (HasBlacklistedInput(tx, view, chainparams, pindex->nHeight))
+                return state.Invalid(false, REJECT_INVALID, "bad-blacklisted-address",
+                                     "Block has a TX input from blacklisted address");
 
             // Check that transaction is BIP68 final
             // BIP68 lock checks (as opposed to nLockTime checks) must
             // be in ConnectBlock because they require the UTXO set
             prevheights.resize(tx.vin.size());
             for (size_t j = 0; j < tx.vin.size(); j++) {
-                prevheights[j] = view.AccessCoins(tx.vin[j].prevout.hash)->nHeight;
+                prevheights[j] = view.AccessCoin(tx.vin[j].prevout).nHeight;
             }
 
             if (!SequenceLocks(tx, nLockTimeFlags, &prevheights, *pindex)) {
@@ -2717,9 +2901,6 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             blockundo.vtxundo.push_back(CTxUndo());
         }
         UpdateCoins(tx, view, i == 0 ? undoDummy : blockundo.vtxundo.back(), pindex->nHeight);
-
-        vPos.push_back(std::make_pair(tx.GetHash(), pos));
-        pos.nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
     }
     int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
     LogPrint("bench", "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs]\n", (unsigned)block.vtx.size(), 0.001 * (nTime3 - nTime2), 0.001 * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : 0.001 * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * 0.000001);
@@ -2758,16 +2939,40 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         setDirtyBlockIndex.insert(pindex);
     }
 
-    if (fTxIndex)
-        if (!pblocktree->WriteTxIndex(vPos))
-            return AbortNode(state, "Failed to write transaction index");
-
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
     int64_t nTime5 = GetTimeMicros(); nTimeIndex += nTime5 - nTime4;
     LogPrint("bench", "    - Index writing: %.2fms [%.2fs]\n", 0.001 * (nTime5 - nTime4), nTimeIndex * 0.000001);
 
+    if (pstats) {
+        // Nothing can fail anymore, so fold the created and spent coins into the statistics directly
+        for (size_t i = 0; i < block.vtx.size(); i++) {
+            const CTransaction& tx = *block.vtx[i];
+            const uint256& hash = tx.GetHash();
+            for (size_t o = 0; o < tx.vout.size(); o++) {
+                if (!tx.vout[o].scriptPubKey.IsUnspendable())
+                    pstats->AddCoin(COutPoint(hash, o), Coin(tx.vout[o], pindex->nHeight, tx.IsCoinBase()));
+            }
+            if (i > 0) {
+                const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+                for (size_t j = 0; j < tx.vin.size(); j++)
+                    pstats->RemoveCoin(tx.vin[j].prevout, txundo.vprevout[j]);
+            }
+        }
+        pstats->hashBlock = pindex->GetBlockHash();
+        int64_t nTimeStats = GetTimeMicros(); nTimeRollingStats += nTimeStats - nTime5;
+        LogPrint("bench", "    - Rolling UTXO set stats: %.2fms [%.2fs]\n", 0.001 * (nTimeStats - nTime5), nTimeRollingStats * 0.000001);
+        nTime5 = nTimeStats;
+    }
+
+    if (paddressindex) {
+        paddressindex->ConnectBlock(block, blockundo, pindex);
+        int64_t nTimeAddressIndex = GetTimeMicros(); nTimeAddressIndexing += nTimeAddressIndex - nTime5;
+        LogPrint("bench", "    - Address index: %.2fms [%.2fs]\n", 0.001 * (nTimeAddressIndex - nTime5), nTimeAddressIndexing * 0.000001);
+        nTime5 = nTimeAddressIndex;
+    }
+
     // Watch for changes to the previous coinbase transaction.
     static uint256 hashPrevBestCoinBase;
     GetMainSignals().UpdatedTransaction(hashPrevBestCoinBase);
@@ -2857,6 +3062,9 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode, int n
                 vBlocks.push_back(*it);
                 setDirtyBlockIndex.erase(it++);
             }
+            if (!auxpowstore.Flush(*pblocktree)) {
+                return AbortNode(state, "Failed to write to auxpow store");
+            }
             if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
                 return AbortNode(state, "Failed to write to block index database");
             }
@@ -2868,14 +3076,15 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode, int n
     }
     // Flush best chain related state. This can only be done if the blocks / block index write was also done.
     if (fDoFullFlush) {
-        // Typical CCoins structures on disk are around 128 bytes in size.
+        // Typical Coin structures on disk are around 48 bytes in size.
         // Pushing a new one to the database can cause it to be written
         // twice (once in the log, and once in the tables). This is already
         // an overestimation, as most will delete an existing entry or
         // overwrite one. Still, use a conservative safety factor of 2.
-        if (!CheckDiskSpace(128 * 2 * 2 * pcoinsTip->GetCacheSize()))
+        if (!CheckDiskSpace(48 * 2 * 2 * pcoinsTip->GetCacheSize()))
             return state.Error("out of disk space");
         // Flush the chainstate (which may refer to block index entries).
+        pcoinsdbview->SetRollingStats(fHaveRollingCoinsStats ? &rollingCoinsStats : NULL);
         if (!pcoinsTip->Flush())
             return AbortNode(state, "Failed to write to coin database");
         nLastFlush = nNow;
@@ -2963,10 +3172,15 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
     int64_t nStart = GetTimeMicros();
     {
         CCoinsViewCache view(pcoinsTip);
-        if (!DisconnectBlock(block, state, pindexDelete, view))
+        CCoinsRollingStats* pstats = fHaveRollingCoinsStats ? &rollingCoinsStats : NULL;
+        CAddressIndexBatch addressindex;
+        CAddressIndexBatch* paddressindex = fAddressIndex && fAddressIndexSynced ? &addressindex : NULL;
+        if (!DisconnectBlock(block, state, pindexDelete, view, NULL, pstats, paddressindex))
             return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
         bool flushed = view.Flush();
         assert(flushed);
+        if (paddressindex && !pblocktree->WriteAddressIndex(addressindex))
+            return AbortNode(state, "Failed to write address index");
     }
     LogPrint("bench", "- Disconnect block: %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
     // Write the chain state to disk, if necessary.
@@ -3005,6 +3219,7 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
 }
 
 static int64_t nTimeReadFromDisk = 0;
+static int64_t nTimePrefetch = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
@@ -3044,19 +3259,27 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint("bench", "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
+    PrefetchBlockInputs(blockConnecting, *pcoinsTip);
+    int64_t nTimePrefetched = GetTimeMicros(); nTimePrefetch += nTimePrefetched - nTime2;
+    LogPrint("bench", "  - Prefetch inputs: %.2fms [%.2fs]\n", (nTimePrefetched - nTime2) * 0.001, nTimePrefetch * 0.000001);
     {
         CCoinsViewCache view(pcoinsTip);
-        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams);
+        CCoinsRollingStats* pstats = fHaveRollingCoinsStats ? &rollingCoinsStats : NULL;
+        CAddressIndexBatch addressindex;
+        CAddressIndexBatch* paddressindex = fAddressIndex && fAddressIndexSynced ? &addressindex : NULL;
+        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams, false, pstats, paddressindex);
         GetMainSignals().BlockChecked(blockConnecting, state);
         if (!rv) {
             if (state.IsInvalid())
                 InvalidBlockFound(pindexNew, state);
             return error("ConnectTip(): ConnectBlock %s failed", pindexNew->GetBlockHash().ToString());
         }
-        nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2;
+        nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTimePrefetched;
         LogPrint("bench", "  - Connect total: %.2fms [%.2fs]\n", (nTime3 - nTime2) * 0.001, nTimeConnectTotal * 0.000001);
         bool flushed = view.Flush();
         assert(flushed);
+        if (paddressindex && !pblocktree->WriteAddressIndex(addressindex))
+            return AbortNode(state, "Failed to write address index");
     }
     int64_t nTime4 = GetTimeMicros(); nTimeFlush += nTime4 - nTime3;
     LogPrint("bench", "  - Flush: %.2fms [%.2fs]\n", (nTime4 - nTime3) * 0.001, nTimeFlush * 0.000001);
@@ -3479,6 +3702,12 @@ CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
     // Construct new block index object
     CBlockIndex* pindexNew = new CBlockIndex(block);
     assert(pindexNew);
+    if (block.auxpow) {
+        auxpowstore.Add(hash, block.auxpow);
+        // Don't let unwritten auxpows pile up in memory during header sync.
+        if (pblocktree && auxpowstore.UnwrittenEntries() >= DEFAULT_AUXPOW_CACHE_ENTRIES)
+            auxpowstore.Flush(*pblocktree);
+    }
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -3578,6 +3807,7 @@ bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, unsigned int nAdd
         }
         FlushBlockFile(!fKnown);
         nLastBlockFile = nFile;
+        blockfilemap.SetFinalizedFiles(nLastBlockFile);
     }
 
     vinfoBlockFile[nFile].AddBlock(nHeight, nTime);
@@ -3652,6 +3882,111 @@ bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool f
     return true;
 }
 
+bool CHeaderPoWCheck::operator()()
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus(0);
+    std::vector<uint256> vPoWHash(nCount);
+    std::vector<const char*> vInputs;
+    std::vector<char*> vOutputs;
+    for (size_t i = 0; i < nCount; i++) {
+        if (!pheaders[i].auxpow) {
+            vInputs.push_back(BEGIN(pheaders[i].nVersion));
+            vOutputs.push_back(BEGIN(vPoWHash[i]));
+        }
+    }
+    scrypt_1024_1_1_256_multi(vInputs.data(), vOutputs.data(), vInputs.size());
+
+    for (size_t i = 0; i < nCount; i++)
+        pfValid[i] = CheckAuxPowProofOfWork(pheaders[i], consensusParams, pheaders[i].auxpow ? NULL : &vPoWHash[i]);
+    return true;
+}
+
+void CheckBlockHeadersPoW(const std::vector<CBlockHeader>& headers, size_t nStart, std::vector<char>& vfValid)
+{
+    vfValid.assign(headers.size(), 0);
+
+    CCheckQueueControl<CHeaderPoWCheck> control(nScriptCheckThreads ? &headercheckqueue : NULL);
+    std::vector<CHeaderPoWCheck> vChecks;
+    for (size_t i = nStart; i < headers.size(); i += HEADER_CHECK_BATCH_SIZE) {
+        CHeaderPoWCheck check(&headers[i], std::min(HEADER_CHECK_BATCH_SIZE, headers.size() - i), &vfValid[i]);
+        if (nScriptCheckThreads) {
+            vChecks.push_back(CHeaderPoWCheck());
+            check.swap(vChecks.back());
+        } else {
+            check();
+        }
+    }
+    control.Add(vChecks);
+    control.Wait();
+}
+
+bool CCoinsPrefetchCheck::operator()()
+{
+    for (size_t i = 0; i < nCount; i++)
+        pfFound[i] = view->GetCoin(poutpoints[i], pcoins[i]);
+    return true;
+}
+
+void PrefetchBlockInputs(const CBlock& block, CCoinsViewCache& view)
+{
+    AssertLockHeld(cs_main);
+
+    // Collect the inputs whose coins aren't cached yet. Outputs created
+    // earlier in the same block are skipped, ConnectBlock adds those itself.
+    std::set<uint256> setBlockTxids;
+    std::vector<COutPoint> vOutpoints;
+    for (const auto& tx : block.vtx) {
+        if (!tx->IsCoinBase()) {
+            for (const CTxIn& txin : tx->vin) {
+                if (setBlockTxids.count(txin.prevout.hash))
+                    continue;
+                if (view.HaveCoinInCache(txin.prevout)) {
+                    coinsPrefetchStats.nHits++;
+                    continue;
+                }
+                vOutpoints.push_back(txin.prevout);
+            }
+        }
+        setBlockTxids.insert(tx->GetHash());
+    }
+    coinsPrefetchStats.nMisses += vOutpoints.size();
+    if (vOutpoints.empty())
+        return;
+
+    // Read them from the backend into a staging area on the prefetch
+    // threads. The cache itself is not thread-safe, so it is only updated
+    // once all reads are done.
+    const CCoinsView* backend = view.GetBackend();
+    std::vector<Coin> vCoins(vOutpoints.size());
+    std::vector<char> vfFound(vOutpoints.size(), 0);
+    {
+        CCheckQueueControl<CCoinsPrefetchCheck> control(nScriptCheckThreads ? &coinsprefetchqueue : NULL);
+        std::vector<CCoinsPrefetchCheck> vChecks;
+        for (size_t i = 0; i < vOutpoints.size(); i += COINS_PREFETCH_BATCH_SIZE) {
+            CCoinsPrefetchCheck check(backend, &vOutpoints[i], std::min(COINS_PREFETCH_BATCH_SIZE, vOutpoints.size() - i), &vCoins[i], &vfFound[i]);
+            if (nScriptCheckThreads) {
+                vChecks.push_back(CCoinsPrefetchCheck());
+                check.swap(vChecks.back());
+            } else {
+                check();
+            }
+        }
+        control.Add(vChecks);
+        control.Wait();
+    }
+
+    for (size_t i = 0; i < vOutpoints.size(); i++) {
+        if (vfFound[i])
+            view.PrefetchCoin(vOutpoints[i], std::move(vCoins[i]));
+    }
+}
+
+CCoinsPrefetchStats GetCoinsPrefetchStats()
+{
+    LOCK(cs_main);
+    return coinsPrefetchStats;
+}
+
 bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bool fCheckMerkleRoot)
 {
     // These are checks that are independent of context.
@@ -3928,7 +4263,7 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, const CB
     return true;
 }
 
-static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fCheckPOW = true)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
@@ -3947,7 +4282,7 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
             return true;
         }
 
-        if (!CheckBlockHeader(block, state))
+        if (!CheckBlockHeader(block, state, fCheckPOW))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
 
         // Get prev block index
@@ -3997,11 +4332,27 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex)
 {
+    // Check the proof of work of the headers we don't know yet in parallel
+    // before taking cs_main. Headers that fail here are checked again below,
+    // so that the usual error and DoS score are reported for them.
+    std::vector<char> vfPoWValid;
+    if (headers.size() > 1) {
+        size_t nFirstUnknown = 0;
+        {
+            LOCK(cs_main);
+            while (nFirstUnknown < headers.size() && mapBlockIndex.count(headers[nFirstUnknown].GetHash()))
+                nFirstUnknown++;
+        }
+        CheckBlockHeadersPoW(headers, nFirstUnknown, vfPoWValid);
+    }
+
     {
         LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
+        for (size_t i = 0; i < headers.size(); i++) {
+            const CBlockHeader& header = headers[i];
             CBlockIndex *pindex = NULL; // Use a temp pindex instead of ppindex to avoid a const_cast
-            if (!AcceptBlockHeader(header, state, chainparams, &pindex)) {
+            const bool fCheckPOW = vfPoWValid.empty() || !vfPoWValid[i];
+            if (!AcceptBlockHeader(header, state, chainparams, &pindex, fCheckPOW)) {
                 return false;
             }
             if (ppindex) {
@@ -4024,7 +4375,8 @@ static bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidation
     CBlockIndex *pindexDummy = NULL;
     CBlockIndex *&pindex = ppindex ? *ppindex : pindexDummy;
 
-    if (!AcceptBlockHeader(block, state, chainparams, &pindex))
+    // The proof of work was checked already if CheckBlock() passed
+    if (!AcceptBlockHeader(block, state, chainparams, &pindex, !block.fChecked))
         return false;
 
     // Try to process all requested blocks that we don't have, but only
@@ -4218,6 +4570,7 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
 {
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         CDiskBlockPos pos(*it, 0);
+        blockfilemap.Forget(*it);
         boost::filesystem::remove(GetBlockPosFilename(pos, "blk"));
         boost::filesystem::remove(GetBlockPosFilename(pos, "rev"));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -4375,6 +4728,12 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
 
     boost::this_thread::interruption_point();
 
+    // The UTXO set may have been loaded from a snapshot of a block we have no history for
+    uint256 hashSnapshotBase;
+    uint64_t nSnapshotChainTx = 0;
+    if (!pcoinsdbview->ReadSnapshotBase(hashSnapshotBase, nSnapshotChainTx))
+        hashSnapshotBase.SetNull();
+
     // Calculate nChainWork
     std::vector<std::pair<int, CBlockIndex*> > vSortedByHeight;
     vSortedByHeight.reserve(mapBlockIndex.size());
@@ -4408,6 +4767,11 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
                 setDirtyBlockIndex.insert(pindex);
             }
         }
+        if (!hashSnapshotBase.IsNull() && pindex->GetBlockHash() == hashSnapshotBase) {
+            pindexSnapshotBase = pindex;
+            if (pindex->nChainTx == 0)
+                pindex->nChainTx = nSnapshotChainTx;
+        }
         if (pindex->IsValid(BLOCK_VALID_TRANSACTIONS) && (pindex->nChainTx || pindex->pprev == NULL))
             setBlockIndexCandidates.insert(pindex);
         if (pindex->nStatus & BLOCK_FAILED_MASK && (!pindexBestInvalid || pindex->nChainWork > pindexBestInvalid->nChainWork))
@@ -4420,6 +4784,7 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
 
     // Load block file info
     pblocktree->ReadLastBlockFile(nLastBlockFile);
+    blockfilemap.SetFinalizedFiles(nLastBlockFile);
     vinfoBlockFile.resize(nLastBlockFile + 1);
     LogPrintf("%s: last block file = %i\n", __func__, nLastBlockFile);
     for (int nFile = 0; nFile <= nLastBlockFile; nFile++) {
@@ -4463,10 +4828,6 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     pblocktree->ReadReindexing(fReindexing);
     fReindex |= fReindexing;
 
-    // Check whether we have a transaction index
-    pblocktree->ReadFlag("txindex", fTxIndex);
-    LogPrintf("%s: transaction index %s\n", __func__, fTxIndex ? "enabled" : "disabled");
-
     // Load pointer to end of best chain
     BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
     if (it == mapBlockIndex.end())
@@ -4525,9 +4886,9 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
         uiInterface.ShowProgress(_("Verifying blocks..."), percentageDone);
         if (pindex->nHeight < chainActive.Height()-nCheckDepth)
             break;
-        if (fPruneMode && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
-            // If pruning, only go back as far as we have data.
-            LogPrintf("VerifyDB(): block verification stopping at height %d (pruning, no data)\n", pindex->nHeight);
+        if ((fPruneMode || pindexSnapshotBase) && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
+            // If pruning or after loading a UTXO set snapshot, only go back as far as we have data.
+            LogPrintf("VerifyDB(): block verification stopping at height %d (%s, no data)\n", pindex->nHeight, fPruneMode ? "pruning" : "snapshot");
             break;
         }
         CBlock block;
@@ -4680,10 +5041,14 @@ void UnloadBlockIndex()
     chainActive.SetTip(NULL);
     pindexBestInvalid = NULL;
     pindexBestHeader = NULL;
+    pindexSnapshotBase = NULL;
+    fHaveRollingCoinsStats = false;
+    fAddressIndexSynced = false;
     mempool.clear();
     mapBlocksUnlinked.clear();
     vinfoBlockFile.clear();
     nLastBlockFile = 0;
+    blockfilemap.SetFinalizedFiles(0);
     nBlockSequenceId = 1;
     setDirtyBlockIndex.clear();
     gFailedBlocks.clear();
@@ -4697,6 +5062,7 @@ void UnloadBlockIndex()
         delete entry.second;
     }
     mapBlockIndex.clear();
+    auxpowstore.Clear();
     fHavePruned = false;
 }
 
@@ -4712,13 +5078,13 @@ bool InitBlockIndex(const CChainParams& chainparams)
 {
     LOCK(cs_main);
 
+    // Pick up the rolling statistics of the UTXO set if they were stored with its best block
+    fHaveRollingCoinsStats = pcoinsdbview->ReadRollingStats(rollingCoinsStats);
+
     // Check whether we're already initialized
     if (chainActive.Genesis() != NULL)
         return true;
 
-    // Use the provided setting for -txindex in the new database
-    fTxIndex = GetBoolArg("-txindex", DEFAULT_TXINDEX);
-    pblocktree->WriteFlag("txindex", fTxIndex);
     LogPrintf("Initializing databases...\n");
 
     // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
@@ -4746,6 +5112,210 @@ bool InitBlockIndex(const CChainParams& chainparams)
     return true;
 }
 
+bool CImportBlockCheck::operator()()
+{
+    for (size_t i = 0; i < nCount; i++) {
+        CImportedBlock& imported = pblocks[i];
+        try {
+            std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+            CSpanReader(SER_DISK, CLIENT_VERSION, imported.vData.data(), imported.vData.data() + imported.vData.size()) >> *pblock;
+            CValidationState state;
+            CheckBlock(*pblock, state);
+            imported.pblock = pblock;
+        } catch (const std::exception&) {
+            // Reported by the caller
+        }
+        std::vector<unsigned char>().swap(imported.vData);
+    }
+    return true;
+}
+
+namespace {
+
+/** Time spent in each stage of a block file import, for the debug log. */
+struct CImportStats
+{
+    uint64_t nBytes;
+    uint64_t nBlocks;
+    int64_t nScanTime;
+    int64_t nCheckTime;
+    int64_t nAcceptTime;
+    int64_t nConnectTime;
+
+    CImportStats() : nBytes(0), nBlocks(0), nScanTime(0), nCheckTime(0), nAcceptTime(0), nConnectTime(0) {}
+};
+
+/**
+ * The first two stages of a block file import, run on a thread of their
+ * own: find the blocks in the file, then deserialize and check batches of
+ * them on the import check threads. Checked batches are handed to the
+ * importing thread in file order, which accepts and connects them while
+ * the next batches are being read and checked.
+ */
+class CBlockFileScanner
+{
+private:
+    const CChainParams& chainparams;
+    FILE* fileIn;
+
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    std::deque<std::vector<CImportedBlock> > queue;
+    bool fDone;
+    std::atomic<bool> fAbort;
+    CImportStats& stats;
+    std::string& strError;
+    boost::thread thread;
+
+    void Check(std::vector<CImportedBlock>& vBlocks);
+    void Run();
+
+public:
+    /** stats and strError (set if the scan ended early) are written to
+     *  until the scanner is destroyed. */
+    CBlockFileScanner(const CChainParams& chainparamsIn, FILE* fileInIn, CImportStats& statsIn, std::string& strErrorIn) :
+        chainparams(chainparamsIn), fileIn(fileInIn), fDone(false), fAbort(false), stats(statsIn), strError(strErrorIn)
+    {
+        thread = boost::thread(&CBlockFileScanner::Run, this);
+    }
+
+    ~CBlockFileScanner()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            fAbort = true;
+        }
+        cond.notify_all();
+        thread.join();
+    }
+
+    /** Wait for the next batch of blocks. Returns false once the whole file was handed out. */
+    bool Next(std::vector<CImportedBlock>& vBlocks)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while (queue.empty() && !fDone)
+            cond.wait(lock);
+        if (queue.empty())
+            return false;
+        vBlocks = std::move(queue.front());
+        queue.pop_front();
+        cond.notify_all();
+        return true;
+    }
+};
+
+void CBlockFileScanner::Check(std::vector<CImportedBlock>& vBlocks)
+{
+    CCheckQueueControl<CImportBlockCheck> control(nScriptCheckThreads ? &importcheckqueue : NULL);
+    std::vector<CImportBlockCheck> vChecks;
+    for (size_t i = 0; i < vBlocks.size(); i += IMPORT_CHECK_BATCH_SIZE) {
+        CImportBlockCheck check(&vBlocks[i], std::min(IMPORT_CHECK_BATCH_SIZE, vBlocks.size() - i));
+        if (nScriptCheckThreads) {
+            vChecks.push_back(CImportBlockCheck());
+            check.swap(vChecks.back());
+        } else {
+            check();
+        }
+    }
+    control.Add(vChecks);
+    control.Wait();
+}
+
+void CBlockFileScanner::Run()
+{
+    RenameThread("dogecoin-loadscan");
+    try {
+        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor.
+        // After a block fails to deserialize, the scan restarts right after its message
+        // start, which can be up to a whole batch back.
+        CBufferedFile blkdat(fileIn, 2*IMPORT_MAX_REWIND, IMPORT_MAX_REWIND, SER_DISK, CLIENT_VERSION);
+        uint64_t nRewind = blkdat.GetPos();
+        bool fEnd = false;
+        while (!fEnd && !fAbort) {
+            // Find a batch of blocks
+            int64_t nTimeStart = GetTimeMicros();
+            std::vector<CImportedBlock> vBlocks;
+            uint64_t nBatchSize = 0;
+            while (vBlocks.size() < IMPORT_BATCH_BLOCKS && nBatchSize < IMPORT_BATCH_SIZE && !fAbort) {
+                if (blkdat.eof()) {
+                    fEnd = true;
+                    break;
+                }
+                blkdat.SetPos(nRewind);
+                nRewind++; // start one byte further next time, in case of failure
+                blkdat.SetLimit(); // remove former limit
+                unsigned int nSize = 0;
+                uint64_t nHeaderPos = 0;
+                try {
+                    // locate a header
+                    unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
+                    blkdat.FindByte(chainparams.MessageStart()[0]);
+                    nHeaderPos = blkdat.GetPos();
+                    nRewind = nHeaderPos + 1;
+                    blkdat >> FLATDATA(buf);
+                    if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
+                        continue;
+                    // read size
+                    blkdat >> nSize;
+                    if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
+                        continue;
+                } catch (const std::exception&) {
+                    // no valid block header found; don't complain
+                    fEnd = true;
+                    break;
+                }
+                try {
+                    // read block
+                    CImportedBlock imported;
+                    imported.nHeaderPos = nHeaderPos;
+                    imported.nPos = blkdat.GetPos();
+                    blkdat.SetLimit(imported.nPos + nSize);
+                    imported.vData.resize(nSize);
+                    blkdat.read((char*)imported.vData.data(), nSize);
+                    nRewind = blkdat.GetPos();
+                    nBatchSize += nSize;
+                    vBlocks.push_back(std::move(imported));
+                } catch (const std::exception& e) {
+                    LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+                }
+            }
+            stats.nScanTime += GetTimeMicros() - nTimeStart;
+            if (vBlocks.empty())
+                continue;
+
+            // Deserialize and check them in parallel
+            nTimeStart = GetTimeMicros();
+            Check(vBlocks);
+            stats.nCheckTime += GetTimeMicros() - nTimeStart;
+            for (size_t i = 0; i < vBlocks.size(); i++) {
+                if (!vBlocks[i].pblock) {
+                    // Another block may start inside the bytes taken for this one
+                    LogPrintf("%s: Deserialize error in block at position %u\n", __func__, vBlocks[i].nPos);
+                    nRewind = vBlocks[i].nHeaderPos + 1;
+                    vBlocks.resize(i);
+                    fEnd = false;
+                    break;
+                }
+                stats.nBytes += ::GetSerializeSize(*vBlocks[i].pblock, SER_DISK, CLIENT_VERSION);
+            }
+            stats.nBlocks += vBlocks.size();
+
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (queue.size() >= IMPORT_BATCHES_QUEUED && !fAbort)
+                cond.wait(lock);
+            queue.push_back(std::move(vBlocks));
+            cond.notify_all();
+        }
+    } catch (const std::runtime_error& e) {
+        strError = e.what();
+    }
+    boost::unique_lock<boost::mutex> lock(mutex);
+    fDone = true;
+    cond.notify_all();
+}
+
+}
+
 bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp)
 {
     // Map of disk positions for blocks with unknown parent (only used for reindex)
@@ -4753,114 +5323,113 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
     int64_t nStart = GetTimeMillis();
 
     int nLoaded = 0;
-    try {
-        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE+8, SER_DISK, CLIENT_VERSION);
-        uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
-            boost::this_thread::interruption_point();
-
-            blkdat.SetPos(nRewind);
-            nRewind++; // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
-                blkdat.FindByte(chainparams.MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> FLATDATA(buf);
-                if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
-            }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-                CBlock& block = *pblock;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                // detect out of order blocks, and store them for later
-                uint256 hash = block.GetHash();
-                if (hash != chainparams.GetConsensus(0).hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
-                    LogPrint("reindex", "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                            block.hashPrevBlock.ToString());
+    CImportStats stats;
+    std::string strError;
+    {
+        CBlockFileScanner scanner(chainparams, fileIn, stats, strError);
+        std::vector<CImportedBlock> vBlocks;
+        bool fError = false;
+        while (!fError && scanner.Next(vBlocks)) {
+            int64_t nTimeStart = GetTimeMicros();
+            for (const CImportedBlock& imported : vBlocks) {
+                boost::this_thread::interruption_point();
+
+                try {
                     if (dbp)
-                        mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                    continue;
-                }
+                        dbp->nPos = imported.nPos;
+                    std::shared_ptr<CBlock> pblock = imported.pblock;
+                    CBlock& block = *pblock;
+
+                    // detect out of order blocks, and store them for later
+                    uint256 hash = block.GetHash();
+                    if (hash != chainparams.GetConsensus(0).hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
+                        LogPrint("reindex", "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
+                                block.hashPrevBlock.ToString());
+                        if (dbp)
+                            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
+                        continue;
+                    }
 
-                // process in case the block isn't known yet
-                if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
-                    LOCK(cs_main);
-                    CValidationState state;
-                    if (AcceptBlock(pblock, state, chainparams, NULL, true, dbp, NULL))
-                        nLoaded++;
-                    if (state.IsError())
-                        break;
-                } else if (hash != chainparams.GetConsensus(0).hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
-                    LogPrint("reindex", "Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
-                }
+                    // process in case the block isn't known yet
+                    if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
+                        LOCK(cs_main);
+                        CValidationState state;
+                        if (AcceptBlock(pblock, state, chainparams, NULL, true, dbp, NULL))
+                            nLoaded++;
+                        if (state.IsError()) {
+                            fError = true;
+                            break;
+                        }
+                    } else if (hash != chainparams.GetConsensus(0).hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
+                        LogPrint("reindex", "Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
+                    }
 
-                // Activate the genesis block so normal node progress can continue
-                if (hash == chainparams.GetConsensus(0).hashGenesisBlock) {
-                    CValidationState state;
-                    if (!ActivateBestChain(state, chainparams)) {
-                        break;
+                    // Activate the genesis block so normal node progress can continue
+                    if (hash == chainparams.GetConsensus(0).hashGenesisBlock) {
+                        CValidationState state;
+                        if (!ActivateBestChain(state, chainparams)) {
+                            fError = true;
+                            break;
+                        }
                     }
-                }
 
-                NotifyHeaderTip();
-
-                // Recursively process earlier encountered successors of this block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
-                        std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
-                        // TODO: Need a valid consensus height
-                        if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus(0)))
-                        {
-                            LogPrint("reindex", "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
-                                    head.ToString());
-                            LOCK(cs_main);
-                            CValidationState dummy;
-                            if (AcceptBlock(pblockrecursive, dummy, chainparams, NULL, true, &it->second, NULL))
+                    NotifyHeaderTip();
+
+                    // Recursively process earlier encountered successors of this block
+                    std::deque<uint256> queue;
+                    queue.push_back(hash);
+                    while (!queue.empty()) {
+                        uint256 head = queue.front();
+                        queue.pop_front();
+                        std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+                        while (range.first != range.second) {
+                            std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
+                            std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
+                            // TODO: Need a valid consensus height
+                            if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus(0)))
                             {
-                                nLoaded++;
-                                queue.push_back(pblockrecursive->GetHash());
+                                LogPrint("reindex", "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
+                                        head.ToString());
+                                LOCK(cs_main);
+                                CValidationState dummy;
+                                if (AcceptBlock(pblockrecursive, dummy, chainparams, NULL, true, &it->second, NULL))
+                                {
+                                    nLoaded++;
+                                    queue.push_back(pblockrecursive->GetHash());
+                                }
                             }
+                            range.first++;
+                            mapBlocksUnknownParent.erase(it);
+                            NotifyHeaderTip();
                         }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                        NotifyHeaderTip();
                     }
+                } catch (const std::exception& e) {
+                    LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
                 }
-            } catch (const std::exception& e) {
-                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
             }
+            stats.nAcceptTime += GetTimeMicros() - nTimeStart;
+            if (fError)
+                break;
+
+            // Connect the blocks accepted so far, while the next batches are read and checked
+            nTimeStart = GetTimeMicros();
+            CValidationState state;
+            if (!ActivateBestChain(state, chainparams))
+                fError = true;
+            stats.nConnectTime += GetTimeMicros() - nTimeStart;
         }
-    } catch (const std::runtime_error& e) {
-        AbortNode(std::string("System error: ") + e.what());
     }
+    if (!strError.empty())
+        AbortNode(std::string("System error: ") + strError);
     if (nLoaded > 0)
         LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
+    if (stats.nBlocks > 0) {
+        LogPrintf("Block import stages: scan %.2fs (%.1f MiB/s), check %.2fs (%.0f blocks/s), accept %.2fs (%.0f blocks/s), connect %.2fs\n",
+            stats.nScanTime * 0.000001, stats.nScanTime ? stats.nBytes / 1.048576 / stats.nScanTime : 0.0,
+            stats.nCheckTime * 0.000001, stats.nCheckTime ? stats.nBlocks * 1000000.0 / stats.nCheckTime : 0.0,
+            stats.nAcceptTime * 0.000001, stats.nAcceptTime ? stats.nBlocks * 1000000.0 / stats.nAcceptTime : 0.0,
+            stats.nConnectTime * 0.000001);
+    }
     return nLoaded > 0;
 }
 
@@ -4880,6 +5449,12 @@ void static CheckBlockIndex(const Consensus::Params& consensusParams)
         return;
     }
 
+    // The checks below assume that every block of the active chain was connected
+    // at some point, which isn't the case after loading a UTXO set snapshot.
+    if (pindexSnapshotBase) {
+        return;
+    }
+
     // Build forward-pointing map of the entire block tree.
     std::multimap<CBlockIndex*,CBlockIndex*> forward;
     for (BlockMap::iterator it = mapBlockIndex.begin(); it != mapBlockIndex.end(); it++) {
@@ -5187,6 +5762,302 @@ void DumpMempool(void)
     }
 }
 
+bool GetRollingCoinsStats(CCoinsRollingStats& stats)
+{
+    LOCK(cs_main);
+    if (!fHaveRollingCoinsStats || rollingCoinsStats.hashBlock != pcoinsTip->GetBestBlock())
+        return false;
+    stats = rollingCoinsStats;
+    return true;
+}
+
+void SetRollingCoinsStats(const CCoinsRollingStats& stats)
+{
+    LOCK(cs_main);
+    if (stats.hashBlock != pcoinsTip->GetBestBlock())
+        return;
+    rollingCoinsStats = stats;
+    fHaveRollingCoinsStats = true;
+}
+
+//! Coins handed to the coin database at once while loading a UTXO set snapshot
+static const size_t UTXO_SNAPSHOT_LOAD_COINS = 100000;
+
+/** Read the unspent outputs of one transaction from a UTXO set snapshot. */
+static void ReadSnapshotCoins(CAutoFile& file, uint64_t nMaxOutputs, uint256& txid, std::map<uint32_t, Coin>& outputs)
+{
+    outputs.clear();
+    uint64_t nOutputs = 0;
+    file >> txid;
+    file >> VARINT(nOutputs);
+    if (nOutputs == 0 || nOutputs > nMaxOutputs)
+        throw std::ios_base::failure("bad number of outputs");
+    for (uint64_t i = 0; i < nOutputs; i++) {
+        uint32_t n = 0;
+        Coin coin;
+        file >> VARINT(n);
+        file >> coin;
+        if (coin.IsSpent() || (!outputs.empty() && n <= outputs.rbegin()->first))
+            throw std::ios_base::failure("bad output");
+        outputs.emplace_hint(outputs.end(), n, std::move(coin));
+    }
+}
+
+/**
+ * Read the coins of a UTXO set snapshot, which follow its metadata, and
+ * check them against the commitment in the metadata. fnCoins is called for
+ * the outputs of each transaction, and may take them.
+ */
+static bool ReadUTXOSnapshot(CAutoFile& file, const CUTXOSnapshotMetadata& metadata, const std::function<bool(const uint256&, std::map<uint32_t, Coin>&)>& fnCoins, std::string& strError)
+{
+    CCoinsStats stats;
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << metadata.hashBlock;
+    uint256 txid, txidPrev;
+    std::map<uint32_t, Coin> outputs;
+    try {
+        while (stats.nTransactionOutputs < metadata.nCoins) {
+            boost::this_thread::interruption_point();
+            ReadSnapshotCoins(file, metadata.nCoins - stats.nTransactionOutputs, txid, outputs);
+            if (stats.nTransactions > 0 && !(txidPrev < txid))
+                throw std::ios_base::failure("transactions out of order");
+            ApplyCoinsStats(stats, ss, txid, outputs);
+            if (!fnCoins(txid, outputs))
+                return false;
+            txidPrev = txid;
+        }
+    } catch (const std::ios_base::failure& e) {
+        strError = strprintf("Invalid UTXO set snapshot: %s", e.what());
+        return false;
+    }
+    if (fgetc(file.Get()) != EOF) {
+        strError = "Invalid UTXO set snapshot: unexpected data after the coins";
+        return false;
+    }
+    if (ss.GetHash() != metadata.hashSerialized) {
+        strError = strprintf("The UTXO set snapshot does not match its commitment %s", metadata.hashSerialized.GetHex());
+        return false;
+    }
+    return true;
+}
+
+/** Find the block a UTXO set snapshot was taken at, and check that it can become the new tip. */
+static CBlockIndex* FindSnapshotBase(const CUTXOSnapshotMetadata& metadata, std::string& strError)
+{
+    AssertLockHeld(cs_main);
+    BlockMap::iterator mi = mapBlockIndex.find(metadata.hashBlock);
+    if (mi == mapBlockIndex.end()) {
+        strError = strprintf("The UTXO set snapshot was taken at block %s, whose header is not known yet", metadata.hashBlock.GetHex());
+        return NULL;
+    }
+    CBlockIndex* pindex = mi->second;
+    if (pindex->nStatus & BLOCK_FAILED_MASK) {
+        strError = strprintf("The UTXO set snapshot was taken at block %s, which is invalid", metadata.hashBlock.GetHex());
+        return NULL;
+    }
+    if (pindex->nHeight != metadata.nHeight || (pindex->nChainTx != 0 && pindex->nChainTx != metadata.nChainTx)) {
+        strError = "The metadata of the UTXO set snapshot does not match its block";
+        return NULL;
+    }
+    if (chainActive.Tip() && pindex->nChainWork < chainActive.Tip()->nChainWork) {
+        strError = "The UTXO set snapshot is behind the active chain";
+        return NULL;
+    }
+    return pindex;
+}
+
+bool DumpUTXOSnapshot(const boost::filesystem::path& path, CUTXOSnapshotMetadata& metadata, std::string& strError)
+{
+    int64_t nStart = GetTimeMicros();
+
+    std::unique_ptr<CCoinsViewCursor> pcursor;
+    {
+        LOCK(cs_main);
+        FlushStateToDisk();
+        pcursor.reset(pcoinsdbview->Cursor());
+        CBlockIndex* pindex = mapBlockIndex.find(pcursor->GetBestBlock())->second;
+        metadata.hashBlock = pindex->GetBlockHash();
+        metadata.nHeight = pindex->nHeight;
+        metadata.nChainTx = pindex->nChainTx;
+    }
+    memcpy(metadata.pchMessageStart, Params().MessageStart(), sizeof(metadata.pchMessageStart));
+
+    boost::filesystem::path pathTmp = path.string() + ".incomplete";
+    FILE* filestr = fopen(pathTmp.string().c_str(), "wb");
+    if (!filestr) {
+        strError = strprintf("Unable to open %s for writing", pathTmp.string());
+        return false;
+    }
+    CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+    try {
+        // Written again once the number of coins and their hash are known
+        file << metadata;
+
+        CCoinsStats stats;
+        CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+        ss << metadata.hashBlock;
+        uint256 prevkey;
+        std::map<uint32_t, Coin> outputs;
+        auto writeCoins = [&]() {
+            ApplyCoinsStats(stats, ss, prevkey, outputs);
+            uint64_t nOutputs = outputs.size();
+            file << prevkey;
+            file << VARINT(nOutputs);
+            for (const auto& output : outputs) {
+                uint32_t n = output.first;
+                file << VARINT(n);
+                file << output.second;
+            }
+            outputs.clear();
+        };
+        while (pcursor->Valid()) {
+            boost::this_thread::interruption_point();
+            COutPoint key;
+            Coin coin;
+            if (!pcursor->GetKey(key) || !pcursor->GetValue(coin))
+                throw std::runtime_error("unable to read coin database");
+            if (!outputs.empty() && key.hash != prevkey)
+                writeCoins();
+            prevkey = key.hash;
+            outputs[key.n] = std::move(coin);
+            pcursor->Next();
+        }
+        if (!outputs.empty())
+            writeCoins();
+
+        metadata.nCoins = stats.nTransactionOutputs;
+        metadata.hashSerialized = ss.GetHash();
+        if (fseek(file.Get(), 0, SEEK_SET) != 0)
+            throw std::runtime_error("unable to seek");
+        file << metadata;
+        FileCommit(file.Get());
+        file.fclose();
+        if (!RenameOver(pathTmp, path))
+            throw std::runtime_error(strprintf("unable to rename to %s", path.string()));
+    } catch (const std::exception& e) {
+        file.fclose();
+        boost::system::error_code ec;
+        boost::filesystem::remove(pathTmp, ec);
+        strError = strprintf("Failed to dump UTXO set: %s", e.what());
+        return false;
+    }
+    LogPrintf("Dumped %u coins at block %s to %s in %.2fs\n", metadata.nCoins, metadata.hashBlock.ToString(), path.string(), (GetTimeMicros() - nStart) * 0.000001);
+    return true;
+}
+
+bool LoadUTXOSnapshot(const boost::filesystem::path& path, const uint256& hashExpected, CUTXOSnapshotMetadata& metadata, std::string& strError)
+{
+    int64_t nStart = GetTimeMicros();
+    const CChainParams& chainparams = Params();
+
+    if (fAddressIndex) {
+        // The address index could not be built for the blocks below the snapshot
+        strError = "Loading a UTXO set snapshot is not supported with -addressindex";
+        return false;
+    }
+
+    FILE* filestr = fopen(path.string().c_str(), "rb");
+    if (!filestr) {
+        strError = strprintf("Unable to open %s", path.string());
+        return false;
+    }
+    CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+    try {
+        file >> metadata;
+    } catch (const std::exception& e) {
+        strError = strprintf("Invalid UTXO set snapshot: %s", e.what());
+        return false;
+    }
+    if (memcmp(metadata.pchMessageStart, chainparams.MessageStart(), sizeof(metadata.pchMessageStart))) {
+        strError = "The UTXO set snapshot was taken on a different network";
+        return false;
+    }
+    if (!hashExpected.IsNull() && metadata.hashSerialized != hashExpected) {
+        strError = strprintf("The UTXO set snapshot commits to %s instead of %s", metadata.hashSerialized.GetHex(), hashExpected.GetHex());
+        return false;
+    }
+    {
+        LOCK(cs_main);
+        if (!FindSnapshotBase(metadata, strError))
+            return false;
+    }
+
+    // Check the whole snapshot against its commitment before touching the chainstate
+    long nCoinsPos = ftell(file.Get());
+    if (nCoinsPos < 0 || !ReadUTXOSnapshot(file, metadata, [](const uint256&, std::map<uint32_t, Coin>&) { return true; }, strError))
+        return false;
+    int64_t nVerified = GetTimeMicros();
+
+    LOCK(cs_main);
+    CBlockIndex* pindex = FindSnapshotBase(metadata, strError);
+    if (!pindex)
+        return false;
+    FlushStateToDisk();
+    mempool.clear();
+    if (fseek(file.Get(), nCoinsPos, SEEK_SET) != 0) {
+        strError = "Unable to seek in the UTXO set snapshot";
+        return false;
+    }
+
+    // The coins are stored in the same order as in the database, so they are
+    // written in large sorted batches.
+    std::vector<std::pair<COutPoint, Coin> > vCoins;
+    vCoins.reserve(UTXO_SNAPSHOT_LOAD_COINS);
+    CCoinsRollingStats statsLoaded;
+    statsLoaded.hashBlock = metadata.hashBlock;
+    fHaveRollingCoinsStats = false;
+    bool fWriteError = !pcoinsdbview->BeginSnapshotLoad(metadata.hashBlock);
+    bool fLoaded = !fWriteError && ReadUTXOSnapshot(file, metadata, [&](const uint256& txid, std::map<uint32_t, Coin>& outputs) {
+        for (auto& output : outputs) {
+            COutPoint outpoint(txid, output.first);
+            statsLoaded.AddCoin(outpoint, output.second);
+            vCoins.emplace_back(outpoint, std::move(output.second));
+        }
+        if (vCoins.size() >= UTXO_SNAPSHOT_LOAD_COINS) {
+            fWriteError = !pcoinsdbview->WriteSnapshotCoins(vCoins);
+            vCoins.clear();
+        }
+        return !fWriteError;
+    }, strError);
+    if (fLoaded) {
+        fWriteError = !pcoinsdbview->WriteSnapshotCoins(vCoins) ||
+                      !pcoinsdbview->FinishSnapshotLoad(metadata.hashBlock, metadata.nChainTx);
+        fLoaded = !fWriteError;
+    }
+    if (!fLoaded) {
+        // The coin database was partially overwritten and stays marked as such
+        if (fWriteError)
+            strError = "Failed to write to coin database";
+        AbortNode(strprintf("Loading UTXO set snapshot failed: %s", strError), _("Loading the UTXO set snapshot failed. You need to rebuild the database using -reindex-chainstate."));
+        return false;
+    }
+
+    // Make the snapshot block the tip. The blocks before it aren't needed to
+    // connect the blocks after it.
+    pcoinsTip->SetBestBlock(metadata.hashBlock);
+    CBlockIndex* pindexOldTip = chainActive.Tip();
+    if (pindex->nChainTx == 0)
+        pindex->nChainTx = metadata.nChainTx;
+    if (pindex->RaiseValidity(BLOCK_VALID_SCRIPTS))
+        setDirtyBlockIndex.insert(pindex);
+    pindexSnapshotBase = pindex;
+    rollingCoinsStats = statsLoaded;
+    fHaveRollingCoinsStats = true;
+    chainActive.SetTip(pindex);
+    setBlockIndexCandidates.insert(pindex);
+    PruneBlockIndexCandidates();
+    FlushStateToDisk();
+
+    LogPrintf("Loaded %u coins from UTXO set snapshot %s in %.2fs (%.2fs to verify): new best=%s height=%d\n",
+        metadata.nCoins, path.string(), (GetTimeMicros() - nStart) * 0.000001, (nVerified - nStart) * 0.000001,
+        pindex->GetBlockHash().ToString(), pindex->nHeight);
+
+    bool fInitialDownload = IsInitialBlockDownload();
+    GetMainSignals().UpdatedBlockTip(pindex, chainActive.FindFork(pindexOldTip), fInitialDownload);
+    uiInterface.NotifyBlockTip(fInitialDownload, pindex);
+    return true;
+}
+
 //! Guess how far we are in the verification process at the given block index
 double GuessVerificationProgress(const ChainTxData& data, CBlockIndex *pindex) {
     if (pindex == NULL)
@@ -34,8 +34,12 @@
 #include <boost/unordered_map.hpp>
 #include <boost/filesystem/path.hpp>
 
+class CAddressIndexBatch;
 class CBlockIndex;
 class CBlockTreeDB;
+class CBlockUndo;
+class CCoinsRollingStats;
+class CCoinsViewDB;
 class CBloomFilter;
 class CChainParams;
 class CInv;
@@ -175,7 +179,7 @@ extern CConditionVariable cvBlockChange;
 extern std::atomic_bool fImporting;
 extern bool fReindex;
 extern int nScriptCheckThreads;
-extern bool fTxIndex;
+extern bool fAddressIndex;
 extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
@@ -273,6 +277,12 @@ bool LoadBlockIndex(const CChainParams& chainparams);
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the header proof-of-work checking thread */
+void ThreadHeaderCheck();
+/** Run an instance of the coins prefetching thread */
+void ThreadCoinsPrefetch();
+/** Run an instance of the block import checking thread */
+void ThreadImportCheck();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Format a string that describes several potential problems detected by the core.
@@ -460,8 +470,8 @@ private:
 
 public:
     CScriptCheck(): amount(0), ptxTo(0), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR), chainSigVersion(CHAINSIG_VERSION_LATEST) {}
-    CScriptCheck(const CCoins& txFromIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn, PrecomputedTransactionData* txdataIn, ChainSigVersion chainSigVersionIn = CHAINSIG_VERSION_LATEST):
-        scriptPubKey(txFromIn.vout[txToIn.vin[nInIn].prevout.n].scriptPubKey), amount(txFromIn.vout[txToIn.vin[nInIn].prevout.n].nValue),
+    CScriptCheck(const CTxOut& outIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn, PrecomputedTransactionData* txdataIn, ChainSigVersion chainSigVersionIn = CHAINSIG_VERSION_LATEST):
+        scriptPubKey(outIn.scriptPubKey), amount(outIn.nValue),
         ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(txdataIn), chainSigVersion(chainSigVersionIn) { }
 
     bool operator()();
@@ -481,12 +491,141 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure representing the proof-of-work check of a run of block headers.
+ * The scrypt hashes of the non-auxpow headers in the run are computed as a
+ * single batch; the result for each header is written to pfValid.
+ */
+class CHeaderPoWCheck
+{
+private:
+    const CBlockHeader *pheaders;
+    size_t nCount;
+    char *pfValid;
+
+public:
+    CHeaderPoWCheck(): pheaders(NULL), nCount(0), pfValid(NULL) {}
+    CHeaderPoWCheck(const CBlockHeader* pheadersIn, size_t nCountIn, char* pfValidIn):
+        pheaders(pheadersIn), nCount(nCountIn), pfValid(pfValidIn) { }
+
+    bool operator()();
+
+    void swap(CHeaderPoWCheck &check) {
+        std::swap(pheaders, check.pheaders);
+        std::swap(nCount, check.nCount);
+        std::swap(pfValid, check.pfValid);
+    }
+};
+
+/**
+ * Check the proof of work of headers[nStart..] on the header check threads.
+ * vfValid is resized to headers.size(); entries are set to 1 for headers
+ * whose proof of work is valid and 0 otherwise (or before nStart).
+ */
+void CheckBlockHeadersPoW(const std::vector<CBlockHeader>& headers, size_t nStart, std::vector<char>& vfValid);
+
+/**
+ * Closure representing the lookup of a run of outpoints in a coins view.
+ * Coins that are found are moved into pcoins and flagged in pfFound. The
+ * view is only read from, so several of these can run concurrently against
+ * a view that supports concurrent reads (such as CCoinsViewDB).
+ */
+class CCoinsPrefetchCheck
+{
+private:
+    const CCoinsView *view;
+    const COutPoint *poutpoints;
+    size_t nCount;
+    Coin *pcoins;
+    char *pfFound;
+
+public:
+    CCoinsPrefetchCheck(): view(NULL), poutpoints(NULL), nCount(0), pcoins(NULL), pfFound(NULL) {}
+    CCoinsPrefetchCheck(const CCoinsView* viewIn, const COutPoint* poutpointsIn, size_t nCountIn, Coin* pcoinsIn, char* pfFoundIn):
+        view(viewIn), poutpoints(poutpointsIn), nCount(nCountIn), pcoins(pcoinsIn), pfFound(pfFoundIn) { }
+
+    bool operator()();
+
+    void swap(CCoinsPrefetchCheck &check) {
+        std::swap(view, check.view);
+        std::swap(poutpoints, check.poutpoints);
+        std::swap(nCount, check.nCount);
+        std::swap(pcoins, check.pcoins);
+        std::swap(pfFound, check.pfFound);
+    }
+};
+
+/** Counters for the coins prefetched ahead of ConnectBlock. */
+struct CCoinsPrefetchStats
+{
+    //! Inputs whose coin was already in the cache
+    uint64_t nHits;
+    //! Inputs whose coin had to be read from the backing view
+    uint64_t nMisses;
+
+    CCoinsPrefetchStats() : nHits(0), nMisses(0) {}
+};
+
+/**
+ * Warm view with the coins spent by block. The coins missing from the cache
+ * are read from the view's backend on the prefetch threads and then added to
+ * the cache as unmodified entries, so ConnectBlock is served from memory.
+ * The backend must support concurrent reads.
+ */
+void PrefetchBlockInputs(const CBlock& block, CCoinsViewCache& view);
+
+/** Return the prefetch counters accumulated since startup. */
+CCoinsPrefetchStats GetCoinsPrefetchStats();
+
+/** A block found in a block file by LoadExternalBlockFile. */
+struct CImportedBlock
+{
+    //! Position of the message start in front of the block
+    uint64_t nHeaderPos;
+    //! Position of the block data
+    uint64_t nPos;
+    //! The block as stored; released once it is deserialized
+    std::vector<unsigned char> vData;
+    //! The deserialized block, or NULL if it couldn't be deserialized
+    std::shared_ptr<CBlock> pblock;
+
+    CImportedBlock() : nHeaderPos(0), nPos(0) {}
+};
+
+/**
+ * Closure representing the deserialization and context-free checks of a
+ * run of imported blocks. Blocks that pass CheckBlock() (which includes
+ * the proof of work) are marked as checked, so accepting them later under
+ * cs_main does not check them again. Blocks that fail are left for
+ * AcceptBlock() to reject with the usual error.
+ */
+class CImportBlockCheck
+{
+private:
+    CImportedBlock *pblocks;
+    size_t nCount;
+
+public:
+    CImportBlockCheck(): pblocks(NULL), nCount(0) {}
+    CImportBlockCheck(CImportedBlock* pblocksIn, size_t nCountIn): pblocks(pblocksIn), nCount(nCountIn) {}
+
+    bool operator()();
+
+    void swap(CImportBlockCheck &check) {
+        std::swap(pblocks, check.pblocks);
+        std::swap(nCount, check.nCount);
+    }
+};
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams, bool fCheckPOW = true);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams, bool fCheckPOW = true);
+/** Read the undo data of a block, which must have been connected before. */
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
 bool ReadBlockHeaderFromDisk(CBlockHeader& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams, bool fCheckPOW = true);
+/** Read a block as it is stored on disk (network serialization with witness data), without deserializing it. */
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -502,15 +641,21 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, const CB
 
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins.
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
- *  can fail if those validity checks fail (among other reasons). */
+ *  can fail if those validity checks fail (among other reasons). If pstats is
+ *  given, the rolling statistics are updated once the block connected. If
+ *  paddressindex is given, the changes to the address index are added to it. */
 bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& coins,
-                  const CChainParams& chainparams, bool fJustCheck = false);
+                  const CChainParams& chainparams, bool fJustCheck = false, CCoinsRollingStats* pstats = NULL,
+                  CAddressIndexBatch* paddressindex = NULL);
 
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
  *  In case pfClean is provided, operation will try to be tolerant about errors, and *pfClean
  *  will be true if no problems were found. Otherwise, the return value will be false in case
- *  of problems. Note that in any case, coins may be modified. */
-bool DisconnectBlock(const CBlock& block, CValidationState& state, const CBlockIndex* pindex, CCoinsViewCache& coins, bool* pfClean = NULL);
+ *  of problems. Note that in any case, coins may be modified. If pstats is given, the
+ *  rolling statistics are updated if no problems were found. If paddressindex is
+ *  given, the changes to the address index are added to it. */
+bool DisconnectBlock(const CBlock& block, CValidationState& state, const CBlockIndex* pindex, CCoinsViewCache& coins, bool* pfClean = NULL,
+                     CCoinsRollingStats* pstats = NULL, CAddressIndexBatch* paddressindex = NULL);
 
 /** Check a block is completely valid from start to finish (only works on top of our current best block, with cs_main held) */
 bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams, const CBlock& block, CBlockIndex* pindexPrev, bool fCheckPOW = true, bool fCheckMerkleRoot = true);
@@ -556,6 +701,9 @@ extern CChain chainActive;
 /** Global variable that points to the active CCoinsView (protected by cs_main) */
 extern CCoinsViewCache *pcoinsTip;
 
+/** Global variable that points to the coin database pcoinsTip is backed by (protected by cs_main) */
+extern CCoinsViewDB *pcoinsdbview;
+
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern CBlockTreeDB *pblocktree;
 
@@ -566,6 +714,15 @@ extern CBlockTreeDB *pblocktree;
  */
 int GetSpendHeight(const CCoinsViewCache& inputs);
 
+/** Whether a P2PKH output paying to the given key id may no longer be spent at nHeight. */
+bool isBlacklisted(const uint160& keyID, const CChainParams& chainParams, int nHeight);
+
+/**
+ * Whether any input of tx spends a P2PKH output paying to a blacklisted
+ * address. All inputs of tx must be available in inputs.
+ */
+bool HasBlacklistedInput(const CTransaction& tx, const CCoinsViewCache& inputs, const CChainParams& chainParams, int nHeight);
+
 extern VersionBitsCache versionbitscache;
 
 /**
@@ -594,4 +751,77 @@ void DumpMempool();
 /** Load the mempool from disk. */
 bool LoadMempool();
 
+/** Get the rolling statistics of the UTXO set at the tip, if they are known. */
+bool GetRollingCoinsStats(CCoinsRollingStats& stats);
+
+/**
+ * Start maintaining rolling statistics from ones computed by a full scan of
+ * the UTXO set. Ignored unless they are at the tip.
+ */
+void SetRollingCoinsStats(const CCoinsRollingStats& stats);
+
+/** Magic bytes at the start of a UTXO set snapshot */
+static const unsigned char UTXO_SNAPSHOT_MAGIC[] = {'u', 't', 'x', 'o', 0xff};
+/** Format version of the UTXO set snapshots written by DumpUTXOSnapshot() */
+static const uint16_t UTXO_SNAPSHOT_VERSION = 1;
+
+/**
+ * Header of a UTXO set snapshot file. It is followed by the coins, grouped
+ * by transaction in txid order: the txid, the number of its unspent outputs
+ * and, in order, the index and the coin of each of those outputs.
+ */
+class CUTXOSnapshotMetadata
+{
+public:
+    //! Network the snapshot was taken on
+    CMessageHeader::MessageStartChars pchMessageStart;
+    //! Block the snapshot was taken at
+    uint256 hashBlock;
+    int nHeight;
+    //! Number of transactions in the chain up to and including that block
+    uint64_t nChainTx;
+    uint64_t nCoins;
+    //! The hash_serialized of gettxoutsetinfo at that block
+    uint256 hashSerialized;
+
+    CUTXOSnapshotMetadata() : nHeight(0), nChainTx(0), nCoins(0)
+    {
+        memset(pchMessageStart, 0, sizeof(pchMessageStart));
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        s.write((const char*)UTXO_SNAPSHOT_MAGIC, sizeof(UTXO_SNAPSHOT_MAGIC));
+        s << UTXO_SNAPSHOT_VERSION;
+        s.write((const char*)pchMessageStart, sizeof(pchMessageStart));
+        s << hashBlock << nHeight << nChainTx << nCoins << hashSerialized;
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        unsigned char magic[sizeof(UTXO_SNAPSHOT_MAGIC)];
+        s.read((char*)magic, sizeof(magic));
+        if (memcmp(magic, UTXO_SNAPSHOT_MAGIC, sizeof(magic)))
+            throw std::ios_base::failure("not a UTXO set snapshot");
+        uint16_t nVersion = 0;
+        s >> nVersion;
+        if (nVersion != UTXO_SNAPSHOT_VERSION)
+            throw std::ios_base::failure("unsupported UTXO set snapshot version");
+        s.read((char*)pchMessageStart, sizeof(pchMessageStart));
+        s >> hashBlock >> nHeight >> nChainTx >> nCoins >> hashSerialized;
+    }
+};
+
+/** Write the UTXO set at the current tip to a snapshot file. */
+bool DumpUTXOSnapshot(const boost::filesystem::path& path, CUTXOSnapshotMetadata& metadata, std::string& strError);
+
+/**
+ * Replace the UTXO set by the one of a snapshot file, and make the block it
+ * was taken at the new tip. The header of that block has to be known. The
+ * blocks before it are not needed, but the chain cannot be reorganized to
+ * below it without them. If hashExpected is not null, the snapshot has to
+ * commit to that hash_serialized.
+ */
+bool LoadUTXOSnapshot(const boost::filesystem::path& path, const uint256& hashExpected, CUTXOSnapshotMetadata& metadata, std::string& strError);
+
 #endif // BITCOIN_VALIDATION_H